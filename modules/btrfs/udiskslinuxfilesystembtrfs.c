@@ -54,6 +54,9 @@ struct _UDisksLinuxFilesystemBTRFS {
 
   UDisksLinuxModuleBTRFS *module;
   UDisksLinuxBlockObject *block_object;
+
+  /* UUID of the filesystem the interface gets updates for */
+  gchar *fs_info_key;
 };
 
 struct _UDisksLinuxFilesystemBTRFSClass {
@@ -134,6 +137,10 @@ udisks_linux_filesystem_btrfs_finalize (GObject *object)
 {
   UDisksLinuxFilesystemBTRFS *l_fs_btrfs = UDISKS_LINUX_FILESYSTEM_BTRFS (object);
 
+  if (l_fs_btrfs->fs_info_key != NULL)
+    udisks_linux_module_btrfs_forget_fs_info (l_fs_btrfs->module, l_fs_btrfs, l_fs_btrfs->fs_info_key);
+  g_free (l_fs_btrfs->fs_info_key);
+
   /* we don't take reference to block_object */
   g_object_unref (l_fs_btrfs->module);
 
@@ -226,58 +233,26 @@ udisks_linux_filesystem_btrfs_get_module (UDisksLinuxFilesystemBTRFS *l_fs_btrfs
 }
 
 /**
- * udisks_linux_filesystem_btrfs_update:
+ * udisks_linux_filesystem_btrfs_set_info:
  * @l_fs_btrfs: A #UDisksLinuxFilesystemBTRFS.
- * @object: The enclosing #UDisksLinuxBlockObject instance.
+ * @info: A #BDBtrfsFilesystemInfo.
  *
- * Updates the interface.
- *
- * Returns: %TRUE if the configuration has changed, %FALSE otherwise.
+ * Updates the interface with @info.
  */
-gboolean
-udisks_linux_filesystem_btrfs_update (UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
-                                      UDisksLinuxBlockObject     *object)
+void
+udisks_linux_filesystem_btrfs_set_info (UDisksLinuxFilesystemBTRFS  *l_fs_btrfs,
+                                        const BDBtrfsFilesystemInfo *info)
 {
   UDisksFilesystemBTRFS *fs_btrfs = UDISKS_FILESYSTEM_BTRFS (l_fs_btrfs);
-  BDBtrfsFilesystemInfo *btrfs_info = NULL;
-  GError *error = NULL;
-  gchar *dev_file = NULL;
-  gboolean rval = FALSE;
-
-  g_return_val_if_fail (UDISKS_IS_LINUX_FILESYSTEM_BTRFS (fs_btrfs), FALSE);
-  g_return_val_if_fail (UDISKS_IS_LINUX_BLOCK_OBJECT (object), FALSE);
-
-  dev_file = udisks_linux_block_object_get_device_file (object);
-  if (! dev_file)
-    {
-      rval = FALSE;
-      goto out;
-    }
-
-  btrfs_info = bd_btrfs_filesystem_info (dev_file, &error);
-
-  if (! btrfs_info)
-    {
-      udisks_critical ("Can't get BTRFS filesystem info for %s", dev_file);
-      rval = FALSE;
-      goto out;
-    }
 
-  /* Update the interface */
-  udisks_filesystem_btrfs_set_label (fs_btrfs, btrfs_info->label);
-  udisks_filesystem_btrfs_set_uuid (fs_btrfs, btrfs_info->uuid);
-  udisks_filesystem_btrfs_set_num_devices (fs_btrfs, btrfs_info->num_devices);
-  udisks_filesystem_btrfs_set_used (fs_btrfs, btrfs_info->used);
+  g_return_if_fail (UDISKS_IS_LINUX_FILESYSTEM_BTRFS (l_fs_btrfs));
+  g_return_if_fail (info != NULL);
 
-out:
+  udisks_filesystem_btrfs_set_label (fs_btrfs, info->label);
+  udisks_filesystem_btrfs_set_uuid (fs_btrfs, info->uuid);
+  udisks_filesystem_btrfs_set_num_devices (fs_btrfs, info->num_devices);
+  udisks_filesystem_btrfs_set_used (fs_btrfs, info->used);
   g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (fs_btrfs));
-  if (btrfs_info)
-    bd_btrfs_filesystem_info_free (btrfs_info);
-  if (error)
-    g_clear_error (&error);
-  g_free (dev_file);
-
-  return rval;
 }
 
 /**
@@ -369,6 +344,9 @@ handle_set_label (UDisksFilesystemBTRFS *fs_btrfs,
 
   udisks_linux_block_object_trigger_uevent_sync (object, UDISKS_DEFAULT_WAIT_TIMEOUT);
 
+  /* Wait for the properties to reflect the change. */
+  udisks_linux_module_btrfs_wait_fs_info (l_fs_btrfs->module, l_fs_btrfs, UDISKS_DEFAULT_WAIT_TIMEOUT);
+
   /* Complete DBus call. */
   udisks_filesystem_btrfs_complete_set_label (fs_btrfs, invocation);
 out:
@@ -435,6 +413,9 @@ btrfs_subvolume_perform_action (UDisksFilesystemBTRFS *fs_btrfs,
 
   udisks_linux_block_object_trigger_uevent_sync (object, UDISKS_DEFAULT_WAIT_TIMEOUT);
 
+  /* Wait for the properties to reflect the change. */
+  udisks_linux_module_btrfs_wait_fs_info (l_fs_btrfs->module, l_fs_btrfs, UDISKS_DEFAULT_WAIT_TIMEOUT);
+
   /* Complete DBus call. */
   g_dbus_method_invocation_return_value (invocation, g_variant_new ("()"));
 
@@ -523,6 +504,9 @@ btrfs_device_perform_action (UDisksFilesystemBTRFS *fs_btrfs,
   udisks_linux_block_object_trigger_uevent_sync (object, UDISKS_DEFAULT_WAIT_TIMEOUT);
   udisks_daemon_util_trigger_uevent_sync (daemon, device, NULL, UDISKS_DEFAULT_WAIT_TIMEOUT);
 
+  /* Wait for the properties to reflect the change. */
+  udisks_linux_module_btrfs_wait_fs_info (l_fs_btrfs->module, l_fs_btrfs, UDISKS_DEFAULT_WAIT_TIMEOUT);
+
   /* Complete DBus call. */
   g_dbus_method_invocation_return_value (invocation, g_variant_new ("()"));
 
@@ -812,6 +796,9 @@ handle_create_snapshot (UDisksFilesystemBTRFS  *fs_btrfs,
       goto out;
     }
 
+  /* Wait for the properties to reflect the change. */
+  udisks_linux_module_btrfs_wait_fs_info (l_fs_btrfs->module, l_fs_btrfs, UDISKS_DEFAULT_WAIT_TIMEOUT);
+
   /* Complete DBus call. */
   udisks_filesystem_btrfs_complete_create_snapshot (fs_btrfs, invocation);
 
@@ -872,6 +859,9 @@ handle_repair (UDisksFilesystemBTRFS *fs_btrfs,
 
   udisks_linux_block_object_trigger_uevent_sync (object, UDISKS_DEFAULT_WAIT_TIMEOUT);
 
+  /* Wait for the properties to reflect the change. */
+  udisks_linux_module_btrfs_wait_fs_info (l_fs_btrfs->module, l_fs_btrfs, UDISKS_DEFAULT_WAIT_TIMEOUT);
+
   /* Complete DBus call. */
   udisks_filesystem_btrfs_complete_repair (fs_btrfs, invocation);
 
@@ -929,6 +919,9 @@ handle_resize (UDisksFilesystemBTRFS *fs_btrfs,
 
   udisks_linux_block_object_trigger_uevent_sync (object, UDISKS_DEFAULT_WAIT_TIMEOUT);
 
+  /* Wait for the properties to reflect the change. */
+  udisks_linux_module_btrfs_wait_fs_info (l_fs_btrfs->module, l_fs_btrfs, UDISKS_DEFAULT_WAIT_TIMEOUT);
+
   /* Complete DBus call. */
   udisks_filesystem_btrfs_complete_resize (fs_btrfs, invocation);
 
@@ -966,6 +959,8 @@ udisks_linux_filesystem_btrfs_module_object_process_uevent (UDisksModuleObject *
 {
   UDisksLinuxFilesystemBTRFS *l_fs_btrfs = UDISKS_LINUX_FILESYSTEM_BTRFS (module_object);
   const gchar *fs_type = NULL;
+  const gchar *key;
+  const gchar *device_file;
 
   g_return_val_if_fail (UDISKS_IS_LINUX_FILESYSTEM_BTRFS (module_object), FALSE);
 
@@ -975,9 +970,29 @@ udisks_linux_filesystem_btrfs_module_object_process_uevent (UDisksModuleObject *
   /* Check filesystem type from udev property. */
   fs_type = g_udev_device_get_property (device->udev_device, "ID_FS_TYPE");
   *keep = g_strcmp0 (fs_type, "btrfs") == 0;
-  if (*keep)
+  device_file = g_udev_device_get_device_file (device->udev_device);
+  if (*keep && device_file != NULL)
+    {
+      /* all member devices share the result of a single query */
+      key = g_udev_device_get_property (device->udev_device, "ID_FS_UUID");
+      if (key == NULL)
+        key = device_file;
+
+      if (l_fs_btrfs->fs_info_key != NULL && g_strcmp0 (l_fs_btrfs->fs_info_key, key) != 0)
+        {
+          udisks_linux_module_btrfs_forget_fs_info (l_fs_btrfs->module, l_fs_btrfs, l_fs_btrfs->fs_info_key);
+          g_clear_pointer (&l_fs_btrfs->fs_info_key, g_free);
+        }
+      if (l_fs_btrfs->fs_info_key == NULL)
+        l_fs_btrfs->fs_info_key = g_strdup (key);
+
+      udisks_linux_module_btrfs_refresh_fs_info (l_fs_btrfs->module, l_fs_btrfs, key, device_file);
+    }
+  else if (l_fs_btrfs->fs_info_key != NULL)
     {
-      udisks_linux_filesystem_btrfs_update (l_fs_btrfs, l_fs_btrfs->block_object);
+      /* no longer a member device */
+      udisks_linux_module_btrfs_forget_fs_info (l_fs_btrfs->module, l_fs_btrfs, l_fs_btrfs->fs_info_key);
+      g_clear_pointer (&l_fs_btrfs->fs_info_key, g_free);
     }
 
   return TRUE;
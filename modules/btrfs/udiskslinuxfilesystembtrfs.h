@@ -21,6 +21,7 @@
 #define __UDISKS_LINUX_FILESYSTEM_BTRFS_H__
 
 #include <src/udisksdaemontypes.h>
+#include <blockdev/btrfs.h>
 #include "udisksbtrfstypes.h"
 
 G_BEGIN_DECLS
@@ -36,8 +37,8 @@ G_BEGIN_DECLS
 GType                       udisks_linux_filesystem_btrfs_get_type   (void) G_GNUC_CONST;
 UDisksLinuxFilesystemBTRFS *udisks_linux_filesystem_btrfs_new        (UDisksLinuxModuleBTRFS     *module,
                                                                       UDisksLinuxBlockObject     *block_object);
-gboolean                    udisks_linux_filesystem_btrfs_update     (UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
-                                                                      UDisksLinuxBlockObject     *object);
+void                        udisks_linux_filesystem_btrfs_set_info   (UDisksLinuxFilesystemBTRFS  *l_fs_btrfs,
+                                                                      const BDBtrfsFilesystemInfo *info);
 UDisksLinuxModuleBTRFS     *udisks_linux_filesystem_btrfs_get_module (UDisksLinuxFilesystemBTRFS *l_fs_btrfs);
 
 G_END_DECLS
@@ -21,6 +21,7 @@
 #include "config.h"
 
 #include <blockdev/blockdev.h>
+#include <blockdev/btrfs.h>
 
 #include <src/udisksdaemon.h>
 #include <src/udiskslogging.h>
@@ -40,6 +41,13 @@
  * @short_description: BTRFS module.
  *
  * The BTRFS module.
+ *
+ * Querying a BTRFS filesystem runs the btrfs tool, so it's done in a
+ * worker thread and only once for all the member devices of the
+ * filesystem - the result is shared by all of them and kept until the
+ * next uevent on any of the member devices. Method calls changing the
+ * filesystem wait for a query started after the change with
+ * udisks_linux_module_btrfs_wait_fs_info().
  */
 
 /**
@@ -51,8 +59,26 @@
 struct _UDisksLinuxModuleBTRFS {
   UDisksModule parent_instance;
 
+  /* filesystem UUID -> BTRFSInfoEntry, protected by fs_info_lock */
+  GHashTable *fs_info;
+  GMutex fs_info_lock;
+  GCond fs_info_cond;             /* signalled when a query finishes */
 };
 
+typedef struct
+{
+  UDisksLinuxModuleBTRFS *module;
+  gchar *key;
+  gchar *device_file;             /* member device to run the query on */
+  GHashTable *members;            /* UDisksLinuxFilesystemBTRFS -> device file, no references held */
+  BDBtrfsFilesystemInfo *info;    /* last result or NULL */
+  guint query_source_id;
+  gboolean running;
+  gboolean rerun;                 /* invalidated while the query was running */
+  guint64 n_started;              /* number of the last query started */
+  guint64 n_finished;             /* number of the last query finished */
+} BTRFSInfoEntry;
+
 typedef struct _UDisksLinuxModuleBTRFSClass UDisksLinuxModuleBTRFSClass;
 
 struct _UDisksLinuxModuleBTRFSClass {
@@ -65,9 +91,25 @@ G_DEFINE_TYPE_WITH_CODE (UDisksLinuxModuleBTRFS, udisks_linux_module_btrfs, UDIS
                          G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, initable_iface_init));
 
 
+static void
+btrfs_info_entry_free (BTRFSInfoEntry *entry)
+{
+  if (entry->query_source_id != 0)
+    g_source_remove (entry->query_source_id);
+  if (entry->info != NULL)
+    bd_btrfs_filesystem_info_free (entry->info);
+  g_hash_table_unref (entry->members);
+  g_free (entry->device_file);
+  g_free (entry->key);
+  g_free (entry);
+}
+
 static void
 udisks_linux_module_btrfs_init (UDisksLinuxModuleBTRFS *module)
 {
+  module->fs_info = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) btrfs_info_entry_free);
+  g_mutex_init (&module->fs_info_lock);
+  g_cond_init (&module->fs_info_cond);
 }
 
 static void
@@ -80,6 +122,12 @@ udisks_linux_module_btrfs_constructed (GObject *object)
 static void
 udisks_linux_module_btrfs_finalize (GObject *object)
 {
+  UDisksLinuxModuleBTRFS *module = UDISKS_LINUX_MODULE_BTRFS (object);
+
+  g_hash_table_unref (module->fs_info);
+  g_mutex_clear (&module->fs_info_lock);
+  g_cond_clear (&module->fs_info_cond);
+
   if (G_OBJECT_CLASS (udisks_linux_module_btrfs_parent_class)->finalize)
     G_OBJECT_CLASS (udisks_linux_module_btrfs_parent_class)->finalize (object);
 }
@@ -167,6 +215,297 @@ udisks_linux_module_btrfs_new_manager (UDisksModule *module)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static void
+btrfs_info_task_func (GTask        *task,
+                      gpointer      source_object,
+                      gpointer      task_data,
+                      GCancellable *cancellable)
+{
+  const gchar *device_file = task_data;
+  BDBtrfsFilesystemInfo *info;
+  GError *error = NULL;
+
+  info = bd_btrfs_filesystem_info (device_file, &error);
+  if (info == NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, info, (GDestroyNotify) bd_btrfs_filesystem_info_free);
+}
+
+static gboolean btrfs_info_start_query (gpointer user_data);
+
+static void
+btrfs_info_schedule_query (BTRFSInfoEntry *entry)
+{
+  if (entry->running)
+    {
+      entry->rerun = TRUE;
+      return;
+    }
+
+  /* let the uevents for the other member devices join in first */
+  if (entry->query_source_id == 0)
+    entry->query_source_id = g_idle_add (btrfs_info_start_query, entry);
+}
+
+static void
+btrfs_info_query_done (GObject      *source_obj,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  UDisksLinuxModuleBTRFS *module = UDISKS_LINUX_MODULE_BTRFS (source_obj);
+  gchar *key = user_data;
+  BTRFSInfoEntry *entry;
+  BDBtrfsFilesystemInfo *info;
+  GError *error = NULL;
+  GHashTableIter iter;
+  gpointer member;
+
+  info = g_task_propagate_pointer (G_TASK (result), &error);
+
+  g_mutex_lock (&module->fs_info_lock);
+  entry = g_hash_table_lookup (module->fs_info, key);
+  g_warn_if_fail (entry != NULL);
+  if (entry == NULL)
+    goto out;
+  entry->running = FALSE;
+  entry->n_finished = entry->n_started;
+
+  if (info == NULL)
+    {
+      udisks_critical ("Can't get BTRFS filesystem info for %s: %s",
+                       (const gchar *) g_task_get_task_data (G_TASK (result)), error->message);
+    }
+  else
+    {
+      if (entry->info != NULL)
+        bd_btrfs_filesystem_info_free (entry->info);
+      entry->info = g_steal_pointer (&info);
+
+      g_hash_table_iter_init (&iter, entry->members);
+      while (g_hash_table_iter_next (&iter, &member, NULL))
+        udisks_linux_filesystem_btrfs_set_info (UDISKS_LINUX_FILESYSTEM_BTRFS (member), entry->info);
+    }
+
+  if (g_hash_table_size (entry->members) == 0)
+    {
+      g_hash_table_remove (module->fs_info, key);
+    }
+  else if (entry->rerun)
+    {
+      entry->rerun = FALSE;
+      btrfs_info_schedule_query (entry);
+    }
+
+ out:
+  /* wake up the method calls waiting for the result */
+  g_cond_broadcast (&module->fs_info_cond);
+  g_mutex_unlock (&module->fs_info_lock);
+  if (info != NULL)
+    bd_btrfs_filesystem_info_free (info);
+  g_clear_error (&error);
+  g_free (key);
+}
+
+static gboolean
+btrfs_info_start_query (gpointer user_data)
+{
+  BTRFSInfoEntry *entry = user_data;
+  UDisksLinuxModuleBTRFS *module = entry->module;
+  GTask *task;
+
+  g_mutex_lock (&module->fs_info_lock);
+  entry->query_source_id = 0;
+  if (entry->device_file == NULL)
+    {
+      g_mutex_unlock (&module->fs_info_lock);
+      return G_SOURCE_REMOVE;
+    }
+  entry->running = TRUE;
+  entry->n_started++;
+
+  /* the callback (btrfs_info_query_done) is called in the default main loop (context) */
+  task = g_task_new (entry->module, NULL /* cancellable */, btrfs_info_query_done, g_strdup (entry->key));
+  g_task_set_task_data (task, g_strdup (entry->device_file), g_free);
+  g_mutex_unlock (&module->fs_info_lock);
+
+  /* holds a reference to 'task' until it is finished */
+  g_task_run_in_thread (task, btrfs_info_task_func);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * udisks_linux_module_btrfs_refresh_fs_info:
+ * @module: A #UDisksLinuxModuleBTRFS.
+ * @l_fs_btrfs: A #UDisksLinuxFilesystemBTRFS of a member device.
+ * @key: The UUID of the filesystem.
+ * @device_file: The device file of the member device.
+ *
+ * Invalidates the information about the filesystem identified by @key
+ * and schedules a query in a worker thread. Requests for the other
+ * member devices made before the query starts are served by the same
+ * query. The result is set on all the known member devices of the
+ * filesystem, @l_fs_btrfs is added to them until
+ * udisks_linux_module_btrfs_forget_fs_info() is called.
+ *
+ * Must be called from the main thread.
+ */
+void
+udisks_linux_module_btrfs_refresh_fs_info (UDisksLinuxModuleBTRFS     *module,
+                                           UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
+                                           const gchar                *key,
+                                           const gchar                *device_file)
+{
+  BTRFSInfoEntry *entry;
+
+  g_return_if_fail (UDISKS_IS_LINUX_MODULE_BTRFS (module));
+  g_return_if_fail (key != NULL && device_file != NULL);
+
+  g_mutex_lock (&module->fs_info_lock);
+  entry = g_hash_table_lookup (module->fs_info, key);
+  if (entry == NULL)
+    {
+      entry = g_new0 (BTRFSInfoEntry, 1);
+      entry->module = module;
+      entry->key = g_strdup (key);
+      entry->members = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+      g_hash_table_insert (module->fs_info, entry->key, entry);
+    }
+
+  /* until the query finishes, a new member gets what other members already have */
+  if (g_hash_table_insert (entry->members, l_fs_btrfs, g_strdup (device_file)) && entry->info != NULL)
+    udisks_linux_filesystem_btrfs_set_info (l_fs_btrfs, entry->info);
+
+  g_free (entry->device_file);
+  entry->device_file = g_strdup (device_file);
+
+  btrfs_info_schedule_query (entry);
+  g_mutex_unlock (&module->fs_info_lock);
+}
+
+/**
+ * udisks_linux_module_btrfs_forget_fs_info:
+ * @module: A #UDisksLinuxModuleBTRFS.
+ * @l_fs_btrfs: A #UDisksLinuxFilesystemBTRFS.
+ * @key: The UUID of the filesystem passed to udisks_linux_module_btrfs_refresh_fs_info().
+ *
+ * Stops updating @l_fs_btrfs with the information about the filesystem
+ * identified by @key.
+ *
+ * Must be called from the main thread.
+ */
+void
+udisks_linux_module_btrfs_forget_fs_info (UDisksLinuxModuleBTRFS     *module,
+                                          UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
+                                          const gchar                *key)
+{
+  BTRFSInfoEntry *entry;
+  GHashTableIter iter;
+  gpointer device_file;
+
+  g_return_if_fail (UDISKS_IS_LINUX_MODULE_BTRFS (module));
+
+  g_mutex_lock (&module->fs_info_lock);
+  entry = g_hash_table_lookup (module->fs_info, key);
+  if (entry == NULL)
+    goto out;
+
+  g_hash_table_remove (entry->members, l_fs_btrfs);
+  /* nothing more to wait for on behalf of @l_fs_btrfs */
+  g_cond_broadcast (&module->fs_info_cond);
+  if (g_hash_table_size (entry->members) == 0 && !entry->running)
+    {
+      g_hash_table_remove (module->fs_info, key);
+      goto out;
+    }
+
+  /* make sure the next query doesn't run on a device that may be gone */
+  g_clear_pointer (&entry->device_file, g_free);
+  g_hash_table_iter_init (&iter, entry->members);
+  if (g_hash_table_iter_next (&iter, NULL, &device_file))
+    entry->device_file = g_strdup (device_file);
+
+ out:
+  g_mutex_unlock (&module->fs_info_lock);
+}
+
+static BTRFSInfoEntry *
+btrfs_info_find_entry (UDisksLinuxModuleBTRFS     *module,
+                       UDisksLinuxFilesystemBTRFS *l_fs_btrfs)
+{
+  GHashTableIter iter;
+  gpointer entry;
+
+  g_hash_table_iter_init (&iter, module->fs_info);
+  while (g_hash_table_iter_next (&iter, NULL, &entry))
+    if (g_hash_table_contains (((BTRFSInfoEntry *) entry)->members, l_fs_btrfs))
+      return entry;
+  return NULL;
+}
+
+/**
+ * udisks_linux_module_btrfs_wait_fs_info:
+ * @module: A #UDisksLinuxModuleBTRFS.
+ * @l_fs_btrfs: A #UDisksLinuxFilesystemBTRFS of a member device.
+ * @timeout_seconds: Maximum time to wait for the query.
+ *
+ * Schedules a query of the filesystem @l_fs_btrfs belongs to and waits
+ * until it finishes and its result is set on the member devices. Any
+ * query already running when this is called is not waited for because
+ * it may have read the filesystem before the caller changed it.
+ *
+ * Must not be called from the main thread.
+ *
+ * Returns: %TRUE if the query finished, %FALSE if @l_fs_btrfs is not
+ * known to be a member device or on timeout.
+ */
+gboolean
+udisks_linux_module_btrfs_wait_fs_info (UDisksLinuxModuleBTRFS     *module,
+                                        UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
+                                        guint                       timeout_seconds)
+{
+  BTRFSInfoEntry *entry;
+  gint64 end_time;
+  guint64 target;
+  gboolean ret = FALSE;
+
+  g_return_val_if_fail (UDISKS_IS_LINUX_MODULE_BTRFS (module), FALSE);
+
+  end_time = g_get_monotonic_time () + timeout_seconds * G_TIME_SPAN_SECOND;
+
+  g_mutex_lock (&module->fs_info_lock);
+  entry = btrfs_info_find_entry (module, l_fs_btrfs);
+  if (entry == NULL || entry->device_file == NULL)
+    goto out;
+
+  /* a running query is followed by another one, see btrfs_info_query_done() */
+  target = entry->n_started + (entry->running ? 2 : 1);
+  btrfs_info_schedule_query (entry);
+
+  while (TRUE)
+    {
+      /* the entry may be gone while we were waiting */
+      entry = btrfs_info_find_entry (module, l_fs_btrfs);
+      if (entry == NULL)
+        break;
+      if (entry->n_finished >= target)
+        {
+          ret = TRUE;
+          break;
+        }
+      if (!g_cond_wait_until (&module->fs_info_cond, &module->fs_info_lock, end_time))
+        break;
+    }
+
+ out:
+  g_mutex_unlock (&module->fs_info_lock);
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 static GType *
 udisks_linux_module_btrfs_get_block_object_interface_types (UDisksModule *module)
 {
@@ -42,6 +42,17 @@ UDisksModule           *udisks_module_btrfs_new              (UDisksDaemon  *dae
                                                               GCancellable  *cancellable,
                                                               GError       **error);
 
+void                    udisks_linux_module_btrfs_refresh_fs_info (UDisksLinuxModuleBTRFS     *module,
+                                                                   UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
+                                                                   const gchar                *key,
+                                                                   const gchar                *device_file);
+void                    udisks_linux_module_btrfs_forget_fs_info  (UDisksLinuxModuleBTRFS     *module,
+                                                                   UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
+                                                                   const gchar                *key);
+gboolean                udisks_linux_module_btrfs_wait_fs_info    (UDisksLinuxModuleBTRFS     *module,
+                                                                   UDisksLinuxFilesystemBTRFS *l_fs_btrfs,
+                                                                   guint                       timeout_seconds);
+
 G_END_DECLS
 
 #endif /* __UDISKS_LINUX_MODULE_BTRFS_H__ */
@@ -168,6 +168,7 @@ handle_logout_interface (UDisksISCSISession    *session,
                                                         g_strdup (name),
                                                         g_free,
                                                         UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                        NULL,
                                                         &error))
     {
       g_prefix_error (&error, "Error waiting for iSCSI device to disappear: ");
@@ -180,6 +181,7 @@ handle_logout_interface (UDisksISCSISession    *session,
                                                         g_strdup (name),
                                                         g_free,
                                                         UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                        NULL,
                                                         &error))
     {
       g_prefix_error (&error, "Error waiting for iSCSI session object to disappear: ");
@@ -628,6 +628,7 @@ handle_login (UDisksManagerISCSIInitiator *object,
                                                      g_strdup (arg_name),
                                                      g_free,
                                                      UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                     NULL,
                                                      &error);
    if (iscsi_object == NULL)
     {
@@ -643,6 +644,7 @@ handle_login (UDisksManagerISCSIInitiator *object,
                                                                  g_strdup (arg_name),
                                                                  g_free,
                                                                  UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                                 NULL,
                                                                  &error);
       if (iscsi_session_object == NULL)
         {
@@ -716,6 +718,7 @@ handle_logout(UDisksManagerISCSIInitiator *object,
                                                         g_strdup (arg_name),
                                                         g_free,
                                                         UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                        NULL,
                                                         &error))
     {
       g_prefix_error (&error, "Error waiting for iSCSI device to disappear: ");
@@ -730,6 +733,7 @@ handle_logout(UDisksManagerISCSIInitiator *object,
                                                             g_strdup (arg_name),
                                                             g_free,
                                                             UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                            NULL,
                                                             &error))
         {
           g_prefix_error (&error, "Error waiting for iSCSI session object to disappear: ");
@@ -366,38 +366,80 @@ void lv_list_free (BDLVMLVdata **lv_list) {
   g_free (lv_list);
 }
 
-void vgs_pvs_data_free (VGsPVsData *data) {
+void lvm_report_data_free (LVMReportData *data) {
   if (!data)
     /* nothing to do */
     return;
 
   vg_list_free (data->vgs);
   pv_list_free (data->pvs);
+  lv_list_free (data->lvs);
+  if (data->lvs_errors)
+    g_hash_table_destroy (data->lvs_errors);
   g_free (data);
 }
 
-void vgs_task_func (GTask        *task,
-                    gpointer      source_obj,
-                    gpointer      task_data,
-                    GCancellable *cancellable)
+/* Lists the LVs VG by VG, the VGs that fail are added to @lvs_errors. */
+static BDLVMLVdata **lvs_tree_per_vg (BDLVMVGdata **vgs, GHashTable *lvs_errors) {
+  GPtrArray *ret = g_ptr_array_new ();
+
+  for (BDLVMVGdata **vgs_p = vgs; *vgs_p; vgs_p++) {
+    GError *error = NULL;
+    BDLVMLVdata **lvs = bd_lvm_lvs_tree ((*vgs_p)->name, &error);
+
+    if (!lvs) {
+      if (!error)
+        /* this should never happen */
+        g_set_error_literal (&error, BD_LVM_ERROR, BD_LVM_ERROR_FAIL, "no error reported");
+      g_hash_table_replace (lvs_errors, g_strdup ((*vgs_p)->name), error);
+      continue;
+    }
+
+    for (BDLVMLVdata **lvs_p = lvs; *lvs_p; lvs_p++)
+      g_ptr_array_add (ret, *lvs_p);
+    /* only free the container, the LVs were moved to 'ret' */
+    g_free (lvs);
+  }
+  g_ptr_array_add (ret, NULL);
+
+  return (BDLVMLVdata **) g_ptr_array_free (ret, FALSE);
+}
+
+/* Gets VGs, PVs and the LVs of all VGs (including their segments) in one go
+ * so that a refresh doesn't need to run the LVM tools once per VG. */
+void lvm_report_task_func (GTask        *task,
+                           gpointer      source_obj,
+                           gpointer      task_data,
+                           GCancellable *cancellable)
 {
   GError *error = NULL;
-  VGsPVsData *ret = g_new0 (VGsPVsData, 1);
+  LVMReportData *ret = g_new0 (LVMReportData, 1);
 
   ret->vgs = bd_lvm_vgs (&error);
   if (!ret->vgs) {
-    vgs_pvs_data_free (ret);
+    lvm_report_data_free (ret);
     g_task_return_error (task, error);
     return;
   }
 
   ret->pvs = bd_lvm_pvs (&error);
   if (!ret->pvs) {
-    vgs_pvs_data_free (ret);
+    lvm_report_data_free (ret);
     g_task_return_error (task, error);
+    return;
   }
-  else
-    g_task_return_pointer (task, ret, (GDestroyNotify) vgs_pvs_data_free);
+
+  ret->lvs = bd_lvm_lvs_tree (NULL /* all VGs */, &error);
+  if (!ret->lvs) {
+    /* don't let one broken VG keep all the others from being refreshed */
+    udisks_debug ("LVM2 plugin: failed to get LVs of all VGs, retrying VG by VG: %s",
+                  error ? error->message : "no error reported");
+    g_clear_error (&error);
+    ret->lvs_errors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_error_free);
+    ret->lvs = lvs_tree_per_vg (ret->vgs, ret->lvs_errors);
+  }
+
+  g_task_return_pointer (task, ret, (GDestroyNotify) lvm_report_data_free);
 }
 
 void lvs_task_func (GTask        *task,
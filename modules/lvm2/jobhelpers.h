@@ -65,7 +65,9 @@ typedef struct {
 typedef struct {
   BDLVMVGdata **vgs;
   BDLVMPVdata **pvs;
-} VGsPVsData;
+  BDLVMLVdata **lvs;
+  GHashTable *lvs_errors;  /* VG name -> GError for the VGs whose LVs couldn't be listed, or NULL */
+} LVMReportData;
 
 gboolean lvcreate_job_func (UDisksThreadedJob  *job,
                             GCancellable       *cancellable,
@@ -187,12 +189,12 @@ gboolean pvmove_job_func (UDisksThreadedJob  *job,
 void vg_list_free (BDLVMVGdata **vg_list);
 void pv_list_free (BDLVMPVdata **pv_list);
 void lv_list_free (BDLVMLVdata **lv_list);
-void vgs_pvs_data_free (VGsPVsData *data);
+void lvm_report_data_free (LVMReportData *data);
 
-void vgs_task_func (GTask        *task,
-                    gpointer      source_obj,
-                    gpointer      task_data,
-                    GCancellable *cancellable);
+void lvm_report_task_func (GTask        *task,
+                           gpointer      source_obj,
+                           gpointer      task_data,
+                           GCancellable *cancellable);
 
 void lvs_task_func (GTask        *task,
                     gpointer      source_obj,
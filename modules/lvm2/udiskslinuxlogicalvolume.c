@@ -393,25 +393,17 @@ peek_block_for_logical_volume (UDisksLogicalVolume *volume,
 {
   UDisksBlock *ret = NULL;
   GDBusObject *object;
-  GList *l, *objects = NULL;
-  UDisksBlockLVM2 *block_lvm2;
+  GList *objects = NULL;
 
   object = g_dbus_interface_get_object (G_DBUS_INTERFACE (volume));
   if (object == NULL)
     goto out;
 
-  objects = udisks_daemon_get_objects (daemon);
-  for (l = objects; l != NULL; l = l->next)
-    {
-      block_lvm2 = udisks_object_peek_block_lvm2 (UDISKS_OBJECT(l->data));
-      if (block_lvm2 &&
-          g_strcmp0 (udisks_block_lvm2_get_logical_volume (block_lvm2),
-                     g_dbus_object_get_object_path (object)) == 0)
-        {
-          ret = udisks_object_peek_block (UDISKS_OBJECT(l->data));
-          goto out;
-        }
-    }
+  objects = udisks_daemon_get_child_objects (daemon,
+                                             g_dbus_object_get_object_path (object),
+                                             UDISKS_OBJECT_RELATION_LOGICAL_VOLUME);
+  if (objects != NULL)
+    ret = udisks_object_peek_block (UDISKS_OBJECT (objects->data));
 
  out:
   g_list_free_full (objects, g_object_unref);
@@ -620,6 +612,7 @@ handle_delete (UDisksLogicalVolume   *_volume,
                                                          &wait_data,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         NULL,
                                                          &error))
     {
       g_prefix_error (&error,
@@ -732,6 +725,7 @@ wait_for_logical_volume_path (UDisksLinuxVolumeGroupObject  *group_object,
                                                       &data,
                                                       NULL,
                                                       UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                      NULL,
                                                       error);
   if (volume_object == NULL)
     return NULL;
@@ -889,30 +883,15 @@ wait_for_logical_volume_block_object (UDisksDaemon *daemon,
                                       gpointer      user_data)
 {
   UDisksLinuxLogicalVolumeObject *volume_object = user_data;
-  const gchar *volume_objpath;
-  GList *objects, *l;
+  GList *objects;
   UDisksObject *ret = NULL;
 
-  volume_objpath = g_dbus_object_get_object_path (G_DBUS_OBJECT (volume_object));
-
-  objects = udisks_daemon_get_objects (daemon);
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlockLVM2 *block;
-
-      block = udisks_object_peek_block_lvm2 (object);
-      if (block == NULL)
-        continue;
+  objects = udisks_daemon_get_child_objects (daemon,
+                                             g_dbus_object_get_object_path (G_DBUS_OBJECT (volume_object)),
+                                             UDISKS_OBJECT_RELATION_LOGICAL_VOLUME);
+  if (objects != NULL)
+    ret = g_object_ref (objects->data);
 
-      if (g_strcmp0 (udisks_block_lvm2_get_logical_volume (block), volume_objpath) == 0)
-        {
-          ret = g_object_ref (object);
-          goto out;
-        }
-    }
-
- out:
   g_list_free_full (objects, g_object_unref);
   return ret;
 }
@@ -966,6 +945,7 @@ handle_activate (UDisksLogicalVolume *_volume,
                                                      object,
                                                      NULL,
                                                      UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                     NULL,
                                                      &error);
   if (block_object == NULL)
     {
@@ -1034,6 +1014,7 @@ handle_deactivate (UDisksLogicalVolume   *_volume,
                                                          object,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         NULL,
                                                          &error))
     {
       g_prefix_error (&error,
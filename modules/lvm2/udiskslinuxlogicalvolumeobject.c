@@ -66,6 +66,10 @@ struct _UDisksLinuxLogicalVolumeObject
 
   UDisksLogicalVolume *iface_logical_volume;
   UDisksVDOVolume *iface_vdo_volume;
+
+  /* digest of the data last applied by _update() and whether it needed polling */
+  gchar *digest;
+  gboolean needs_polling;
 };
 
 struct _UDisksLinuxLogicalVolumeObjectClass
@@ -96,6 +100,7 @@ udisks_linux_logical_volume_object_finalize (GObject *_object)
   if (object->iface_vdo_volume != NULL)
     g_object_unref (object->iface_vdo_volume);
 
+  g_free (object->digest);
   g_free (object->name);
 
   if (G_OBJECT_CLASS (udisks_linux_logical_volume_object_parent_class)->finalize != NULL)
@@ -299,20 +304,55 @@ udisks_linux_logical_volume_object_get_name (UDisksLinuxLogicalVolumeObject *obj
   return object->name;
 }
 
+/**
+ * udisks_linux_logical_volume_object_is_up_to_date:
+ * @object: A #UDisksLinuxLogicalVolumeObject.
+ * @digest: Digest of the data @object would be updated with.
+ * @needs_polling_ret: (out): Return location for whether polling is needed.
+ *
+ * Checks whether @object was last updated with data matching @digest. If so,
+ * @needs_polling_ret is set the same way the last update set it.
+ *
+ * Returns: %TRUE if updating @object would change nothing, %FALSE otherwise.
+ */
+gboolean
+udisks_linux_logical_volume_object_is_up_to_date (UDisksLinuxLogicalVolumeObject *object,
+                                                  const gchar                    *digest,
+                                                  gboolean                       *needs_polling_ret)
+{
+  g_return_val_if_fail (UDISKS_IS_LINUX_LOGICAL_VOLUME_OBJECT (object), FALSE);
+
+  if (object->digest == NULL || g_strcmp0 (object->digest, digest) != 0)
+    return FALSE;
+
+  if (object->needs_polling)
+    *needs_polling_ret = TRUE;
+  return TRUE;
+}
+
 void
 udisks_linux_logical_volume_object_update (UDisksLinuxLogicalVolumeObject *object,
                                            BDLVMLVdata *lv_info,
                                            BDLVMLVdata *meta_lv_info,
                                            BDLVMLVdata **all_lv_infos,
                                            BDLVMVDOPooldata *vdo_info,
+                                           const gchar *digest,
                                            gboolean *needs_polling_ret)
 {
+  gboolean needs_polling = FALSE;
+
   g_return_if_fail (UDISKS_IS_LINUX_LOGICAL_VOLUME_OBJECT (object));
 
   udisks_linux_logical_volume_update (UDISKS_LINUX_LOGICAL_VOLUME (object->iface_logical_volume),
                                       object->volume_group,
                                       lv_info, meta_lv_info, all_lv_infos,
-                                      needs_polling_ret);
+                                      &needs_polling);
+
+  g_free (object->digest);
+  object->digest = g_strdup (digest);
+  object->needs_polling = needs_polling;
+  if (needs_polling)
+    *needs_polling_ret = TRUE;
 
   if (vdo_info)
     {
@@ -47,6 +47,10 @@ void                            udisks_linux_logical_volume_object_update
                                                                                      BDLVMLVdata                    *meta_lv_info,
                                                                                      BDLVMLVdata                   **all_lv_infos,
                                                                                      BDLVMVDOPooldata               *vdo_info,
+                                                                                     const gchar                    *digest,
+                                                                                     gboolean                       *needs_polling_ret);
+gboolean                        udisks_linux_logical_volume_object_is_up_to_date    (UDisksLinuxLogicalVolumeObject *object,
+                                                                                     const gchar                    *digest,
                                                                                      gboolean                       *needs_polling_ret);
 void                            udisks_linux_logical_volume_object_update_etctabs   (UDisksLinuxLogicalVolumeObject *object);
 
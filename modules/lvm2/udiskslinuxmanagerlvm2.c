@@ -402,6 +402,7 @@ handle_volume_group_create (UDisksManagerLVM2     *_object,
                                                      &wait_data,
                                                      NULL,
                                                      UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                     NULL,
                                                      &error);
   if (group_object == NULL)
     {
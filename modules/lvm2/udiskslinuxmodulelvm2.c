@@ -216,9 +216,13 @@ lvm_update_vgs (GObject      *source_obj,
 
   GTask *task = G_TASK (result);
   GError *error = NULL;
-  VGsPVsData *data = g_task_propagate_pointer (task, &error);
+  LVMReportData *data = g_task_propagate_pointer (task, &error);
   BDLVMVGdata **vgs, **vgs_p;
   BDLVMPVdata **pvs, **pvs_p;
+  BDLVMLVdata **lvs, **lvs_p;
+  GHashTable *lvs_errors;
+  GHashTable *vg_pvs;
+  GHashTable *vg_lvs;
 
   GHashTableIter vg_name_iter;
   gpointer key, value;
@@ -226,7 +230,7 @@ lvm_update_vgs (GObject      *source_obj,
 
   if (GPOINTER_TO_UINT (user_data) != module->update_epoch)
     {
-      vgs_pvs_data_free (data);
+      lvm_report_data_free (data);
       return;
     }
 
@@ -246,27 +250,60 @@ lvm_update_vgs (GObject      *source_obj,
     }
   vgs = data->vgs;
   pvs = data->pvs;
+  lvs = data->lvs;
+  lvs_errors = data->lvs_errors;
 
-  /* free the data container (but not 'vgs' and 'pvs') */
+  /* free the data container (but not 'vgs', 'pvs', 'lvs' and 'lvs_errors') */
   g_free (data);
 
   daemon = udisks_module_get_daemon (UDISKS_MODULE (module));
   manager = udisks_daemon_get_object_manager (daemon);
 
+  /* Index PVs and LVs by the name of their VG, both only for the VGs that
+   * were reported. The lists take ownership of the items. */
+  vg_pvs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  vg_lvs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (vgs_p = vgs; *vgs_p; vgs_p++)
+    {
+      if (g_hash_table_contains (vg_lvs, (*vgs_p)->name))
+        continue;
+      g_hash_table_insert (vg_pvs, g_strdup ((*vgs_p)->name), NULL);
+      g_hash_table_insert (vg_lvs, g_strdup ((*vgs_p)->name), g_ptr_array_new ());
+    }
+
+  /* UDisksLinuxVolumeGroupObject takes the BDLVMPVdata that belong to the VG.
+   * The rest of the PVs, either not assigned to any VG or assigned to a
+   * non-existing VG, are basically unused and freed here anyway.
+   */
+  for (pvs_p = pvs; *pvs_p; pvs_p++)
+    {
+      if ((*pvs_p)->vg_name && g_hash_table_contains (vg_pvs, (*pvs_p)->vg_name))
+        g_hash_table_insert (vg_pvs, g_strdup ((*pvs_p)->vg_name),
+                             g_slist_prepend (g_hash_table_lookup (vg_pvs, (*pvs_p)->vg_name), *pvs_p));
+      else
+        bd_lvm_pvdata_free (*pvs_p);
+    }
+
+  for (lvs_p = lvs; *lvs_p; lvs_p++)
+    {
+      GPtrArray *lvs_array = (*lvs_p)->vg_name ? g_hash_table_lookup (vg_lvs, (*lvs_p)->vg_name) : NULL;
+
+      if (lvs_array != NULL)
+        g_ptr_array_add (lvs_array, *lvs_p);
+      else
+        bd_lvm_lvdata_free (*lvs_p);
+    }
+
   /* Remove obsolete groups */
   g_hash_table_iter_init (&vg_name_iter, module->name_to_volume_group);
   while (g_hash_table_iter_next (&vg_name_iter, &key, &value))
     {
       UDisksLinuxVolumeGroupObject *group;
-      gboolean found = FALSE;
 
       vg_name = key;
       group = value;
 
-      for (vgs_p = vgs; !found && *vgs_p; vgs_p++)
-        found = g_strcmp0 ((*vgs_p)->name, vg_name) == 0;
-
-      if (! found)
+      if (! g_hash_table_contains (vg_lvs, vg_name))
         {
           udisks_linux_volume_group_object_destroy (group);
           g_dbus_object_manager_server_unexport (manager, g_dbus_object_get_object_path (G_DBUS_OBJECT (group)));
@@ -278,9 +315,25 @@ lvm_update_vgs (GObject      *source_obj,
   for (vgs_p = vgs; *vgs_p; vgs_p++)
     {
       UDisksLinuxVolumeGroupObject *group;
-      GSList *vg_pvs = NULL;
+      GSList *pvs_list;
+      GPtrArray *lvs_array;
+      GError *lvs_error;
 
       vg_name = (*vgs_p)->name;
+
+      /* the first VG with a duplicate name took the PVs and LVs, don't
+       * let the others overwrite its object */
+      lvs_array = g_hash_table_lookup (vg_lvs, vg_name);
+      if (lvs_array == NULL)
+        {
+          udisks_debug ("LVM2 plugin: ignoring duplicate volume group name %s", vg_name);
+          bd_lvm_vgdata_free (*vgs_p);
+          continue;
+        }
+      g_hash_table_remove (vg_lvs, vg_name);
+      pvs_list = g_hash_table_lookup (vg_pvs, vg_name);
+      g_hash_table_remove (vg_pvs, vg_name);
+
       group = g_hash_table_lookup (module->name_to_volume_group, vg_name);
       if (group == NULL)
         {
@@ -288,23 +341,32 @@ lvm_update_vgs (GObject      *source_obj,
           g_hash_table_insert (module->name_to_volume_group, g_strdup (vg_name), group);
         }
 
-      for (pvs_p = pvs; *pvs_p; pvs_p++)
-        if (g_strcmp0 ((*pvs_p)->vg_name, vg_name) == 0)
-            vg_pvs = g_slist_prepend (vg_pvs, bd_lvm_pvdata_copy (*pvs_p));
+      /* leave the VG alone if its LVs couldn't be listed, like a failed poll */
+      lvs_error = lvs_errors ? g_hash_table_lookup (lvs_errors, vg_name) : NULL;
+      if (lvs_error != NULL)
+        {
+          udisks_warning ("Failed to update LVM volume group %s: %s", vg_name, lvs_error->message);
+          g_slist_free_full (pvs_list, (GDestroyNotify) bd_lvm_pvdata_free);
+          g_ptr_array_free (lvs_array, TRUE);
+          bd_lvm_vgdata_free (*vgs_p);
+          continue;
+        }
+      g_ptr_array_add (lvs_array, NULL);
 
-      udisks_linux_volume_group_object_update (group, *vgs_p, vg_pvs);
+      /* takes ownership of the VG info, the PVs and the LVs */
+      udisks_linux_volume_group_object_update (group, *vgs_p, pvs_list,
+                                               (BDLVMLVdata **) g_ptr_array_free (lvs_array, FALSE));
     }
 
-  /* UDisksLinuxVolumeGroupObject carries copies of BDLVMPVdata that belong to the VG.
-  *  The rest of the PVs, either not assigned to any VG or assigned to a non-existing VG,
-  *  are basically unused and freed here anyway.
-  */
-  for (pvs_p = pvs; *pvs_p; pvs_p++)
-    bd_lvm_pvdata_free (*pvs_p);
+  g_hash_table_destroy (vg_lvs);
+  g_hash_table_destroy (vg_pvs);
+  if (lvs_errors)
+    g_hash_table_destroy (lvs_errors);
 
   /* only free the containers, the contents were passed further */
   g_free (vgs);
   g_free (pvs);
+  g_free (lvs);
 }
 
 static void
@@ -321,7 +383,7 @@ lvm_update (UDisksLinuxModuleLVM2 *module)
                      GUINT_TO_POINTER (module->update_epoch));
 
   /* holds a reference to 'task' until it is finished */
-  g_task_run_in_thread (task, (GTaskThreadFunc) vgs_task_func);
+  g_task_run_in_thread (task, (GTaskThreadFunc) lvm_report_task_func);
   g_object_unref (task);
 }
 
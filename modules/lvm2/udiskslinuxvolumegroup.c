@@ -483,6 +483,7 @@ handle_rename (UDisksVolumeGroup     *_group,
                                                      &wait_data,
                                                      NULL,
                                                      UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                     NULL,
                                                      &error);
   if (group_object == NULL)
     {
@@ -926,6 +927,7 @@ wait_for_logical_volume_path (UDisksLinuxVolumeGroupObject  *group_object,
                                                       &data,
                                                       NULL,
                                                       UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                      NULL,
                                                       error);
   if (volume_object == NULL)
     return NULL;
@@ -66,7 +66,10 @@ struct _UDisksLinuxVolumeGroupObject
   gchar *name;
 
   GHashTable *logical_volumes;
-  guint32 update_epoch;
+  /* digest of the VG, PVs and LVs data last applied by _update() */
+  gchar *digest;
+  /* digest of the PVs and their block objects, part of every LV's digest */
+  gchar *pvs_digest;
   guint32 poll_epoch;
   guint poll_timeout_id;
   gboolean poll_requested;
@@ -97,12 +100,6 @@ static void crypttab_changed (UDisksCrypttabMonitor  *monitor,
                               UDisksCrypttabEntry    *entry,
                               gpointer                user_data);
 
-typedef struct {
-  BDLVMVGdata *vg_info;
-  GSList *vg_pvs;
-  guint32 epoch;
-} VGUpdateData;
-
 static void
 udisks_linux_volume_group_object_finalize (GObject *_object)
 {
@@ -117,6 +114,8 @@ udisks_linux_volume_group_object_finalize (GObject *_object)
     g_object_unref (object->iface_volume_group);
 
   g_hash_table_unref (object->logical_volumes);
+  g_free (object->digest);
+  g_free (object->pvs_digest);
   g_free (object->name);
 
   g_signal_handlers_disconnect_by_func (object->mount_monitor,
@@ -185,7 +184,6 @@ udisks_linux_volume_group_object_set_property (GObject      *__object,
 static void
 udisks_linux_volume_group_object_init (UDisksLinuxVolumeGroupObject *object)
 {
-  object->update_epoch = 0;
   object->poll_epoch = 0;
   object->poll_timeout_id = 0;
   object->poll_requested = FALSE;
@@ -454,6 +452,11 @@ block_object_update_lvm_iface (UDisksLinuxBlockObject *object,
   udisks_linux_block_lvm2_update (UDISKS_LINUX_BLOCK_LVM2 (iface_block_lvm2), object);
   udisks_block_lvm2_set_logical_volume (iface_block_lvm2, lv_obj_path);
   g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (iface_block_lvm2));
+
+  udisks_daemon_set_object_parent (udisks_linux_block_object_get_daemon (object),
+                                   UDISKS_OBJECT (object),
+                                   UDISKS_OBJECT_RELATION_LOGICAL_VOLUME,
+                                   lv_obj_path);
 }
 
 static void
@@ -536,145 +539,295 @@ update_block (UDisksLinuxBlockObject       *block_object,
     }
 }
 
-/**
- * cmp_int_lv_name: (skip)
- *
- * Compare name of an internal LV (possibly enclosed in square brackets) with a
- * given other name.
- */
-static gboolean
-cmp_int_lv_name (const gchar *int_lv_name, const gchar *lv_name)
+static void
+checksum_add_string (GChecksum   *checksum,
+                     const gchar *str)
 {
-  const gchar *c = NULL;
-  if (!int_lv_name || !lv_name)
-    return FALSE;
+  /* include the terminator so that adjacent strings can't run together, NULL differs from "" */
+  if (str != NULL)
+    g_checksum_update (checksum, (const guchar *) str, strlen (str) + 1);
+  else
+    g_checksum_update (checksum, (const guchar *) "\xff", 1);
+}
 
-  if (*int_lv_name == '[')
-    int_lv_name++;
+static void
+checksum_add_uint64 (GChecksum *checksum,
+                     guint64    value)
+{
+  g_checksum_update (checksum, (const guchar *) &value, sizeof (value));
+}
 
-  for (c=int_lv_name; *c != '\0' && *c != ']'; c++)
-    if (*c != lv_name[c - int_lv_name])
-      return FALSE;
+static void
+checksum_add_strv (GChecksum  *checksum,
+                   gchar     **strv)
+{
+  for (; strv && *strv; strv++)
+    checksum_add_string (checksum, *strv);
+  checksum_add_string (checksum, NULL);
+}
 
-  if (*c == ']')
-    c++;
-  if (*c == '\0' && lv_name[c - int_lv_name] == '\0')
-    return TRUE;
+static void
+checksum_add_lv (GChecksum   *checksum,
+                 BDLVMLVdata *lv_info)
+{
+  checksum_add_string (checksum, lv_info->lv_name);
+  checksum_add_string (checksum, lv_info->vg_name);
+  checksum_add_string (checksum, lv_info->uuid);
+  checksum_add_uint64 (checksum, lv_info->size);
+  checksum_add_string (checksum, lv_info->attr);
+  checksum_add_string (checksum, lv_info->segtype);
+  checksum_add_string (checksum, lv_info->origin);
+  checksum_add_string (checksum, lv_info->pool_lv);
+  checksum_add_string (checksum, lv_info->metadata_lv);
+  checksum_add_string (checksum, lv_info->move_pv);
+  checksum_add_uint64 (checksum, lv_info->data_percent);
+  checksum_add_uint64 (checksum, lv_info->metadata_percent);
+  checksum_add_uint64 (checksum, lv_info->copy_percent);
+  for (BDLVMSEGdata **segs_p=lv_info->segs; segs_p && *segs_p; segs_p++)
+    {
+      checksum_add_uint64 (checksum, (*segs_p)->size_pe);
+      checksum_add_uint64 (checksum, (*segs_p)->pv_start_pe);
+      checksum_add_string (checksum, (*segs_p)->pvdev);
+    }
+  checksum_add_string (checksum, NULL);
+  checksum_add_strv (checksum, lv_info->data_lvs);
+  checksum_add_strv (checksum, lv_info->metadata_lvs);
+}
 
-  return FALSE;
+/* The LV structures refer to the block objects of the PVs, so those are included. */
+static gchar *
+compute_pvs_digest (UDisksDaemon *daemon,
+                    GSList       *vg_pvs)
+{
+  GChecksum *checksum;
+  gchar *ret;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  for (GSList *vg_pvs_p=vg_pvs; vg_pvs_p; vg_pvs_p=vg_pvs_p->next)
+    {
+      BDLVMPVdata *pv_info = vg_pvs_p->data;
+      UDisksObject *block_object = NULL;
+
+      checksum_add_string (checksum, pv_info->pv_name);
+      checksum_add_string (checksum, pv_info->pv_uuid);
+      checksum_add_uint64 (checksum, pv_info->pv_size);
+      checksum_add_uint64 (checksum, pv_info->pv_free);
+      checksum_add_uint64 (checksum, pv_info->missing);
+
+      if (pv_info->pv_name)
+        block_object = udisks_daemon_find_block_by_device_file_and_symlinks (daemon, pv_info->pv_name);
+      checksum_add_string (checksum, block_object ? g_dbus_object_get_object_path (G_DBUS_OBJECT (block_object)) : NULL);
+      g_clear_object (&block_object);
+    }
+
+  ret = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return ret;
+}
+
+/* Computes a digest of everything the VG and LV objects are built from. */
+static gchar *
+compute_digest (BDLVMVGdata  *vg_info,
+                const gchar  *pvs_digest,
+                BDLVMLVdata **lvs)
+{
+  GChecksum *checksum;
+  gchar *ret;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  checksum_add_string (checksum, vg_info->name);
+  checksum_add_string (checksum, vg_info->uuid);
+  checksum_add_uint64 (checksum, vg_info->size);
+  checksum_add_uint64 (checksum, vg_info->free);
+  checksum_add_uint64 (checksum, vg_info->extent_size);
+  checksum_add_string (checksum, pvs_digest);
+
+  for (BDLVMLVdata **lvs_p=lvs; *lvs_p; lvs_p++)
+    checksum_add_lv (checksum, *lvs_p);
+
+  ret = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return ret;
+}
+
+/* Indexes @lvs by name, internal LVs without the square brackets. */
+static GHashTable *
+index_lvs (BDLVMLVdata **lvs)
+{
+  GHashTable *ret;
+
+  ret = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (BDLVMLVdata **lvs_p=lvs; *lvs_p; lvs_p++)
+    {
+      const gchar *lv_name = (*lvs_p)->lv_name;
+      gsize len = lv_name ? strlen (lv_name) : 0;
+
+      if (len == 0)
+        continue;
+      if (lv_name[0] == '[' && lv_name[len - 1] == ']')
+        g_hash_table_insert (ret, g_strndup (lv_name + 1, len - 2), *lvs_p);
+      else
+        g_hash_table_insert (ret, g_strdup (lv_name), *lvs_p);
+    }
+
+  return ret;
 }
 
 static void
-update_vg (GObject      *source_obj,
-           GAsyncResult *result,
-           gpointer      user_data)
+checksum_add_lv_structure (GChecksum   *checksum,
+                           BDLVMLVdata *lv_info,
+                           GHashTable  *lvs_index,
+                           guint        depth)
 {
-  UDisksLinuxVolumeGroupObject *object = UDISKS_LINUX_VOLUME_GROUP_OBJECT (source_obj);
-  UDisksDaemon *daemon;
-  GDBusObjectManagerServer *manager;
-  GHashTableIter volume_iter;
-  gpointer key, value;
-  GHashTable *new_lvs;
-  GHashTable *new_pvs;
-  GList *objects, *l;
-  gboolean needs_polling = FALSE;
-  GTask *task = G_TASK (result);
-  VGUpdateData *data = user_data;
+  gchar **names[2] = { lv_info->data_lvs, lv_info->metadata_lvs };
+
+  /* LV stacks are shallow, this only guards against broken reports */
+  if (depth > 8)
+    return;
+
+  for (guint i = 0; i < G_N_ELEMENTS (names); i++)
+    for (gchar **names_p=names[i]; names_p && *names_p; names_p++)
+      {
+        BDLVMLVdata *sub_lv_info = g_hash_table_lookup (lvs_index, *names_p);
+
+        if (sub_lv_info)
+          {
+            checksum_add_lv (checksum, sub_lv_info);
+            checksum_add_lv_structure (checksum, sub_lv_info, lvs_index, depth + 1);
+          }
+      }
+}
+
+/* Computes a digest of everything the LV object for @lv_info is built from,
+ * including the pool (so that VDO statistics are refreshed when it changes)
+ * and the objects the LV refers to. */
+static gchar *
+compute_lv_digest (UDisksLinuxVolumeGroupObject *object,
+                   BDLVMLVdata                  *lv_info,
+                   BDLVMLVdata                  *meta_lv_info,
+                   GHashTable                   *lvs_index)
+{
+  UDisksLinuxLogicalVolumeObject *ref_object;
+  BDLVMLVdata *pool_lv_info;
+  GChecksum *checksum;
+  gchar *ret;
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+  checksum_add_lv (checksum, lv_info);
+  if (meta_lv_info)
+    checksum_add_lv (checksum, meta_lv_info);
+  checksum_add_lv_structure (checksum, lv_info, lvs_index, 0);
+
+  if (lv_info->pool_lv)
+    {
+      pool_lv_info = g_hash_table_lookup (lvs_index, lv_info->pool_lv);
+      if (pool_lv_info)
+        checksum_add_lv (checksum, pool_lv_info);
+      ref_object = g_hash_table_lookup (object->logical_volumes, lv_info->pool_lv);
+      checksum_add_string (checksum, ref_object ? g_dbus_object_get_object_path (G_DBUS_OBJECT (ref_object)) : NULL);
+    }
+  if (lv_info->origin)
+    {
+      ref_object = g_hash_table_lookup (object->logical_volumes, lv_info->origin);
+      checksum_add_string (checksum, ref_object ? g_dbus_object_get_object_path (G_DBUS_OBJECT (ref_object)) : NULL);
+    }
+
+  checksum_add_string (checksum, object->pvs_digest);
+
+  ret = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return ret;
+}
+
+/* Updates @volume unless it's already up to date with @lv_info. */
+static void
+update_logical_volume (UDisksLinuxVolumeGroupObject   *object,
+                       UDisksLinuxLogicalVolumeObject *volume,
+                       BDLVMLVdata                    *lv_info,
+                       BDLVMLVdata                   **lvs,
+                       GHashTable                     *lvs_index,
+                       gboolean                       *needs_polling)
+{
+  BDLVMLVdata *meta_lv_info = NULL;
+  BDLVMVDOPooldata *vdo_info = NULL;
   GError *error = NULL;
-  BDLVMLVdata **lvs = g_task_propagate_pointer (task, &error);
-  BDLVMVGdata *vg_info = data->vg_info;
-  GSList *vg_pvs = data->vg_pvs;
+  gchar *digest;
+
+  if (lv_info->metadata_lv && *(lv_info->metadata_lv) != '\0')
+    meta_lv_info = g_hash_table_lookup (lvs_index, lv_info->metadata_lv);
 
-  if (data->epoch != object->update_epoch)
+  digest = compute_lv_digest (object, lv_info, meta_lv_info, lvs_index);
+  if (udisks_linux_logical_volume_object_is_up_to_date (volume, digest, needs_polling))
     {
-      lv_list_free (lvs);
-      g_slist_free_full (vg_pvs, (GDestroyNotify) bd_lvm_pvdata_free);
-      bd_lvm_vgdata_free (vg_info);
-      g_object_unref (object);
-      g_free (data);
+      g_free (digest);
       return;
     }
 
-  /* free the data container (but not 'vg_info' and 'vg_pvs') */
-  g_free (data);
-
-  if (!lvs)
+  if (lv_info->pool_lv && g_strcmp0 (lv_info->segtype, "vdo") == 0)
     {
-      if (error)
+      vdo_info = bd_lvm_vdo_info (lv_info->vg_name, lv_info->pool_lv, &error);
+      if (!vdo_info)
         {
-          udisks_warning ("Failed to update LVM volume group %s: %s",
-                          udisks_linux_volume_group_object_get_name (object),
-                          error->message);
+          udisks_warning ("Failed to get information about VDO volume %s: %s",
+                          lv_info->lv_name, error->message);
           g_clear_error (&error);
+          /* not up to date with @digest, try again on the next update */
+          g_clear_pointer (&digest, g_free);
         }
-      else
-        {
-          /* this should never happen */
-          udisks_warning ("Failed to update LVM volume group %s: no error reported",
-                          udisks_linux_volume_group_object_get_name (object));
-        }
-      g_slist_free_full (vg_pvs, (GDestroyNotify) bd_lvm_pvdata_free);
-      bd_lvm_vgdata_free (vg_info);
-      g_object_unref (object);
-      return;
     }
 
-  daemon = udisks_module_get_daemon (UDISKS_MODULE (object->module));
-  manager = udisks_daemon_get_object_manager (daemon);
+  udisks_linux_logical_volume_object_update (volume, lv_info, meta_lv_info, lvs, vdo_info, digest, needs_polling);
 
-  udisks_linux_volume_group_update (UDISKS_LINUX_VOLUME_GROUP (object->iface_volume_group), vg_info, vg_pvs,
-                                    &needs_polling);
+  if (vdo_info)
+    bd_lvm_vdopooldata_free (vdo_info);
+  g_free (digest);
+}
 
-  if (!g_dbus_object_manager_server_is_exported (manager, G_DBUS_OBJECT_SKELETON (object)))
-    g_dbus_object_manager_server_export_uniquely (manager, G_DBUS_OBJECT_SKELETON (object));
+static void
+update_lvs (UDisksLinuxVolumeGroupObject *object,
+            BDLVMLVdata                 **lvs,
+            GHashTable                   *new_lvs,
+            gboolean                     *needs_polling)
+{
+  UDisksDaemon *daemon;
+  GDBusObjectManagerServer *manager;
+  GHashTableIter volume_iter;
+  gpointer key, value;
+  GHashTable *lvs_index;
 
-  new_lvs = g_hash_table_new (g_str_hash, g_str_equal);
+  daemon = udisks_module_get_daemon (UDISKS_MODULE (object->module));
+  manager = udisks_daemon_get_object_manager (daemon);
+
+  lvs_index = index_lvs (lvs);
 
   for (BDLVMLVdata **lvs_p=lvs; *lvs_p; lvs_p++)
     {
       UDisksLinuxLogicalVolumeObject *volume;
       BDLVMLVdata *lv_info = *lvs_p;
       const gchar *lv_name = lv_info->lv_name;
-      BDLVMLVdata *meta_lv_info = NULL;
-      BDLVMVDOPooldata *vdo_info = NULL;
 
-      update_operations (object, lv_name, lv_info, &needs_polling);
+      update_operations (object, lv_name, lv_info, needs_polling);
 
       if (udisks_daemon_util_lvm2_name_is_reserved (lv_name))
         continue;
 
-      if (lv_info->metadata_lv && *(lv_info->metadata_lv) != '\0')
-        /* this is not cheap to do, but not many LVs have a metadata LV */
-        for (BDLVMLVdata **lvs_p2=lvs; !meta_lv_info && *lvs_p2; lvs_p2++)
-          if (cmp_int_lv_name ((*lvs_p2)->lv_name, lv_info->metadata_lv))
-            meta_lv_info = *lvs_p2;
-
-      if (lv_info->pool_lv && g_strcmp0 (lv_info->segtype, "vdo") == 0)
-        {
-          vdo_info = bd_lvm_vdo_info (lv_info->vg_name, lv_info->pool_lv, &error);
-          if (!vdo_info)
-            {
-              udisks_warning ("Failed to get information about VDO volume %s: %s",
-                              lv_info->lv_name, error->message);
-              g_clear_error (&error);
-            }
-        }
-
-
       volume = g_hash_table_lookup (object->logical_volumes, lv_name);
       if (volume == NULL)
         {
           volume = udisks_linux_logical_volume_object_new (object->module, object, lv_name);
-          udisks_linux_logical_volume_object_update (volume, lv_info, meta_lv_info, lvs, vdo_info, &needs_polling);
+          update_logical_volume (object, volume, lv_info, lvs, lvs_index, needs_polling);
           udisks_linux_logical_volume_object_update_etctabs (volume);
           g_dbus_object_manager_server_export_uniquely (manager, G_DBUS_OBJECT_SKELETON (volume));
           g_hash_table_insert (object->logical_volumes, g_strdup (lv_name), volume);
         }
       else
-        udisks_linux_logical_volume_object_update (volume, lv_info, meta_lv_info, lvs, vdo_info, &needs_polling);
-
-      if (vdo_info)
-        bd_lvm_vdopooldata_free (vdo_info);
+        update_logical_volume (object, volume, lv_info, lvs, lvs_index, needs_polling);
 
       g_hash_table_insert (new_lvs, (gchar *)lv_name, volume);
     }
@@ -693,14 +846,76 @@ update_vg (GObject      *source_obj,
         }
     }
 
-  udisks_volume_group_set_needs_polling (UDISKS_VOLUME_GROUP (object->iface_volume_group),
-                                         needs_polling);
+  g_hash_table_destroy (lvs_index);
+}
+
+/**
+ * udisks_linux_volume_group_object_update:
+ * @object: A #UDisksLinuxVolumeGroupObject.
+ * @vg_info: (transfer full): LVM volume group info.
+ * @pvs: (transfer full) (element-type BDLVMPVdata): The physical volumes of the volume group.
+ * @lvs: (transfer full): %NULL-terminated array of all logical volumes of the volume group.
+ *
+ * Updates @object and its logical volume objects. The volume group and
+ * logical volume objects are left alone if nothing changed since the
+ * last update, the physical volume block objects are always updated.
+ */
+void
+udisks_linux_volume_group_object_update (UDisksLinuxVolumeGroupObject *object,
+                                         BDLVMVGdata                  *vg_info,
+                                         GSList                       *pvs,
+                                         BDLVMLVdata                 **lvs)
+{
+  UDisksDaemon *daemon;
+  GDBusObjectManagerServer *manager;
+  GHashTableIter volume_iter;
+  gpointer key, value;
+  GHashTable *new_lvs;
+  GHashTable *new_pvs;
+  GList *objects, *l;
+  gchar *digest;
+  gboolean needs_polling = FALSE;
+
+  daemon = udisks_module_get_daemon (UDISKS_MODULE (object->module));
+  manager = udisks_daemon_get_object_manager (daemon);
+
+  new_lvs = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_free (object->pvs_digest);
+  object->pvs_digest = compute_pvs_digest (daemon, pvs);
+
+  digest = compute_digest (vg_info, object->pvs_digest, lvs);
+  if (g_strcmp0 (digest, object->digest) == 0)
+    {
+      g_free (digest);
+
+      /* nothing changed, just make sure the block objects are up to date */
+      g_hash_table_iter_init (&volume_iter, object->logical_volumes);
+      while (g_hash_table_iter_next (&volume_iter, &key, &value))
+        g_hash_table_insert (new_lvs, key, value);
+    }
+  else
+    {
+      g_free (object->digest);
+      object->digest = digest;
+
+      udisks_linux_volume_group_update (UDISKS_LINUX_VOLUME_GROUP (object->iface_volume_group), vg_info, pvs,
+                                        &needs_polling);
+
+      if (!g_dbus_object_manager_server_is_exported (manager, G_DBUS_OBJECT_SKELETON (object)))
+        g_dbus_object_manager_server_export_uniquely (manager, G_DBUS_OBJECT_SKELETON (object));
+
+      update_lvs (object, lvs, new_lvs, &needs_polling);
+
+      udisks_volume_group_set_needs_polling (UDISKS_VOLUME_GROUP (object->iface_volume_group),
+                                             needs_polling);
+    }
 
   /* Update block objects. */
   new_pvs = g_hash_table_new (g_str_hash, g_str_equal);
-  for (GSList *vg_pvs_p=vg_pvs; vg_pvs_p; vg_pvs_p=vg_pvs_p->next)
+  for (GSList *pvs_p=pvs; pvs_p; pvs_p=pvs_p->next)
     {
-      BDLVMPVdata *pv_info = vg_pvs_p->data;
+      BDLVMPVdata *pv_info = pvs_p->data;
       gchar *pv_name = pv_info->pv_name;
       if (pv_name)
         g_hash_table_insert (new_pvs, pv_name, pv_info);
@@ -717,35 +932,12 @@ update_vg (GObject      *source_obj,
   g_hash_table_destroy (new_lvs);
   g_hash_table_destroy (new_pvs);
 
-  g_slist_free_full (vg_pvs, (GDestroyNotify) bd_lvm_pvdata_free);
+  g_slist_free_full (pvs, (GDestroyNotify) bd_lvm_pvdata_free);
   bd_lvm_vgdata_free (vg_info);
   lv_list_free (lvs);
 
   g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (object->iface_volume_group));
-  g_object_unref (object);
-}
-
-void
-udisks_linux_volume_group_object_update (UDisksLinuxVolumeGroupObject *object, BDLVMVGdata *vg_info, GSList *pvs)
-{
-  VGUpdateData *data = g_new0 (VGUpdateData, 1);
-  gchar *vg_name = g_strdup (vg_info->name);
-  GTask *task = NULL;
-
-  object->update_epoch++;
-
-  data->vg_info = vg_info;
-  data->vg_pvs = pvs;
-  data->epoch = object->update_epoch;
-
-  /* the callback (update_vg) is called in the default main loop (context) */
-  task = g_task_new (g_object_ref (object), NULL /* cancellable */, update_vg, data /* callback_data */);
-  g_task_set_task_data (task, vg_name, g_free);
-
-  /* holds a reference to 'task' until it is finished */
-  g_task_run_in_thread (task, (GTaskThreadFunc) lvs_task_func);
-
-  g_object_unref (task);
+  udisks_daemon_notify_objects_changed (daemon);
 }
 
 static void
@@ -753,8 +945,9 @@ poll_vg_update (GObject      *source_obj,
                 GAsyncResult *result,
                 gpointer      user_data)
 {
-  gboolean needs_polling;
+  gboolean needs_polling = FALSE;
   GError *error = NULL;
+  GHashTable *lvs_index;
   UDisksLinuxVolumeGroupObject *object = UDISKS_LINUX_VOLUME_GROUP_OBJECT (source_obj);
   GTask *task = G_TASK (result);
   guint32 epoch_started = GPOINTER_TO_UINT (user_data);
@@ -789,41 +982,23 @@ poll_vg_update (GObject      *source_obj,
   /* XXX: we used to do this, but it seems to be pointless (how could a VG change without emitting a uevent on the PVs?) */
   /* udisks_linux_volume_group_update (UDISKS_LINUX_VOLUME_GROUP (object->iface_volume_group), info, &needs_polling); */
 
+  lvs_index = index_lvs (lvs);
+
   for (BDLVMLVdata **lvs_p=lvs; *lvs_p; lvs_p++)
     {
       UDisksLinuxLogicalVolumeObject *volume;
       BDLVMLVdata *lv_info = *lvs_p;
-      BDLVMLVdata *meta_lv_info = NULL;
       const gchar *lv_name = lv_info->lv_name;
-      BDLVMVDOPooldata *vdo_info = NULL;
-
-      if (lv_info->metadata_lv && *(lv_info->metadata_lv) != '\0')
-        /* this is not cheap to do, but not many LVs have a metadata LV */
-        for (BDLVMLVdata **lvs_np=lvs; !meta_lv_info && *lvs_np; lvs_np++)
-          if (cmp_int_lv_name ((*lvs_np)->lv_name, lv_info->metadata_lv))
-            meta_lv_info = *lvs_np;
-
-      if (lv_info->pool_lv && g_strcmp0 (lv_info->segtype, "vdo") == 0)
-        {
-          vdo_info = bd_lvm_vdo_info (lv_info->vg_name, lv_info->pool_lv, &error);
-          if (!vdo_info)
-            {
-              udisks_warning ("Failed to get information about VDO volume %s: %s",
-                              lv_info->lv_name, error->message);
-              g_clear_error (&error);
-            }
-        }
 
       update_operations (object, lv_name, lv_info, &needs_polling);
       volume = g_hash_table_lookup (object->logical_volumes, lv_name);
       if (volume)
-        udisks_linux_logical_volume_object_update (volume, lv_info, meta_lv_info, lvs, vdo_info, &needs_polling);
-
-      if (vdo_info)
-        bd_lvm_vdopooldata_free (vdo_info);
+        update_logical_volume (object, volume, lv_info, lvs, lvs_index, &needs_polling);
     }
 
+  g_hash_table_destroy (lvs_index);
   lv_list_free (lvs);
+  udisks_daemon_notify_objects_changed (udisks_module_get_daemon (UDISKS_MODULE (object->module)));
   g_object_unref (object);
 }
 
@@ -339,3 +339,26 @@ class UdisksBaseTest(udiskstestcase.UdisksTestCase):
             dev_obj = self.get_object("/block_devices/%s" % os.path.basename(d))
             self.assertIsNotNone(dev_obj)
             self.assertTrue(os.path.exists(d))
+
+    def test_90_stats(self):
+        '''Test the daemon statistics interface (only present with collect_stats=true)'''
+        manager_intro = dbus.Interface(self.manager_obj, "org.freedesktop.DBus.Introspectable")
+        if 'interface name="%s.Manager.Stats"' % self.iface_prefix not in manager_intro.Introspect():
+            self.skipTest('Statistics collection not enabled in udisks2.conf')
+
+        stats = self.get_interface(self.manager_obj, '.Manager.Stats')
+        counters, histograms = stats.GetStats(self.no_options)
+        self.assertEqual(set(counters.keys()),
+                         {'uevents-received', 'uevents-probed', 'uevents-coalesced', 'auth-cache-hits'})
+        self.assertEqual(set(histograms.keys()),
+                         {'probe-latency', 'uevent-dispatch-delay', 'polkit-check', 'spawned-job', 'housekeeping'})
+        for count, total, min_, max_, buckets in histograms.values():
+            self.assertEqual(len(buckets), 32)
+            self.assertEqual(sum(buckets), count)
+            if count > 0:
+                self.assertLessEqual(min_, max_)
+                self.assertLessEqual(max_, total)
+
+        since = self.get_property_raw(self.manager_obj, '.Manager.Stats', 'Since')
+        stats.ResetStats(self.no_options)
+        self.assertGreaterEqual(self.get_property_raw(self.manager_obj, '.Manager.Stats', 'Since'), since)
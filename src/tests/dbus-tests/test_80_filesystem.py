@@ -458,6 +458,46 @@ class UdisksFSTestCase(udiskstestcase.UdisksTestCase):
         size = self.get_property(block_fs, '.Block', 'Size').value
         self.get_property(block_fs, '.Filesystem', 'Size').assertAlmostEqual(size, delta=1024**2)
 
+    def test_usage(self):
+        self._check_can_create()
+
+        if not self._can_mount:
+            self.skipTest('Cannot mount %s filesystem' % self._fs_signature)
+
+        disk = self.get_object('/block_devices/' + os.path.basename(self.vdevs[0]))
+        self.assertIsNotNone(disk)
+
+        # create filesystem
+        disk.Format(self._fs_signature, self.no_options, dbus_interface=self.iface_prefix + '.Block')
+        self.addCleanup(self.wipe_fs, self.vdevs[0])
+
+        # get real block object for the newly created filesystem
+        block_fs, block_fs_dev = self._get_formatted_block_object(self.vdevs[0])
+        self.assertIsNotNone(block_fs)
+        self.assertIsNotNone(block_fs_dev)
+
+        # not mounted -- no usage statistics
+        self.get_property(block_fs, '.Filesystem', 'Used').assertEqual(0)
+        self.get_property(block_fs, '.Filesystem', 'Free').assertEqual(0)
+
+        d = dbus.Dictionary(signature='sv')
+        if self._fs_name:
+            d['fstype'] = self._fs_name
+        d['options'] = 'ro'
+        mnt_path = block_fs.Mount(d, dbus_interface=self.iface_prefix + '.Filesystem')
+        self.addCleanup(self.try_unmount, block_fs_dev)
+        self.addCleanup(self.try_unmount, self.vdevs[0])
+
+        # read-only, so the numbers must match statvfs exactly
+        st = os.statvfs(mnt_path)
+        self.get_property(block_fs, '.Filesystem', 'Free').assertEqual(st.f_bavail * st.f_frsize)
+        self.get_property(block_fs, '.Filesystem', 'Used').assertEqual((st.f_blocks - st.f_bfree) * st.f_frsize)
+        self.get_property(block_fs, '.Filesystem', 'InodesFree').assertEqual(st.f_favail)
+
+        block_fs.Unmount(self.no_options, dbus_interface=self.iface_prefix + '.Filesystem')
+        self.get_property(block_fs, '.Filesystem', 'Used').assertEqual(0)
+        self.get_property(block_fs, '.Filesystem', 'Free').assertEqual(0)
+
     def test_mount_auto(self):
         self._check_can_create()
 
@@ -1471,6 +1511,25 @@ class Ext4TestCase(Ext2TestCase):
         self.assertEqual(sys_stat.st_uid, int(uid))
         self.assertEqual(sys_stat.st_gid, int(gid))
 
+        # a wider and deeper tree, processed by several workers
+        treename = 'udisks_test_tree'
+        for i in range(8):
+            path = os.path.join(mnt_path, treename, *(['d%d' % i] * (i + 1)))
+            os.makedirs(path)
+            for j in range(16):
+                os.mknod(os.path.join(path, 'f%d' % j))
+        for root, dirs, files in os.walk(os.path.join(mnt_path, treename)):
+            for name in [root] + [os.path.join(root, f) for f in files]:
+                os.chown(name, int(uid), int(gid))
+
+        disk.TakeOwnership(d, dbus_interface=self.iface_prefix + '.Filesystem')
+
+        for root, dirs, files in os.walk(os.path.join(mnt_path, treename)):
+            for name in [root] + [os.path.join(root, f) for f in files]:
+                sys_stat = os.lstat(name)
+                self.assertEqual(sys_stat.st_uid, 0, name)
+                self.assertEqual(sys_stat.st_gid, 0, name)
+
     def test_create_format_mkfs_args(self):
         self._check_can_create()
 
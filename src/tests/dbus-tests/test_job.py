@@ -13,6 +13,9 @@ import udiskstestcase
 class UdisksJobTest(udiskstestcase.UdisksTestCase):
     '''This is a basic test suite for job objects and interface'''
 
+    # zeroing out may be offloaded to the device, keep the job around long enough
+    ERASE_RATE_LIMIT = 16 * 1024**2
+
     def setUp(self):
         self.job = None
         self.exception = None
@@ -31,7 +34,8 @@ class UdisksJobTest(udiskstestcase.UdisksTestCase):
                                 self.path_prefix + '/block_devices/' + devname,
                                 self.iface_prefix + '.Block',
                                 'Format',
-                                GLib.Variant('(sa{sv})', ('empty', {'erase': GLib.Variant("s", 'zero')})))
+                                GLib.Variant('(sa{sv})', ('empty', {'erase': GLib.Variant("s", 'zero'),
+                                                                    'erase-rate-limit': GLib.Variant("t", self.ERASE_RATE_LIMIT)})))
         except Exception as e:
             self.exception = e
 
@@ -145,3 +149,42 @@ class UdisksJobTest(udiskstestcase.UdisksTestCase):
         self.assertIsNotNone(self.exception)
         self.assertTrue(isinstance(self.exception, safe_dbus.DBusCallError))
         self.assertIn('Error erasing device: Job was canceled', str(self.exception))
+
+    def test_rate_limit(self):
+        '''Test that the erase rate limit is honored and reported by the Job'''
+
+        disk_name = os.path.basename(self.vdevs[0])
+        obj_path = self.path_prefix + '/block_devices/' + disk_name
+
+        watch_thread = threading.Thread(target=self._wait_for_job_thread, args=('format-erase', obj_path))
+        watch_thread.start()
+
+        erase_thread = threading.Thread(target=self._secure_erase, args=(disk_name,))
+        erase_thread.start()
+
+        watch_thread.join(timeout=10)
+        if not self.job:
+            watch_thread.run = False
+            if self.exception:
+                raise self.exception
+            else:
+                self.fail('Failed to find the job objects.')
+
+        job_path = self.job[0]
+        job = self.get_object(job_path)
+
+        # progress is updated about once a second, the rate is estimated after a few updates
+        rate = self.get_property(job, '.Job', 'Rate')
+        rate.assertGreater(0, timeout=10)
+        self.assertLessEqual(self.get_property_raw(job, '.Job', 'Rate'), self.ERASE_RATE_LIMIT * 1.2)
+        self.assertLessEqual(self.get_property_raw(job, '.Job', 'InstantaneousRate'), self.ERASE_RATE_LIMIT * 1.2)
+        confidence = self.get_property_raw(job, '.Job', 'RateConfidence')
+        self.assertGreater(confidence, 0.0)
+        self.assertLessEqual(confidence, 1.0)
+
+        safe_dbus.call_sync(self.iface_prefix,
+                            job_path,
+                            self.iface_prefix + '.Job',
+                            'Cancel',
+                            GLib.Variant('(a{sv})', ({},)))
+        erase_thread.join()
@@ -30,6 +30,7 @@
 #include <udisksdaemon.h>
 #include <udisksspawnedjob.h>
 #include <udisksthreadedjob.h>
+#include <udisksworkerpool.h>
 
 #include "testutil.h"
 
@@ -678,6 +679,96 @@ test_threaded_job_override_signal_handler (void)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+typedef struct
+{
+  GMutex lock;
+  GCond cond;
+  gboolean released;
+  gint n_finished;    /* accessed atomically */
+  gint n_cancelled;   /* accessed atomically */
+  gint n_timed_out;
+} WorkerPoolData;
+
+static void
+worker_pool_func (gpointer      data,
+                  GCancellable *cancellable,
+                  gpointer      user_data)
+{
+  WorkerPoolData *wpd = user_data;
+
+  g_assert (g_thread_self () != main_thread);
+  if (GPOINTER_TO_INT (data))
+    {
+      /* an unresponsive drive, ignores the cancellation */
+      g_mutex_lock (&wpd->lock);
+      while (!wpd->released)
+        g_cond_wait (&wpd->cond, &wpd->lock);
+      g_mutex_unlock (&wpd->lock);
+    }
+  if (g_cancellable_is_cancelled (cancellable))
+    g_atomic_int_inc (&wpd->n_cancelled);
+  g_atomic_int_inc (&wpd->n_finished);
+  g_main_context_wakeup (NULL);
+}
+
+static void
+worker_pool_timeout_func (gpointer data,
+                          gpointer user_data)
+{
+  WorkerPoolData *wpd = user_data;
+
+  g_assert (g_thread_self () == main_thread);
+  g_assert (GPOINTER_TO_INT (data));
+  wpd->n_timed_out++;
+}
+
+static void
+test_worker_pool_timed_out (void)
+{
+  UDisksWorkerPool *pool;
+  WorkerPoolData wpd = { 0, };
+  gint n;
+
+  g_mutex_init (&wpd.lock);
+  g_cond_init (&wpd.cond);
+
+  /* more blocked items than workers, followed by responsive ones */
+  pool = udisks_worker_pool_new (worker_pool_func, worker_pool_timeout_func, &wpd, NULL, 4, 100 /* msec */);
+  for (n = 0; n < 6; n++)
+    udisks_worker_pool_push (pool, GINT_TO_POINTER (TRUE));
+  for (n = 0; n < 2; n++)
+    udisks_worker_pool_push (pool, GINT_TO_POINTER (FALSE));
+
+  /* the timed out items must not keep their slots */
+  while (g_atomic_int_get (&wpd.n_finished) < 2)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpint (wpd.n_timed_out, >=, 4);
+  while (wpd.n_timed_out < 6)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpint (g_atomic_int_get (&wpd.n_finished), ==, 2);
+  g_assert_cmpint (g_atomic_int_get (&wpd.n_cancelled), ==, 0);
+
+  g_mutex_lock (&wpd.lock);
+  wpd.released = TRUE;
+  g_cond_broadcast (&wpd.cond);
+  g_mutex_unlock (&wpd.lock);
+  while (g_atomic_int_get (&wpd.n_finished) < 8)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpint (g_atomic_int_get (&wpd.n_cancelled), ==, 6);
+  g_assert_cmpint (wpd.n_timed_out, ==, 6);
+
+  /* the pool keeps working after giving the extra threads back */
+  udisks_worker_pool_push (pool, GINT_TO_POINTER (FALSE));
+  while (g_atomic_int_get (&wpd.n_finished) < 9)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (pool);
+  g_mutex_clear (&wpd.lock);
+  g_cond_clear (&wpd.cond);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 int
 main (int    argc,
       char **argv)
@@ -719,6 +810,7 @@ main (int    argc,
   g_test_add_func ("/udisks/daemon/threaded_job_sync/failure", test_threaded_job_sync_failure);
   g_test_add_func ("/udisks/daemon/threaded_job_sync/cancelled_at_start", test_threaded_job_sync_cancelled_at_start);
   g_test_add_func ("/udisks/daemon/threaded_job_sync/cancelled_midway", test_threaded_job_sync_cancelled_midway);
+  g_test_add_func ("/udisks/daemon/worker_pool/timed_out", test_worker_pool_timed_out);
 
   ret = g_test_run();
 
@@ -0,0 +1,463 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib/gi18n-lib.h>
+
+#include "udisksauthcache.h"
+#include "udiskslogging.h"
+
+/**
+ * SECTION:udisksauthcache
+ * @title: UDisksAuthCache
+ * @short_description: Cache of positive authorization results
+ *
+ * This type remembers positive polkit authorization results for a
+ * short time so that clients issuing many requests without user
+ * interaction don't pay a polkit round trip for each of them.
+ *
+ * Entries are keyed by the unique bus name of the caller, the action
+ * id, the object the action is performed on and any extra details
+ * passed to polkit. All entries for a caller are dropped once it
+ * disconnects from the bus and the whole cache is flushed whenever
+ * polkit signals a change (of its configuration, rules or temporary
+ * authorizations). Results based on a temporary authorization must not
+ * be added - polkit doesn't signal their expiration. The entries for an
+ * object are dropped when it goes away, the object path may be reused
+ * for a different device which polkit rules may treat differently.
+ *
+ * A check that was already running when the cache got flushed (or an
+ * object got removed) may have been answered based on the old state,
+ * so callers take the generation of the cache with
+ * udisks_auth_cache_get_generation() before starting a check and pass it
+ * to udisks_auth_cache_add() - the result is dropped if it changed.
+ *
+ * The cache is disabled when created with a zero timeout, see the
+ * <literal>auth_cache_timeout</literal> option in
+ * <filename>udisks2.conf</filename>.
+ */
+
+struct _UDisksAuthCache
+{
+  GObject parent_instance;
+
+  GDBusConnection *connection;
+  PolkitAuthority *authority;
+  gint64 timeout;                 /* usec, 0 if disabled */
+  guint name_owner_changed_id;
+
+  GMutex lock;
+  GHashTable *senders;            /* unique name -> GHashTable (key -> gint64 expiry) */
+  guint generation;               /* bumped whenever entries are invalidated */
+};
+
+typedef struct _UDisksAuthCacheClass UDisksAuthCacheClass;
+
+struct _UDisksAuthCacheClass
+{
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (UDisksAuthCache, udisks_auth_cache, G_TYPE_OBJECT);
+
+static void on_authority_changed (PolkitAuthority *authority,
+                                  gpointer         user_data);
+
+static void
+udisks_auth_cache_init (UDisksAuthCache *cache)
+{
+  g_mutex_init (&cache->lock);
+  cache->senders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+}
+
+static void
+udisks_auth_cache_finalize (GObject *object)
+{
+  UDisksAuthCache *cache = UDISKS_AUTH_CACHE (object);
+
+  if (cache->name_owner_changed_id > 0)
+    g_dbus_connection_signal_unsubscribe (cache->connection, cache->name_owner_changed_id);
+  if (cache->authority != NULL)
+    g_signal_handlers_disconnect_by_func (cache->authority, G_CALLBACK (on_authority_changed), cache);
+
+  g_clear_object (&cache->connection);
+  g_clear_object (&cache->authority);
+  g_hash_table_unref (cache->senders);
+  g_mutex_clear (&cache->lock);
+
+  G_OBJECT_CLASS (udisks_auth_cache_parent_class)->finalize (object);
+}
+
+static void
+udisks_auth_cache_class_init (UDisksAuthCacheClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = udisks_auth_cache_finalize;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+on_authority_changed (PolkitAuthority *authority,
+                      gpointer         user_data)
+{
+  UDisksAuthCache *cache = UDISKS_AUTH_CACHE (user_data);
+
+  udisks_debug ("Flushing authorization cache: polkit authority changed");
+  udisks_auth_cache_flush (cache);
+}
+
+static void
+on_name_owner_changed (GDBusConnection *connection,
+                       const gchar     *sender_name,
+                       const gchar     *object_path,
+                       const gchar     *interface_name,
+                       const gchar     *signal_name,
+                       GVariant        *parameters,
+                       gpointer         user_data)
+{
+  UDisksAuthCache *cache = UDISKS_AUTH_CACHE (user_data);
+  const gchar *name;
+  const gchar *old_owner;
+  const gchar *new_owner;
+
+  if (!g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sss)")))
+    return;
+
+  g_variant_get (parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+
+  /* only unique names ever get cached and they are never reused */
+  if (name[0] != ':' || new_owner[0] != '\0')
+    return;
+
+  g_mutex_lock (&cache->lock);
+  g_hash_table_remove (cache->senders, name);
+  g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * udisks_auth_cache_new:
+ * @connection: The #GDBusConnection the daemon is serving on.
+ * @authority: (nullable): The #PolkitAuthority to watch for changes or %NULL.
+ * @timeout: For how long to keep positive results, in seconds. 0 disables the cache.
+ *
+ * Creates a new #UDisksAuthCache. Must be called from the main thread,
+ * the invalidation signals are delivered there.
+ *
+ * Returns: A new #UDisksAuthCache. Free with g_object_unref().
+ */
+UDisksAuthCache *
+udisks_auth_cache_new (GDBusConnection *connection,
+                       PolkitAuthority *authority,
+                       guint            timeout)
+{
+  UDisksAuthCache *cache;
+
+  g_return_val_if_fail (G_IS_DBUS_CONNECTION (connection), NULL);
+
+  cache = UDISKS_AUTH_CACHE (g_object_new (UDISKS_TYPE_AUTH_CACHE, NULL));
+  cache->timeout = (gint64) timeout * G_USEC_PER_SEC;
+
+  /* nothing to invalidate if nothing is ever cached */
+  if (cache->timeout == 0 || authority == NULL)
+    {
+      cache->timeout = 0;
+      return cache;
+    }
+
+  cache->connection = g_object_ref (connection);
+  cache->authority = g_object_ref (authority);
+  g_signal_connect (cache->authority, "changed", G_CALLBACK (on_authority_changed), cache);
+  cache->name_owner_changed_id = g_dbus_connection_signal_subscribe (cache->connection,
+                                                                     "org.freedesktop.DBus",  /* sender */
+                                                                     "org.freedesktop.DBus",  /* interface */
+                                                                     "NameOwnerChanged",      /* member */
+                                                                     "/org/freedesktop/DBus", /* object path */
+                                                                     NULL,                    /* arg0 */
+                                                                     G_DBUS_SIGNAL_FLAGS_NONE,
+                                                                     on_name_owner_changed,
+                                                                     cache,
+                                                                     NULL);
+  return cache;
+}
+
+static gchar *
+make_key (const gchar *action_id,
+          const gchar *object_path,
+          const gchar *extra)
+{
+  return g_strjoin ("\n", action_id, object_path != NULL ? object_path : "", extra != NULL ? extra : "", NULL);
+}
+
+/* Checks whether @key made by make_key() is for @object_path */
+static gboolean
+key_has_object_path (const gchar *key,
+                     const gchar *object_path)
+{
+  const gchar *path;
+  gsize len;
+
+  path = strchr (key, '\n');
+  if (path == NULL)
+    return FALSE;
+  path++;
+  len = strlen (object_path);
+  return strncmp (path, object_path, len) == 0 && path[len] == '\n';
+}
+
+/**
+ * udisks_auth_cache_lookup:
+ * @cache: A #UDisksAuthCache.
+ * @sender: The unique bus name of the caller.
+ * @action_id: The polkit action id.
+ * @object_path: (nullable): The object the action is performed on or %NULL.
+ * @extra: (nullable): Any extra details the result depends on or %NULL.
+ *
+ * Checks whether @sender has recently been authorized for @action_id.
+ *
+ * This function may be called from any thread.
+ *
+ * Returns: %TRUE if a valid positive result is cached, %FALSE otherwise.
+ */
+gboolean
+udisks_auth_cache_lookup (UDisksAuthCache *cache,
+                          const gchar     *sender,
+                          const gchar     *action_id,
+                          const gchar     *object_path,
+                          const gchar     *extra)
+{
+  GHashTable *entries;
+  gpointer expiry;
+  gchar *key;
+  gboolean ret = FALSE;
+
+  g_return_val_if_fail (UDISKS_IS_AUTH_CACHE (cache), FALSE);
+
+  if (cache->timeout == 0 || sender == NULL)
+    return FALSE;
+
+  key = make_key (action_id, object_path, extra);
+
+  g_mutex_lock (&cache->lock);
+  entries = g_hash_table_lookup (cache->senders, sender);
+  if (entries != NULL && g_hash_table_lookup_extended (entries, key, NULL, &expiry))
+    {
+      if (*(gint64 *) expiry > g_get_monotonic_time ())
+        ret = TRUE;
+      else
+        g_hash_table_remove (entries, key);
+    }
+  g_mutex_unlock (&cache->lock);
+
+  g_free (key);
+  return ret;
+}
+
+/* Only called for a sender's first entry, see udisks_auth_cache_add() */
+static gboolean
+name_has_owner (UDisksAuthCache *cache,
+                const gchar     *name)
+{
+  GVariant *value;
+  GError *error = NULL;
+  gboolean ret = FALSE;
+
+  value = g_dbus_connection_call_sync (cache->connection,
+                                       "org.freedesktop.DBus",  /* bus name */
+                                       "/org/freedesktop/DBus", /* object path */
+                                       "org.freedesktop.DBus",  /* interface */
+                                       "NameHasOwner",          /* method */
+                                       g_variant_new ("(s)", name),
+                                       G_VARIANT_TYPE ("(b)"),
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1,                      /* timeout_msec */
+                                       NULL,                    /* GCancellable */
+                                       &error);
+  if (value == NULL)
+    {
+      udisks_warning ("Error checking whether %s is still connected: %s", name, error->message);
+      g_clear_error (&error);
+      return FALSE;
+    }
+
+  g_variant_get (value, "(b)", &ret);
+  g_variant_unref (value);
+  return ret;
+}
+
+static gboolean
+entry_is_expired (gpointer key,
+                  gpointer value,
+                  gpointer user_data)
+{
+  return *(gint64 *) value <= *(gint64 *) user_data;
+}
+
+/**
+ * udisks_auth_cache_add:
+ * @cache: A #UDisksAuthCache.
+ * @sender: The unique bus name of the caller.
+ * @action_id: The polkit action id.
+ * @object_path: (nullable): The object the action is performed on or %NULL.
+ * @extra: (nullable): Any extra details the result depends on or %NULL.
+ * @generation: The value returned by udisks_auth_cache_get_generation() before the check started.
+ *
+ * Records that @sender has been authorized for @action_id. Only pass
+ * results that were obtained without user interaction and that are not
+ * based on a temporary authorization. Nothing is recorded if the cache
+ * was invalidated since @generation was taken.
+ *
+ * This function may be called from any thread.
+ */
+void
+udisks_auth_cache_add (UDisksAuthCache *cache,
+                       const gchar     *sender,
+                       const gchar     *action_id,
+                       const gchar     *object_path,
+                       const gchar     *extra,
+                       guint            generation)
+{
+  GHashTable *entries;
+  gint64 now;
+  gint64 *expiry;
+  gboolean new_sender = FALSE;
+
+  g_return_if_fail (UDISKS_IS_AUTH_CACHE (cache));
+
+  if (cache->timeout == 0 || sender == NULL || sender[0] != ':')
+    return;
+
+  now = g_get_monotonic_time ();
+  expiry = g_new (gint64, 1);
+  *expiry = now + cache->timeout;
+
+  g_mutex_lock (&cache->lock);
+  if (generation != cache->generation)
+    {
+      /* the result may predate the change */
+      g_mutex_unlock (&cache->lock);
+      g_free (expiry);
+      return;
+    }
+  entries = g_hash_table_lookup (cache->senders, sender);
+  if (entries == NULL)
+    {
+      entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+      g_hash_table_insert (cache->senders, g_strdup (sender), entries);
+      new_sender = TRUE;
+    }
+  else
+    {
+      /* keep the table from growing with objects that come and go */
+      g_hash_table_foreach_remove (entries, entry_is_expired, &now);
+    }
+  g_hash_table_replace (entries, make_key (action_id, object_path, extra), expiry);
+  g_mutex_unlock (&cache->lock);
+
+  /* The sender may have disconnected (and NameOwnerChanged may have been
+   * handled) while it was being authorized, its entries would never be
+   * dropped then. Unique names are never reused, so checking once the
+   * entries are in place is enough.
+   */
+  if (new_sender && !name_has_owner (cache, sender))
+    {
+      g_mutex_lock (&cache->lock);
+      g_hash_table_remove (cache->senders, sender);
+      g_mutex_unlock (&cache->lock);
+    }
+}
+
+/**
+ * udisks_auth_cache_flush:
+ * @cache: A #UDisksAuthCache.
+ *
+ * Drops all cached results.
+ */
+void
+udisks_auth_cache_flush (UDisksAuthCache *cache)
+{
+  g_return_if_fail (UDISKS_IS_AUTH_CACHE (cache));
+
+  g_mutex_lock (&cache->lock);
+  g_hash_table_remove_all (cache->senders);
+  cache->generation++;
+  g_mutex_unlock (&cache->lock);
+}
+
+static gboolean
+entry_is_for_object (gpointer key,
+                     gpointer value,
+                     gpointer user_data)
+{
+  return key_has_object_path (key, user_data);
+}
+
+/**
+ * udisks_auth_cache_forget_object:
+ * @cache: A #UDisksAuthCache.
+ * @object_path: The object path of an object that went away.
+ *
+ * Drops all cached results for @object_path.
+ *
+ * This function may be called from any thread.
+ */
+void
+udisks_auth_cache_forget_object (UDisksAuthCache *cache,
+                                 const gchar     *object_path)
+{
+  GHashTableIter iter;
+  gpointer entries;
+
+  g_return_if_fail (UDISKS_IS_AUTH_CACHE (cache));
+  g_return_if_fail (object_path != NULL);
+
+  g_mutex_lock (&cache->lock);
+  g_hash_table_iter_init (&iter, cache->senders);
+  while (g_hash_table_iter_next (&iter, NULL, &entries))
+    g_hash_table_foreach_remove (entries, entry_is_for_object, (gpointer) object_path);
+  cache->generation++;
+  g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * udisks_auth_cache_get_generation:
+ * @cache: A #UDisksAuthCache.
+ *
+ * Gets the generation of @cache, to be passed to udisks_auth_cache_add().
+ *
+ * This function may be called from any thread.
+ *
+ * Returns: The number of times the entries were invalidated.
+ */
+guint
+udisks_auth_cache_get_generation (UDisksAuthCache *cache)
+{
+  guint ret;
+
+  g_return_val_if_fail (UDISKS_IS_AUTH_CACHE (cache), 0);
+
+  g_mutex_lock (&cache->lock);
+  ret = cache->generation;
+  g_mutex_unlock (&cache->lock);
+  return ret;
+}
@@ -0,0 +1,52 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __UDISKS_AUTH_CACHE_H__
+#define __UDISKS_AUTH_CACHE_H__
+
+#include "udisksdaemontypes.h"
+
+G_BEGIN_DECLS
+
+#define UDISKS_TYPE_AUTH_CACHE         (udisks_auth_cache_get_type ())
+#define UDISKS_AUTH_CACHE(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), UDISKS_TYPE_AUTH_CACHE, UDisksAuthCache))
+#define UDISKS_IS_AUTH_CACHE(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), UDISKS_TYPE_AUTH_CACHE))
+
+GType             udisks_auth_cache_get_type  (void) G_GNUC_CONST;
+UDisksAuthCache  *udisks_auth_cache_new       (GDBusConnection *connection,
+                                               PolkitAuthority *authority,
+                                               guint            timeout);
+gboolean          udisks_auth_cache_lookup    (UDisksAuthCache *cache,
+                                               const gchar     *sender,
+                                               const gchar     *action_id,
+                                               const gchar     *object_path,
+                                               const gchar     *extra);
+void              udisks_auth_cache_add       (UDisksAuthCache *cache,
+                                               const gchar     *sender,
+                                               const gchar     *action_id,
+                                               const gchar     *object_path,
+                                               const gchar     *extra,
+                                               guint            generation);
+void              udisks_auth_cache_flush     (UDisksAuthCache *cache);
+void              udisks_auth_cache_forget_object  (UDisksAuthCache *cache,
+                                                    const gchar     *object_path);
+guint             udisks_auth_cache_get_generation (UDisksAuthCache *cache);
+
+G_END_DECLS
+
+#endif /* __UDISKS_AUTH_CACHE_H__ */
@@ -29,11 +29,18 @@
 #include "udisksdaemonutil.h"
 #include "udisks-daemon-marshal.h"
 
-#define MAX_SAMPLES 100
+/* Progress samples kept for the instantaneous rate */
+#define MAX_SAMPLES 32
+/* Samples needed before publishing an estimate */
+#define MIN_SAMPLES 3
+/* The time span the instantaneous rate is computed over */
+#define INSTANT_RATE_WINDOW_USEC (2 * G_USEC_PER_SEC)
+/* Time constant of the smoothed rate */
+#define RATE_SMOOTHING_USEC (10 * G_USEC_PER_SEC)
 
 typedef struct
 {
-  gint64 time_usec;
+  gint64 time_usec;       /* monotonic */
   gdouble value;
 } Sample;
 
@@ -53,8 +60,13 @@ struct _UDisksBaseJobPrivate
   gboolean auto_estimate;
   gulong notify_progress_signal_handler_id;
 
-  Sample *samples;
+  Sample *samples;         /* ring buffer of MAX_SAMPLES */
+  guint samples_head;      /* where the next sample goes */
   guint num_samples;
+
+  gdouble smoothed_speed;  /* progress per usec */
+  gdouble speed_variance;
+  gint64 observed_usec;
 };
 
 static void job_iface_init (UDisksJobIface *iface);
@@ -221,9 +233,10 @@ udisks_base_job_class_init (UDisksBaseJobClass *klass)
   /**
    * UDisksBaseJob:auto-estimate:
    *
-   * If %TRUE, the #UDisksJob:expected-end-time property will be
-   * automatically updated every time the #UDisksJob:progress property
-   * is updated.
+   * If %TRUE, the #UDisksJob:expected-end-time, #UDisksJob:rate,
+   * #UDisksJob:instantaneous-rate and #UDisksJob:rate-confidence
+   * properties will be automatically updated every time the
+   * #UDisksJob:progress property is updated.
    */
   g_object_class_install_property (gobject_class,
                                    PROP_AUTO_ESTIMATE,
@@ -458,6 +471,25 @@ udisks_base_job_get_auto_estimate (UDisksBaseJob  *job)
 }
 
 
+static void
+reset_estimate (UDisksBaseJob *job)
+{
+  job->priv->samples_head = 0;
+  job->priv->num_samples = 0;
+  job->priv->smoothed_speed = 0.0;
+  job->priv->speed_variance = 0.0;
+  job->priv->observed_usec = 0;
+}
+
+/* @n is 0 for the newest sample */
+static Sample *
+get_sample (UDisksBaseJob *job,
+            guint          n)
+{
+  g_assert (n < job->priv->num_samples);
+  return &job->priv->samples[(job->priv->samples_head + MAX_SAMPLES - 1 - n) % MAX_SAMPLES];
+}
+
 static void
 on_notify_progress (GObject     *object,
                     GParamSpec  *spec,
@@ -465,59 +497,109 @@ on_notify_progress (GObject     *object,
 {
   UDisksBaseJob *job = UDISKS_BASE_JOB (user_data);
   Sample *sample;
+  Sample *prev;
+  Sample *oldest;
   guint n;
-  gdouble sum_of_speeds;
-  guint num_speeds;
-  gdouble avg_speed;
+  gdouble speed;
+  gdouble instant_speed;
+  gdouble confidence;
   gint64 usec_remaining;
   gint64 now;
+  gint64 dt;
   guint64 bytes;
   gdouble current_progress;
 
-  now = g_get_real_time ();
+  /* wall-clock time may be stepped, only use it for the end time itself */
+  now = g_get_monotonic_time ();
   current_progress = udisks_job_get_progress (UDISKS_JOB (job));
 
-  /* first add new sample... */
-  if (job->priv->num_samples == MAX_SAMPLES)
+  if (job->priv->num_samples > 0)
     {
-      memmove (job->priv->samples, job->priv->samples + 1, sizeof (Sample) * (MAX_SAMPLES - 1));
-      job->priv->num_samples -= 1;
+      sample = get_sample (job, 0);
+      if (current_progress < sample->value)
+        {
+          /* progress went backwards, e.g. the next stage started */
+          reset_estimate (job);
+        }
+      else if (now <= sample->time_usec)
+        {
+          sample->value = current_progress;
+          goto out;
+        }
     }
-  sample = &job->priv->samples[job->priv->num_samples++];
+
+  /* first add new sample... */
+  sample = &job->priv->samples[job->priv->samples_head];
   sample->time_usec = now;
   sample->value = current_progress;
+  job->priv->samples_head = (job->priv->samples_head + 1) % MAX_SAMPLES;
+  if (job->priv->num_samples < MAX_SAMPLES)
+    job->priv->num_samples++;
 
-  /* ... then update expected-end-time from samples - we want at
-   * least five samples before making an estimate...
-   */
-  if (job->priv->num_samples < 5)
+  if (job->priv->num_samples < 2)
     goto out;
 
-  num_speeds = 0;
-  sum_of_speeds = 0.0;
-  for (n = 1; n < job->priv->num_samples; n++)
+  /* ... then update the exponentially weighted average and variance of
+   * the speed, weighing each interval by its length so that bursts of
+   * notifications don't dominate...
+   */
+  prev = get_sample (job, 1);
+  dt = now - prev->time_usec;
+  speed = (current_progress - prev->value) / dt;
+  if (job->priv->observed_usec == 0)
     {
-      Sample *a = &job->priv->samples[n-1];
-      Sample *b = &job->priv->samples[n];
-      gdouble speed;
-      speed = (b->value - a->value) / (b->time_usec - a->time_usec);
-      sum_of_speeds += speed;
-      num_speeds++;
+      job->priv->smoothed_speed = speed;
+      job->priv->speed_variance = 0.0;
     }
-  avg_speed = sum_of_speeds / num_speeds;
+  else
+    {
+      gdouble alpha;
+      gdouble diff;
 
-  bytes = udisks_job_get_bytes (UDISKS_JOB (job));
-  if (bytes > 0)
+      alpha = (gdouble) dt / (dt + RATE_SMOOTHING_USEC);
+      diff = speed - job->priv->smoothed_speed;
+      job->priv->smoothed_speed += alpha * diff;
+      job->priv->speed_variance = (1.0 - alpha) * (job->priv->speed_variance + alpha * diff * diff);
+    }
+  job->priv->observed_usec += dt;
+
+  /* ... and only publish it once there are a few samples */
+  if (job->priv->num_samples < MIN_SAMPLES)
+    goto out;
+
+  /* the instantaneous speed is taken over the last couple of seconds */
+  oldest = prev;
+  for (n = 2; n < job->priv->num_samples; n++)
     {
-      udisks_job_set_rate (UDISKS_JOB (job), bytes * avg_speed * G_USEC_PER_SEC);
+      Sample *s = get_sample (job, n);
+      if (now - s->time_usec > INSTANT_RATE_WINDOW_USEC)
+        break;
+      oldest = s;
     }
-  else
+  instant_speed = (current_progress - oldest->value) / (now - oldest->time_usec);
+
+  /* confidence grows as the smoothing window fills up and drops with
+   * the relative variance of the speed
+   */
+  confidence = 0.0;
+  if (job->priv->smoothed_speed > 0.0)
     {
-      udisks_job_set_rate (UDISKS_JOB (job), 0);
+      gdouble relative_variance;
+
+      relative_variance = job->priv->speed_variance / (job->priv->smoothed_speed * job->priv->smoothed_speed);
+      confidence = MIN (1.0, (gdouble) job->priv->observed_usec / RATE_SMOOTHING_USEC) / (1.0 + relative_variance);
     }
 
-  usec_remaining = (1.0 - current_progress) / avg_speed;
-  udisks_job_set_expected_end_time (UDISKS_JOB (job), now + usec_remaining);
+  bytes = udisks_job_get_bytes (UDISKS_JOB (job));
+  udisks_job_set_rate (UDISKS_JOB (job), bytes * job->priv->smoothed_speed * G_USEC_PER_SEC);
+  udisks_job_set_instantaneous_rate (UDISKS_JOB (job), bytes * instant_speed * G_USEC_PER_SEC);
+  udisks_job_set_rate_confidence (UDISKS_JOB (job), confidence);
+
+  if (job->priv->smoothed_speed > 0.0)
+    {
+      usec_remaining = (1.0 - current_progress) / job->priv->smoothed_speed;
+      udisks_job_set_expected_end_time (UDISKS_JOB (job), g_get_real_time () + usec_remaining);
+    }
 
  out:
   ;
@@ -543,6 +625,7 @@ udisks_base_job_set_auto_estimate (UDisksBaseJob  *job,
     {
       if (job->priv->samples == NULL)
         job->priv->samples = g_new0 (Sample, MAX_SAMPLES);
+      reset_estimate (job);
       g_assert_cmpint (job->priv->notify_progress_signal_handler_id, ==, 0);
       job->priv->notify_progress_signal_handler_id = g_signal_connect (job,
                                                                        "notify::progress",
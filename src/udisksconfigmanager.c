@@ -37,6 +37,10 @@ struct _UDisksConfigManager {
 
   const gchar *encryption;
   gchar *config_dir;
+
+  guint uevent_coalesce_window;
+  gboolean collect_stats;
+  guint auth_cache_timeout;
 };
 
 struct _UDisksConfigManagerClass {
@@ -57,6 +61,9 @@ enum
 #define MODULES_GROUP_NAME  PACKAGE_NAME_UDISKS2
 #define MODULES_KEY "modules"
 #define MODULES_LOAD_PREFERENCE_KEY "modules_load_preference"
+#define UEVENT_COALESCE_WINDOW_KEY "uevent_coalesce_window"
+#define COLLECT_STATS_KEY "collect_stats"
+#define AUTH_CACHE_TIMEOUT_KEY "auth_cache_timeout"
 
 #define DEFAULTS_GROUP_NAME "defaults"
 #define DEFAULTS_ENCRYPTION_KEY "encryption"
@@ -142,6 +149,9 @@ static void
 parse_config_file (UDisksConfigManager         *manager,
                    UDisksModuleLoadPreference  *out_load_preference,
                    const gchar                **out_encryption,
+                   guint                       *out_uevent_coalesce_window,
+                   gboolean                    *out_collect_stats,
+                   guint                       *out_auth_cache_timeout,
                    GList                      **out_modules)
 {
   GKeyFile *config_file;
@@ -213,6 +223,62 @@ parse_config_file (UDisksConfigManager         *manager,
             }
         }
 
+      if (out_uevent_coalesce_window != NULL &&
+          g_key_file_has_key (config_file, MODULES_GROUP_NAME, UEVENT_COALESCE_WINDOW_KEY, NULL))
+        {
+          gint window;
+
+          /* Read the uevent coalescing window configuration option. */
+          window = g_key_file_get_integer (config_file, MODULES_GROUP_NAME, UEVENT_COALESCE_WINDOW_KEY, &l_error);
+          if (l_error != NULL || window < 0)
+            {
+              udisks_warning ("Invalid value used for 'uevent_coalesce_window'; defaulting to %u",
+                              UDISKS_UEVENT_COALESCE_WINDOW_DEFAULT);
+              g_clear_error (&l_error);
+            }
+          else
+            {
+              *out_uevent_coalesce_window = window;
+            }
+        }
+
+      if (out_collect_stats != NULL &&
+          g_key_file_has_key (config_file, MODULES_GROUP_NAME, COLLECT_STATS_KEY, NULL))
+        {
+          gboolean collect_stats;
+
+          /* Read the statistics collection configuration option. */
+          collect_stats = g_key_file_get_boolean (config_file, MODULES_GROUP_NAME, COLLECT_STATS_KEY, &l_error);
+          if (l_error != NULL)
+            {
+              udisks_warning ("Invalid value used for 'collect_stats'; defaulting to 'false'");
+              g_clear_error (&l_error);
+            }
+          else
+            {
+              *out_collect_stats = collect_stats;
+            }
+        }
+
+      if (out_auth_cache_timeout != NULL &&
+          g_key_file_has_key (config_file, MODULES_GROUP_NAME, AUTH_CACHE_TIMEOUT_KEY, NULL))
+        {
+          gint timeout;
+
+          /* Read the authorization cache timeout configuration option. */
+          timeout = g_key_file_get_integer (config_file, MODULES_GROUP_NAME, AUTH_CACHE_TIMEOUT_KEY, &l_error);
+          if (l_error != NULL || timeout < 0)
+            {
+              udisks_warning ("Invalid value used for 'auth_cache_timeout'; defaulting to %u",
+                              UDISKS_AUTH_CACHE_TIMEOUT_DEFAULT);
+              g_clear_error (&l_error);
+            }
+          else
+            {
+              *out_auth_cache_timeout = timeout;
+            }
+        }
+
       if (out_encryption != NULL)
         {
           /* Read the load preference configuration option. */
@@ -260,7 +326,13 @@ udisks_config_manager_constructed (GObject *object)
       udisks_warning ("Error creating directory %s: %m", manager->config_dir);
     }
 
-  parse_config_file (manager, &manager->load_preference, &manager->encryption, NULL);
+  parse_config_file (manager,
+                     &manager->load_preference,
+                     &manager->encryption,
+                     &manager->uevent_coalesce_window,
+                     &manager->collect_stats,
+                     &manager->auth_cache_timeout,
+                     NULL);
 
   if (G_OBJECT_CLASS (udisks_config_manager_parent_class))
     G_OBJECT_CLASS (udisks_config_manager_parent_class)->constructed (object);
@@ -352,6 +424,8 @@ udisks_config_manager_init (UDisksConfigManager *manager)
 {
   manager->load_preference = UDISKS_MODULE_LOAD_ONDEMAND;
   manager->encryption = UDISKS_ENCRYPTION_DEFAULT;
+  manager->uevent_coalesce_window = UDISKS_UEVENT_COALESCE_WINDOW_DEFAULT;
+  manager->auth_cache_timeout = UDISKS_AUTH_CACHE_TIMEOUT_DEFAULT;
 }
 
 UDisksConfigManager *
@@ -396,7 +470,7 @@ udisks_config_manager_get_modules (UDisksConfigManager *manager)
 
   g_return_val_if_fail (UDISKS_IS_CONFIG_MANAGER (manager), NULL);
 
-  parse_config_file (manager, NULL, NULL, &modules);
+  parse_config_file (manager, NULL, NULL, NULL, NULL, NULL, &modules);
   return modules;
 }
 
@@ -417,7 +491,7 @@ udisks_config_manager_get_modules_all (UDisksConfigManager *manager)
 
   g_return_val_if_fail (UDISKS_IS_CONFIG_MANAGER (manager), FALSE);
 
-  parse_config_file (manager, NULL, NULL, &modules);
+  parse_config_file (manager, NULL, NULL, NULL, NULL, NULL, &modules);
 
   ret = !modules || (g_strcmp0 (modules->data, MODULES_ALL_ARG) == 0 && g_list_length (modules) == 1);
 
@@ -442,6 +516,56 @@ udisks_config_manager_get_encryption (UDisksConfigManager *manager)
   return manager->encryption;
 }
 
+/**
+ * udisks_config_manager_get_uevent_coalesce_window:
+ * @manager: A #UDisksConfigManager.
+ *
+ * Gets the time window in which subsequent change uevents for the same
+ * device are folded together before being processed.
+ *
+ * Returns: The window in milliseconds, 0 if uevents are processed as soon as possible.
+ */
+guint
+udisks_config_manager_get_uevent_coalesce_window (UDisksConfigManager *manager)
+{
+  g_return_val_if_fail (UDISKS_IS_CONFIG_MANAGER (manager),
+                        UDISKS_UEVENT_COALESCE_WINDOW_DEFAULT);
+  return manager->uevent_coalesce_window;
+}
+
+/**
+ * udisks_config_manager_get_collect_stats:
+ * @manager: A #UDisksConfigManager.
+ *
+ * Gets whether the daemon should collect performance statistics and
+ * expose them on the org.freedesktop.UDisks2.Manager.Stats interface.
+ *
+ * Returns: %TRUE if statistics should be collected, %FALSE otherwise.
+ */
+gboolean
+udisks_config_manager_get_collect_stats (UDisksConfigManager *manager)
+{
+  g_return_val_if_fail (UDISKS_IS_CONFIG_MANAGER (manager), FALSE);
+  return manager->collect_stats;
+}
+
+/**
+ * udisks_config_manager_get_auth_cache_timeout:
+ * @manager: A #UDisksConfigManager.
+ *
+ * Gets for how long positive authorization results obtained without
+ * user interaction may be reused for the same caller, action and object.
+ *
+ * Returns: The timeout in seconds, 0 if authorization results are not cached.
+ */
+guint
+udisks_config_manager_get_auth_cache_timeout (UDisksConfigManager *manager)
+{
+  g_return_val_if_fail (UDISKS_IS_CONFIG_MANAGER (manager),
+                        UDISKS_AUTH_CACHE_TIMEOUT_DEFAULT);
+  return manager->auth_cache_timeout;
+}
+
 /**
  * udisks_config_manager_get_config_dir:
  * @manager: A #UDisksConfigManager.
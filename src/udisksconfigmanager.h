@@ -49,6 +49,10 @@ typedef enum
 #define UDISKS_ENCRYPTION_LUKS2 "luks2"
 #define UDISKS_ENCRYPTION_DEFAULT UDISKS_ENCRYPTION_LUKS1
 
+#define UDISKS_UEVENT_COALESCE_WINDOW_DEFAULT 20
+
+#define UDISKS_AUTH_CACHE_TIMEOUT_DEFAULT 0
+
 GType                 udisks_config_manager_get_type        (void) G_GNUC_CONST;
 UDisksConfigManager  *udisks_config_manager_new             (void);
 UDisksConfigManager  *udisks_config_manager_new_uninstalled (void);
@@ -61,6 +65,9 @@ UDisksModuleLoadPreference
                       udisks_config_manager_get_load_preference (UDisksConfigManager *manager);
 const gchar          *udisks_config_manager_get_encryption (UDisksConfigManager *manager);
 const gchar * const  *udisks_config_manager_get_supported_encryption_types (UDisksConfigManager *manager);
+guint                 udisks_config_manager_get_uevent_coalesce_window (UDisksConfigManager *manager);
+gboolean              udisks_config_manager_get_collect_stats (UDisksConfigManager *manager);
+guint                 udisks_config_manager_get_auth_cache_timeout (UDisksConfigManager *manager);
 
 const gchar          *udisks_config_manager_get_config_dir  (UDisksConfigManager *manager);
 
@@ -36,6 +36,8 @@
 #include "udisksthreadedjob.h"
 #include "udiskssimplejob.h"
 #include "udisksstate.h"
+#include "udisksstats.h"
+#include "udisksauthcache.h"
 #include "udiskscrypttabmonitor.h"
 #include "udiskscrypttabentry.h"
 #include "udiskslinuxblockobject.h"
@@ -56,6 +58,8 @@
 
 typedef struct _UDisksDaemonClass   UDisksDaemonClass;
 
+#define N_OBJECT_RELATIONS (UDISKS_OBJECT_RELATION_LOGICAL_VOLUME + 1)
+
 /**
  * UDisksDaemon:
  *
@@ -84,6 +88,26 @@ struct _UDisksDaemon
 
   UDisksConfigManager *config_manager;
 
+  UDisksStats *stats;
+
+  UDisksAuthCache *auth_cache;
+
+  /* indexes of exported block objects, see udisks_daemon_index_block_object() */
+  GMutex block_index_lock;
+  GHashTable *block_index;            /* UDisksObject -> BlockIndexEntry */
+  GHashTable *block_by_dev;           /* guint64 -> UDisksObject */
+  GHashTable *block_by_device_file;   /* gchar* -> UDisksObject */
+  GHashTable *block_by_symlink;       /* gchar* -> UDisksObject */
+  GHashTable *block_by_sysfs_path;    /* gchar* -> UDisksObject */
+  GHashTable *block_children[N_OBJECT_RELATIONS]; /* parent object path -> set of UDisksObject */
+
+  /* wakes up threads waiting for objects, see udisks_daemon_notify_objects_changed() */
+  GMutex wait_lock;
+  GCond wait_cond;
+  guint64 wait_serial;
+  gint n_waiters;                     /* atomic */
+  gboolean property_notify_pending;   /* property changes batched until idle */
+
   gboolean disable_modules;
   gboolean force_load_modules;
   gboolean uninstalled;
@@ -118,6 +142,7 @@ static void
 udisks_daemon_finalize (GObject *object)
 {
   UDisksDaemon *daemon = UDISKS_DAEMON (object);
+  guint n;
 
   udisks_state_stop_cleanup (daemon->state);
 
@@ -137,6 +162,20 @@ udisks_daemon_finalize (GObject *object)
   g_free (daemon->uuid);
 
   g_clear_object (&daemon->config_manager);
+  g_clear_object (&daemon->stats);
+  g_clear_object (&daemon->auth_cache);
+
+  g_hash_table_destroy (daemon->block_by_dev);
+  g_hash_table_destroy (daemon->block_by_device_file);
+  g_hash_table_destroy (daemon->block_by_symlink);
+  g_hash_table_destroy (daemon->block_by_sysfs_path);
+  for (n = 0; n < N_OBJECT_RELATIONS; n++)
+    g_hash_table_destroy (daemon->block_children[n]);
+  g_hash_table_destroy (daemon->block_index);
+  g_mutex_clear (&daemon->block_index_lock);
+
+  g_cond_clear (&daemon->wait_cond);
+  g_mutex_clear (&daemon->wait_lock);
 
   if (G_OBJECT_CLASS (udisks_daemon_parent_class)->finalize != NULL)
     G_OBJECT_CLASS (udisks_daemon_parent_class)->finalize (object);
@@ -252,9 +291,179 @@ udisks_daemon_set_property (GObject      *object,
     }
 }
 
+typedef struct
+{
+  UDisksObject *object;
+  guint64 dev;
+  gchar *device_file;
+  gchar **symlinks;
+  gchar *sysfs_path;
+  gchar *parents[N_OBJECT_RELATIONS];
+} BlockIndexEntry;
+
+static void
+block_index_entry_free (BlockIndexEntry *entry)
+{
+  guint n;
+
+  g_object_unref (entry->object);
+  g_free (entry->device_file);
+  g_strfreev (entry->symlinks);
+  g_free (entry->sysfs_path);
+  for (n = 0; n < N_OBJECT_RELATIONS; n++)
+    g_free (entry->parents[n]);
+  g_free (entry);
+}
+
 static void
 udisks_daemon_init (UDisksDaemon *daemon)
 {
+  guint n;
+
+  g_mutex_init (&daemon->block_index_lock);
+  /* the lookup tables other than block_children don't own anything, keys point into the BlockIndexEntry */
+  daemon->block_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                               NULL, (GDestroyNotify) block_index_entry_free);
+  daemon->block_by_dev = g_hash_table_new (g_int64_hash, g_int64_equal);
+  daemon->block_by_device_file = g_hash_table_new (g_str_hash, g_str_equal);
+  daemon->block_by_symlink = g_hash_table_new (g_str_hash, g_str_equal);
+  daemon->block_by_sysfs_path = g_hash_table_new (g_str_hash, g_str_equal);
+  for (n = 0; n < N_OBJECT_RELATIONS; n++)
+    daemon->block_children[n] = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                       g_free, (GDestroyNotify) g_hash_table_unref);
+
+  g_mutex_init (&daemon->wait_lock);
+  g_cond_init (&daemon->wait_cond);
+}
+
+static gboolean
+on_property_notify_idle (gpointer user_data)
+{
+  UDisksDaemon *daemon = UDISKS_DAEMON (user_data);
+
+  g_mutex_lock (&daemon->wait_lock);
+  daemon->property_notify_pending = FALSE;
+  g_mutex_unlock (&daemon->wait_lock);
+
+  udisks_daemon_notify_objects_changed (daemon);
+  return G_SOURCE_REMOVE;
+}
+
+/* A single update usually changes many properties, the waiters are woken
+ * up once they are all set instead of once for each of them.
+ */
+static void
+on_interface_notify (GObject    *interface,
+                     GParamSpec *pspec,
+                     gpointer    user_data)
+{
+  UDisksDaemon *daemon = UDISKS_DAEMON (user_data);
+
+  if (g_atomic_int_get (&daemon->n_waiters) == 0)
+    return;
+
+  g_mutex_lock (&daemon->wait_lock);
+  if (!daemon->property_notify_pending)
+    {
+      daemon->property_notify_pending = TRUE;
+      g_idle_add_full (G_PRIORITY_DEFAULT,
+                       on_property_notify_idle,
+                       g_object_ref (daemon),
+                       g_object_unref);
+    }
+  g_mutex_unlock (&daemon->wait_lock);
+}
+
+static void
+watch_interface (UDisksDaemon   *daemon,
+                 GDBusInterface *interface,
+                 gboolean        watch)
+{
+  g_signal_handlers_disconnect_by_func (interface, G_CALLBACK (on_interface_notify), daemon);
+  if (watch)
+    g_signal_connect (interface, "notify", G_CALLBACK (on_interface_notify), daemon);
+}
+
+static void
+watch_object (UDisksDaemon *daemon,
+              GDBusObject  *object,
+              gboolean      watch)
+{
+  GList *interfaces, *l;
+
+  interfaces = g_dbus_object_get_interfaces (object);
+  for (l = interfaces; l != NULL; l = l->next)
+    watch_interface (daemon, G_DBUS_INTERFACE (l->data), watch);
+  g_list_free_full (interfaces, g_object_unref);
+}
+
+static void block_children_remove_parent (UDisksDaemon         *daemon,
+                                          UDisksObjectRelation  relation,
+                                          const gchar          *parent_object_path);
+
+static void
+on_object_added (GDBusObjectManager *manager,
+                 GDBusObject        *object,
+                 gpointer            user_data)
+{
+  UDisksDaemon *daemon = UDISKS_DAEMON (user_data);
+
+  watch_object (daemon, object, TRUE);
+  udisks_daemon_notify_objects_changed (daemon);
+}
+
+static void
+on_object_removed (GDBusObjectManager *manager,
+                   GDBusObject        *object,
+                   gpointer            user_data)
+{
+  UDisksDaemon *daemon = UDISKS_DAEMON (user_data);
+
+  watch_object (daemon, object, FALSE);
+
+  /* an LV that went away is no longer the parent of its block device */
+  g_mutex_lock (&daemon->block_index_lock);
+  block_children_remove_parent (daemon, UDISKS_OBJECT_RELATION_LOGICAL_VOLUME,
+                                g_dbus_object_get_object_path (object));
+  g_mutex_unlock (&daemon->block_index_lock);
+
+  /* the object path may be reused for a different device */
+  if (daemon->auth_cache != NULL)
+    udisks_auth_cache_forget_object (daemon->auth_cache, g_dbus_object_get_object_path (object));
+  udisks_daemon_notify_objects_changed (daemon);
+}
+
+static void
+on_interface_added (GDBusObjectManager *manager,
+                    GDBusObject        *object,
+                    GDBusInterface     *interface,
+                    gpointer            user_data)
+{
+  UDisksDaemon *daemon = UDISKS_DAEMON (user_data);
+
+  watch_interface (daemon, interface, TRUE);
+  udisks_daemon_notify_objects_changed (daemon);
+}
+
+static void
+on_interface_removed (GDBusObjectManager *manager,
+                      GDBusObject        *object,
+                      GDBusInterface     *interface,
+                      gpointer            user_data)
+{
+  UDisksDaemon *daemon = UDISKS_DAEMON (user_data);
+
+  watch_interface (daemon, interface, FALSE);
+  udisks_daemon_notify_objects_changed (daemon);
+}
+
+static void
+mount_monitor_on_mount_changed (UDisksMountMonitor *monitor,
+                                UDisksMount        *mount,
+                                gpointer            user_data)
+{
+  /* connected after the provider has updated the objects */
+  udisks_daemon_notify_objects_changed (UDISKS_DAEMON (user_data));
 }
 
 static void
@@ -408,6 +617,14 @@ udisks_daemon_constructed (GObject *object)
     }
 
   daemon->object_manager = g_dbus_object_manager_server_new ("/org/freedesktop/UDisks2");
+  g_signal_connect (daemon->object_manager, "object-added",
+                    G_CALLBACK (on_object_added), daemon);
+  g_signal_connect (daemon->object_manager, "object-removed",
+                    G_CALLBACK (on_object_removed), daemon);
+  g_signal_connect (daemon->object_manager, "interface-added",
+                    G_CALLBACK (on_interface_added), daemon);
+  g_signal_connect (daemon->object_manager, "interface-removed",
+                    G_CALLBACK (on_interface_removed), daemon);
 
   if (!g_file_test ("/run/udisks2", G_FILE_TEST_IS_DIR))
     {
@@ -437,6 +654,11 @@ udisks_daemon_constructed (GObject *object)
       daemon->module_manager = udisks_module_manager_new_uninstalled (daemon);
     }
 
+  daemon->stats = udisks_stats_new (udisks_config_manager_get_collect_stats (daemon->config_manager));
+  daemon->auth_cache = udisks_auth_cache_new (daemon->connection,
+                                              daemon->authority,
+                                              udisks_config_manager_get_auth_cache_timeout (daemon->config_manager));
+
   daemon->mount_monitor = udisks_mount_monitor_new ();
 
   daemon->state = udisks_state_new (daemon);
@@ -445,6 +667,14 @@ udisks_daemon_constructed (GObject *object)
                     "mount-removed",
                     G_CALLBACK (mount_monitor_on_mount_removed),
                     daemon);
+  g_signal_connect_after (daemon->mount_monitor,
+                          "mount-added",
+                          G_CALLBACK (mount_monitor_on_mount_changed),
+                          daemon);
+  g_signal_connect_after (daemon->mount_monitor,
+                          "mount-removed",
+                          G_CALLBACK (mount_monitor_on_mount_changed),
+                          daemon);
 
   daemon->crypttab_monitor = udisks_crypttab_monitor_new ();
   daemon->utab_monitor = udisks_utab_monitor_new ();
@@ -456,8 +686,8 @@ udisks_daemon_constructed (GObject *object)
   /* fill in default mount options */
   g_object_set_data_full (object,
                           "mount-options",
-                          udisks_linux_mount_options_get_builtin (),
-                          (GDestroyNotify) g_hash_table_destroy);
+                          udisks_linux_mount_options_cache_new (udisks_config_manager_get_config_dir (daemon->config_manager)),
+                          (GDestroyNotify) udisks_linux_mount_options_cache_free);
 
   /* Load modules if requested but only once providers have started and
    * have connected on the UDisksModuleManager::modules-activated signal.
@@ -765,6 +995,36 @@ udisks_daemon_get_state (UDisksDaemon *daemon)
   return daemon->state;
 }
 
+/**
+ * udisks_daemon_get_stats:
+ * @daemon: A #UDisksDaemon.
+ *
+ * Gets the performance statistics collector used by @daemon.
+ *
+ * Returns: A #UDisksStats instance. Do not free, the object is owned by @daemon.
+ */
+UDisksStats *
+udisks_daemon_get_stats (UDisksDaemon *daemon)
+{
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
+  return daemon->stats;
+}
+
+/**
+ * udisks_daemon_get_auth_cache:
+ * @daemon: A #UDisksDaemon.
+ *
+ * Gets the cache of authorization results used by @daemon.
+ *
+ * Returns: A #UDisksAuthCache instance. Do not free, the object is owned by @daemon.
+ */
+UDisksAuthCache *
+udisks_daemon_get_auth_cache (UDisksDaemon *daemon)
+{
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
+  return daemon->auth_cache;
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 typedef struct
@@ -1388,27 +1648,40 @@ udisks_daemon_launch_threaded_job_sync (UDisksDaemon          *daemon,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
-typedef struct {
-  GMainContext *context;
-  GMainLoop *loop;
-  gboolean timed_out;
-} WaitData;
+/* Interval for re-checking the wait function even if no change has been signalled */
+#define WAIT_RECHECK_INTERVAL_USEC (G_USEC_PER_SEC)
 
-static gboolean
-wait_on_timed_out (gpointer user_data)
+/**
+ * udisks_daemon_notify_objects_changed:
+ * @daemon: A #UDisksDaemon.
+ *
+ * Notifies threads blocked in udisks_daemon_wait_for_object_sync() and
+ * friends that exported objects have been added, removed or their
+ * properties have changed so that they can re-check the object they wait for.
+ *
+ * Additions and removals of objects and interfaces as well as property
+ * changes of exported interfaces are tracked automatically, this only needs
+ * to be called after changes the wait functions depend on that aren't
+ * reflected in any property.
+ *
+ * This function is thread-safe.
+ */
+void
+udisks_daemon_notify_objects_changed (UDisksDaemon *daemon)
 {
-  WaitData *data = user_data;
-  data->timed_out = TRUE;
-  g_main_loop_quit (data->loop);
-  return FALSE; /* remove the source */
+  g_return_if_fail (UDISKS_IS_DAEMON (daemon));
+
+  g_mutex_lock (&daemon->wait_lock);
+  daemon->wait_serial++;
+  g_cond_broadcast (&daemon->wait_cond);
+  g_mutex_unlock (&daemon->wait_lock);
 }
 
-static gboolean
-wait_on_recheck (gpointer user_data)
+static void
+wait_on_cancelled (GCancellable *cancellable,
+                   gpointer      user_data)
 {
-  WaitData *data = user_data;
-  g_main_loop_quit (data->loop);
-  return FALSE; /* remove the source */
+  udisks_daemon_notify_objects_changed (UDISKS_DAEMON (user_data));
 }
 
 static gpointer wait_for_objects (UDisksDaemon                *daemon,
@@ -1417,59 +1690,45 @@ static gpointer wait_for_objects (UDisksDaemon                *daemon,
                                   GDestroyNotify               user_data_free_func,
                                   guint                        timeout_seconds,
                                   gboolean                     to_disappear,
+                                  GCancellable                *cancellable,
                                   GError                     **error)
 {
   gpointer ret;
-  WaitData data;
-
-  /* TODO: support GCancellable */
+  gint64 end_time;
+  gulong cancelled_id = 0;
 
   g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
   g_return_val_if_fail (wait_func != NULL, NULL);
-
-  ret = NULL;
-
-  memset (&data, '\0', sizeof (data));
-  data.context = NULL;
-  data.loop = NULL;
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 
   g_object_ref (daemon);
 
- again:
-  ret = wait_func (daemon, user_data);
+  end_time = g_get_monotonic_time () + (gint64) timeout_seconds * G_USEC_PER_SEC;
+  if (cancellable != NULL)
+    cancelled_id = g_cancellable_connect (cancellable, G_CALLBACK (wait_on_cancelled), daemon, NULL);
+  g_atomic_int_inc (&daemon->n_waiters);
 
-  if ((!to_disappear && ret == NULL && timeout_seconds > 0) ||
-      (to_disappear && ret != NULL && timeout_seconds > 0))
+  while (TRUE)
     {
-      GSource *source;
+      guint64 serial;
+      gint64 now;
 
-      /* sit and wait for up to @timeout_seconds if the object isn't there already */
-      if (data.context == NULL)
-        {
-          /* TODO: this will deadlock if we are calling from the main thread... */
-          data.context = g_main_context_new ();
-          data.loop = g_main_loop_new (data.context, FALSE);
-
-          source = g_timeout_source_new_seconds (timeout_seconds);
-          g_source_set_priority (source, G_PRIORITY_DEFAULT);
-          g_source_set_callback (source, wait_on_timed_out, &data, NULL);
-          g_source_attach (source, data.context);
-          g_source_unref (source);
-        }
+      g_mutex_lock (&daemon->wait_lock);
+      serial = daemon->wait_serial;
+      g_mutex_unlock (&daemon->wait_lock);
 
-      /* TODO: do something a bit more elegant than checking every 250ms ... it's
-       *       probably going to involve having each UDisksProvider emit a "changed"
-       *       signal when it's time to recheck... for now this works.
-       */
-      source = g_timeout_source_new (250);
-      g_source_set_priority (source, G_PRIORITY_DEFAULT);
-      g_source_set_callback (source, wait_on_recheck, &data, NULL);
-      g_source_attach (source, data.context);
-      g_source_unref (source);
+      ret = wait_func (daemon, user_data);
+
+      if (timeout_seconds == 0 ||
+          (!to_disappear && ret != NULL) ||
+          (to_disappear && ret == NULL))
+        break;
 
-      g_main_loop_run (data.loop);
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        break;
 
-      if (data.timed_out)
+      now = g_get_monotonic_time ();
+      if (now >= end_time)
         {
           if (to_disappear)
             g_set_error (error,
@@ -1479,25 +1738,34 @@ static gpointer wait_for_objects (UDisksDaemon                *daemon,
             g_set_error (error,
                          UDISKS_ERROR, UDISKS_ERROR_FAILED,
                          "Timed out waiting for object");
+          break;
         }
-      else
+
+      /* sit and wait until something changes, falling back to a periodic
+       * re-check in case a change hasn't been signalled
+       */
+      g_mutex_lock (&daemon->wait_lock);
+      while (daemon->wait_serial == serial && !g_cancellable_is_cancelled (cancellable))
         {
-          if (to_disappear)
-            g_object_unref (G_OBJECT (ret));
-          goto again;
+          if (!g_cond_wait_until (&daemon->wait_cond, &daemon->wait_lock,
+                                  MIN (end_time, now + WAIT_RECHECK_INTERVAL_USEC)))
+            break;
         }
+      g_mutex_unlock (&daemon->wait_lock);
+
+      if (to_disappear)
+        g_clear_object (&ret);
     }
 
+  g_atomic_int_add (&daemon->n_waiters, -1);
+  if (cancelled_id != 0)
+    g_cancellable_disconnect (cancellable, cancelled_id);
+
   if (user_data_free_func != NULL)
     user_data_free_func (user_data);
 
   g_object_unref (daemon);
 
-  if (data.loop != NULL)
-    g_main_loop_unref (data.loop);
-  if (data.context != NULL)
-    g_main_context_unref (data.context);
-
   return ret;
 }
 
@@ -1509,14 +1777,19 @@ static gpointer wait_for_objects (UDisksDaemon                *daemon,
  * @user_data: User data to pass to @wait_func.
  * @user_data_free_func: (allow-none): Function to free @user_data or %NULL.
  * @timeout_seconds: Maximum time to wait for the object (in seconds) or 0 to never wait.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
  * @error: (allow-none): Return location for error or %NULL.
  *
  * Blocks the calling thread until an object picked by @wait_func is
  * available or until @timeout_seconds has passed (in which case the
- * function fails with %UDISKS_ERROR_TIMED_OUT).
+ * function fails with %UDISKS_ERROR_TIMED_OUT) or @cancellable is cancelled.
  *
- * Note that @wait_func will be called from time to time - for example
- * if there is a device event.
+ * Note that @wait_func will be called whenever the exported objects
+ * change - for example if there is a device event - see
+ * udisks_daemon_notify_objects_changed().
+ *
+ * The objects are updated in the main thread so this must not be called
+ * from there with a non-zero @timeout_seconds.
  *
  * Returns: (transfer full): The object picked by @wait_func or %NULL if @error is set.
  */
@@ -1526,6 +1799,7 @@ udisks_daemon_wait_for_object_sync (UDisksDaemon               *daemon,
                                     gpointer                    user_data,
                                     GDestroyNotify              user_data_free_func,
                                     guint                       timeout_seconds,
+                                    GCancellable               *cancellable,
                                     GError                      **error)
 {
   return (UDisksObject *) wait_for_objects (daemon,
@@ -1534,6 +1808,7 @@ udisks_daemon_wait_for_object_sync (UDisksDaemon               *daemon,
                                             user_data_free_func,
                                             timeout_seconds,
                                             FALSE, /* to_disappear */
+                                            cancellable,
                                             error);
 }
 
@@ -1544,14 +1819,19 @@ udisks_daemon_wait_for_object_sync (UDisksDaemon               *daemon,
  * @user_data: User data to pass to @wait_func.
  * @user_data_free_func: (allow-none): Function to free @user_data or %NULL.
  * @timeout_seconds: Maximum time to wait for the object (in seconds) or 0 to never wait.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
  * @error: (allow-none): Return location for error or %NULL.
  *
  * Blocks the calling thread until one or more objects picked by @wait_func
  * is/are available or until @timeout_seconds has passed (in which case the
- * function fails with %UDISKS_ERROR_TIMED_OUT).
+ * function fails with %UDISKS_ERROR_TIMED_OUT) or @cancellable is cancelled.
+ *
+ * Note that @wait_func will be called whenever the exported objects
+ * change - for example if there is a device event - see
+ * udisks_daemon_notify_objects_changed().
  *
- * Note that @wait_func will be called from time to time - for example
- * if there is a device event.
+ * The objects are updated in the main thread so this must not be called
+ * from there with a non-zero @timeout_seconds.
  *
  * Returns: (transfer full): The objects picked by @wait_func or %NULL if @error is set.
  */
@@ -1561,6 +1841,7 @@ udisks_daemon_wait_for_objects_sync (UDisksDaemon                 *daemon,
                                      gpointer                      user_data,
                                      GDestroyNotify                user_data_free_func,
                                      guint                         timeout_seconds,
+                                     GCancellable                 *cancellable,
                                      GError                      **error)
 {
   return (UDisksObject **) wait_for_objects (daemon,
@@ -1569,6 +1850,7 @@ udisks_daemon_wait_for_objects_sync (UDisksDaemon                 *daemon,
                                              user_data_free_func,
                                              timeout_seconds,
                                              FALSE, /* to_disappear */
+                                             cancellable,
                                              error);
 }
 
@@ -1580,17 +1862,21 @@ udisks_daemon_wait_for_objects_sync (UDisksDaemon                 *daemon,
  * @user_data: User data to pass to @wait_func.
  * @user_data_free_func: (allow-none): Function to free @user_data or %NULL.
  * @timeout_seconds: Maximum time to wait for the object to disappear (in seconds) or 0 to never wait.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
  * @error: (allow-none): Return location for error or %NULL.
  *
  * Blocks the calling thread until an object picked by @wait_func disappears or
  * until @timeout_seconds has passed (in which case the function fails with
- * %UDISKS_ERROR_TIMED_OUT).
+ * %UDISKS_ERROR_TIMED_OUT) or @cancellable is cancelled.
  *
- * Note that @wait_func will be called from time to time - for example
- * if there is a device event. For consistency @wait_func is supposed
+ * Note that @wait_func will be called whenever the exported objects
+ * change - for example if there is a device event. For consistency @wait_func is supposed
  * to return full reference to an existing object; udisks_daemon_wait_for_object_to_disappear_sync()
  * will take care of dropping the reference after each iteration.
  *
+ * The objects are updated in the main thread so this must not be called
+ * from there with a non-zero @timeout_seconds.
+ *
  * Returns: (transfer full): Whether the object picked by @wait_func disappeared or not (@error is set).
  */
 gboolean
@@ -1599,6 +1885,7 @@ udisks_daemon_wait_for_object_to_disappear_sync (UDisksDaemon               *dae
                                                  gpointer                    user_data,
                                                  GDestroyNotify              user_data_free_func,
                                                  guint                       timeout_seconds,
+                                                 GCancellable               *cancellable,
                                                  GError                      **error)
 {
   UDisksObject *object;
@@ -1609,6 +1896,7 @@ udisks_daemon_wait_for_object_to_disappear_sync (UDisksDaemon               *dae
                                               user_data_free_func,
                                               timeout_seconds,
                                               TRUE, /* to_disappear */
+                                              cancellable,
                                               error);
   if (object != NULL)
     g_object_unref (object);
@@ -1619,6 +1907,300 @@ udisks_daemon_wait_for_object_to_disappear_sync (UDisksDaemon               *dae
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* called with block_index_lock held */
+static void
+block_index_remove_key (GHashTable    *table,
+                        gconstpointer  key,
+                        UDisksObject  *object)
+{
+  /* don't drop a key that has been claimed by another object meanwhile */
+  if (key != NULL && g_hash_table_lookup (table, key) == object)
+    g_hash_table_remove (table, key);
+}
+
+/* called with block_index_lock held */
+static void
+block_children_add (UDisksDaemon         *daemon,
+                    UDisksObjectRelation  relation,
+                    const gchar          *parent_object_path,
+                    UDisksObject         *object)
+{
+  GHashTable *children;
+
+  if (parent_object_path == NULL)
+    return;
+
+  children = g_hash_table_lookup (daemon->block_children[relation], parent_object_path);
+  if (children == NULL)
+    {
+      children = g_hash_table_new (g_direct_hash, g_direct_equal);
+      g_hash_table_insert (daemon->block_children[relation], g_strdup (parent_object_path), children);
+    }
+  g_hash_table_add (children, object);
+}
+
+/* called with block_index_lock held */
+static void
+block_children_remove (UDisksDaemon         *daemon,
+                       UDisksObjectRelation  relation,
+                       const gchar          *parent_object_path,
+                       UDisksObject         *object)
+{
+  GHashTable *children;
+
+  if (parent_object_path == NULL)
+    return;
+
+  children = g_hash_table_lookup (daemon->block_children[relation], parent_object_path);
+  if (children != NULL && g_hash_table_remove (children, object) && g_hash_table_size (children) == 0)
+    g_hash_table_remove (daemon->block_children[relation], parent_object_path);
+}
+
+/* called with block_index_lock held */
+static void
+block_children_remove_parent (UDisksDaemon         *daemon,
+                              UDisksObjectRelation  relation,
+                              const gchar          *parent_object_path)
+{
+  GHashTable *children;
+  GHashTableIter iter;
+  gpointer object;
+  BlockIndexEntry *entry;
+
+  children = g_hash_table_lookup (daemon->block_children[relation], parent_object_path);
+  if (children == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, children);
+  while (g_hash_table_iter_next (&iter, &object, NULL))
+    {
+      entry = g_hash_table_lookup (daemon->block_index, object);
+      if (entry != NULL && g_strcmp0 (entry->parents[relation], parent_object_path) == 0)
+        g_clear_pointer (&entry->parents[relation], g_free);
+    }
+  g_hash_table_remove (daemon->block_children[relation], parent_object_path);
+}
+
+/* called with block_index_lock held */
+static void
+block_index_remove_entry (UDisksDaemon    *daemon,
+                          BlockIndexEntry *entry)
+{
+  gchar **l;
+  guint n;
+
+  block_index_remove_key (daemon->block_by_dev, &entry->dev, entry->object);
+  block_index_remove_key (daemon->block_by_device_file, entry->device_file, entry->object);
+  for (l = entry->symlinks; l != NULL && *l != NULL; l++)
+    block_index_remove_key (daemon->block_by_symlink, *l, entry->object);
+  block_index_remove_key (daemon->block_by_sysfs_path, entry->sysfs_path, entry->object);
+  for (n = 0; n < N_OBJECT_RELATIONS; n++)
+    block_children_remove (daemon, n, entry->parents[n], entry->object);
+}
+
+static gchar *
+object_path_or_null (const gchar *object_path)
+{
+  if (object_path == NULL || g_strcmp0 (object_path, "/") == 0)
+    return NULL;
+  return g_strdup (object_path);
+}
+
+/**
+ * udisks_daemon_index_block_object:
+ * @daemon: A #UDisksDaemon.
+ * @object: An exported #UDisksLinuxBlockObject.
+ *
+ * Adds @object to the block device lookup tables used by
+ * udisks_daemon_find_block() and friends or refreshes the keys
+ * for an already indexed object. This needs to be called every time
+ * the device number, device file, symlinks or sysfs path of @object
+ * might have changed.
+ *
+ * The partition table and crypto backing device of @object are recorded
+ * as its parents for udisks_daemon_get_child_objects() as well.
+ */
+void
+udisks_daemon_index_block_object (UDisksDaemon *daemon,
+                                  UDisksObject *object)
+{
+  BlockIndexEntry *entry;
+  BlockIndexEntry *old_entry;
+  UDisksLinuxDevice *device;
+  UDisksBlock *block;
+  UDisksPartition *partition;
+  gboolean is_lv;
+  gchar **l;
+  guint n;
+
+  g_return_if_fail (UDISKS_IS_DAEMON (daemon));
+  g_return_if_fail (UDISKS_IS_LINUX_BLOCK_OBJECT (object));
+
+  block = udisks_object_peek_block (object);
+  if (block == NULL)
+    return;
+
+  entry = g_new0 (BlockIndexEntry, 1);
+  entry->object = g_object_ref (object);
+  entry->dev = udisks_block_get_device_number (block);
+  entry->device_file = udisks_block_dup_device (block);
+  entry->symlinks = udisks_block_dup_symlinks (block);
+  device = udisks_linux_block_object_get_device (UDISKS_LINUX_BLOCK_OBJECT (object));
+  entry->sysfs_path = g_strdup (g_udev_device_get_sysfs_path (device->udev_device));
+  is_lv = g_udev_device_get_property (device->udev_device, "DM_LV_NAME") != NULL;
+  g_object_unref (device);
+
+  partition = udisks_object_peek_partition (object);
+  if (partition != NULL)
+    entry->parents[UDISKS_OBJECT_RELATION_PARTITION] = object_path_or_null (udisks_partition_get_table (partition));
+  entry->parents[UDISKS_OBJECT_RELATION_CLEARTEXT] = object_path_or_null (udisks_block_get_crypto_backing_device (block));
+
+  g_mutex_lock (&daemon->block_index_lock);
+  old_entry = g_hash_table_lookup (daemon->block_index, object);
+  if (old_entry != NULL)
+    {
+      /* relations set by udisks_daemon_set_object_parent() are kept as
+       * long as the block device is still an LV */
+      if (is_lv)
+        entry->parents[UDISKS_OBJECT_RELATION_LOGICAL_VOLUME] = g_strdup (old_entry->parents[UDISKS_OBJECT_RELATION_LOGICAL_VOLUME]);
+      block_index_remove_entry (daemon, old_entry);
+    }
+
+  /* use _replace() so that the keys always point into the current entry */
+  g_hash_table_replace (daemon->block_by_dev, &entry->dev, object);
+  if (entry->device_file != NULL)
+    g_hash_table_replace (daemon->block_by_device_file, entry->device_file, object);
+  for (l = entry->symlinks; l != NULL && *l != NULL; l++)
+    g_hash_table_replace (daemon->block_by_symlink, *l, object);
+  if (entry->sysfs_path != NULL)
+    g_hash_table_replace (daemon->block_by_sysfs_path, entry->sysfs_path, object);
+  for (n = 0; n < N_OBJECT_RELATIONS; n++)
+    block_children_add (daemon, n, entry->parents[n], object);
+
+  /* frees the old entry */
+  g_hash_table_replace (daemon->block_index, object, entry);
+  g_mutex_unlock (&daemon->block_index_lock);
+}
+
+/**
+ * udisks_daemon_unindex_block_object:
+ * @daemon: A #UDisksDaemon.
+ * @object: A #UDisksLinuxBlockObject.
+ *
+ * Removes @object from the block device lookup tables. Should be called
+ * right before @object is unexported.
+ */
+void
+udisks_daemon_unindex_block_object (UDisksDaemon *daemon,
+                                    UDisksObject *object)
+{
+  BlockIndexEntry *entry;
+
+  g_return_if_fail (UDISKS_IS_DAEMON (daemon));
+
+  g_mutex_lock (&daemon->block_index_lock);
+  entry = g_hash_table_lookup (daemon->block_index, object);
+  if (entry != NULL)
+    {
+      block_index_remove_entry (daemon, entry);
+      g_hash_table_remove (daemon->block_index, object);
+    }
+  g_mutex_unlock (&daemon->block_index_lock);
+}
+
+/**
+ * udisks_daemon_set_object_parent:
+ * @daemon: A #UDisksDaemon.
+ * @object: An indexed #UDisksLinuxBlockObject.
+ * @relation: A #UDisksObjectRelation.
+ * @parent_object_path: (nullable): The object path of the parent or %NULL (or "/") to unset.
+ *
+ * Records @parent_object_path as the parent of @object for @relation.
+ * This is meant for relations the daemon can't derive from the core
+ * interfaces itself, e.g. the @UDISKS_OBJECT_RELATION_LOGICAL_VOLUME relation
+ * maintained by the LVM2 module. Does nothing if @object is not indexed.
+ */
+void
+udisks_daemon_set_object_parent (UDisksDaemon         *daemon,
+                                 UDisksObject         *object,
+                                 UDisksObjectRelation  relation,
+                                 const gchar          *parent_object_path)
+{
+  BlockIndexEntry *entry;
+
+  g_return_if_fail (UDISKS_IS_DAEMON (daemon));
+  g_return_if_fail (relation < N_OBJECT_RELATIONS);
+
+  g_mutex_lock (&daemon->block_index_lock);
+  entry = g_hash_table_lookup (daemon->block_index, object);
+  if (entry != NULL)
+    {
+      block_children_remove (daemon, relation, entry->parents[relation], object);
+      g_free (entry->parents[relation]);
+      entry->parents[relation] = object_path_or_null (parent_object_path);
+      block_children_add (daemon, relation, entry->parents[relation], object);
+    }
+  g_mutex_unlock (&daemon->block_index_lock);
+}
+
+/**
+ * udisks_daemon_get_child_objects:
+ * @daemon: A #UDisksDaemon.
+ * @parent_object_path: The object path of the parent object.
+ * @relation: A #UDisksObjectRelation.
+ *
+ * Gets the exported block objects that are children of the object at
+ * @parent_object_path, e.g. the partitions of a partition table.
+ *
+ * Returns: (transfer full) (element-type UDisksObject): A list of #UDisksObject
+ *   instances. The returned list should be freed with g_list_free() after each
+ *   element has been freed with g_object_unref().
+ */
+GList *
+udisks_daemon_get_child_objects (UDisksDaemon         *daemon,
+                                 const gchar          *parent_object_path,
+                                 UDisksObjectRelation  relation)
+{
+  GHashTable *children;
+  GHashTableIter iter;
+  gpointer object;
+  GList *ret = NULL;
+
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
+  g_return_val_if_fail (relation < N_OBJECT_RELATIONS, NULL);
+
+  if (parent_object_path == NULL)
+    return NULL;
+
+  g_mutex_lock (&daemon->block_index_lock);
+  children = g_hash_table_lookup (daemon->block_children[relation], parent_object_path);
+  if (children != NULL)
+    {
+      g_hash_table_iter_init (&iter, children);
+      while (g_hash_table_iter_next (&iter, &object, NULL))
+        ret = g_list_prepend (ret, g_object_ref (object));
+    }
+  g_mutex_unlock (&daemon->block_index_lock);
+
+  return ret;
+}
+
+static UDisksObject *
+block_index_lookup (UDisksDaemon  *daemon,
+                    GHashTable    *table,
+                    gconstpointer  key)
+{
+  UDisksObject *ret;
+
+  g_mutex_lock (&daemon->block_index_lock);
+  ret = g_hash_table_lookup (table, key);
+  if (ret != NULL)
+    g_object_ref (ret);
+  g_mutex_unlock (&daemon->block_index_lock);
+
+  return ret;
+}
+
 /**
  * udisks_daemon_find_block:
  * @daemon: A #UDisksDaemon.
@@ -1632,28 +2214,11 @@ UDisksObject *
 udisks_daemon_find_block (UDisksDaemon *daemon,
                           dev_t         block_device_number)
 {
-  UDisksObject *ret = NULL;
-  GList *objects, *l;
+  guint64 dev = block_device_number;
 
-  objects = g_dbus_object_manager_get_objects (G_DBUS_OBJECT_MANAGER (daemon->object_manager));
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
-
-      block = udisks_object_peek_block (object);
-      if (block == NULL)
-        continue;
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
 
-      if (udisks_block_get_device_number (block) == block_device_number)
-        {
-          ret = g_object_ref (object);
-          goto out;
-        }
-    }
- out:
-  g_list_free_full (objects, g_object_unref);
-  return ret;
+  return block_index_lookup (daemon, daemon->block_by_dev, &dev);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -1671,28 +2236,12 @@ UDisksObject *
 udisks_daemon_find_block_by_device_file (UDisksDaemon *daemon,
                                          const gchar  *device_file)
 {
-  UDisksObject *ret = NULL;
-  GList *objects, *l;
-
-  objects = g_dbus_object_manager_get_objects (G_DBUS_OBJECT_MANAGER (daemon->object_manager));
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
 
-      block = udisks_object_peek_block (object);
-      if (block == NULL)
-        continue;
+  if (device_file == NULL)
+    return NULL;
 
-      if (g_strcmp0 (udisks_block_get_device (block), device_file) == 0)
-        {
-          ret = g_object_ref (object);
-          goto out;
-        }
-    }
- out:
-  g_list_free_full (objects, g_object_unref);
-  return ret;
+  return block_index_lookup (daemon, daemon->block_by_device_file, device_file);
 }
 
 /**
@@ -1709,35 +2258,21 @@ UDisksObject *
 udisks_daemon_find_block_by_device_file_and_symlinks (UDisksDaemon *daemon,
                                                       const gchar  *device_file)
 {
-  UDisksObject *ret = NULL;
-  GList *objects, *l;
+  UDisksObject *ret;
 
-  objects = g_dbus_object_manager_get_objects (G_DBUS_OBJECT_MANAGER (daemon->object_manager));
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
-      const gchar *const *symlinks;
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
 
-      block = udisks_object_peek_block (object);
-      if (block == NULL)
-        continue;
+  if (device_file == NULL)
+    return NULL;
 
-      if (g_strcmp0 (udisks_block_get_device (block), device_file) == 0)
-        {
-          ret = g_object_ref (object);
-          goto out;
-        }
+  g_mutex_lock (&daemon->block_index_lock);
+  ret = g_hash_table_lookup (daemon->block_by_device_file, device_file);
+  if (ret == NULL)
+    ret = g_hash_table_lookup (daemon->block_by_symlink, device_file);
+  if (ret != NULL)
+    g_object_ref (ret);
+  g_mutex_unlock (&daemon->block_index_lock);
 
-      symlinks = udisks_block_get_symlinks (UDISKS_BLOCK (block));
-      if (symlinks && g_strv_contains (symlinks, device_file))
-        {
-          ret = g_object_ref (object);
-          goto out;
-        }
-    }
- out:
-  g_list_free_full (objects, g_object_unref);
   return ret;
 }
 
@@ -1756,33 +2291,12 @@ UDisksObject *
 udisks_daemon_find_block_by_sysfs_path (UDisksDaemon *daemon,
                                         const gchar  *sysfs_path)
 {
-  UDisksObject *ret = NULL;
-  GList *objects, *l;
-
-  objects = g_dbus_object_manager_get_objects (G_DBUS_OBJECT_MANAGER (daemon->object_manager));
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksLinuxDevice *device;
-
-      if (!UDISKS_IS_LINUX_BLOCK_OBJECT (object))
-        continue;
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
 
-      device = udisks_linux_block_object_get_device (UDISKS_LINUX_BLOCK_OBJECT (object));
-      if (device == NULL)
-        continue;
+  if (sysfs_path == NULL)
+    return NULL;
 
-      if (g_strcmp0 (g_udev_device_get_sysfs_path (device->udev_device), sysfs_path) == 0)
-        {
-          g_object_unref (device);
-          ret = g_object_ref (object);
-          goto out;
-        }
-      g_object_unref (device);
-    }
- out:
-  g_list_free_full (objects, g_object_unref);
-  return ret;
+  return block_index_lookup (daemon, daemon->block_by_sysfs_path, sysfs_path);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -44,6 +44,8 @@ UDisksUtabMonitor        *udisks_daemon_get_utab_monitor      (UDisksDaemon    *
 UDisksLinuxProvider      *udisks_daemon_get_linux_provider    (UDisksDaemon    *daemon);
 PolkitAuthority          *udisks_daemon_get_authority         (UDisksDaemon    *daemon);
 UDisksState              *udisks_daemon_get_state             (UDisksDaemon    *daemon);
+UDisksStats              *udisks_daemon_get_stats             (UDisksDaemon    *daemon);
+UDisksAuthCache          *udisks_daemon_get_auth_cache        (UDisksDaemon    *daemon);
 UDisksModuleManager      *udisks_daemon_get_module_manager    (UDisksDaemon    *daemon);
 UDisksConfigManager      *udisks_daemon_get_config_manager    (UDisksDaemon    *daemon);
 gboolean                  udisks_daemon_get_disable_modules   (UDisksDaemon    *daemon);
@@ -73,6 +75,7 @@ UDisksObject             *udisks_daemon_wait_for_object_sync  (UDisksDaemon
                                                                gpointer                   user_data,
                                                                GDestroyNotify             user_data_free_func,
                                                                guint                      timeout_seconds,
+                                                               GCancellable              *cancellable,
                                                                GError                   **error);
 
 UDisksObject             **udisks_daemon_wait_for_objects_sync  (UDisksDaemon                *daemon,
@@ -80,6 +83,7 @@ UDisksObject             **udisks_daemon_wait_for_objects_sync  (UDisksDaemon
                                                                  gpointer                     user_data,
                                                                  GDestroyNotify               user_data_free_func,
                                                                  guint                        timeout_seconds,
+                                                                 GCancellable                *cancellable,
                                                                  GError                       **error);
 
 gboolean             udisks_daemon_wait_for_object_to_disappear_sync (UDisksDaemon               *daemon,
@@ -87,8 +91,11 @@ gboolean             udisks_daemon_wait_for_object_to_disappear_sync (UDisksDaem
                                                                       gpointer                    user_data,
                                                                       GDestroyNotify              user_data_free_func,
                                                                       guint                       timeout_seconds,
+                                                                      GCancellable               *cancellable,
                                                                       GError                      **error);
 
+void                      udisks_daemon_notify_objects_changed (UDisksDaemon        *daemon);
+
 GList                    *udisks_daemon_get_objects           (UDisksDaemon         *daemon);
 
 UDisksObject             *udisks_daemon_find_block            (UDisksDaemon         *daemon,
@@ -103,6 +110,18 @@ UDisksObject             *udisks_daemon_find_block_by_device_file_and_symlinks (
 UDisksObject             *udisks_daemon_find_block_by_sysfs_path (UDisksDaemon *daemon,
                                                                   const gchar  *sysfs_path);
 
+void                      udisks_daemon_index_block_object    (UDisksDaemon         *daemon,
+                                                               UDisksObject         *object);
+void                      udisks_daemon_unindex_block_object  (UDisksDaemon         *daemon,
+                                                               UDisksObject         *object);
+void                      udisks_daemon_set_object_parent     (UDisksDaemon         *daemon,
+                                                               UDisksObject         *object,
+                                                               UDisksObjectRelation  relation,
+                                                               const gchar          *parent_object_path);
+GList                    *udisks_daemon_get_child_objects     (UDisksDaemon         *daemon,
+                                                               const gchar          *parent_object_path,
+                                                               UDisksObjectRelation  relation);
+
 UDisksObject             *udisks_daemon_find_object           (UDisksDaemon         *daemon,
                                                                const gchar          *object_path);
 
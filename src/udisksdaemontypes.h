@@ -156,6 +156,18 @@ typedef gboolean (*UDisksThreadedJobFunc) (UDisksThreadedJob   *job,
 struct _UDisksState;
 typedef struct _UDisksState UDisksState;
 
+struct _UDisksStats;
+typedef struct _UDisksStats UDisksStats;
+
+struct _UDisksAuthCache;
+typedef struct _UDisksAuthCache UDisksAuthCache;
+
+struct _UDisksWorkerPool;
+typedef struct _UDisksWorkerPool UDisksWorkerPool;
+
+struct _UDisksLinuxManagerStats;
+typedef struct _UDisksLinuxManagerStats UDisksLinuxManagerStats;
+
 /**
  * UDisksMountType:
  * @UDISKS_MOUNT_TYPE_FILESYSTEM: Object correspond to a mounted filesystem.
@@ -240,6 +252,22 @@ typedef enum
 struct _UDisksLinuxDevice;
 typedef struct _UDisksLinuxDevice UDisksLinuxDevice;
 
+/**
+ * UDisksObjectRelation:
+ * @UDISKS_OBJECT_RELATION_PARTITION: The child is a partition of the parent partition table.
+ * @UDISKS_OBJECT_RELATION_CLEARTEXT: The child is the cleartext device of the parent encrypted device.
+ * @UDISKS_OBJECT_RELATION_LOGICAL_VOLUME: The child is the block device of the parent LVM2 logical volume.
+ *
+ * Kinds of parent/child relations between block objects and their parents
+ * tracked by the #UDisksDaemon, see udisks_daemon_get_child_objects().
+ */
+typedef enum
+{
+  UDISKS_OBJECT_RELATION_PARTITION,
+  UDISKS_OBJECT_RELATION_CLEARTEXT,
+  UDISKS_OBJECT_RELATION_LOGICAL_VOLUME
+} UDisksObjectRelation;
+
 /**
  * UDISKS_DEFAULT_WAIT_TIMEOUT:
  *
@@ -40,6 +40,8 @@
 #include "udisksdaemon.h"
 #include "udisksdaemonutil.h"
 #include "udisksstate.h"
+#include "udisksstats.h"
+#include "udisksauthcache.h"
 #include "udiskslogging.h"
 #include "udiskslinuxdevice.h"
 #include "udiskslinuxprovider.h"
@@ -836,6 +838,10 @@ udisks_daemon_util_check_authorization_sync_with_error (UDisksDaemon           *
   const gchar *details_device = NULL;
   gchar *details_drive = NULL;
   gchar *device_display_name = NULL;
+  const gchar *as_user = NULL;
+  const gchar *object_path = NULL;
+  guint auth_cache_generation;
+  gint64 start_time;
 
   authority = udisks_daemon_get_authority (daemon);
   if (authority == NULL)
@@ -844,7 +850,6 @@ udisks_daemon_util_check_authorization_sync_with_error (UDisksDaemon           *
       goto out;
     }
 
-  subject = polkit_system_bus_name_new (g_dbus_method_invocation_get_sender (invocation));
   if (options != NULL)
     {
       g_variant_lookup (options,
@@ -855,18 +860,33 @@ udisks_daemon_util_check_authorization_sync_with_error (UDisksDaemon           *
   if (!auth_no_user_interaction)
     flags = POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION;
 
-  details = polkit_details_new ();
-  polkit_details_insert (details, "polkit.message", message);
-  polkit_details_insert (details, "polkit.gettext_domain", "udisks2");
-
   if (options != NULL &&
       g_strcmp0 (action_id, "org.freedesktop.udisks2.filesystem-mount-other-user") == 0)
+    g_variant_lookup (options, "as-user", "&s", &as_user);
+
+  /* A cached result spares both the polkit round trip and gathering the details below */
+  if (object != NULL)
+    object_path = g_dbus_object_get_object_path (G_DBUS_OBJECT (object));
+  if (udisks_auth_cache_lookup (udisks_daemon_get_auth_cache (daemon),
+                                g_dbus_method_invocation_get_sender (invocation),
+                                action_id,
+                                object_path,
+                                as_user))
     {
-      const gchar *as_user = NULL;
-      g_variant_lookup (options, "as-user", "&s", &as_user);
-      _safe_polkit_details_insert (details, "mount.as-user", as_user);
+      udisks_stats_add (udisks_daemon_get_stats (daemon), UDISKS_STATS_COUNTER_AUTH_CACHE_HITS, 1);
+      ret = TRUE;
+      goto out;
     }
 
+  subject = polkit_system_bus_name_new (g_dbus_method_invocation_get_sender (invocation));
+
+  details = polkit_details_new ();
+  polkit_details_insert (details, "polkit.message", message);
+  polkit_details_insert (details, "polkit.gettext_domain", "udisks2");
+
+  if (as_user != NULL)
+    _safe_polkit_details_insert (details, "mount.as-user", as_user);
+
   /* Find drive associated with the block device, if any */
   if (object != NULL)
     {
@@ -992,6 +1012,8 @@ udisks_daemon_util_check_authorization_sync_with_error (UDisksDaemon           *
   polkit_details_insert (details, "device.name", device_display_name);
 
   sub_error = NULL;
+  auth_cache_generation = udisks_auth_cache_get_generation (udisks_daemon_get_auth_cache (daemon));
+  start_time = udisks_stats_start (udisks_daemon_get_stats (daemon));
   result = polkit_authority_check_authorization_sync (authority,
                                                       subject,
                                                       action_id,
@@ -999,6 +1021,7 @@ udisks_daemon_util_check_authorization_sync_with_error (UDisksDaemon           *
                                                       flags,
                                                       NULL, /* GCancellable* */
                                                       &sub_error);
+  udisks_stats_finish (udisks_daemon_get_stats (daemon), UDISKS_STATS_HISTOGRAM_POLKIT_CHECK, start_time);
   if (result == NULL)
     {
       if (sub_error->domain != POLKIT_ERROR)
@@ -1039,6 +1062,21 @@ udisks_daemon_util_check_authorization_sync_with_error (UDisksDaemon           *
       goto out;
     }
 
+  /* Only results obtained without user interaction are safe to reuse,
+   * an interactive authentication must not be kept around for longer
+   * than polkit itself would. The same goes for a retained (auth_*_keep)
+   * authorization even though no interaction was needed now - polkit
+   * doesn't signal when it expires.
+   */
+  if (flags == POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE &&
+      polkit_authorization_result_get_temporary_authorization_id (result) == NULL)
+    udisks_auth_cache_add (udisks_daemon_get_auth_cache (daemon),
+                           g_dbus_method_invocation_get_sender (invocation),
+                           action_id,
+                           object_path,
+                           as_user,
+                           auth_cache_generation);
+
   ret = TRUE;
 
  out:
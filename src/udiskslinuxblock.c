@@ -26,6 +26,7 @@
 #include <sys/types.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <pwd.h>
 #include <grp.h>
@@ -190,55 +191,39 @@ get_sysfs_attr (GUdevDevice *device,
 /* ---------------------------------------------------------------------------------------------------- */
 
 static UDisksLinuxBlockObject *
-find_block_device_by_sysfs_path (GDBusObjectManagerServer *object_manager,
-                                 const gchar              *sysfs_path)
+find_block_device_by_sysfs_path (UDisksDaemon *daemon,
+                                 const gchar  *sysfs_path)
 {
-  UDisksLinuxBlockObject *ret;
-  GList *objects;
-  GList *l;
-
-  ret = NULL;
-
-  objects = g_dbus_object_manager_get_objects (G_DBUS_OBJECT_MANAGER (object_manager));
-  for (l = objects; l != NULL; l = l->next)
-    {
-      GDBusObjectSkeleton *object = G_DBUS_OBJECT_SKELETON (l->data);
-      UDisksLinuxDevice *device;
-
-      if (!UDISKS_IS_LINUX_BLOCK_OBJECT (object))
-        continue;
+  UDisksObject *object;
 
-      device = udisks_linux_block_object_get_device (UDISKS_LINUX_BLOCK_OBJECT (object));
-      if (g_strcmp0 (sysfs_path, g_udev_device_get_sysfs_path (device->udev_device)) == 0)
-        {
-          ret = g_object_ref (UDISKS_LINUX_BLOCK_OBJECT (object));
-          g_object_unref (device);
-          goto out;
-        }
-      g_object_unref (device);
-    }
+  object = udisks_daemon_find_block_by_sysfs_path (daemon, sysfs_path);
+  if (object != NULL && !UDISKS_IS_LINUX_BLOCK_OBJECT (object))
+    g_clear_object (&object);
 
- out:
-  g_list_free_full (objects, g_object_unref);
-  return ret;
+  return (UDisksLinuxBlockObject *) object;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
 
 static gchar *
-find_drive (GDBusObjectManagerServer  *object_manager,
-            GUdevDevice               *block_device,
-            UDisksDrive              **out_drive)
+find_drive (UDisksDaemon  *daemon,
+            GUdevDevice   *block_device,
+            UDisksDrive  **out_drive)
 {
+  UDisksLinuxProvider *provider;
+  UDisksLinuxDriveObject *object = NULL;
   GUdevDevice *whole_disk_block_device;
   const gchar *whole_disk_block_device_sysfs_path;
   gchar **nvme_ctrls = NULL;
   gchar *ret;
-  GList *objects = NULL;
-  GList *l;
+  guint n;
 
   ret = NULL;
 
+  provider = udisks_daemon_get_linux_provider (daemon);
+  if (provider == NULL)
+    return NULL;
+
   if (g_strcmp0 (g_udev_device_get_devtype (block_device), "disk") == 0)
     whole_disk_block_device = g_object_ref (block_device);
   else
@@ -247,8 +232,10 @@ find_drive (GDBusObjectManagerServer  *object_manager,
     goto out;
   whole_disk_block_device_sysfs_path = g_udev_device_get_sysfs_path (whole_disk_block_device);
 
+  object = udisks_linux_provider_find_drive_object (provider, whole_disk_block_device_sysfs_path);
+
   /* check for NVMe */
-  if (g_strcmp0 (g_udev_device_get_subsystem (whole_disk_block_device), "block") == 0)
+  if (object == NULL && g_strcmp0 (g_udev_device_get_subsystem (whole_disk_block_device), "block") == 0)
     {
       GUdevDevice *parent_device;
 
@@ -265,49 +252,30 @@ find_drive (GDBusObjectManagerServer  *object_manager,
           if (subsysnqn_p)
             g_strchomp (subsysnqn_p);
 
-          nvme_ctrls = bd_nvme_find_ctrls_for_ns (whole_disk_block_device_sysfs_path, subsysnqn_p,
-                                                  NULL, NULL, NULL);
+          nvme_ctrls = udisks_linux_provider_dup_nvme_ctrls_for_ns (provider,
+                                                                    whole_disk_block_device_sysfs_path,
+                                                                    subsysnqn_p);
           g_free (subsysnqn_p);
         }
       g_clear_object (&parent_device);
     }
 
-  objects = g_dbus_object_manager_get_objects (G_DBUS_OBJECT_MANAGER (object_manager));
-  for (l = objects; l != NULL; l = l->next)
-    {
-      GDBusObjectSkeleton *object = G_DBUS_OBJECT_SKELETON (l->data);
-      GList *drive_devices;
-      GList *j;
-
-      if (!UDISKS_IS_LINUX_DRIVE_OBJECT (object))
-        continue;
-
-      drive_devices = udisks_linux_drive_object_get_devices (UDISKS_LINUX_DRIVE_OBJECT (object));
-      for (j = drive_devices; j != NULL; j = j->next)
-        {
-          UDisksLinuxDevice *drive_device = UDISKS_LINUX_DEVICE (j->data);
-          const gchar *drive_sysfs_path;
+  /* FIXME: NVMe namespace may be provided by multiple controllers within
+   *  a NVMe subsystem, however the org.freedesktop.UDisks2.Block.Drive
+   *  property may only contain single object path.
+   */
+  for (n = 0; object == NULL && nvme_ctrls != NULL && nvme_ctrls[n] != NULL; n++)
+    object = udisks_linux_provider_find_drive_object (provider, nvme_ctrls[n]);
 
-          drive_sysfs_path = g_udev_device_get_sysfs_path (drive_device->udev_device);
-          if (g_strcmp0 (whole_disk_block_device_sysfs_path, drive_sysfs_path) == 0 ||
-              (nvme_ctrls && g_strv_contains ((const gchar * const *) nvme_ctrls, drive_sysfs_path)))
-            {
-              if (out_drive != NULL)
-                *out_drive = udisks_object_get_drive (UDISKS_OBJECT (object));
-              ret = g_strdup (g_dbus_object_get_object_path (G_DBUS_OBJECT (object)));
-              g_list_free_full (drive_devices, g_object_unref);
-              /* FIXME: NVMe namespace may be provided by multiple controllers within
-               *  a NVMe subsystem, however the org.freedesktop.UDisks2.Block.Drive
-               *  property may only contain single object path.
-               */
-              goto out;
-            }
-        }
-      g_list_free_full (drive_devices, g_object_unref);
+  if (object != NULL)
+    {
+      if (out_drive != NULL)
+        *out_drive = udisks_object_get_drive (UDISKS_OBJECT (object));
+      ret = g_strdup (g_dbus_object_get_object_path (G_DBUS_OBJECT (object)));
     }
 
  out:
-  g_list_free_full (objects, g_object_unref);
+  g_clear_object (&object);
   g_clear_object (&whole_disk_block_device);
   if (nvme_ctrls)
     g_strfreev (nvme_ctrls);
@@ -317,35 +285,16 @@ find_drive (GDBusObjectManagerServer  *object_manager,
 /* ---------------------------------------------------------------------------------------------------- */
 
 static UDisksLinuxMDRaidObject *
-find_mdraid (GDBusObjectManagerServer  *object_manager,
-             const gchar               *md_uuid)
+find_mdraid (UDisksDaemon *daemon,
+             const gchar  *md_uuid)
 {
-  UDisksLinuxMDRaidObject *ret = NULL;
-  GList *objects = NULL, *l;
+  UDisksLinuxProvider *provider;
 
-  objects = g_dbus_object_manager_get_objects (G_DBUS_OBJECT_MANAGER (object_manager));
-  for (l = objects; l != NULL; l = l->next)
-    {
-      GDBusObjectSkeleton *object = G_DBUS_OBJECT_SKELETON (l->data);
-      if (UDISKS_IS_LINUX_MDRAID_OBJECT (object))
-        {
-          UDisksMDRaid *mdraid = udisks_object_get_mdraid (UDISKS_OBJECT (object));
-          if (mdraid != NULL)
-            {
-              if (g_strcmp0 (udisks_mdraid_get_uuid (mdraid), md_uuid) == 0)
-                {
-                  ret = UDISKS_LINUX_MDRAID_OBJECT (g_object_ref (object));
-                  g_object_unref (mdraid);
-                  goto out;
-                }
-              g_object_unref (mdraid);
-            }
-        }
-    }
+  provider = udisks_daemon_get_linux_provider (daemon);
+  if (provider == NULL)
+    return NULL;
 
- out:
-  g_list_free_full (objects, g_object_unref);
-  return ret;
+  return udisks_linux_provider_find_mdraid_object (provider, md_uuid);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -354,7 +303,7 @@ static void
 update_mdraid (UDisksLinuxBlock         *block,
                UDisksLinuxDevice        *device,
                UDisksDrive              *drive,
-               GDBusObjectManagerServer *object_manager)
+               UDisksDaemon             *daemon)
 {
   UDisksBlock *iface = UDISKS_BLOCK (block);
   const gchar *uuid;
@@ -365,7 +314,7 @@ update_mdraid (UDisksLinuxBlock         *block,
   uuid = g_udev_device_get_property (device->udev_device, "UDISKS_MD_UUID");
   if (uuid != NULL && strlen (uuid) > 0)
     {
-      object = find_mdraid (object_manager, uuid);
+      object = find_mdraid (daemon, uuid);
       if (object != NULL)
         {
           objpath_mdraid = g_dbus_object_get_object_path (G_DBUS_OBJECT (object));
@@ -376,7 +325,7 @@ update_mdraid (UDisksLinuxBlock         *block,
   uuid = g_udev_device_get_property (device->udev_device, "UDISKS_MD_MEMBER_UUID");
   if (uuid != NULL && strlen (uuid) > 0)
     {
-      object = find_mdraid (object_manager, uuid);
+      object = find_mdraid (daemon, uuid);
       if (object != NULL)
         {
           objpath_mdraid_member = g_dbus_object_get_object_path (G_DBUS_OBJECT (object));
@@ -458,102 +407,379 @@ udisks_linux_block_matches_id (UDisksLinuxBlock *block,
   return ret;
 }
 
-static GList *
-find_fstab_entries (UDisksDaemon     *daemon,
-                    UDisksLinuxBlock *block,
-                    const gchar      *needle)
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* The /etc/fstab and /etc/crypttab entries are shared by all block objects.
+ *
+ * Each table is parsed only once and kept until the file is modified or
+ * replaced (detected by comparing the stat() data) or until it is explicitly
+ * invalidated with udisks_linux_block_invalidate_etctabs(). The entries are
+ * indexed by the identifier they use to refer to the device (either a
+ * KEY=VALUE tag or a device file) so that looking up the entries for a block
+ * device is just a few hash table lookups instead of a parse of the whole file.
+ */
+typedef struct
+{
+  gboolean valid;
+  gboolean exists;
+  struct stat statbuf;
+
+  GPtrArray *entries;   /* entries in the order they are returned, owns references */
+  GHashTable *index;    /* "TAG=value" or device file -> GArray of guint positions in @entries */
+} EtcTabCache;
+
+G_LOCK_DEFINE_STATIC (etctabs_lock);
+static EtcTabCache fstab_cache;
+static EtcTabCache crypttab_cache;
+
+#define CRYPTTAB_FILENAME "/etc/crypttab"
+
+/* returns the key @source is indexed by, i.e. "TAG=value" for KEY=VALUE
+ * identifiers or @source itself for device files */
+static gchar *
+etctab_source_key (const gchar *source)
+{
+  gchar *tag_type = NULL;
+  gchar *tag_val = NULL;
+  gchar *ret;
+
+  if (source == NULL || *source == '\0')
+    return NULL;
+
+  /* same parsing as in udisks_linux_block_matches_id() */
+  if (blkid_parse_tag_string (source, &tag_type, &tag_val) != 0 || !tag_type || !tag_val)
+    ret = g_strdup (source);
+  else
+    ret = g_strdup_printf ("%s=%s", tag_type, tag_val);
+
+  g_free (tag_type);
+  g_free (tag_val);
+
+  return ret;
+}
+
+/* called with etctabs_lock held */
+static gboolean
+etctab_cache_is_current (EtcTabCache       *cache,
+                         const struct stat *statbuf)
+{
+  if (!cache->valid)
+    return FALSE;
+
+  if (statbuf == NULL)
+    return !cache->exists;
+
+  return cache->exists &&
+         cache->statbuf.st_dev == statbuf->st_dev &&
+         cache->statbuf.st_ino == statbuf->st_ino &&
+         cache->statbuf.st_size == statbuf->st_size &&
+         cache->statbuf.st_mtim.tv_sec == statbuf->st_mtim.tv_sec &&
+         cache->statbuf.st_mtim.tv_nsec == statbuf->st_mtim.tv_nsec;
+}
+
+/* called with etctabs_lock held */
+static void
+etctab_cache_reset (EtcTabCache       *cache,
+                    const struct stat *statbuf)
 {
+  g_clear_pointer (&cache->entries, g_ptr_array_unref);
+  g_clear_pointer (&cache->index, g_hash_table_destroy);
+
+  cache->entries = g_ptr_array_new_with_free_func (g_object_unref);
+  cache->index = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_array_unref);
+
+  cache->valid = TRUE;
+  cache->exists = statbuf != NULL;
+  if (statbuf != NULL)
+    cache->statbuf = *statbuf;
+}
+
+/* called with etctabs_lock held, takes ownership of @entry */
+static void
+etctab_cache_add (EtcTabCache *cache,
+                  gpointer     entry,
+                  const gchar *source)
+{
+  guint position = cache->entries->len;
+  gchar *key;
+  GArray *positions;
+
+  g_ptr_array_add (cache->entries, entry);
+
+  key = etctab_source_key (source);
+  if (key == NULL)
+    return;
+
+  positions = g_hash_table_lookup (cache->index, key);
+  if (positions == NULL)
+    {
+      positions = g_array_new (FALSE, FALSE, sizeof (guint));
+      g_hash_table_insert (cache->index, key, positions);
+    }
+  else
+    g_free (key);
+
+  g_array_append_val (positions, position);
+}
+
+/* called with etctabs_lock held */
+static void
+fstab_cache_ensure (void)
+{
+  const gchar *path = mnt_get_fstab_path ();
+  struct stat statbuf;
+  gboolean exists;
   struct libmnt_table *table;
-  struct libmnt_iter* iter;
+  struct libmnt_iter *iter;
   struct libmnt_fs *fs = NULL;
-  GList *ret = NULL;
+
+  exists = stat (path, &statbuf) == 0;
+  if (etctab_cache_is_current (&fstab_cache, exists ? &statbuf : NULL))
+    return;
+
+  etctab_cache_reset (&fstab_cache, exists ? &statbuf : NULL);
+  if (!exists)
+    return;
 
   table = mnt_new_table ();
   if (mnt_table_parse_fstab (table, NULL) < 0)
     {
       mnt_free_table (table);
-      return NULL;
+      return;
     }
 
   iter = mnt_new_iter (MNT_ITER_FORWARD);
   while (mnt_table_next_fs (table, iter, &fs) == 0)
+    etctab_cache_add (&fstab_cache, _udisks_fstab_entry_new_from_mnt_fs (fs), mnt_fs_get_source (fs));
+  mnt_free_iter (iter);
+  mnt_free_table (table);
+}
+
+/* called with etctabs_lock held */
+static void
+crypttab_cache_ensure (UDisksDaemon *daemon)
+{
+  struct stat statbuf;
+  gboolean exists;
+  GList *entries;
+  GList *l;
+
+  exists = stat (CRYPTTAB_FILENAME, &statbuf) == 0;
+  if (etctab_cache_is_current (&crypttab_cache, exists ? &statbuf : NULL))
+    return;
+
+  etctab_cache_reset (&crypttab_cache, exists ? &statbuf : NULL);
+  if (!exists)
+    return;
+
+  /* keep the order the entries were reported in before they were cached */
+  entries = udisks_crypttab_monitor_get_entries (udisks_daemon_get_crypttab_monitor (daemon));
+  entries = g_list_reverse (entries);
+  for (l = entries; l != NULL; l = l->next)
     {
-      UDisksFstabEntry *entry;
+      UDisksCrypttabEntry *entry = UDISKS_CRYPTTAB_ENTRY (l->data);
+      etctab_cache_add (&crypttab_cache, entry, udisks_crypttab_entry_get_device (entry));
+    }
+  /* references have been transferred to the cache */
+  g_list_free (entries);
+}
 
-      if (block != NULL)
-        {
-          if (! udisks_linux_block_matches_id (block, mnt_fs_get_source (fs)))
-            continue;
-        }
-      else if (needle != NULL)
+/* returns all the keys the entries for @block may be indexed by */
+static GPtrArray *
+block_etctab_keys (UDisksLinuxBlock *block)
+{
+  UDisksBlock *iface = UDISKS_BLOCK (block);
+  GPtrArray *keys;
+  const gchar *const *symlinks;
+  const gchar *value;
+  UDisksObject *object;
+
+  keys = g_ptr_array_new_with_free_func (g_free);
+
+  value = udisks_block_get_device (iface);
+  if (value != NULL && *value != '\0')
+    g_ptr_array_add (keys, g_strdup (value));
+
+  symlinks = udisks_block_get_symlinks (iface);
+  for (; symlinks != NULL && *symlinks != NULL; symlinks++)
+    g_ptr_array_add (keys, g_strdup (*symlinks));
+
+  value = udisks_block_get_id_uuid (iface);
+  if (value != NULL && *value != '\0')
+    g_ptr_array_add (keys, g_strdup_printf ("UUID=%s", value));
+
+  value = udisks_block_get_id_label (iface);
+  if (value != NULL && *value != '\0')
+    g_ptr_array_add (keys, g_strdup_printf ("LABEL=%s", value));
+
+  object = udisks_daemon_util_dup_object (block, NULL);
+  if (object != NULL)
+    {
+      UDisksPartition *partition = udisks_object_peek_partition (object);
+
+      if (partition != NULL)
         {
-          const char *opts;
+          value = udisks_partition_get_uuid (partition);
+          if (value != NULL && *value != '\0')
+            g_ptr_array_add (keys, g_strdup_printf ("PARTUUID=%s", value));
 
-          opts = mnt_fs_get_options (fs);
-          if (! opts || g_strstr_len (opts, -1, needle) == NULL)
-            continue;
+          value = udisks_partition_get_name (partition);
+          if (value != NULL && *value != '\0')
+            g_ptr_array_add (keys, g_strdup_printf ("PARTLABEL=%s", value));
         }
-
-      entry = _udisks_fstab_entry_new_from_mnt_fs (fs);
-      ret = g_list_prepend (ret, entry);
+      g_object_unref (object);
     }
-  mnt_free_iter (iter);
-  mnt_free_table (table);
 
-  return g_list_reverse (ret);
+  return keys;
+}
+
+static gint
+compare_positions (gconstpointer a,
+                   gconstpointer b)
+{
+  guint pa = *((const guint *) a);
+  guint pb = *((const guint *) b);
+
+  return pa < pb ? -1 : (pa > pb ? 1 : 0);
 }
 
+/* called with etctabs_lock held */
 static GList *
-find_crypttab_entries_for_device (UDisksLinuxBlock *block,
-                                  UDisksDaemon     *daemon)
+etctab_cache_lookup_block (EtcTabCache      *cache,
+                           UDisksLinuxBlock *block)
+{
+  GPtrArray *keys;
+  GArray *found;
+  GList *ret = NULL;
+  guint n;
+
+  keys = block_etctab_keys (block);
+  found = g_array_new (FALSE, FALSE, sizeof (guint));
+  for (n = 0; n < keys->len; n++)
+    {
+      GArray *positions = g_hash_table_lookup (cache->index, keys->pdata[n]);
+      if (positions != NULL)
+        g_array_append_vals (found, positions->data, positions->len);
+    }
+
+  /* keep the file order and drop duplicates */
+  g_array_sort (found, compare_positions);
+  for (n = found->len; n > 0; n--)
+    {
+      guint position = g_array_index (found, guint, n - 1);
+
+      if (n < found->len && position == g_array_index (found, guint, n))
+        continue;
+      ret = g_list_prepend (ret, g_object_ref (cache->entries->pdata[position]));
+    }
+
+  g_array_unref (found);
+  g_ptr_array_unref (keys);
+
+  return ret;
+}
+
+/**
+ * udisks_linux_block_invalidate_etctabs:
+ *
+ * Drops the cached /etc/fstab and /etc/crypttab entries so that they are
+ * parsed again on next use. Should be called whenever either of the files
+ * is known to have changed.
+ */
+void
+udisks_linux_block_invalidate_etctabs (void)
+{
+  G_LOCK (etctabs_lock);
+  fstab_cache.valid = FALSE;
+  crypttab_cache.valid = FALSE;
+  G_UNLOCK (etctabs_lock);
+}
+
+/**
+ * udisks_linux_block_find_fstab_entries:
+ * @block: A #UDisksLinuxBlock.
+ *
+ * Finds all /etc/fstab entries referring to @block, see
+ * udisks_linux_block_matches_id() for the identifiers that are considered.
+ *
+ * Returns: (transfer full) (element-type UDisksFstabEntry): A list of #UDisksFstabEntry objects in the file order. Free with g_list_free_full() and g_object_unref().
+ */
+GList *
+udisks_linux_block_find_fstab_entries (UDisksLinuxBlock *block)
 {
-  GList *entries;
-  GList *l;
   GList *ret;
 
-  ret = NULL;
+  g_return_val_if_fail (UDISKS_IS_LINUX_BLOCK (block), NULL);
 
-  /* if this is too slow, we could add lookup methods to UDisksCrypttabMonitor... */
-  entries = udisks_crypttab_monitor_get_entries (udisks_daemon_get_crypttab_monitor (daemon));
-  for (l = entries; l != NULL; l = l->next)
+  G_LOCK (etctabs_lock);
+  fstab_cache_ensure ();
+  ret = etctab_cache_lookup_block (&fstab_cache, block);
+  G_UNLOCK (etctabs_lock);
+
+  return ret;
+}
+
+static GList *
+find_fstab_entries_for_needle (const gchar *needle)
+{
+  GList *ret = NULL;
+  guint n;
+
+  G_LOCK (etctabs_lock);
+  fstab_cache_ensure ();
+  for (n = fstab_cache.entries->len; n > 0; n--)
     {
-      UDisksCrypttabEntry *entry = UDISKS_CRYPTTAB_ENTRY (l->data);
-      const gchar *device;
+      UDisksFstabEntry *entry = UDISKS_FSTAB_ENTRY (fstab_cache.entries->pdata[n - 1]);
+      const gchar *opts;
 
-      device = udisks_crypttab_entry_get_device (entry);
-      if (udisks_linux_block_matches_id (block, device))
+      opts = udisks_fstab_entry_get_opts (entry);
+      if (opts && g_strstr_len (opts, -1, needle) != NULL)
         ret = g_list_prepend (ret, g_object_ref (entry));
     }
+  G_UNLOCK (etctabs_lock);
 
-  g_list_free_full (entries, g_object_unref);
   return ret;
 }
 
 static GList *
-find_crypttab_entries_for_needle (gchar        *needle,
-                                  UDisksDaemon *daemon)
+find_crypttab_entries_for_device (UDisksLinuxBlock *block,
+                                  UDisksDaemon     *daemon)
 {
-  GList *entries;
-  GList *l;
   GList *ret;
 
-  ret = NULL;
+  G_LOCK (etctabs_lock);
+  crypttab_cache_ensure (daemon);
+  ret = etctab_cache_lookup_block (&crypttab_cache, block);
+  G_UNLOCK (etctabs_lock);
 
-  entries = udisks_crypttab_monitor_get_entries (udisks_daemon_get_crypttab_monitor (daemon));
-  for (l = entries; l != NULL; l = l->next)
+  return ret;
+}
+
+static GList *
+find_crypttab_entries_for_needle (gchar        *needle,
+                                  UDisksDaemon *daemon)
+{
+  GList *ret = NULL;
+  guint n;
+
+  G_LOCK (etctabs_lock);
+  crypttab_cache_ensure (daemon);
+  for (n = crypttab_cache.entries->len; n > 0; n--)
     {
-      UDisksCrypttabEntry *entry = UDISKS_CRYPTTAB_ENTRY (l->data);
+      UDisksCrypttabEntry *entry = UDISKS_CRYPTTAB_ENTRY (crypttab_cache.entries->pdata[n - 1]);
       const gchar *opts = NULL;
 
       opts = udisks_crypttab_entry_get_options (entry);
-      if (opts && strstr(opts, needle))
+      if (opts && strstr (opts, needle))
         ret = g_list_prepend (ret, g_object_ref (entry));
     }
+  G_UNLOCK (etctabs_lock);
 
-  g_list_free_full (entries, g_object_unref);
   return ret;
 }
 
+/* ---------------------------------------------------------------------------------------------------- */
+
 static GList *
 find_utab_entries_for_device (UDisksLinuxBlock *block,
                               UDisksDaemon     *daemon)
@@ -685,7 +911,7 @@ calculate_configuration (UDisksLinuxBlock  *block,
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sa{sv})"));
   /* First the /etc/fstab entries */
-  entries = find_fstab_entries (daemon, block, NULL);
+  entries = udisks_linux_block_find_fstab_entries (block);
   for (l = entries; l != NULL; l = l->next)
     add_fstab_entry (&builder, UDISKS_FSTAB_ENTRY (l->data));
   g_list_free_full (entries, g_object_unref);
@@ -789,7 +1015,7 @@ find_configurations (gchar         *needle,
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sa{sv})"));
   /* First the /etc/fstab entries */
-  entries = find_fstab_entries (daemon, NULL, needle);
+  entries = find_fstab_entries_for_needle (needle);
   for (l = entries; l != NULL; l = l->next)
     add_fstab_entry (&builder, UDISKS_FSTAB_ENTRY (l->data));
   g_list_free_full (entries, g_object_unref);
@@ -904,7 +1130,7 @@ update_hints (UDisksDaemon      *daemon,
     hint_partitionable = FALSE;
 
   /* Check fstab entries */
-  fstab_entries = find_fstab_entries (daemon, block, NULL);
+  fstab_entries = udisks_linux_block_find_fstab_entries (block);
   for (l = fstab_entries; l != NULL; l = l->next)
     {
       UDisksFstabEntry *entry = UDISKS_FSTAB_ENTRY (l->data);
@@ -975,7 +1201,6 @@ udisks_linux_block_update (UDisksLinuxBlock       *block,
 {
   UDisksBlock *iface = UDISKS_BLOCK (block);
   UDisksDaemon *daemon;
-  GDBusObjectManagerServer *object_manager;
   UDisksLinuxDevice *device;
   GUdevDeviceNumber dev;
   gchar *drive_object_path;
@@ -1001,7 +1226,6 @@ udisks_linux_block_update (UDisksLinuxBlock       *block,
     goto out;
 
   daemon = udisks_linux_block_object_get_daemon (object);
-  object_manager = udisks_daemon_get_object_manager (daemon);
 
   dev = g_udev_device_get_device_number (device->udev_device);
   device_file = g_udev_device_get_device_file (device->udev_device);
@@ -1041,7 +1265,7 @@ udisks_linux_block_update (UDisksLinuxBlock       *block,
           while (slave_sysfs_path)
             {
               UDisksLinuxBlockObject *slave_object;
-              slave_object = find_block_device_by_sysfs_path (object_manager, slave_sysfs_path);
+              slave_object = find_block_device_by_sysfs_path (daemon, slave_sysfs_path);
               if (slave_object != NULL)
                 {
                   UDisksEncrypted *enc;
@@ -1140,7 +1364,7 @@ udisks_linux_block_update (UDisksLinuxBlock       *block,
    * TODO: if this is slow we could have a cache or ensure that we
    * only do this once or something else
    */
-  drive_object_path = find_drive (object_manager, device->udev_device, &drive);
+  drive_object_path = find_drive (daemon, device->udev_device, &drive);
   if (drive_object_path != NULL)
     {
       udisks_block_set_drive (iface, drive_object_path);
@@ -1247,7 +1471,7 @@ udisks_linux_block_update (UDisksLinuxBlock       *block,
   update_hints (daemon, block, device, drive);
   update_configuration (block, daemon);
   update_userspace_mount_options (block, daemon);
-  update_mdraid (block, device, drive, object_manager);
+  update_mdraid (block, device, drive, daemon);
 
  out:
   g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (block));
@@ -1627,6 +1851,8 @@ add_remove_fstab_entry (UDisksBlock *block,
                                              error))
     goto out;
 
+  udisks_linux_block_invalidate_etctabs ();
+
   ret = TRUE;
 
  out:
@@ -1969,6 +2195,8 @@ add_remove_crypttab_entry (UDisksBlock *block,
                                              error))
     goto out;
 
+  udisks_linux_block_invalidate_etctabs ();
+
   ret = TRUE;
 
  out:
@@ -1998,7 +2226,7 @@ update_block_fstab (UDisksDaemon           *daemon,
 
   /* hints take fstab records in the calculation */
   device = udisks_linux_block_object_get_device (object);
-  drive_object_path = find_drive (udisks_daemon_get_object_manager (daemon), device->udev_device, &drive);
+  drive_object_path = find_drive (daemon, device->udev_device, &drive);
   update_hints (daemon, block, device, drive);
   g_free (drive_object_path);
   g_clear_object (&device);
@@ -2363,29 +2591,14 @@ wait_for_luks_cleartext (UDisksDaemon *daemon,
 {
   FormatWaitData *data = user_data;
   UDisksObject *ret = NULL;
-  GList *objects, *l;
-
-  objects = udisks_daemon_get_objects (daemon);
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block = NULL;
+  GList *objects;
 
-      block = udisks_object_get_block (object);
-      if (block != NULL)
-        {
-          if (g_strcmp0 (udisks_block_get_crypto_backing_device (block),
-                         g_dbus_object_get_object_path (G_DBUS_OBJECT (data->object))) == 0)
-            {
-              g_object_unref (block);
-              ret = g_object_ref (object);
-              goto out;
-            }
-          g_object_unref (block);
-        }
-    }
+  objects = udisks_daemon_get_child_objects (daemon,
+                                             g_dbus_object_get_object_path (G_DBUS_OBJECT (data->object)),
+                                             UDISKS_OBJECT_RELATION_CLEARTEXT);
+  if (objects != NULL)
+    ret = g_object_ref (objects->data);
 
- out:
   g_list_free_full (objects, g_object_unref);
   return ret;
 }
@@ -2446,7 +2659,158 @@ erase_ata_device (UDisksBlock   *block,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
-#define ERASE_SIZE (1 * 1024*1024)
+#ifndef BLKDISCARD
+#define BLKDISCARD    _IO(0x12,119)
+#endif
+#ifndef BLKSECDISCARD
+#define BLKSECDISCARD _IO(0x12,125)
+#endif
+#ifndef BLKZEROOUT
+#define BLKZEROOUT    _IO(0x12,127)
+#endif
+
+/* Size of the ranges passed to the BLKZEROOUT and BLKDISCARD ioctls at once */
+#define ERASE_OFFLOAD_SIZE (256 * 1024*1024)
+
+/* Size and alignment of the buffer used to write zeroes when the device can't do it itself */
+#define ERASE_WRITE_SIZE   (8 * 1024*1024)
+#define ERASE_WRITE_ALIGN  4096
+
+/* Granularity of sleeping when a rate limit is in effect */
+#define ERASE_THROTTLE_USEC (100 * 1000)
+
+typedef struct
+{
+  UDisksBaseJob *job;
+  guint64 size;
+  guint64 rate_limit;
+  guint64 chunk_size;
+  gint64 start_time;
+  gint64 last_time;
+} EraseProgress;
+
+/* Called after each erased chunk, @pos bytes have been erased so far.
+ *
+ * Reports progress through the job at most once a second (the rate and
+ * expected end time are estimated from it by the job), sleeps as needed
+ * to stay under the rate limit and returns FALSE with @error set if the
+ * job was cancelled.
+ */
+static gboolean
+erase_progress_update (EraseProgress  *progress,
+                       guint64         pos,
+                       GError        **error)
+{
+  GCancellable *cancellable = udisks_base_job_get_cancellable (progress->job);
+  gint64 now;
+
+  if (progress->rate_limit > 0)
+    {
+      gint64 due;
+
+      due = progress->start_time + (gint64) ((gdouble) pos / progress->rate_limit * G_USEC_PER_SEC);
+      while ((now = g_get_monotonic_time ()) < due && !g_cancellable_is_cancelled (cancellable))
+        g_usleep (MIN (due - now, ERASE_THROTTLE_USEC));
+    }
+
+  if (g_cancellable_is_cancelled (cancellable))
+    {
+      g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_CANCELLED,
+                   "Job was canceled");
+      return FALSE;
+    }
+
+  /* only emit D-Bus signal at most once a second */
+  now = g_get_monotonic_time ();
+  if (now - progress->last_time > G_USEC_PER_SEC || pos == progress->size)
+    {
+      udisks_job_set_progress (UDISKS_JOB (progress->job), ((gdouble) pos) / progress->size);
+      progress->last_time = now;
+    }
+
+  return TRUE;
+}
+
+/* Erases the device using @request (one of BLKZEROOUT, BLKDISCARD and
+ * BLKSECDISCARD) starting at *@pos. On failure, *@pos is where the
+ * device stopped and errno is set.
+ */
+static gboolean
+erase_device_offload (gint            fd,
+                      gulong          request,
+                      guint64        *pos,
+                      EraseProgress  *progress,
+                      GError        **error)
+{
+  while (*pos < progress->size)
+    {
+      guint64 range[2];
+
+      range[0] = *pos;
+      range[1] = MIN (progress->size - *pos, progress->chunk_size);
+      if (ioctl (fd, request, range) != 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return FALSE;
+        }
+      *pos += range[1];
+
+      if (!erase_progress_update (progress, *pos, error))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Writes zeroes to the device from *@pos on */
+static gboolean
+erase_device_write (gint            fd,
+                    const gchar    *device_file,
+                    guint64        *pos,
+                    EraseProgress  *progress,
+                    GError        **error)
+{
+  gboolean ret = FALSE;
+  gpointer buf = NULL;
+
+  if (posix_memalign (&buf, ERASE_WRITE_ALIGN, ERASE_WRITE_SIZE) != 0)
+    {
+      g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                   "Error allocating memory for erasing %s", device_file);
+      goto out;
+    }
+  memset (buf, 0, ERASE_WRITE_SIZE);
+
+  while (*pos < progress->size)
+    {
+      size_t to_write;
+      ssize_t num_written;
+
+      to_write = MIN (progress->size - *pos, MIN (progress->chunk_size, ERASE_WRITE_SIZE));
+    again:
+      num_written = pwrite (fd, buf, to_write, *pos);
+      if (num_written == -1 || num_written == 0)
+        {
+          if (errno == EINTR)
+            goto again;
+          g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                       "Error writing %d bytes to %s: %m",
+                       (gint) to_write, device_file);
+          goto out;
+        }
+      *pos += num_written;
+
+      if (!erase_progress_update (progress, *pos, error))
+        goto out;
+    }
+
+  ret = TRUE;
+
+ out:
+  free (buf);
+  return ret;
+}
 
 static gboolean
 erase_device (UDisksBlock   *block,
@@ -2454,6 +2818,7 @@ erase_device (UDisksBlock   *block,
               UDisksDaemon  *daemon,
               uid_t          caller_uid,
               const gchar   *erase_type,
+              guint64        rate_limit,
               GError       **error)
 {
   gboolean ret = FALSE;
@@ -2462,8 +2827,8 @@ erase_device (UDisksBlock   *block,
   gint fd = -1;
   guint64 size;
   guint64 pos;
-  guchar *buf = NULL;
-  gint64 time_of_last_signal;
+  gulong request;
+  EraseProgress progress;
   GError *local_error = NULL;
 
   if (g_strcmp0 (erase_type, "ata-secure-erase") == 0)
@@ -2476,7 +2841,19 @@ erase_device (UDisksBlock   *block,
       ret = erase_ata_device (block, object, daemon, caller_uid, TRUE, error);
       goto out;
     }
-  else if (g_strcmp0 (erase_type, "zero") != 0)
+  else if (g_strcmp0 (erase_type, "zero") == 0)
+    {
+      request = BLKZEROOUT;
+    }
+  else if (g_strcmp0 (erase_type, "discard") == 0)
+    {
+      request = BLKDISCARD;
+    }
+  else if (g_strcmp0 (erase_type, "secure-discard") == 0)
+    {
+      request = BLKSECDISCARD;
+    }
+  else
     {
       g_set_error (&local_error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
                    "Unknown or unsupported erase type `%s'",
@@ -2484,8 +2861,13 @@ erase_device (UDisksBlock   *block,
       goto out;
     }
 
+  /* O_DIRECT is only needed for the fallback to writing zeroes, but
+   * the device can't be reopened once it's been claimed with O_EXCL
+   */
   device_file = udisks_block_get_device (block);
-  fd = open (device_file, O_WRONLY | O_SYNC | O_EXCL);
+  fd = open (device_file, O_WRONLY | O_DIRECT | O_EXCL);
+  if (fd == -1 && errno == EINVAL)
+    fd = open (device_file, O_WRONLY | O_SYNC | O_EXCL);
   if (fd == -1)
     {
       g_set_error (&local_error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
@@ -2494,7 +2876,6 @@ erase_device (UDisksBlock   *block,
     }
 
   job = udisks_daemon_launch_simple_job (daemon, object, "format-erase", caller_uid, FALSE, NULL);
-  udisks_base_job_set_auto_estimate (UDISKS_BASE_JOB (job), TRUE);
   udisks_job_set_progress_valid (UDISKS_JOB (job), TRUE);
 
   if (ioctl (fd, BLKGETSIZE64, &size) != 0)
@@ -2505,45 +2886,45 @@ erase_device (UDisksBlock   *block,
     }
 
   udisks_job_set_bytes (UDISKS_JOB (job), size);
-
-  buf = g_new0 (guchar, ERASE_SIZE);
+  udisks_base_job_set_auto_estimate (job, TRUE);
+
+  progress.job = job;
+  progress.size = size;
+  progress.rate_limit = rate_limit;
+  /* keep the chunks small enough for a steady rate when throttled */
+  progress.chunk_size = ERASE_OFFLOAD_SIZE;
+  if (rate_limit > 0)
+    progress.chunk_size = CLAMP (rate_limit / 4 / ERASE_WRITE_ALIGN * ERASE_WRITE_ALIGN,
+                                 ERASE_WRITE_ALIGN, ERASE_OFFLOAD_SIZE);
+  progress.start_time = g_get_monotonic_time ();
+  progress.last_time = progress.start_time;
+
+  /* let the device (or the kernel) do the work if it can */
   pos = 0;
-  time_of_last_signal = g_get_monotonic_time ();
-  while (pos < size)
+  if (!erase_device_offload (fd, request, &pos, &progress, &local_error))
     {
-      size_t to_write;
-      ssize_t num_written;
-      gint64 now;
+      if (local_error != NULL)
+        goto out;
 
-      to_write = MIN (size - pos, ERASE_SIZE);
-    again:
-      num_written = write (fd, buf, to_write);
-      if (num_written == -1 || num_written == 0)
+      /* only zeroing out has a fallback, discarding is an explicit request */
+      if (request != BLKZEROOUT || (errno != EOPNOTSUPP && errno != ENOTTY && errno != EINVAL))
         {
-          if (errno == EINTR)
-            goto again;
           g_set_error (&local_error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
-                       "Error writing %d bytes to %s: %m",
-                       (gint) to_write, device_file);
+                       "Error erasing %s at offset %" G_GUINT64_FORMAT ": %m",
+                       device_file, pos);
           goto out;
         }
-      pos += num_written;
 
-      if (g_cancellable_is_cancelled (udisks_base_job_get_cancellable (job)))
-        {
-          g_set_error (&local_error, UDISKS_ERROR, UDISKS_ERROR_CANCELLED,
-                       "Job was canceled");
-          goto out;
-        }
+      udisks_debug ("Device %s doesn't support BLKZEROOUT, writing zeroes instead", device_file);
+      if (!erase_device_write (fd, device_file, &pos, &progress, &local_error))
+        goto out;
+    }
 
-      /* only emit D-Bus signal at most once a second */
-      now = g_get_monotonic_time ();
-      if (now - time_of_last_signal > G_USEC_PER_SEC)
-        {
-          /* TODO: estimation etc. */
-          udisks_job_set_progress (UDISKS_JOB (job), ((gdouble) pos) / size);
-          time_of_last_signal = now;
-        }
+  if (fsync (fd) != 0)
+    {
+      g_set_error (&local_error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                   "Error syncing %s: %m", device_file);
+      goto out;
     }
 
   ret = TRUE;
@@ -2558,7 +2939,6 @@ erase_device (UDisksBlock   *block,
     }
   if (local_error != NULL)
     g_propagate_error (error, local_error);
-  g_free (buf);
   if (fd != -1)
     close (fd);
   return ret;
@@ -2592,7 +2972,6 @@ get_cleartext_block (UDisksDaemon  *daemon,
 {
   UDisksBlock *ret = NULL;
   GDBusObject *object;
-  const gchar *object_path;
   GList *objects = NULL;
   GList *l;
 
@@ -2600,22 +2979,14 @@ get_cleartext_block (UDisksDaemon  *daemon,
   if (object == NULL)
     goto out;
 
-  object_path = g_dbus_object_get_object_path (object);
-  objects = udisks_daemon_get_objects (daemon);
+  objects = udisks_daemon_get_child_objects (daemon,
+                                             g_dbus_object_get_object_path (object),
+                                             UDISKS_OBJECT_RELATION_CLEARTEXT);
   for (l = objects; l != NULL; l = l->next)
     {
-      UDisksObject *iter_object = UDISKS_OBJECT (l->data);
-      UDisksBlock *iter_block;
-
-      iter_block = udisks_object_peek_block (iter_object);
-      if (iter_block == NULL)
-        continue;
-
-      if (g_strcmp0 (udisks_block_get_crypto_backing_device (iter_block), object_path) == 0)
-        {
-          ret = g_object_ref (iter_block);
-          goto out;
-        }
+      ret = udisks_object_get_block (UDISKS_OBJECT (l->data));
+      if (ret != NULL)
+        break;
     }
 
  out:
@@ -3184,6 +3555,7 @@ format_wipe (UDisksDaemon  *daemon,
                                                           &wait_data,
                                                           NULL,
                                                           UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                          NULL,
                                                           error);
   if (filesystem_object == NULL)
     {
@@ -3268,6 +3640,7 @@ format_create_luks (UDisksDaemon  *daemon,
                                                          &wait_data,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         NULL,
                                                          error);
   if (luks_uuid_object == NULL)
     {
@@ -3308,6 +3681,7 @@ format_create_luks (UDisksDaemon  *daemon,
                                                          &wait_data,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         NULL,
                                                          error);
   if (cleartext_object == NULL)
     {
@@ -3476,6 +3850,7 @@ udisks_linux_block_handle_format (UDisksBlock             *block,
   guint32 encrypt_threads = 0;
   const gchar *encrypt_label = NULL;
   const gchar *erase_type = NULL;
+  guint64 erase_rate_limit = 0;
   gboolean no_block = FALSE;
   gboolean update_partition_type = FALSE;
   gboolean dry_run_first = FALSE;
@@ -3511,6 +3886,7 @@ udisks_linux_block_handle_format (UDisksBlock             *block,
   g_variant_lookup (options, "encrypt.threads", "u", &encrypt_threads);
   g_variant_lookup (options, "encrypt.label", "&s", &encrypt_label);
   g_variant_lookup (options, "erase", "&s", &erase_type);
+  g_variant_lookup (options, "erase-rate-limit", "t", &erase_rate_limit);
   g_variant_lookup (options, "no-block", "b", &no_block);
   g_variant_lookup (options, "update-partition-type", "b", &update_partition_type);
   g_variant_lookup (options, "dry-run-first", "b", &dry_run_first);
@@ -3679,7 +4055,7 @@ udisks_linux_block_handle_format (UDisksBlock             *block,
   /* Erase the device, if requested */
   if (erase_type != NULL)
     {
-      if (!erase_device (block_to_mkfs, object_to_mkfs, daemon, caller_uid, erase_type, &error))
+      if (!erase_device (block_to_mkfs, object_to_mkfs, daemon, caller_uid, erase_type, erase_rate_limit, &error))
         {
           g_prefix_error (&error, "Error erasing device: ");
           handle_format_failure (invocation, error);
@@ -3804,6 +4180,7 @@ udisks_linux_block_handle_format (UDisksBlock             *block,
                                                           &wait_data,
                                                           NULL,
                                                           UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                          NULL,
                                                           &error);
   if (filesystem_object == NULL)
     {
@@ -3818,7 +4195,7 @@ udisks_linux_block_handle_format (UDisksBlock             *block,
       (fs_features->features & BD_FS_FEATURE_OWNERS) == BD_FS_FEATURE_OWNERS)
     {
       if (!take_filesystem_ownership (udisks_block_get_device (block_to_mkfs),
-                                      type, caller_uid, caller_gid, FALSE, &error))
+                                      type, caller_uid, caller_gid, FALSE, NULL, &error))
         {
           g_prefix_error (&error, "Failed to take ownership of the newly created filesystem: ");
           handle_format_failure (invocation, error);
@@ -637,7 +637,8 @@ udisks_linux_drive_ata_refresh_smart_sync (UDisksLinuxDriveAta  *drive,
       goto out;
     }
 
-  /* TODO: use cancellable */
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    goto out;
 
   if (simulate_path != NULL)
     {
@@ -687,6 +688,10 @@ udisks_linux_drive_ata_refresh_smart_sync (UDisksLinuxDriveAta  *drive,
           goto out_io;
         }
 
+      /* checking the power state may have taken a while on a slow link */
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        goto out_io;
+
       extra = build_smart_extra_args (device);
       data = bd_smart_ata_get_info (g_udev_device_get_device_file (device->udev_device),
                                     (const BDExtraArg **) extra,
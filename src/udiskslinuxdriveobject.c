@@ -24,6 +24,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "udiskslogging.h"
 #include "udisksdaemon.h"
@@ -72,6 +73,9 @@ struct _UDisksLinuxDriveObject
   UDisksLinuxNVMeController *iface_nvme_ctrl;
   UDisksNVMeFabrics *iface_nvme_fabrics;
   GHashTable *module_ifaces;
+
+  /* set while udisks_linux_drive_object_housekeeping() runs, accessed atomically */
+  gint housekeeping_running;
 };
 
 struct _UDisksLinuxDriveObjectClass
@@ -1100,6 +1104,13 @@ udisks_linux_drive_object_should_include_device (GUdevClient        *client,
  * Long-running tasks should periodically check @cancellable to see if
  * they have been cancelled.
  *
+ * If housekeeping for @object is still in progress in another thread,
+ * e.g. because a previous run got stuck on an unresponsive device, this
+ * function returns %TRUE immediately.
+ *
+ * On completion, the #UDisksDrive:housekeeping-updated and
+ * #UDisksDrive:housekeeping-duration properties are updated.
+ *
  * Returns: %TRUE if the operation succeeded, %FALSE if @error is set.
  */
 gboolean
@@ -1108,11 +1119,24 @@ udisks_linux_drive_object_housekeeping (UDisksLinuxDriveObject  *object,
                                         GCancellable            *cancellable,
                                         GError                 **error)
 {
+  UDisksDrive *iface_drive = NULL;
   UDisksDriveAta *iface_drive_ata = NULL;
   UDisksNVMeController *iface_nvme_ctrl = NULL;
   UDisksLinuxDevice *device = NULL;
+  gint64 start_time;
   gboolean ret = FALSE;
 
+  if (!g_atomic_int_compare_and_exchange (&object->housekeeping_running, 0, 1))
+    {
+      udisks_info ("Housekeeping for drive %s still in progress, skipping",
+                   g_dbus_object_get_object_path (G_DBUS_OBJECT (object)));
+      return TRUE;
+    }
+  start_time = g_get_monotonic_time ();
+
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    goto out;
+
   /* ATA */
   iface_drive_ata = udisks_object_get_drive_ata (UDISKS_OBJECT (object));
   if (iface_drive_ata != NULL &&
@@ -1167,6 +1191,9 @@ udisks_linux_drive_object_housekeeping (UDisksLinuxDriveObject  *object,
         }
     }
 
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    goto out;
+
   /* NVMe */
   iface_nvme_ctrl = udisks_object_get_nvme_controller (UDISKS_OBJECT (object));
   if (iface_nvme_ctrl != NULL &&
@@ -1195,7 +1222,17 @@ udisks_linux_drive_object_housekeeping (UDisksLinuxDriveObject  *object,
   ret = TRUE;
 
  out:
+  iface_drive = udisks_object_get_drive (UDISKS_OBJECT (object));
+  if (iface_drive != NULL)
+    {
+      if (ret)
+        udisks_drive_set_housekeeping_updated (iface_drive, time (NULL));
+      udisks_drive_set_housekeeping_duration (iface_drive, g_get_monotonic_time () - start_time);
+    }
+  g_atomic_int_set (&object->housekeeping_running, 0);
+
   g_clear_object (&device);
+  g_clear_object (&iface_drive);
   g_clear_object (&iface_drive_ata);
   g_clear_object (&iface_nvme_ctrl);
   return ret;
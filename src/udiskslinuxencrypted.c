@@ -116,28 +116,12 @@ wait_for_cleartext_object (UDisksDaemon *daemon,
 {
   const gchar *crypto_object_path = user_data;
   UDisksObject *ret = NULL;
-  GList *objects, *l;
+  GList *objects;
 
-  objects = udisks_daemon_get_objects (daemon);
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
-
-      block = udisks_object_get_block (object);
-      if (block != NULL)
-        {
-          if (g_strcmp0 (udisks_block_get_crypto_backing_device (block), crypto_object_path) == 0)
-            {
-              g_object_unref (block);
-              ret = g_object_ref (object);
-              goto out;
-            }
-          g_object_unref (block);
-        }
-    }
+  objects = udisks_daemon_get_child_objects (daemon, crypto_object_path, UDISKS_OBJECT_RELATION_CLEARTEXT);
+  if (objects != NULL)
+    ret = g_object_ref (objects->data);
 
- out:
   g_list_free_full (objects, g_object_unref);
   return ret;
 }
@@ -427,6 +411,7 @@ handle_unlock (UDisksEncrypted        *encrypted,
                                                          g_strdup (g_dbus_object_get_object_path (G_DBUS_OBJECT (object))),
                                                          g_free,
                                                          0, /* timeout_seconds */
+                                                         NULL, /* cancellable */
                                                          NULL); /* error */
   if (cleartext_object != NULL)
     {
@@ -604,6 +589,7 @@ handle_unlock (UDisksEncrypted        *encrypted,
                                                          g_strdup (g_dbus_object_get_object_path (G_DBUS_OBJECT (object))),
                                                          g_free,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         NULL,
                                                          &error);
   if (cleartext_object == NULL)
     {
@@ -720,6 +706,7 @@ udisks_linux_encrypted_lock (UDisksLinuxEncrypted   *encrypted,
                                                          g_strdup (g_dbus_object_get_object_path (G_DBUS_OBJECT (object))),
                                                          g_free,
                                                          0, /* timeout_seconds */
+                                                         NULL, /* cancellable */
                                                          NULL); /* error */
   if (cleartext_object == NULL)
     {
@@ -821,6 +808,7 @@ udisks_linux_encrypted_lock (UDisksLinuxEncrypted   *encrypted,
                                                          cleartext_path,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         NULL,
                                                          &loc_error))
     {
       g_set_error (error,
@@ -1074,6 +1062,7 @@ handle_resize (UDisksEncrypted       *encrypted,
                                                          g_strdup (g_dbus_object_get_object_path (G_DBUS_OBJECT (object))),
                                                          g_free,
                                                          0, /* timeout_seconds */
+                                                         NULL, /* cancellable */
                                                          NULL); /* error */
   if (cleartext_object == NULL)
     {
@@ -23,6 +23,7 @@
 
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/statvfs.h>
 #include <pwd.h>
 #include <grp.h>
 #include <string.h>
@@ -37,8 +38,6 @@
 #include <blockdev/fs.h>
 #include <blockdev/utils.h>
 
-#include <libmount/libmount.h>
-
 #include <glib/gstdio.h>
 
 #include "udiskslogging.h"
@@ -46,6 +45,7 @@
 #include "udiskslinuxfilesystemhelpers.h"
 #include "udiskslinuxblockobject.h"
 #include "udiskslinuxblock.h"
+#include "udisksfstabentry.h"
 #include "udisksdaemon.h"
 #include "udisksstate.h"
 #include "udisksdaemonutil.h"
@@ -78,10 +78,19 @@ struct _UDisksLinuxFilesystem
 {
   UDisksFilesystemSkeleton parent_instance;
   GMutex lock;
-  guint64 cached_fs_size;
-  gchar *cached_device_file;
-  gchar *cached_fs_type;
-  gboolean cached_drive_is_ata;
+
+  /* bumped on every update so that results of outdated size queries are dropped,
+   * size_done_generation is the last one whose size has been determined */
+  GMutex size_lock;
+  GCond size_cond;
+  guint size_generation;
+  guint size_done_generation;
+
+  /* the mount point usage statistics are taken from or NULL if not mounted */
+  gchar *usage_mount_point;
+  guint usage_timeout_id;
+  guint usage_interval;
+  gboolean usage_refreshing;
 };
 
 struct _UDisksLinuxFilesystemClass
@@ -89,14 +98,7 @@ struct _UDisksLinuxFilesystemClass
   UDisksFilesystemSkeletonClass parent_class;
 };
 
-enum
-{
-  PROP_0,
-  PROP_SIZE,
-};
-
 static void filesystem_iface_init (UDisksFilesystemIface *iface);
-static guint64 get_filesystem_size (UDisksLinuxFilesystem *filesystem);
 
 G_DEFINE_TYPE_WITH_CODE (UDisksLinuxFilesystem, udisks_linux_filesystem, UDISKS_TYPE_FILESYSTEM_SKELETON,
                          G_IMPLEMENT_INTERFACE (UDISKS_TYPE_FILESYSTEM, filesystem_iface_init));
@@ -140,6 +142,12 @@ static const gchar *well_known_filesystems[] =
   "xfs",
 };
 
+/* Bounds of the refresh interval of usage statistics - the interval is
+ * doubled every time nothing changed and reset once something does
+ */
+#define USAGE_REFRESH_MIN_SECS   5
+#define USAGE_REFRESH_MAX_SECS   (5 * 60)
+
 /* filesystems known to report their outer boundaries */
 static const gchar *fs_lastblock_list[] =
 {
@@ -157,8 +165,11 @@ udisks_linux_filesystem_finalize (GObject *object)
   UDisksLinuxFilesystem *filesystem = UDISKS_LINUX_FILESYSTEM (object);
 
   g_mutex_clear (&(filesystem->lock));
-  g_free (filesystem->cached_device_file);
-  g_free (filesystem->cached_fs_type);
+  g_mutex_clear (&filesystem->size_lock);
+  g_cond_clear (&filesystem->size_cond);
+  if (filesystem->usage_timeout_id > 0)
+    g_source_remove (filesystem->usage_timeout_id);
+  g_free (filesystem->usage_mount_point);
 
   if (G_OBJECT_CLASS (udisks_linux_filesystem_parent_class)->finalize != NULL)
     G_OBJECT_CLASS (udisks_linux_filesystem_parent_class)->finalize (object);
@@ -168,48 +179,12 @@ static void
 udisks_linux_filesystem_init (UDisksLinuxFilesystem *filesystem)
 {
   g_mutex_init (&filesystem->lock);
+  g_mutex_init (&filesystem->size_lock);
+  g_cond_init (&filesystem->size_cond);
   g_dbus_interface_skeleton_set_flags (G_DBUS_INTERFACE_SKELETON (filesystem),
                                        G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
 }
 
-static void
-udisks_linux_filesystem_get_property (GObject    *object,
-                                      guint       prop_id,
-                                      GValue     *value,
-                                      GParamSpec *pspec)
-{
-  UDisksLinuxFilesystem *filesystem = UDISKS_LINUX_FILESYSTEM (object);
-
-  switch (prop_id)
-    {
-    case PROP_SIZE:
-      g_value_set_uint64 (value, get_filesystem_size (filesystem));
-      break;
-
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-      break;
-    }
-}
-
-static void
-udisks_linux_filesystem_set_property (GObject      *object,
-                                      guint         prop_id,
-                                      const GValue *value,
-                                      GParamSpec   *pspec)
-{
-  switch (prop_id)
-    {
-    case PROP_SIZE:
-      g_warning ("udisks_linux_filesystem_set_property() should never be called, value = %" G_GUINT64_FORMAT, g_value_get_uint64 (value));
-      break;
-
-    default:
-      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
-      break;
-    }
-}
-
 static void
 udisks_linux_filesystem_class_init (UDisksLinuxFilesystemClass *klass)
 {
@@ -217,10 +192,6 @@ udisks_linux_filesystem_class_init (UDisksLinuxFilesystemClass *klass)
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize     = udisks_linux_filesystem_finalize;
-  gobject_class->get_property = udisks_linux_filesystem_get_property;
-  gobject_class->set_property = udisks_linux_filesystem_set_property;
-
-  g_object_class_override_property (gobject_class, PROP_SIZE, "size");
 }
 
 /**
@@ -250,39 +221,234 @@ in_fs_lastblock_list (const gchar *fstype)
   return FALSE;
 }
 
-/* WARNING: called with GDBusObjectManager lock held, avoid any object lookup */
-static guint64
-get_filesystem_size (UDisksLinuxFilesystem *filesystem)
+typedef struct
 {
-  guint64 size = 0;
-
-  if (filesystem->cached_fs_size > 0)
-    return filesystem->cached_fs_size;
+  gchar *device_file;
+  gchar *fs_type;
+  gboolean drive_is_ata;
+  guint generation;
+  guint64 size;
+} SizeData;
 
-  if (!filesystem->cached_device_file || !filesystem->cached_fs_type)
-    return 0;
+static void
+size_data_free (SizeData *data)
+{
+  g_free (data->device_file);
+  g_free (data->fs_type);
+  g_free (data);
+}
 
-  /* manually getting size is supported only for Ext and XFS */
-  if (!in_fs_lastblock_list (filesystem->cached_fs_type))
-    return 0;
+/* runs in a worker thread, the filesystem tools may take a while */
+static void
+get_filesystem_size_thread_func (GTask        *task,
+                                 gpointer      source_object,
+                                 gpointer      task_data,
+                                 GCancellable *cancellable)
+{
+  SizeData *data = task_data;
 
   /* if the drive is ATA and is sleeping, skip filesystem size check to prevent
    * drive waking up - nothing has changed anyway since it's been sleeping...
    */
-  if (filesystem->cached_drive_is_ata)
+  if (data->drive_is_ata)
     {
       guchar pm_state = 0;
 
-      if (udisks_ata_get_pm_state (filesystem->cached_device_file, NULL, &pm_state))
+      if (udisks_ata_get_pm_state (data->device_file, NULL, &pm_state))
         if (!UDISKS_ATA_PM_STATE_AWAKE (pm_state))
-          return 0;
+          {
+            g_task_return_boolean (task, FALSE);
+            return;
+          }
+    }
+
+  data->size = bd_fs_get_size (data->device_file, data->fs_type, NULL);
+  g_task_return_boolean (task, TRUE);
+}
+
+/* called in the main thread once the size for @generation is known */
+static void
+size_done (UDisksLinuxFilesystem *filesystem,
+           guint                  generation)
+{
+  g_mutex_lock (&filesystem->size_lock);
+  if (generation > filesystem->size_done_generation)
+    filesystem->size_done_generation = generation;
+  g_cond_broadcast (&filesystem->size_cond);
+  g_mutex_unlock (&filesystem->size_lock);
+}
+
+/* called in the main thread */
+static void
+on_filesystem_size_ready (GObject      *source_object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+  UDisksLinuxFilesystem *filesystem = UDISKS_LINUX_FILESYSTEM (source_object);
+  SizeData *data = g_task_get_task_data (G_TASK (res));
+
+  /* keep the last known size if the drive is asleep or the filesystem changed meanwhile */
+  if (g_task_propagate_boolean (G_TASK (res), NULL) && data->generation == filesystem->size_generation)
+    udisks_filesystem_set_size (UDISKS_FILESYSTEM (filesystem), data->size);
+
+  size_done (filesystem, data->generation);
+}
+
+/* Waits until the size determined by the last update has been set, so
+ * that a method changing the filesystem can complete with the new size
+ * in place. Only the updates since the caller's change must be waited
+ * for, so call this after udisks_linux_block_object_trigger_uevent_sync().
+ *
+ * Must not be called from the main thread.
+ */
+static void
+wait_for_size (UDisksLinuxFilesystem *filesystem,
+               guint                  timeout_seconds)
+{
+  gint64 end_time;
+  guint target;
+
+  end_time = g_get_monotonic_time () + timeout_seconds * G_TIME_SPAN_SECOND;
+
+  g_mutex_lock (&filesystem->size_lock);
+  target = filesystem->size_generation;
+  while (filesystem->size_done_generation < target)
+    {
+      if (!g_cond_wait_until (&filesystem->size_cond, &filesystem->size_lock, end_time))
+        break;
     }
+  g_mutex_unlock (&filesystem->size_lock);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
 
-  size = bd_fs_get_size (filesystem->cached_device_file, filesystem->cached_fs_type, NULL);
-  filesystem->cached_fs_size = size;
-  return size;
+static void refresh_usage (UDisksLinuxFilesystem *filesystem);
+
+static void
+set_usage (UDisksLinuxFilesystem *filesystem,
+           guint64                used,
+           guint64                free_space,
+           guint64                inodes_free)
+{
+  UDisksFilesystem *iface = UDISKS_FILESYSTEM (filesystem);
+
+  udisks_filesystem_set_used (iface, used);
+  udisks_filesystem_set_free (iface, free_space);
+  udisks_filesystem_set_inodes_free (iface, inodes_free);
+}
+
+static gboolean
+on_usage_timeout (gpointer user_data)
+{
+  UDisksLinuxFilesystem *filesystem = UDISKS_LINUX_FILESYSTEM (user_data);
+
+  filesystem->usage_timeout_id = 0;
+  refresh_usage (filesystem);
+  return G_SOURCE_REMOVE;
 }
 
+/* runs in a worker thread so that an unresponsive filesystem doesn't block the main loop */
+static void
+statvfs_thread_func (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  const gchar *mount_point = task_data;
+  struct statvfs buf;
+  gint errsv;
+
+  if (statvfs (mount_point, &buf) != 0)
+    {
+      errsv = errno;
+      g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (errsv),
+                               "Error getting usage of %s: %s", mount_point, g_strerror (errsv));
+      return;
+    }
+  g_task_return_pointer (task, g_memdup2 (&buf, sizeof (buf)), g_free);
+}
+
+/* called in the main thread */
+static void
+on_statvfs_ready (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  UDisksLinuxFilesystem *filesystem = UDISKS_LINUX_FILESYSTEM (source_object);
+  UDisksFilesystem *iface = UDISKS_FILESYSTEM (filesystem);
+  const gchar *mount_point = g_task_get_task_data (G_TASK (res));
+  struct statvfs *buf;
+  guint64 used;
+  guint64 free_space;
+  guint64 inodes_free;
+  GError *error = NULL;
+
+  filesystem->usage_refreshing = FALSE;
+  buf = g_task_propagate_pointer (G_TASK (res), &error);
+
+  /* unmounted or moved in the meantime */
+  if (g_strcmp0 (mount_point, filesystem->usage_mount_point) != 0)
+    {
+      if (filesystem->usage_mount_point != NULL)
+        refresh_usage (filesystem);
+      goto out;
+    }
+
+  if (buf == NULL)
+    {
+      udisks_warning ("%s", error->message);
+      set_usage (filesystem, 0, 0, 0);
+      filesystem->usage_interval = USAGE_REFRESH_MAX_SECS;
+    }
+  else
+    {
+      used = (guint64) (buf->f_blocks - buf->f_bfree) * buf->f_frsize;
+      free_space = (guint64) buf->f_bavail * buf->f_frsize;
+      inodes_free = buf->f_favail;
+
+      /* back off while the filesystem is idle */
+      if (used == udisks_filesystem_get_used (iface) &&
+          free_space == udisks_filesystem_get_free (iface) &&
+          inodes_free == udisks_filesystem_get_inodes_free (iface))
+        filesystem->usage_interval = MIN (filesystem->usage_interval * 2, USAGE_REFRESH_MAX_SECS);
+      else
+        filesystem->usage_interval = USAGE_REFRESH_MIN_SECS;
+
+      set_usage (filesystem, used, free_space, inodes_free);
+    }
+
+  filesystem->usage_timeout_id = g_timeout_add_seconds (filesystem->usage_interval, on_usage_timeout, filesystem);
+
+ out:
+  g_clear_error (&error);
+  g_free (buf);
+}
+
+/* called in the main thread */
+static void
+refresh_usage (UDisksLinuxFilesystem *filesystem)
+{
+  GTask *task;
+
+  /* the pending refresh will pick up any change of the mount point */
+  if (filesystem->usage_refreshing || filesystem->usage_mount_point == NULL)
+    return;
+
+  if (filesystem->usage_timeout_id > 0)
+    {
+      g_source_remove (filesystem->usage_timeout_id);
+      filesystem->usage_timeout_id = 0;
+    }
+
+  filesystem->usage_refreshing = TRUE;
+  task = g_task_new (filesystem, NULL, on_statvfs_ready, NULL);
+  g_task_set_task_data (task, g_strdup (filesystem->usage_mount_point), g_free);
+  g_task_run_in_thread (task, statvfs_thread_func);
+  g_object_unref (task);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 static UDisksDriveAta *
 get_drive_ata (UDisksLinuxBlockObject *object)
 {
@@ -305,37 +471,6 @@ get_drive_ata (UDisksLinuxBlockObject *object)
   return ata;
 }
 
-static void
-invalidate_property (UDisksLinuxFilesystem *filesystem,
-                     const gchar           *prop_name)
-{
-  GVariantBuilder builder;
-  GVariantBuilder invalidated_builder;
-  GList *connections, *ll;
-  GVariant *signal_variant;
-
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
-  g_variant_builder_init (&invalidated_builder, G_VARIANT_TYPE ("as"));
-  g_variant_builder_add (&invalidated_builder, "s", prop_name);
-
-  signal_variant = g_variant_ref_sink (g_variant_new ("(sa{sv}as)", "org.freedesktop.UDisks2.Filesystem",
-                                       &builder, &invalidated_builder));
-  connections = g_dbus_interface_skeleton_get_connections (G_DBUS_INTERFACE_SKELETON (filesystem));
-  for (ll = connections; ll != NULL; ll = ll->next)
-    {
-      GDBusConnection *connection = ll->data;
-
-      g_dbus_connection_emit_signal (connection,
-                                     NULL, g_dbus_interface_skeleton_get_object_path (G_DBUS_INTERFACE_SKELETON (filesystem)),
-                                     "org.freedesktop.DBus.Properties",
-                                     "PropertiesChanged",
-                                     signal_variant,
-                                     NULL);
-    }
-  g_variant_unref (signal_variant);
-  g_list_free_full (connections, g_object_unref);
-}
-
 /**
  * udisks_linux_filesystem_update:
  * @filesystem: A #UDisksLinuxFilesystem.
@@ -354,6 +489,9 @@ udisks_linux_filesystem_update (UDisksLinuxFilesystem  *filesystem,
   GList *mounts;
   GList *l;
   gboolean mounted;
+  gchar *mount_point;
+  const gchar *fs_type;
+  guint64 size;
 
   mount_monitor = udisks_daemon_get_mount_monitor (udisks_linux_block_object_get_daemon (object));
   device = udisks_linux_block_object_get_device (object);
@@ -373,42 +511,84 @@ udisks_linux_filesystem_update (UDisksLinuxFilesystem  *filesystem,
   udisks_filesystem_set_mount_points (UDISKS_FILESYSTEM (filesystem),
                                       (const gchar *const *) p->pdata);
   mounted = p->len > 1;
+  mount_point = mounted ? g_strdup (p->pdata[0]) : NULL;
   g_ptr_array_free (p, TRUE);
   g_list_free_full (mounts, g_object_unref);
 
-  /* cached device properties for on-demand filesystem size retrieval */
-  g_free (filesystem->cached_device_file);
-  g_free (filesystem->cached_fs_type);
-  filesystem->cached_fs_type = g_strdup (g_udev_device_get_property (device->udev_device, "ID_FS_TYPE"));
-  filesystem->cached_device_file = udisks_linux_block_object_get_device_file (object);
-
-  /* TODO: this only looks for a drive object associated with the current
-   * block object. In case of a complex layered structure this needs to walk
-   * the tree and return a list of physical drives to check the powermanagement on.
-   */
-  ata = get_drive_ata (object);
-  filesystem->cached_drive_is_ata = ata != NULL && udisks_drive_ata_get_pm_supported (ata);
-  g_clear_object (&ata);
+  /* usage statistics are refreshed periodically for as long as the filesystem is mounted */
+  if (g_strcmp0 (mount_point, filesystem->usage_mount_point) != 0)
+    {
+      g_free (filesystem->usage_mount_point);
+      filesystem->usage_mount_point = mount_point;
+      mount_point = NULL;
+      filesystem->usage_interval = USAGE_REFRESH_MIN_SECS;
+      if (filesystem->usage_mount_point != NULL)
+        {
+          refresh_usage (filesystem);
+        }
+      else
+        {
+          if (filesystem->usage_timeout_id > 0)
+            {
+              g_source_remove (filesystem->usage_timeout_id);
+              filesystem->usage_timeout_id = 0;
+            }
+          set_usage (filesystem, 0, 0, 0);
+        }
+    }
+  g_free (mount_point);
 
-  g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (filesystem));
+  fs_type = g_udev_device_get_property (device->udev_device, "ID_FS_TYPE");
+  g_mutex_lock (&filesystem->size_lock);
+  filesystem->size_generation++;
+  g_mutex_unlock (&filesystem->size_lock);
 
-  if (mounted && g_strcmp0 (filesystem->cached_fs_type, "xfs") == 0)
+  if (mounted && g_strcmp0 (fs_type, "xfs") == 0)
     /* Force native filesystem tools for mounted XFS as superblock might
      * not have been written right after the grow.
      */
-    filesystem->cached_fs_size = 0;
+    size = 0;
   else
     /* The ID_FS_SIZE property only contains data part of the total filesystem
      * size and comes with no guarantees while 'ID_FS_LASTBLOCK * ID_FS_BLOCKSIZE'
      * typically marks the boundary of the filesystem.
      */
-    filesystem->cached_fs_size = g_udev_device_get_property_as_uint64 (device->udev_device, "ID_FS_LASTBLOCK") *
-                                 g_udev_device_get_property_as_uint64 (device->udev_device, "ID_FS_BLOCKSIZE");
+    size = g_udev_device_get_property_as_uint64 (device->udev_device, "ID_FS_LASTBLOCK") *
+           g_udev_device_get_property_as_uint64 (device->udev_device, "ID_FS_BLOCKSIZE");
 
-  /* The Size property is hacked to be retrieved on-demand, only need to
-   * notify subscribers that it has changed.
-   */
-  invalidate_property (filesystem, "Size");
+  if (size > 0 || !in_fs_lastblock_list (fs_type))
+    {
+      udisks_filesystem_set_size (UDISKS_FILESYSTEM (filesystem), size);
+      size_done (filesystem, filesystem->size_generation);
+    }
+  else
+    {
+      SizeData *data;
+      GTask *task;
+
+      /* manually getting size is supported only for Ext and XFS, the
+       * filesystem tools may take a while so don't block on them
+       */
+      data = g_new0 (SizeData, 1);
+      data->device_file = udisks_linux_block_object_get_device_file (object);
+      data->fs_type = g_strdup (fs_type);
+      data->generation = filesystem->size_generation;
+
+      /* TODO: this only looks for a drive object associated with the current
+       * block object. In case of a complex layered structure this needs to walk
+       * the tree and return a list of physical drives to check the powermanagement on.
+       */
+      ata = get_drive_ata (object);
+      data->drive_is_ata = ata != NULL && udisks_drive_ata_get_pm_supported (ata);
+      g_clear_object (&ata);
+
+      task = g_task_new (filesystem, NULL, on_filesystem_size_ready, NULL);
+      g_task_set_task_data (task, data, (GDestroyNotify) size_data_free);
+      g_task_run_in_thread (task, get_filesystem_size_thread_func);
+      g_object_unref (task);
+    }
+
+  g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (filesystem));
 
   g_object_unref (device);
 }
@@ -860,42 +1040,31 @@ is_system_managed (UDisksDaemon *daemon,
 {
   UDisksMountMonitor *mount_monitor = udisks_daemon_get_mount_monitor (daemon);
   gboolean ret = FALSE;
-  struct libmnt_table *table;
-  struct libmnt_iter* iter;
-  struct libmnt_fs *fs = NULL;
+  GList *entries;
+  GList *l;
 
-  table = mnt_new_table ();
-  if (mnt_table_parse_fstab (table, NULL) < 0)
+  entries = udisks_linux_block_find_fstab_entries (UDISKS_LINUX_BLOCK (block));
+  for (l = entries; l != NULL && !ret; l = l->next)
     {
-      mnt_free_table (table);
-      return FALSE;
-    }
+      UDisksFstabEntry *entry = UDISKS_FSTAB_ENTRY (l->data);
+      UDisksMount *mount;
 
-  iter = mnt_new_iter (MNT_ITER_FORWARD);
-  while (mnt_table_next_fs (table, iter, &fs) == 0)
-    {
-      if (udisks_linux_block_matches_id (UDISKS_LINUX_BLOCK (block), mnt_fs_get_source (fs)))
+      /* If this block device is found in fstab, but something else is already
+       * mounted on that mount point, ignore the fstab entry.
+       */
+      mount = udisks_mount_monitor_get_mount_for_path (mount_monitor, udisks_fstab_entry_get_dir (entry));
+      if (mount == NULL || udisks_block_get_device_number (block) == udisks_mount_get_dev (mount))
         {
-          /* If this block device is found in fstab, but something else is already
-           * mounted on that mount point, ignore the fstab entry.
-           */
-          UDisksMount *mount = udisks_mount_monitor_get_mount_for_path (mount_monitor, mnt_fs_get_target (fs));
-          if (mount == NULL || udisks_block_get_device_number (block) == udisks_mount_get_dev (mount))
-            {
-              ret = TRUE;
-              if (out_mount_point != NULL)
-                *out_mount_point = g_strdup (mnt_fs_get_target (fs));
-              if (out_mount_options != NULL)
-                *out_mount_options = mnt_fs_strdup_options (fs);
-            }
-
-          g_clear_object (&mount);
-          if (ret)
-            break;
+          ret = TRUE;
+          if (out_mount_point != NULL)
+            *out_mount_point = g_strdup (udisks_fstab_entry_get_dir (entry));
+          if (out_mount_options != NULL)
+            *out_mount_options = g_strdup (udisks_fstab_entry_get_opts (entry));
         }
+
+      g_clear_object (&mount);
     }
-  mnt_free_iter (iter);
-  mnt_free_table (table);
+  g_list_free_full (entries, g_object_unref);
 
   return ret;
 }
@@ -1781,6 +1950,7 @@ handle_unmount (UDisksFilesystem      *filesystem,
                                                           &wait_data,
                                                           NULL,
                                                           UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                          NULL,
                                                           NULL);
 
   udisks_filesystem_complete_unmount (filesystem, invocation);
@@ -2136,9 +2306,9 @@ handle_resize (UDisksFilesystem      *filesystem,
 
   /* At least resize2fs might need another uevent after it is done.
    */
-  UDISKS_LINUX_FILESYSTEM (filesystem)->cached_fs_size = 0;
   udisks_linux_block_object_trigger_uevent_sync (UDISKS_LINUX_BLOCK_OBJECT (object),
                                                  UDISKS_DEFAULT_WAIT_TIMEOUT);
+  wait_for_size (UDISKS_LINUX_FILESYSTEM (filesystem), UDISKS_DEFAULT_WAIT_TIMEOUT);
   g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (filesystem));
   udisks_filesystem_complete_resize (filesystem, invocation);
   udisks_simple_job_complete (UDISKS_SIMPLE_JOB (job), TRUE, NULL);
@@ -2618,6 +2788,7 @@ handle_take_ownership (UDisksFilesystem      *filesystem,
                                    probed_fs_type,
                                    caller_uid, caller_gid,
                                    recursive,
+                                   job,
                                    &error))
     {
       g_dbus_method_invocation_return_error (invocation,
@@ -2630,7 +2801,11 @@ handle_take_ownership (UDisksFilesystem      *filesystem,
       goto out;
     }
 
-
+  /* the filesystem may have been mounted for the change, make sure Size is current */
+  udisks_linux_block_object_trigger_uevent_sync (UDISKS_LINUX_BLOCK_OBJECT (object),
+                                                 UDISKS_DEFAULT_WAIT_TIMEOUT);
+  wait_for_size (UDISKS_LINUX_FILESYSTEM (filesystem), UDISKS_DEFAULT_WAIT_TIMEOUT);
+  g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (filesystem));
   udisks_filesystem_complete_take_ownership (filesystem, invocation);
   udisks_simple_job_complete (UDISKS_SIMPLE_JOB (job), TRUE, NULL);
 
@@ -23,6 +23,7 @@
 #include <glib.h>
 #include <stdio.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -32,19 +33,247 @@
 
 #include "udiskslinuxfilesystemhelpers.h"
 #include "udiskslogging.h"
+#include "udisksbasejob.h"
 
 
-static gboolean
-recursive_chown (const gchar *path,
-                 uid_t        caller_uid,
-                 gid_t        caller_gid,
-                 gboolean     recursive,
-                 GError     **error)
+/* Maximum number of threads changing ownership in parallel */
+#define CHOWN_WORKERS_MAX      4
+
+/* How often to check for cancellation while processing a directory */
+#define CHOWN_CANCEL_CHECK_INTERVAL  256
+
+/* A directory waiting to be processed - holds a reference to its parent
+ * whose fd it is opened relative to. The fd of a directory is kept open
+ * for as long as any of its subdirectories are waiting.
+ */
+typedef struct _ChownDir ChownDir;
+struct _ChownDir
 {
-  int dirfd;
-  DIR *dir;
+  ChownDir *parent;
+  gchar *name;
+  gint fd;
+};
+
+typedef struct
+{
+  uid_t uid;
+  gid_t gid;
+  GCancellable *cancellable;
+
+  GMutex lock;
+  GCond cond;
+  GPtrArray *pending;   /* of ChownDir, used as a stack to keep the number of open fds low */
+  guint n_busy;         /* number of workers processing a directory */
+  gboolean done;
+  guint64 n_processed;
+  GError *error;        /* the first error, stops all workers */
+} ChownContext;
+
+static void
+chown_dir_clear (ChownDir *dir)
+{
+  if (dir->fd >= 0)
+    close (dir->fd);
+  if (dir->parent != NULL)
+    g_atomic_rc_box_release_full (dir->parent, (GDestroyNotify) chown_dir_clear);
+  g_free (dir->name);
+}
+
+static void
+chown_dir_unref (ChownDir *dir)
+{
+  g_atomic_rc_box_release_full (dir, (GDestroyNotify) chown_dir_clear);
+}
+
+/* Changes ownership of @dir and all its entries, queues subdirectories.
+ * Returns the number of processed entries or -1 with @error set.
+ */
+static gint64
+chown_dir_process (ChownContext  *ctx,
+                   ChownDir      *dir,
+                   GError       **error)
+{
+  GPtrArray *subdirs;
+  DIR *dirp;
   struct dirent *dirent;
-  GSList *list, *l;
+  gint64 n_processed = 0;
+  guint n_entries = 0;
+  gint fd;
+  guint n;
+
+  if (g_cancellable_set_error_if_cancelled (ctx->cancellable, error))
+    return -1;
+
+  if (dir->fd < 0)
+    {
+      dir->fd = openat (dir->parent->fd, dir->name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (dir->fd < 0)
+        {
+          /* replaced by something else since it was listed */
+          if ((errno == ENOTDIR || errno == ELOOP) &&
+              fchownat (dir->parent->fd, dir->name, ctx->uid, ctx->gid, AT_SYMLINK_NOFOLLOW) == 0)
+            return 1;
+          g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                       "Error opening directory %s: %m", dir->name);
+          return -1;
+        }
+      if (fchown (dir->fd, ctx->uid, ctx->gid) != 0)
+        {
+          g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                       "Error changing ownership of %s to uid=%u and gid=%u: %m",
+                       dir->name, ctx->uid, ctx->gid);
+          return -1;
+        }
+      n_processed++;
+    }
+
+  /* the parent doesn't need to stay open for our sake anymore */
+  g_clear_pointer (&dir->parent, chown_dir_unref);
+
+  /* fdopendir() takes over the fd, keep ours for the subdirectories */
+  fd = dup (dir->fd);
+  dirp = fd >= 0 ? fdopendir (fd) : NULL;
+  if (dirp == NULL)
+    {
+      g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                   "Error opening directory %s: %m", dir->name != NULL ? dir->name : "/");
+      if (fd >= 0)
+        close (fd);
+      return -1;
+    }
+
+  subdirs = g_ptr_array_new ();
+  while ((errno = 0, dirent = readdir (dirp)))
+    {
+      gboolean is_dir;
+
+      if (g_strcmp0 (dirent->d_name, ".") == 0 || g_strcmp0 (dirent->d_name, "..") == 0)
+        continue;
+
+      if (++n_entries % CHOWN_CANCEL_CHECK_INTERVAL == 0 &&
+          g_cancellable_set_error_if_cancelled (ctx->cancellable, error))
+        goto error;
+
+      is_dir = dirent->d_type == DT_DIR;
+      if (dirent->d_type == DT_UNKNOWN)
+        {
+          struct stat st;
+
+          is_dir = fstatat (dir->fd, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR (st.st_mode);
+        }
+
+      if (is_dir)
+        {
+          ChownDir *subdir;
+
+          /* changed and counted by the worker picking it up */
+          subdir = g_atomic_rc_box_new0 (ChownDir);
+          subdir->parent = g_atomic_rc_box_acquire (dir);
+          subdir->name = g_strdup (dirent->d_name);
+          subdir->fd = -1;
+          g_ptr_array_add (subdirs, subdir);
+        }
+      else if (fchownat (dir->fd, dirent->d_name, ctx->uid, ctx->gid, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+          g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                       "Error changing ownership of %s to uid=%u and gid=%u: %m",
+                       dirent->d_name, ctx->uid, ctx->gid);
+          goto error;
+        }
+      else
+        {
+          n_processed++;
+        }
+    }
+  if (errno != 0)
+    {
+      g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
+                   "Error reading directory %s: %m", dir->name != NULL ? dir->name : "/");
+      goto error;
+    }
+  closedir (dirp);
+
+  g_mutex_lock (&ctx->lock);
+  for (n = 0; n < subdirs->len; n++)
+    g_ptr_array_add (ctx->pending, g_ptr_array_index (subdirs, n));
+  g_mutex_unlock (&ctx->lock);
+  g_ptr_array_free (subdirs, TRUE);
+
+  return n_processed;
+
+ error:
+  closedir (dirp);
+  g_ptr_array_set_free_func (subdirs, (GDestroyNotify) chown_dir_unref);
+  g_ptr_array_free (subdirs, TRUE);
+  return -1;
+}
+
+static gpointer
+chown_worker_thread_func (gpointer user_data)
+{
+  ChownContext *ctx = user_data;
+
+  g_mutex_lock (&ctx->lock);
+  while (TRUE)
+    {
+      ChownDir *dir;
+      GError *error = NULL;
+      gint64 n_processed;
+
+      while (ctx->pending->len == 0 && ctx->n_busy > 0 && !ctx->done)
+        g_cond_wait (&ctx->cond, &ctx->lock);
+
+      /* nothing left to do and nobody who could add more */
+      if (ctx->done || ctx->pending->len == 0)
+        break;
+
+      dir = g_ptr_array_steal_index_fast (ctx->pending, ctx->pending->len - 1);
+      ctx->n_busy++;
+      g_mutex_unlock (&ctx->lock);
+
+      n_processed = chown_dir_process (ctx, dir, &error);
+      chown_dir_unref (dir);
+
+      g_mutex_lock (&ctx->lock);
+      ctx->n_busy--;
+      if (n_processed < 0)
+        {
+          if (ctx->error == NULL)
+            ctx->error = error;
+          else
+            g_error_free (error);
+          ctx->done = TRUE;
+        }
+      else
+        {
+          ctx->n_processed += n_processed;
+        }
+      g_cond_broadcast (&ctx->cond);
+    }
+  ctx->done = TRUE;
+  g_cond_broadcast (&ctx->cond);
+  g_mutex_unlock (&ctx->lock);
+
+  return NULL;
+}
+
+static gboolean
+recursive_chown (const gchar    *path,
+                 uid_t           caller_uid,
+                 gid_t           caller_gid,
+                 gboolean        recursive,
+                 UDisksBaseJob  *job,
+                 GError        **error)
+{
+  ChownContext ctx = { 0, };
+  GThread *workers[CHOWN_WORKERS_MAX];
+  ChownDir *root;
+  struct statvfs buf;
+  guint64 total = 0;
+  guint n_workers;
+  guint n;
+  gint fd;
+  gboolean ret = FALSE;
 
   g_return_val_if_fail (path != NULL, FALSE);
 
@@ -59,9 +288,8 @@ recursive_chown (const gchar *path,
   if (! recursive)
     return TRUE;
 
-  /* read and traverse through the directory */
-  dirfd = open (path, O_DIRECTORY | O_NOFOLLOW);
-  if (dirfd < 0)
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
     {
       if (errno == ENOTDIR)
         return TRUE;
@@ -70,47 +298,74 @@ recursive_chown (const gchar *path,
       return FALSE;
     }
 
-  dir = fdopendir (dirfd);
-  if (! dir)
+  /* the number of inodes in use is the best estimate of the amount of work */
+  if (job != NULL && fstatvfs (fd, &buf) == 0 && buf.f_files > buf.f_ffree)
     {
-      g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
-                   "Error opening directory %s: %m", path);
-      close (dirfd);
-      return FALSE;
+      total = buf.f_files - buf.f_ffree;
+      udisks_job_set_progress_valid (UDISKS_JOB (job), TRUE);
+      udisks_base_job_set_auto_estimate (job, TRUE);
     }
 
-  /* build a list of filenames to prevent fd exhaustion */
-  list = NULL;
-  while ((errno = 0, dirent = readdir (dir)))
-    if (g_strcmp0 (dirent->d_name, ".") != 0 && g_strcmp0 (dirent->d_name, "..") != 0)
-      list = g_slist_append (list, g_strdup (dirent->d_name));
-  if (!dirent && errno != 0)
+  root = g_atomic_rc_box_new0 (ChownDir);
+  root->fd = fd;
+
+  ctx.uid = caller_uid;
+  ctx.gid = caller_gid;
+  ctx.cancellable = job != NULL ? udisks_base_job_get_cancellable (job) : NULL;
+  g_mutex_init (&ctx.lock);
+  g_cond_init (&ctx.cond);
+  ctx.pending = g_ptr_array_new_with_free_func ((GDestroyNotify) chown_dir_unref);
+  g_ptr_array_add (ctx.pending, root);
+  ctx.n_processed = 1;  /* the root */
+
+  n_workers = CLAMP (g_get_num_processors (), 1, CHOWN_WORKERS_MAX);
+  for (n = 0; n < n_workers; n++)
+    workers[n] = g_thread_new ("udisks-chown", chown_worker_thread_func, &ctx);
+
+  /* report progress at most once a second until the workers are done */
+  g_mutex_lock (&ctx.lock);
+  while (!ctx.done)
     {
-      g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_FAILED,
-                   "Error reading directory %s: %m", path);
-      closedir (dir);
-      g_slist_free_full (list, g_free);
-      return FALSE;
+      gint64 end_time = g_get_monotonic_time () + G_USEC_PER_SEC;
+      guint64 n_processed;
+
+      while (!ctx.done && g_cond_wait_until (&ctx.cond, &ctx.lock, end_time))
+        ;
+      if (ctx.done || total == 0)
+        continue;
+
+      n_processed = ctx.n_processed;
+      g_mutex_unlock (&ctx.lock);
+      udisks_job_set_progress (UDISKS_JOB (job), MIN ((gdouble) n_processed / total, 1.0));
+      g_mutex_lock (&ctx.lock);
     }
-  closedir (dir);
+  g_mutex_unlock (&ctx.lock);
 
-  /* recurse into children */
-  for (l = list; l; l = g_slist_next (l))
-    {
-      gchar *newpath;
+  for (n = 0; n < n_workers; n++)
+    g_thread_join (workers[n]);
 
-      newpath = g_build_filename (path, l->data, NULL);
-      if (! recursive_chown (newpath, caller_uid, caller_gid, TRUE, error))
-        {
-          g_free (newpath);
-          g_slist_free_full (list, g_free);
-          return FALSE;
-        }
-      g_free (newpath);
+  udisks_debug ("Changed ownership of %" G_GUINT64_FORMAT " files under %s", ctx.n_processed, path);
+
+  if (ctx.error != NULL)
+    {
+      if (g_error_matches (ctx.error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_set_error (error, UDISKS_ERROR, UDISKS_ERROR_CANCELLED, "Job was canceled");
+      else
+        g_propagate_error (error, g_steal_pointer (&ctx.error));
+      g_clear_error (&ctx.error);
+      goto out;
     }
-  g_slist_free_full (list, g_free);
 
-  return TRUE;
+  if (total > 0)
+    udisks_job_set_progress (UDISKS_JOB (job), 1.0);
+  ret = TRUE;
+
+ out:
+  /* left behind after an error */
+  g_ptr_array_unref (ctx.pending);
+  g_cond_clear (&ctx.cond);
+  g_mutex_clear (&ctx.lock);
+  return ret;
 }
 
 gboolean
@@ -119,6 +374,7 @@ take_filesystem_ownership (const gchar  *device,
                            uid_t         caller_uid,
                            gid_t         caller_gid,
                            gboolean      recursive,
+                           UDisksBaseJob *job,
                            GError      **error)
 
 {
@@ -177,7 +433,7 @@ take_filesystem_ownership (const gchar  *device,
     }
 
   /* actual chown */
-  success = recursive_chown (mountpoint, caller_uid, caller_gid, recursive, error);
+  success = recursive_chown (mountpoint, caller_uid, caller_gid, recursive, job, error);
   if (! success)
     goto out;
 
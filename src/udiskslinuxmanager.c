@@ -463,6 +463,7 @@ handle_loop_setup (UDisksManager          *object,
                                                     &wait_data,
                                                     NULL,
                                                     UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                    NULL,
                                                     &error);
   if (loop_object == NULL)
     {
@@ -801,6 +802,7 @@ handle_mdraid_create (UDisksManager         *_object,
                                                      raid_device_file,
                                                      NULL,
                                                      UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                     NULL,
                                                      &error);
   if (array_object == NULL)
     {
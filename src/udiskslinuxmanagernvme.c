@@ -539,6 +539,7 @@ handle_connect (UDisksManagerNVMe     *object,
                                                     &wait_data,
                                                     NULL,
                                                     UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                    NULL,
                                                     &error);
   if (ctrl_object == NULL)
     {
@@ -642,6 +643,7 @@ handle_set_host_nqn (UDisksManagerNVMe     *_manager,
                                                     &wait_data,
                                                     NULL,
                                                     UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                    NULL,
                                                     &error);
   if (wait_object == NULL)
     {
@@ -711,6 +713,7 @@ handle_set_host_id (UDisksManagerNVMe     *_manager,
                                                     &wait_data,
                                                     NULL,
                                                     UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                    NULL,
                                                     &error);
   if (wait_object == NULL)
     {
@@ -0,0 +1,292 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "config.h"
+#include <glib/gi18n-lib.h>
+
+#include "udiskslogging.h"
+#include "udiskslinuxmanagerstats.h"
+#include "udisksdaemon.h"
+#include "udisksdaemonutil.h"
+#include "udiskslinuxprovider.h"
+#include "udisksstats.h"
+
+/**
+ * SECTION:udiskslinuxmanagerstats
+ * @title: UDisksLinuxManagerStats
+ * @short_description: Linux implementation of #UDisksManagerStats
+ *
+ * This type provides an implementation of the #UDisksManagerStats
+ * interface on Linux, exporting the data collected by #UDisksStats.
+ */
+
+typedef struct _UDisksLinuxManagerStatsClass   UDisksLinuxManagerStatsClass;
+
+/**
+ * UDisksLinuxManagerStats:
+ *
+ * The #UDisksLinuxManagerStats structure contains only private data and should
+ * only be accessed using the provided API.
+ */
+struct _UDisksLinuxManagerStats
+{
+  UDisksManagerStatsSkeleton parent_instance;
+
+  UDisksDaemon *daemon;
+
+  /* The number of coalesced uevents is counted by the provider (it is
+   * needed even if statistics are disabled), this is its value at the
+   * last reset. */
+  GMutex lock;
+  guint64 n_uevents_coalesced_base;
+};
+
+struct _UDisksLinuxManagerStatsClass
+{
+  UDisksManagerStatsSkeletonClass parent_class;
+};
+
+enum
+{
+  PROP_0,
+  PROP_DAEMON
+};
+
+static void manager_iface_init (UDisksManagerStatsIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (UDisksLinuxManagerStats, udisks_linux_manager_stats, UDISKS_TYPE_MANAGER_STATS_SKELETON,
+                         G_IMPLEMENT_INTERFACE (UDISKS_TYPE_MANAGER_STATS, manager_iface_init));
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+udisks_linux_manager_stats_get_property (GObject    *object,
+                                         guint       prop_id,
+                                         GValue     *value,
+                                         GParamSpec *pspec)
+{
+  UDisksLinuxManagerStats *manager = UDISKS_LINUX_MANAGER_STATS (object);
+
+  switch (prop_id)
+    {
+    case PROP_DAEMON:
+      g_value_set_object (value, udisks_linux_manager_stats_get_daemon (manager));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+udisks_linux_manager_stats_set_property (GObject      *object,
+                                         guint         prop_id,
+                                         const GValue *value,
+                                         GParamSpec   *pspec)
+{
+  UDisksLinuxManagerStats *manager = UDISKS_LINUX_MANAGER_STATS (object);
+
+  switch (prop_id)
+    {
+    case PROP_DAEMON:
+      g_assert (manager->daemon == NULL);
+      /* we don't take a reference to the daemon */
+      manager->daemon = g_value_get_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+udisks_linux_manager_stats_finalize (GObject *object)
+{
+  UDisksLinuxManagerStats *manager = UDISKS_LINUX_MANAGER_STATS (object);
+
+  g_mutex_clear (&manager->lock);
+
+  G_OBJECT_CLASS (udisks_linux_manager_stats_parent_class)->finalize (object);
+}
+
+static void
+udisks_linux_manager_stats_init (UDisksLinuxManagerStats *manager)
+{
+  g_mutex_init (&manager->lock);
+  g_dbus_interface_skeleton_set_flags (G_DBUS_INTERFACE_SKELETON (manager),
+                                       G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
+}
+
+static void
+udisks_linux_manager_stats_constructed (GObject *obj)
+{
+  UDisksLinuxManagerStats *manager = UDISKS_LINUX_MANAGER_STATS (obj);
+
+  G_OBJECT_CLASS (udisks_linux_manager_stats_parent_class)->constructed (obj);
+
+  udisks_manager_stats_set_since (UDISKS_MANAGER_STATS (manager),
+                                  udisks_stats_get_since (udisks_daemon_get_stats (manager->daemon)));
+}
+
+static void
+udisks_linux_manager_stats_class_init (UDisksLinuxManagerStatsClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize     = udisks_linux_manager_stats_finalize;
+  gobject_class->constructed  = udisks_linux_manager_stats_constructed;
+  gobject_class->set_property = udisks_linux_manager_stats_set_property;
+  gobject_class->get_property = udisks_linux_manager_stats_get_property;
+
+  /**
+   * UDisksLinuxManagerStats:daemon:
+   *
+   * The #UDisksDaemon for the object.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_DAEMON,
+                                   g_param_spec_object ("daemon",
+                                                        "Daemon",
+                                                        "The daemon for the object",
+                                                        UDISKS_TYPE_DAEMON,
+                                                        G_PARAM_READABLE |
+                                                        G_PARAM_WRITABLE |
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_STATIC_STRINGS));
+}
+
+/**
+ * udisks_linux_manager_stats_new:
+ * @daemon: A #UDisksDaemon.
+ *
+ * Creates a new #UDisksLinuxManagerStats instance.
+ *
+ * Returns: A new #UDisksLinuxManagerStats. Free with g_object_unref().
+ */
+UDisksManagerStats *
+udisks_linux_manager_stats_new (UDisksDaemon *daemon)
+{
+  g_return_val_if_fail (UDISKS_IS_DAEMON (daemon), NULL);
+  return UDISKS_MANAGER_STATS (g_object_new (UDISKS_TYPE_LINUX_MANAGER_STATS,
+                                             "daemon", daemon,
+                                             NULL));
+}
+
+/**
+ * udisks_linux_manager_stats_get_daemon:
+ * @manager: A #UDisksLinuxManagerStats.
+ *
+ * Gets the daemon used by @manager.
+ *
+ * Returns: A #UDisksDaemon. Do not free, the object is owned by @manager.
+ */
+UDisksDaemon *
+udisks_linux_manager_stats_get_daemon (UDisksLinuxManagerStats *manager)
+{
+  g_return_val_if_fail (UDISKS_IS_LINUX_MANAGER_STATS (manager), NULL);
+  return manager->daemon;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static guint64
+get_n_uevents_coalesced (UDisksLinuxManagerStats *manager)
+{
+  guint64 n_coalesced = 0;
+
+  udisks_linux_provider_get_uevent_stats (udisks_daemon_get_linux_provider (manager->daemon),
+                                          NULL, NULL, &n_coalesced, NULL);
+  return n_coalesced;
+}
+
+static gboolean
+handle_get_stats (UDisksManagerStats    *_manager,
+                  GDBusMethodInvocation *invocation,
+                  GVariant              *arg_options)
+{
+  UDisksLinuxManagerStats *manager = UDISKS_LINUX_MANAGER_STATS (_manager);
+  GVariantBuilder builder;
+  GVariantIter iter;
+  GVariant *counters;
+  GVariant *histograms;
+  const gchar *name;
+  guint64 value;
+
+  /* no authorization needed, the statistics don't reveal anything sensitive */
+  g_mutex_lock (&manager->lock);
+  udisks_stats_snapshot (udisks_daemon_get_stats (manager->daemon), &counters, &histograms);
+  value = get_n_uevents_coalesced (manager) - manager->n_uevents_coalesced_base;
+  g_mutex_unlock (&manager->lock);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+  g_variant_builder_add (&builder, "{st}", "uevents-coalesced", value);
+  g_variant_ref_sink (counters);
+  g_variant_iter_init (&iter, counters);
+  while (g_variant_iter_next (&iter, "{&st}", &name, &value))
+    g_variant_builder_add (&builder, "{st}", name, value);
+  g_variant_unref (counters);
+
+  udisks_manager_stats_complete_get_stats (_manager, invocation, g_variant_builder_end (&builder), histograms);
+
+  return TRUE; /* returning TRUE means that we handled the method invocation */
+}
+
+static gboolean
+handle_reset_stats (UDisksManagerStats    *_manager,
+                    GDBusMethodInvocation *invocation,
+                    GVariant              *arg_options)
+{
+  UDisksLinuxManagerStats *manager = UDISKS_LINUX_MANAGER_STATS (_manager);
+  UDisksStats *stats;
+
+  if (!udisks_daemon_util_check_authorization_sync (manager->daemon,
+                                                    NULL,
+                                                    "org.freedesktop.udisks2.modify-system-configuration",
+                                                    arg_options,
+                                                    /* Translators: Shown in authentication dialog when the user
+                                                     * requests resetting the daemon statistics.
+                                                     */
+                                                    N_("Authentication is required to reset the daemon statistics"),
+                                                    invocation))
+    goto out;
+
+  stats = udisks_daemon_get_stats (manager->daemon);
+  g_mutex_lock (&manager->lock);
+  udisks_stats_reset (stats);
+  manager->n_uevents_coalesced_base = get_n_uevents_coalesced (manager);
+  g_mutex_unlock (&manager->lock);
+  udisks_manager_stats_set_since (_manager, udisks_stats_get_since (stats));
+  g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (_manager));
+
+  udisks_manager_stats_complete_reset_stats (_manager, invocation);
+
+ out:
+  return TRUE; /* returning TRUE means that we handled the method invocation */
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+manager_iface_init (UDisksManagerStatsIface *iface)
+{
+  iface->handle_get_stats = handle_get_stats;
+  iface->handle_reset_stats = handle_reset_stats;
+}
@@ -22,6 +22,9 @@
 #include <glib/gi18n-lib.h>
 
 #include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
 #include <pwd.h>
 #include <grp.h>
 #include <string.h>
@@ -68,7 +71,12 @@ struct _UDisksLinuxMDRaid
 {
   UDisksMDRaidSkeleton parent_instance;
 
-  guint polling_timeout;
+  /* set while the array is on the progress poller's list, see ensure_polling() */
+  gboolean polling;
+  gchar *polling_sysfs_path;
+  gint sync_action_fd;
+  gint sync_completed_fd;
+  gint sync_speed_fd;
 };
 
 struct _UDisksLinuxMDRaidClass
@@ -77,6 +85,7 @@ struct _UDisksLinuxMDRaidClass
 };
 
 static void ensure_polling (UDisksLinuxMDRaid  *mdraid,
+                            UDisksLinuxDevice  *raid_device,
                             gboolean            polling_on);
 
 static void mdraid_iface_init (UDisksMDRaidIface *iface);
@@ -91,7 +100,7 @@ udisks_linux_mdraid_finalize (GObject *object)
 {
   UDisksLinuxMDRaid *mdraid = UDISKS_LINUX_MDRAID (object);
 
-  ensure_polling (mdraid, FALSE);
+  ensure_polling (mdraid, NULL, FALSE);
 
   if (G_OBJECT_CLASS (udisks_linux_mdraid_parent_class)->finalize != NULL)
     G_OBJECT_CLASS (udisks_linux_mdraid_parent_class)->finalize (object);
@@ -100,6 +109,9 @@ udisks_linux_mdraid_finalize (GObject *object)
 static void
 udisks_linux_mdraid_init (UDisksLinuxMDRaid *mdraid)
 {
+  mdraid->sync_action_fd = -1;
+  mdraid->sync_completed_fd = -1;
+  mdraid->sync_speed_fd = -1;
   g_dbus_interface_skeleton_set_flags (G_DBUS_INTERFACE_SKELETON (mdraid),
                                        G_DBUS_INTERFACE_SKELETON_FLAGS_HANDLE_METHOD_INVOCATIONS_IN_THREAD);
 }
@@ -129,53 +141,278 @@ udisks_linux_mdraid_new (void)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* All arrays with a running resync, recovery, check or repair share a
+ * single poller ticking once per second. A tick only re-reads
+ * md/sync_action, md/sync_completed and md/sync_speed through file
+ * descriptors kept open while polling instead of synthesizing a full uevent
+ * for each array - the full update is only needed once the operation stops
+ * or changes.
+ *
+ * The update (and thus ensure_polling()) also runs in method handler
+ * threads and the last reference to an array may be dropped in any thread,
+ * so the list, the timeout source id and the polling state and file
+ * descriptors of the arrays are protected by polling_lock. The tick holds
+ * the lock while polling so that finalize() can't take an array off the list
+ * under its feet. The tick removes its source itself once the list is empty.
+ */
+G_LOCK_DEFINE_STATIC (polling_lock);
+static GList *polled_mdraids = NULL;
+static guint progress_timeout_id = 0;
+
+/* Parses md/sync_completed (e.g. "1234 / 5678") and md/sync_speed (KiB/s). */
 static gboolean
-on_polling_timeout (gpointer user_data)
+compute_sync_progress (const gchar *sync_completed,
+                       guint64      sync_speed,
+                       gdouble     *out_completed,
+                       guint64     *out_rate,
+                       guint64     *out_remaining_time)
 {
-  UDisksLinuxMDRaid *mdraid = UDISKS_LINUX_MDRAID (user_data);
-  UDisksLinuxMDRaidObject *object = NULL;
-  UDisksLinuxDevice *raid_device;
+  guint64 completed_sectors = 0;
+  guint64 num_sectors = 1;
+  gdouble completed = 0.0;
+  guint64 rate;
+  guint64 remaining_time = 0;
 
-  /* udisks_debug ("polling timeout"); */
+  if (sync_completed == NULL || g_str_has_prefix (sync_completed, "none"))
+    return FALSE;
 
-  object = udisks_daemon_util_dup_object (mdraid, NULL);
-  if (object == NULL)
-    goto out;
+  if (sscanf (sync_completed, "%" G_GUINT64_FORMAT " / %" G_GUINT64_FORMAT,
+              &completed_sectors, &num_sectors) == 2)
+    {
+      if (num_sectors != 0)
+        completed = ((gdouble) completed_sectors) / ((gdouble) num_sectors);
+    }
+
+  /* this is KiB/s (see drivers/md/md.c:sync_speed_show()) */
+  rate = sync_speed * 1024;
+  if (rate > 0 && num_sectors >= completed_sectors)
+    {
+      guint64 num_bytes_remaining = (num_sectors - completed_sectors) * 512ULL;
+      remaining_time = ((guint64) G_USEC_PER_SEC) * num_bytes_remaining / rate;
+    }
+
+  *out_completed = completed;
+  *out_rate = rate;
+  *out_remaining_time = remaining_time;
+  return TRUE;
+}
+
+static void
+set_sync_progress (UDisksLinuxMDRaid *mdraid,
+                   UDisksJob         *job,
+                   gdouble            completed,
+                   guint64            rate,
+                   guint64            remaining_time)
+{
+  UDisksMDRaid *iface = UDISKS_MDRAID (mdraid);
+
+  if (job != NULL)
+    {
+      udisks_job_set_progress (job, completed);
+      udisks_job_set_progress_valid (job, TRUE);
+      udisks_job_set_rate (job, rate);
+      udisks_job_set_expected_end_time (job, g_get_real_time () + remaining_time);
+    }
+  udisks_mdraid_set_sync_completed (iface, completed);
+  udisks_mdraid_set_sync_rate (iface, rate);
+  udisks_mdraid_set_sync_remaining_time (iface, remaining_time);
+}
+
+/* Reads a sysfs attribute from the start, returns %FALSE on error. */
+static gboolean
+read_polled_attr (gint    fd,
+                  gchar  *buf,
+                  gsize   buf_size)
+{
+  gssize len;
+
+  if (fd < 0)
+    return FALSE;
+
+  do
+    len = pread (fd, buf, buf_size - 1, 0);
+  while (len < 0 && errno == EINTR);
+  if (len < 0)
+    return FALSE;
+
+  buf[len] = '\0';
+  g_strchomp (buf);
+  return TRUE;
+}
+
+static void
+close_polled_attrs (UDisksLinuxMDRaid *mdraid)
+{
+  if (mdraid->sync_action_fd >= 0)
+    close (mdraid->sync_action_fd);
+  if (mdraid->sync_completed_fd >= 0)
+    close (mdraid->sync_completed_fd);
+  if (mdraid->sync_speed_fd >= 0)
+    close (mdraid->sync_speed_fd);
+  mdraid->sync_action_fd = -1;
+  mdraid->sync_completed_fd = -1;
+  mdraid->sync_speed_fd = -1;
+  g_clear_pointer (&mdraid->polling_sysfs_path, g_free);
+}
+
+static gint
+open_polled_attr (const gchar *sysfs_path,
+                  const gchar *attr)
+{
+  gchar *path;
+  gint fd;
+
+  path = g_build_filename (sysfs_path, "md", attr, NULL);
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    udisks_debug ("Error opening %s: %m", path);
+  g_free (path);
+
+  return fd;
+}
+
+static void
+open_polled_attrs (UDisksLinuxMDRaid *mdraid,
+                   UDisksLinuxDevice *raid_device)
+{
+  const gchar *sysfs_path;
+
+  sysfs_path = g_udev_device_get_sysfs_path (raid_device->udev_device);
+  if (g_strcmp0 (sysfs_path, mdraid->polling_sysfs_path) == 0 && mdraid->sync_completed_fd >= 0)
+    return;
+
+  close_polled_attrs (mdraid);
+  mdraid->polling_sysfs_path = g_strdup (sysfs_path);
+
+  mdraid->sync_action_fd = open_polled_attr (sysfs_path, "sync_action");
+  mdraid->sync_completed_fd = open_polled_attr (sysfs_path, "sync_completed");
+  mdraid->sync_speed_fd = open_polled_attr (sysfs_path, "sync_speed");
+}
+
+/* Runs the full update by synthesizing a uevent, like the old per-array poller did. */
+static void
+synthesize_uevent (UDisksLinuxMDRaidObject *object)
+{
+  UDisksLinuxDevice *raid_device;
 
-  /* synthesize uevent */
   raid_device = udisks_linux_mdraid_object_get_device (object);
   if (raid_device != NULL)
     {
       udisks_linux_mdraid_object_uevent (object, UDISKS_UEVENT_ACTION_CHANGE, raid_device, FALSE);
       g_object_unref (raid_device);
     }
+}
 
- out:
-  g_clear_object (&object);
-  return TRUE; /* keep timeout around */
+/* Returns %FALSE if @mdraid needs a full update. */
+static gboolean
+poll_sync_progress (UDisksLinuxMDRaid       *mdraid,
+                    UDisksLinuxMDRaidObject *object)
+{
+  UDisksBaseJob *job;
+  gboolean ret = TRUE;
+  gchar sync_action[32];
+  gchar sync_completed[64];
+  gchar sync_speed[32];
+  gdouble completed;
+  guint64 rate;
+  guint64 remaining_time;
+
+  /* only the full update sets SyncAction, let it handle a changed operation */
+  if (!read_polled_attr (mdraid->sync_action_fd, sync_action, sizeof (sync_action)) ||
+      g_strcmp0 (sync_action, udisks_mdraid_get_sync_action (UDISKS_MDRAID (mdraid))) != 0)
+    return FALSE;
+  if (!read_polled_attr (mdraid->sync_completed_fd, sync_completed, sizeof (sync_completed)))
+    return FALSE;
+  /* sync_speed reads "none" when idle, treat that as 0 */
+  if (!read_polled_attr (mdraid->sync_speed_fd, sync_speed, sizeof (sync_speed)))
+    return FALSE;
+
+  if (!compute_sync_progress (sync_completed,
+                              g_ascii_strtoull (sync_speed, NULL, 10),
+                              &completed, &rate, &remaining_time))
+    return FALSE;
+
+  /* the job is launched by the full update, let it do that first */
+  job = udisks_linux_mdraid_object_get_sync_job (object);
+  if (job != NULL)
+    set_sync_progress (mdraid, UDISKS_JOB (job), completed, rate, remaining_time);
+  else
+    ret = FALSE;
+
+  return ret;
+}
+
+static gboolean
+on_progress_timeout (gpointer user_data)
+{
+  GList *objects = NULL;
+  GList *stale = NULL;
+  GList *l;
+  gboolean ret = G_SOURCE_CONTINUE;
+
+  G_LOCK (polling_lock);
+  for (l = polled_mdraids; l != NULL; l = l->next)
+    {
+      UDisksLinuxMDRaid *mdraid = UDISKS_LINUX_MDRAID (l->data);
+      UDisksLinuxMDRaidObject *object;
+
+      /* The enclosing object is safe to reference here (unlike @mdraid
+       * which may already be waiting in finalize() for the lock). It must
+       * not be released with the lock held though, dropping the last
+       * reference finalizes @mdraid which takes the lock again. */
+      object = udisks_daemon_util_dup_object (mdraid, NULL);
+      if (object == NULL)
+        continue;
+      objects = g_list_prepend (objects, object);
+
+      /* the full update takes the lock, run it once it's released */
+      if (!poll_sync_progress (mdraid, object))
+        stale = g_list_prepend (stale, object);
+    }
+  if (polled_mdraids == NULL)
+    {
+      progress_timeout_id = 0;
+      ret = G_SOURCE_REMOVE;
+    }
+  G_UNLOCK (polling_lock);
+
+  for (l = stale; l != NULL; l = l->next)
+    synthesize_uevent (UDISKS_LINUX_MDRAID_OBJECT (l->data));
+  g_list_free (stale);
+  g_list_free_full (objects, g_object_unref);
+
+  return ret;
 }
 
 static void
 ensure_polling (UDisksLinuxMDRaid  *mdraid,
+                UDisksLinuxDevice  *raid_device,
                 gboolean            polling_on)
 {
-  if (polling_on)
+  G_LOCK (polling_lock);
+  if (polling_on && raid_device != NULL)
     {
-      if (mdraid->polling_timeout == 0)
+      open_polled_attrs (mdraid, raid_device);
+      if (!mdraid->polling)
         {
-          mdraid->polling_timeout = g_timeout_add_seconds (1,
-                                                           on_polling_timeout,
-                                                           mdraid);
+          /* not referenced, finalize() takes the array off the list */
+          polled_mdraids = g_list_prepend (polled_mdraids, mdraid);
+          mdraid->polling = TRUE;
         }
+      /* attached to the global default main context from any thread */
+      if (progress_timeout_id == 0)
+        progress_timeout_id = g_timeout_add_seconds (1, on_progress_timeout, NULL);
     }
   else
     {
-      if (mdraid->polling_timeout != 0)
+      if (mdraid->polling)
         {
-          g_source_remove (mdraid->polling_timeout);
-          mdraid->polling_timeout = 0;
+          polled_mdraids = g_list_remove (polled_mdraids, mdraid);
+          mdraid->polling = FALSE;
         }
+      close_polled_attrs (mdraid);
     }
+  G_UNLOCK (polling_lock);
 }
 
 static gint
@@ -335,24 +572,11 @@ udisks_linux_mdraid_update (UDisksLinuxMDRaid       *mdraid,
   udisks_mdraid_set_bitmap_location (iface, bitmap_location);
   udisks_mdraid_set_chunk_size (iface, chunk_size);
 
-  if (sync_completed != NULL && g_strcmp0 (sync_completed, "none") != 0)
+  if (raid_device != NULL && sync_completed != NULL)
     {
-      guint64 completed_sectors = 0;
-      guint64 num_sectors = 1;
-      if (sscanf (sync_completed, "%" G_GUINT64_FORMAT " / %" G_GUINT64_FORMAT,
-                  &completed_sectors, &num_sectors) == 2)
-        {
-          if (num_sectors != 0)
-            sync_completed_val = ((gdouble) completed_sectors) / ((gdouble) num_sectors);
-        }
-
-      /* this is KiB/s (see drivers/md/md.c:sync_speed_show()) */
-      sync_rate = udisks_linux_device_read_sysfs_attr_as_uint64 (raid_device, "md/sync_speed", NULL) * 1024;
-      if (sync_rate > 0)
-        {
-          guint64 num_bytes_remaining = (num_sectors - completed_sectors) * 512ULL;
-          sync_remaining_time = ((guint64) G_USEC_PER_SEC) * num_bytes_remaining / sync_rate;
-        }
+      compute_sync_progress (sync_completed,
+                             udisks_linux_device_read_sysfs_attr_as_uint64 (raid_device, "md/sync_speed", NULL),
+                             &sync_completed_val, &sync_rate, &sync_remaining_time);
     }
 
   if (sync_action == NULL || g_strcmp0 (sync_action, "idle") == 0)
@@ -383,18 +607,10 @@ udisks_linux_mdraid_update (UDisksLinuxMDRaid       *mdraid,
         }
       else
         job = udisks_linux_mdraid_object_get_sync_job (object);
-
-      /* Update the job's interface */
-      udisks_job_set_progress (UDISKS_JOB (job), sync_completed_val);
-      udisks_job_set_progress_valid (UDISKS_JOB (job), TRUE);
-      udisks_job_set_rate (UDISKS_JOB (job), sync_rate);
-
-      udisks_job_set_expected_end_time (UDISKS_JOB (job),
-                                        g_get_real_time () + sync_remaining_time);
     }
-  udisks_mdraid_set_sync_completed (iface, sync_completed_val);
-  udisks_mdraid_set_sync_rate (iface, sync_rate);
-  udisks_mdraid_set_sync_remaining_time (iface, sync_remaining_time);
+  /* Update the job's interface */
+  set_sync_progress (mdraid, job != NULL ? UDISKS_JOB (job) : NULL,
+                     sync_completed_val, sync_rate, sync_remaining_time);
 
   /* ensure we poll, exactly when we need to */
   if (g_strcmp0 (sync_action, "resync") == 0 ||
@@ -402,11 +618,11 @@ udisks_linux_mdraid_update (UDisksLinuxMDRaid       *mdraid,
       g_strcmp0 (sync_action, "check") == 0 ||
       g_strcmp0 (sync_action, "repair") == 0)
     {
-      ensure_polling (mdraid, TRUE);
+      ensure_polling (mdraid, raid_device, TRUE);
     }
   else
     {
-      ensure_polling (mdraid, FALSE);
+      ensure_polling (mdraid, NULL, FALSE);
     }
 
   /* figure out active devices */
@@ -672,6 +888,7 @@ handle_start (UDisksMDRaid           *_mdraid,
                                                      object,
                                                      NULL,
                                                      UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                     NULL,
                                                      &error);
   if (block_object == NULL)
     {
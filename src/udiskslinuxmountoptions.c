@@ -23,6 +23,7 @@
 #include <glib/gi18n-lib.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <pwd.h>
 #include <grp.h>
 #include <string.h>
@@ -40,7 +41,6 @@
 #include "udisksstate.h"
 #include "udisksdaemonutil.h"
 #include "udiskslinuxdevice.h"
-#include "udisksconfigmanager.h"
 #include "udisks-daemon-resources.h"
 
 
@@ -174,18 +174,194 @@ udisks_mount_options_entry_free (UDisksMountOptionsEntry *entry)
 #define FS_SIGNATURE_DRIVER_SEP              ":"
 
 
-/* transfer none */
+/* Mount options for a filesystem type with the "any" options merged in and
+ * the allow lists turned into sets, ready for validating caller options.
+ */
+typedef struct
+{
+  FSMountOptions *fsmo;
+  GHashTable *allow;              /* set of fsmo->allow entries, borrowed */
+  GHashTable *allow_uid_self;     /* set of option names taking $UID */
+  GHashTable *allow_gid_self;     /* set of option names taking $GID */
+  gboolean changed;               /* whether any overrides were applied */
+} MountOptionsRule;
+
+/* The parsed global config file along with the rules computed from it */
+typedef struct
+{
+  GHashTable *overrides;          /* two-level, NULL if there's no usable config file */
+  GMutex lock;
+  GHashTable *rules;              /* rule key -> MountOptionsRule */
+} MountOptionsConfig;
+
+struct _UDisksMountOptionsCache
+{
+  GHashTable *builtin;            /* two-level */
+  gchar *config_file_path;
+
+  GMutex lock;
+  MountOptionsConfig *config;
+  struct stat config_stat;        /* zeroed if the file couldn't be stat'ed */
+};
+
+/* extracts option names from @allow that carry the @arg string as an argument */
 static GHashTable *
-get_options_for_block (GHashTable  *opts,
-                       UDisksBlock *block)
+extract_opts_with_arg (gchar **allow,
+                       const gchar *arg)
+{
+  GHashTable *opts;
+
+  opts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (; allow && *allow; allow++)
+    {
+      gchar *eq;
+
+      eq = g_strrstr (*allow, arg);
+      if (eq && eq != *allow && *(eq - 1) == '=' && *(eq + strlen (arg)) == '\0')
+        g_hash_table_add (opts, g_strndup (*allow, eq - *allow - 1));
+    }
+
+  return opts;
+}
+
+/* takes ownership of @fsmo */
+static MountOptionsRule *
+mount_options_rule_new (FSMountOptions *fsmo,
+                        gboolean        changed)
+{
+  MountOptionsRule *rule;
+  gchar **s;
+
+  rule = g_atomic_rc_box_new0 (MountOptionsRule);
+  rule->fsmo = fsmo;
+  rule->changed = changed;
+  rule->allow = g_hash_table_new (g_str_hash, g_str_equal);
+  for (s = fsmo->allow; s && *s; s++)
+    g_hash_table_add (rule->allow, *s);
+  rule->allow_uid_self = extract_opts_with_arg (fsmo->allow, MOUNT_OPTIONS_ARG_UID_SELF);
+  rule->allow_gid_self = extract_opts_with_arg (fsmo->allow, MOUNT_OPTIONS_ARG_GID_SELF);
+
+  return rule;
+}
+
+static void
+mount_options_rule_clear (MountOptionsRule *rule)
+{
+  g_hash_table_unref (rule->allow);
+  g_hash_table_unref (rule->allow_uid_self);
+  g_hash_table_unref (rule->allow_gid_self);
+  free_fs_mount_options (rule->fsmo);
+}
+
+static void
+mount_options_rule_unref (MountOptionsRule *rule)
+{
+  g_atomic_rc_box_release_full (rule, (GDestroyNotify) mount_options_rule_clear);
+}
+
+static MountOptionsConfig *
+mount_options_config_new (const gchar *config_file_path)
+{
+  MountOptionsConfig *config;
+  GError *error = NULL;
+
+  config = g_atomic_rc_box_new0 (MountOptionsConfig);
+  g_mutex_init (&config->lock);
+  config->rules = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         (GDestroyNotify) mount_options_rule_unref);
+
+  config->overrides = mount_options_parse_config_file (config_file_path, &error);
+  if (!config->overrides)
+    {
+      if (! g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT) /* not found */ &&
+          ! g_error_matches (error, UDISKS_ERROR, UDISKS_ERROR_NOT_SUPPORTED) /* empty file */ )
+        {
+          udisks_warning ("Error reading global mount options config file %s: %s",
+                          config_file_path, error->message);
+        }
+      g_clear_error (&error);
+    }
+  else
+    {
+      udisks_debug ("Parsed global mount options config file %s", config_file_path);
+    }
+
+  return config;
+}
+
+static void
+mount_options_config_clear (MountOptionsConfig *config)
+{
+  if (config->overrides)
+    g_hash_table_unref (config->overrides);
+  g_hash_table_unref (config->rules);
+  g_mutex_clear (&config->lock);
+}
+
+static void
+mount_options_config_unref (MountOptionsConfig *config)
+{
+  g_atomic_rc_box_release_full (config, (GDestroyNotify) mount_options_config_clear);
+}
+
+static gboolean
+config_stat_equal (const struct stat *a,
+                   const struct stat *b)
+{
+  return a->st_dev == b->st_dev &&
+         a->st_ino == b->st_ino &&
+         a->st_size == b->st_size &&
+         a->st_mtim.tv_sec == b->st_mtim.tv_sec &&
+         a->st_mtim.tv_nsec == b->st_mtim.tv_nsec &&
+         a->st_ctim.tv_sec == b->st_ctim.tv_sec &&
+         a->st_ctim.tv_nsec == b->st_ctim.tv_nsec;
+}
+
+/*
+ * mount_options_cache_dup_config: <internal>
+ * @cache: A #UDisksMountOptionsCache.
+ *
+ * Gets the parsed global config file, parsing it again only if it has been
+ * modified, replaced or removed since the last call. This costs a single
+ * stat() in the common case.
+ *
+ * Returns: (transfer full): A #MountOptionsConfig. Free with mount_options_config_unref().
+ */
+static MountOptionsConfig *
+mount_options_cache_dup_config (UDisksMountOptionsCache *cache)
+{
+  MountOptionsConfig *config;
+  struct stat st;
+
+  if (stat (cache->config_file_path, &st) != 0)
+    memset (&st, 0, sizeof (st));
+
+  g_mutex_lock (&cache->lock);
+  if (cache->config == NULL || !config_stat_equal (&st, &cache->config_stat))
+    {
+      if (cache->config != NULL)
+        mount_options_config_unref (cache->config);
+      cache->config = mount_options_config_new (cache->config_file_path);
+      cache->config_stat = st;
+    }
+  config = g_atomic_rc_box_acquire (cache->config);
+  g_mutex_unlock (&cache->lock);
+
+  return config;
+}
+
+/* transfer none */
+static const gchar *
+find_block_group (GHashTable  *opts,
+                  UDisksBlock *block)
 {
-  GHashTable *block_options = NULL;
+  const gchar *group = NULL;
   const gchar *block_device;
   const gchar * const *block_symlinks;
   GList *keys;
   GList *l;
 
-  if (!block)
+  if (!opts || !block)
     return NULL;
 
   block_device = udisks_block_get_device (block);
@@ -200,13 +376,24 @@ get_options_for_block (GHashTable  *opts,
       if (g_str_equal (l->data, block_device) ||
           (block_symlinks && g_strv_contains (block_symlinks, l->data)))
         {
-          block_options = g_hash_table_lookup (opts, l->data);
+          group = l->data;
           break;
         }
     }
   g_list_free (keys);
 
-  return block_options;
+  return group;
+}
+
+/* transfer none */
+static GHashTable *
+get_options_for_block (GHashTable  *opts,
+                       UDisksBlock *block)
+{
+  const gchar *group;
+
+  group = find_block_group (opts, block);
+  return group ? g_hash_table_lookup (opts, group) : NULL;
 }
 
 /*
@@ -320,47 +507,77 @@ compute_block_level_fs_drivers (GHashTable      *opts,
 
 /*
  * compute_mount_options_for_fs_type: <internal>
- * @daemon: A #UDisksDaemon.
+ * @cache: A #UDisksMountOptionsCache.
+ * @config: The current #MountOptionsConfig.
  * @block: A #UDisksBlock.
  * @object: A #UDisksLinuxBlockObject.
- * @overrides: Config file overrides.
  * @fstype: The filesystem type to use or %NULL.
  *
  * Calculate mount options across different levels of overrides (builtin,
- * global config, local user config).
+ * global config, local user config). Unless the device carries udev
+ * overrides, the result only depends on the matched config file sections
+ * and is shared through @config.
  *
- * Returns: (transfer full): Newly allocated #FSMountOptions options. Free with free_fs_mount_options().
+ * Returns: (transfer full): A #MountOptionsRule. Free with mount_options_rule_unref().
  */
-static FSMountOptions *
-compute_mount_options_for_fs_type (UDisksDaemon           *daemon,
-                                   UDisksBlock            *block,
-                                   UDisksLinuxBlockObject *object,
-                                   GHashTable             *overrides,
-                                   const gchar            *fstype)
+static MountOptionsRule *
+compute_mount_options_for_fs_type (UDisksMountOptionsCache *cache,
+                                   MountOptionsConfig      *config,
+                                   UDisksBlock             *block,
+                                   UDisksLinuxBlockObject  *object,
+                                   const gchar             *fstype)
 {
   UDisksLinuxDevice *device;
-  GHashTable *builtin_opts;
+  MountOptionsRule *rule = NULL;
   FSMountOptions *fsmo;
   FSMountOptions *fsmo_any;
   GHashTable *udev_overrides;
+  gchar *rule_key = NULL;
   GError *error = NULL;
   gboolean changed = FALSE;
 
   /* Builtin options, two-level hashtable */
-  builtin_opts = g_object_get_data (G_OBJECT (daemon), "mount-options");
-  g_return_val_if_fail (builtin_opts != NULL, NULL);
+  g_return_val_if_fail (cache->builtin != NULL, NULL);
+
+  /* udev properties, single-level hashtable */
+  device = udisks_linux_block_object_get_device (object);
+  udev_overrides = mount_options_get_from_udev (device, &error);
+  if (!udev_overrides)
+    {
+      udisks_warning ("Error getting udev mount options: %s",
+                      error->message);
+      g_clear_error (&error);
+    }
+  g_object_unref (device);
+
+  /* Without udev overrides the result is fully determined by the matched sections */
+  if (!udev_overrides || g_hash_table_size (udev_overrides) == 0)
+    {
+      const gchar *builtin_group = find_block_group (cache->builtin, block);
+      const gchar *overrides_group = find_block_group (config->overrides, block);
+
+      rule_key = g_strjoin ("\n",
+                            fstype ? fstype : "",
+                            builtin_group ? builtin_group : "",
+                            overrides_group ? overrides_group : "",
+                            NULL);
+      g_mutex_lock (&config->lock);
+      rule = g_hash_table_lookup (config->rules, rule_key);
+      if (rule)
+        rule = g_atomic_rc_box_acquire (rule);
+      g_mutex_unlock (&config->lock);
+      if (rule)
+        goto out;
+    }
 
   fsmo = g_malloc0 (sizeof (FSMountOptions));
   fsmo_any = g_malloc0 (sizeof (FSMountOptions));
-  compute_block_level_mount_options (builtin_opts, block, fstype, fsmo, fsmo_any);
+  compute_block_level_mount_options (cache->builtin, block, fstype, fsmo, fsmo_any);
 
   /* Global config file overrides, two-level hashtable */
-  if (overrides)
-    changed = compute_block_level_mount_options (overrides, block, fstype, fsmo, fsmo_any);
+  if (config->overrides)
+    changed = compute_block_level_mount_options (config->overrides, block, fstype, fsmo, fsmo_any);
 
-  /* udev properties, single-level hashtable */
-  device = udisks_linux_block_object_get_device (object);
-  udev_overrides = mount_options_get_from_udev (device, &error);
   if (udev_overrides)
     {
       FSMountOptions *o;
@@ -372,35 +589,39 @@ compute_mount_options_for_fs_type (UDisksDaemon           *daemon,
       o = fstype ? g_hash_table_lookup (udev_overrides, fstype) : NULL;
       override_fs_mount_options (o, fsmo);
       changed = changed || o != NULL;
-
-      g_hash_table_unref (udev_overrides);
     }
-  else
-    {
-      udisks_warning ("Error getting udev mount options: %s",
-                      error->message);
-      g_clear_error (&error);
-    }
-  g_object_unref (device);
 
   /* Merge "any" and fstype-specific options */
   append_fs_mount_options (fsmo_any, fsmo);
   free_fs_mount_options (fsmo_any);
   fsmo_any = NULL;
 
-  if (changed && fsmo->defaults)
+  rule = mount_options_rule_new (fsmo, changed);
+  if (rule_key)
     {
-      gchar *opts = g_strjoinv (",", fsmo->defaults);
+      g_mutex_lock (&config->lock);
+      g_hash_table_replace (config->rules, g_steal_pointer (&rule_key), g_atomic_rc_box_acquire (rule));
+      g_mutex_unlock (&config->lock);
+    }
+
+ out:
+  if (rule->changed && rule->fsmo->defaults)
+    {
+      gchar *opts = g_strjoinv (",", rule->fsmo->defaults);
       udisks_notice ("Using overridden mount options: %s", opts);
       g_free (opts);
     }
 
-  return fsmo;
+  if (udev_overrides)
+    g_hash_table_unref (udev_overrides);
+  g_free (rule_key);
+
+  return rule;
 }
 
 /*
  * compute_drivers: <internal>
- * @daemon: A #UDisksDaemon.
+ * @cache: A #UDisksMountOptionsCache.
  * @block: A #UDisksBlock.
  * @object: A #UDisksLinuxBlockObject.
  * @overrides: Config file overrides.
@@ -412,15 +633,14 @@ compute_mount_options_for_fs_type (UDisksDaemon           *daemon,
  * Returns: (transfer full) (array zero-terminated=1): list of filesystem drivers. Free with g_strfreev().
  */
 static gchar **
-compute_drivers (UDisksDaemon           *daemon,
-                 UDisksBlock            *block,
-                 UDisksLinuxBlockObject *object,
-                 GHashTable             *overrides,
-                 const gchar            *fs_signature,
-                 const gchar            *fs_type)
+compute_drivers (UDisksMountOptionsCache *cache,
+                 UDisksBlock             *block,
+                 UDisksLinuxBlockObject  *object,
+                 GHashTable              *overrides,
+                 const gchar             *fs_signature,
+                 const gchar             *fs_type)
 {
   UDisksLinuxDevice *device;
-  GHashTable *builtin_opts;
   GHashTable *udev_overrides;
   GError *error = NULL;
   gchar **drivers;
@@ -434,9 +654,8 @@ compute_drivers (UDisksDaemon           *daemon,
     }
 
   /* Builtin options, two-level hashtable */
-  builtin_opts = g_object_get_data (G_OBJECT (daemon), "mount-options");
-  g_return_val_if_fail (builtin_opts != NULL, NULL);
-  drivers = compute_block_level_fs_drivers (builtin_opts, block, fs_signature);
+  g_return_val_if_fail (cache->builtin != NULL, NULL);
+  drivers = compute_block_level_fs_drivers (cache->builtin, block, fs_signature);
 
   /* Global config file overrides, two-level hashtable */
   if (overrides)
@@ -834,6 +1053,51 @@ udisks_linux_mount_options_get_builtin (void)
   return mount_options;
 }
 
+/*
+ * udisks_linux_mount_options_cache_new: <internal>
+ * @config_dir: The directory to look for the global config file in.
+ *
+ * Creates a cache holding the built-in mount options and the parsed
+ * global config file. The config file is only parsed again once it
+ * changes and mount options computed for a filesystem type are reused
+ * until then.
+ *
+ * Returns: (transfer full): A #UDisksMountOptionsCache. Free with udisks_linux_mount_options_cache_free().
+ */
+UDisksMountOptionsCache *
+udisks_linux_mount_options_cache_new (const gchar *config_dir)
+{
+  UDisksMountOptionsCache *cache;
+
+  cache = g_new0 (UDisksMountOptionsCache, 1);
+  cache->builtin = udisks_linux_mount_options_get_builtin ();
+  cache->config_file_path = g_build_filename (config_dir, MOUNT_OPTIONS_GLOBAL_CONFIG_FILE_NAME, NULL);
+  g_mutex_init (&cache->lock);
+
+  return cache;
+}
+
+/*
+ * udisks_linux_mount_options_cache_free: <internal>
+ * @cache: A #UDisksMountOptionsCache.
+ *
+ * Frees the mount options cache.
+ */
+void
+udisks_linux_mount_options_cache_free (UDisksMountOptionsCache *cache)
+{
+  if (cache)
+    {
+      if (cache->builtin)
+        g_hash_table_destroy (cache->builtin);
+      if (cache->config)
+        mount_options_config_unref (cache->config);
+      g_mutex_clear (&cache->lock);
+      g_free (cache->config_file_path);
+      g_free (cache);
+    }
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 static gboolean
@@ -887,39 +1151,13 @@ is_uid_in_gid (uid_t uid,
   return ret;
 }
 
-/* extracts option names from @allow that carry the @arg string as an argument */
-static gchar **
-extract_opts_with_arg (gchar **allow,
-                       const gchar *arg)
-{
-  GPtrArray *opts;
-
-  if (allow == NULL)
-    return NULL;
-
-  opts = g_ptr_array_new ();
-  for (; *allow; allow++)
-    {
-      gchar *eq;
-
-      eq = g_strrstr (*allow, arg);
-      if (eq && eq != *allow && *(eq - 1) == '=' && *(eq + strlen (arg)) == '\0')
-        g_ptr_array_add (opts, g_strndup (*allow, eq - *allow - 1));
-    }
-  g_ptr_array_add (opts, NULL);
-
-  return (gchar **) g_ptr_array_free (opts, FALSE);
-}
-
 #define VARIANT_NULL_STRING  "\1"
 
 static gboolean
-is_mount_option_allowed (const FSMountOptions *fsmo,
-                         const gchar * const  *allow_uid_self,
-                         const gchar * const  *allow_gid_self,
-                         const gchar          *option,
-                         const gchar          *value,
-                         uid_t                 caller_uid)
+is_mount_option_allowed (const MountOptionsRule *rule,
+                         const gchar            *option,
+                         const gchar            *value,
+                         uid_t                   caller_uid)
 {
   gchar *endp;
   guint64 uid64;
@@ -927,10 +1165,10 @@ is_mount_option_allowed (const FSMountOptions *fsmo,
   gchar *s;
 
   /* match the exact option=value string within allowed options */
-  if (fsmo && fsmo->allow && value && strlen (value) > 0)
+  if (rule && value && strlen (value) > 0)
     {
       s = g_strdup_printf ("%s=%s", option, value);
-      if (g_strv_contains ((const gchar * const *) fsmo->allow, s))
+      if (g_hash_table_contains (rule->allow, s))
         {
           g_free (s);
           /* not checking whether the option is in UID/GID_self as
@@ -943,7 +1181,7 @@ is_mount_option_allowed (const FSMountOptions *fsmo,
   /* .. then check for mount options where the caller is allowed to pass
    * in his own uid
    */
-  if (fsmo && allow_uid_self && g_strv_contains (allow_uid_self, option))
+  if (rule && g_hash_table_contains (rule->allow_uid_self, option))
     {
       if (value == NULL || strlen (value) == 0)
         {
@@ -960,7 +1198,7 @@ is_mount_option_allowed (const FSMountOptions *fsmo,
 
   /* .. ditto for gid
    */
-  if (fsmo && allow_gid_self && g_strv_contains (allow_gid_self, option))
+  if (rule && g_hash_table_contains (rule->allow_gid_self, option))
     {
       if (value == NULL || strlen (value) == 0)
         {
@@ -979,10 +1217,10 @@ is_mount_option_allowed (const FSMountOptions *fsmo,
    * would be checked again against the _allow array */
 
   /* match within allowed mount options */
-  if (fsmo && fsmo->allow)
+  if (rule)
     {
       /* simple 'option' match */
-      if (g_strv_contains ((const gchar * const *) fsmo->allow, option))
+      if (g_hash_table_contains (rule->allow, option))
         return TRUE;
     }
 
@@ -995,12 +1233,10 @@ is_mount_option_allowed (const FSMountOptions *fsmo,
 }
 
 static GVariant *
-prepend_default_mount_options (const FSMountOptions *fsmo,
-                               const gchar * const  *allow_uid_self,
-                               const gchar * const  *allow_gid_self,
-                               uid_t                 caller_uid,
-                               GVariant             *given_options,
-                               gboolean              shared_fs)
+prepend_default_mount_options (const MountOptionsRule *rule,
+                               uid_t                   caller_uid,
+                               GVariant               *given_options,
+                               gboolean                shared_fs)
 {
   GVariantBuilder builder;
   gint n;
@@ -1009,9 +1245,9 @@ prepend_default_mount_options (const FSMountOptions *fsmo,
   const gchar *option_string;
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ss}"));
-  if (fsmo != NULL)
+  if (rule != NULL)
     {
-      gchar **defaults = fsmo->defaults;
+      gchar **defaults = rule->fsmo->defaults;
 
       for (n = 0; defaults != NULL && defaults[n] != NULL; n++)
         {
@@ -1024,21 +1260,21 @@ prepend_default_mount_options (const FSMountOptions *fsmo,
               gchar *option_name = g_strndup (option, eq - option);
 
               /* check that 'option=value' is explicitly allowed */
-              if (value && strlen (value) > 0 && fsmo->allow &&
-                  g_strv_contains ((const gchar * const *) fsmo->allow, option) &&
+              if (value && strlen (value) > 0 &&
+                  g_hash_table_contains (rule->allow, option) &&
                   !g_str_equal (value, MOUNT_OPTIONS_ARG_UID_SELF) &&
                   !g_str_equal (value, MOUNT_OPTIONS_ARG_GID_SELF))
                 {
                   g_variant_builder_add (&builder, "{ss}", option_name, value);
                 }
-              else if (allow_uid_self && g_strv_contains (allow_uid_self, option_name))
+              else if (g_hash_table_contains (rule->allow_uid_self, option_name))
                 {
                   /* append caller UID */
                   s = g_strdup_printf ("%u", caller_uid);
                   g_variant_builder_add (&builder, "{ss}", option_name, s);
                   g_free (s);
                 }
-              else if (allow_gid_self && g_strv_contains (allow_gid_self, option_name))
+              else if (g_hash_table_contains (rule->allow_gid_self, option_name))
                 {
                   if (udisks_daemon_util_get_user_info (caller_uid, &gid, NULL, NULL))
                     {
@@ -1123,37 +1359,30 @@ prepend_default_mount_options (const FSMountOptions *fsmo,
 const gchar *fs_no_uhelper[] = { "erofs", "zonefs", NULL };
 
 static UDisksMountOptionsEntry *
-calculate_mount_options_for_fs_type (UDisksDaemon  *daemon,
-                                     UDisksBlock   *block,
-                                     UDisksLinuxBlockObject *object,
-                                     GHashTable    *overrides,
-                                     uid_t          caller_uid,
-                                     gboolean       shared_fs,
-                                     const gchar   *fs_type,
-                                     GVariant      *options,
-                                     GError       **error)
+calculate_mount_options_for_fs_type (UDisksMountOptionsCache *cache,
+                                     MountOptionsConfig      *config,
+                                     UDisksBlock             *block,
+                                     UDisksLinuxBlockObject  *object,
+                                     uid_t                    caller_uid,
+                                     gboolean                 shared_fs,
+                                     const gchar             *fs_type,
+                                     GVariant                *options,
+                                     GError                 **error)
 {
   UDisksMountOptionsEntry *entry;
-  FSMountOptions *fsmo;
-  gchar **allow_uid_self = NULL;
-  gchar **allow_gid_self = NULL;
+  MountOptionsRule *rule;
   GVariant *options_to_use;
   GVariantIter iter;
   gchar *options_to_use_str = NULL;
   gchar *key, *value;
   GString *str;
 
-  fsmo = compute_mount_options_for_fs_type (daemon, block, object, overrides, fs_type);
-
-  allow_uid_self = extract_opts_with_arg (fsmo->allow, MOUNT_OPTIONS_ARG_UID_SELF);
-  allow_gid_self = extract_opts_with_arg (fsmo->allow, MOUNT_OPTIONS_ARG_GID_SELF);
+  rule = compute_mount_options_for_fs_type (cache, config, block, object, fs_type);
 
   /* always prepend some reasonable default mount options; these are
    * chosen here; the user can override them if he wants to
    */
-  options_to_use = prepend_default_mount_options (fsmo,
-                                                  (const gchar * const *) allow_uid_self,
-                                                  (const gchar * const *) allow_gid_self,
+  options_to_use = prepend_default_mount_options (rule,
                                                   caller_uid,
                                                   options,
                                                   shared_fs);
@@ -1182,10 +1411,7 @@ calculate_mount_options_for_fs_type (UDisksDaemon  *daemon,
         }
 
       /* first check if the mount option is allowed */
-      if (!is_mount_option_allowed (fsmo,
-                                    (const gchar * const *) allow_uid_self,
-                                    (const gchar * const *) allow_gid_self,
-                                    key, value, caller_uid))
+      if (!is_mount_option_allowed (rule, key, value, caller_uid))
         {
           if (value == NULL)
             {
@@ -1217,9 +1443,8 @@ calculate_mount_options_for_fs_type (UDisksDaemon  *daemon,
 
  out:
   g_variant_unref (options_to_use);
-  free_fs_mount_options (fsmo);
-  g_strfreev (allow_uid_self);
-  g_strfreev (allow_gid_self);
+  if (rule)
+    mount_options_rule_unref (rule);
 
   if (!options_to_use_str)
     return NULL;
@@ -1256,18 +1481,18 @@ udisks_linux_calculate_mount_options (UDisksDaemon  *daemon,
                                       GVariant      *options,
                                       GError       **error)
 {
+  UDisksMountOptionsCache *cache;
+  MountOptionsConfig *config;
   UDisksLinuxBlockObject *object = NULL;
-  UDisksConfigManager *config_manager;
   UDisksLinuxDevice *device = NULL;
   gboolean shared_fs = FALSE;
-  GHashTable *overrides;
-  gchar *config_file_path;
-  GError *l_error = NULL;
   GPtrArray *ptr_array;
   gchar **drivers;
   gchar **d;
 
-  config_manager = udisks_daemon_get_config_manager (daemon);
+  cache = g_object_get_data (G_OBJECT (daemon), "mount-options");
+  g_return_val_if_fail (cache != NULL, NULL);
+
   object = udisks_daemon_util_dup_object (block, NULL);
   device = udisks_linux_block_object_get_device (object);
   if (device != NULL && device->udev_device != NULL &&
@@ -1275,23 +1500,10 @@ udisks_linux_calculate_mount_options (UDisksDaemon  *daemon,
     shared_fs = TRUE;
 
   /* Global config file overrides */
-  config_file_path = g_build_filename (udisks_config_manager_get_config_dir (config_manager),
-                                       MOUNT_OPTIONS_GLOBAL_CONFIG_FILE_NAME, NULL);
-  overrides = mount_options_parse_config_file (config_file_path, &l_error);
-  if (!overrides)
-    {
-      if (! g_error_matches (l_error, G_FILE_ERROR, G_FILE_ERROR_NOENT) /* not found */ &&
-          ! g_error_matches (l_error, UDISKS_ERROR, UDISKS_ERROR_NOT_SUPPORTED) /* empty file */ )
-        {
-          udisks_warning ("Error reading global mount options config file %s: %s",
-                          config_file_path, l_error->message);
-        }
-      g_clear_error (&l_error);
-    }
-  g_free (config_file_path);
+  config = mount_options_cache_dup_config (cache);
 
   /* Compute filesystem drivers for given @fs_signature and @fs_type */
-  drivers = compute_drivers (daemon, block, object, overrides, fs_signature, fs_type);
+  drivers = compute_drivers (cache, block, object, config->overrides, fs_signature, fs_type);
 
   ptr_array = g_ptr_array_new_with_free_func ((GDestroyNotify) udisks_mount_options_entry_free);
   for (d = drivers; *d; d++)
@@ -1304,10 +1516,10 @@ udisks_linux_calculate_mount_options (UDisksDaemon  *daemon,
       else
         fs_type_full = g_strdup (*d);
 
-      entry = calculate_mount_options_for_fs_type (daemon,
+      entry = calculate_mount_options_for_fs_type (cache,
+                                                   config,
                                                    block,
                                                    object,
-                                                   overrides,
                                                    caller_uid,
                                                    shared_fs,
                                                    fs_type_full,
@@ -1329,8 +1541,7 @@ udisks_linux_calculate_mount_options (UDisksDaemon  *daemon,
 
   g_clear_object (&device);
   g_clear_object (&object);
-  if (overrides)
-    g_hash_table_unref (overrides);
+  mount_options_config_unref (config);
   g_strfreev (drivers);
 
   if (!ptr_array)
@@ -37,6 +37,15 @@ typedef struct
   gchar *options;
 } UDisksMountOptionsEntry;
 
+/**
+ * UDisksMountOptionsCache:
+ *
+ * The built-in mount options along with the parsed global config file.
+ * The structure contains only private data and should only be accessed
+ * using the provided API.
+ */
+typedef struct _UDisksMountOptionsCache UDisksMountOptionsCache;
+
 void                       udisks_mount_options_entry_free        (UDisksMountOptionsEntry *entry);
 
 UDisksMountOptionsEntry ** udisks_linux_calculate_mount_options   (UDisksDaemon            *daemon,
@@ -49,6 +58,9 @@ UDisksMountOptionsEntry ** udisks_linux_calculate_mount_options   (UDisksDaemon
 
 GHashTable               * udisks_linux_mount_options_get_builtin (void);
 
+UDisksMountOptionsCache  * udisks_linux_mount_options_cache_new   (const gchar             *config_dir);
+void                       udisks_linux_mount_options_cache_free  (UDisksMountOptionsCache *cache);
+
 
 G_END_DECLS
 
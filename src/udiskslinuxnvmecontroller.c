@@ -399,6 +399,12 @@ udisks_linux_nvme_controller_refresh_smart_sync (UDisksLinuxNVMeController  *ctr
       g_object_unref (object);
       return FALSE;
     }
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    {
+      g_object_unref (device);
+      g_object_unref (object);
+      return FALSE;
+    }
 
   /* Controller capabilities check - there's no authoritative way to find out which
    * log pages are actually supported, taking controller feature flags into account instead.
@@ -234,6 +234,7 @@ handle_disconnect (UDisksNVMeFabrics     *_object,
                                                          object_path,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         NULL,
                                                          &error))
     {
       g_prefix_error (&error, "Error waiting for the NVMeoF object to disappear after disconnecting: ");
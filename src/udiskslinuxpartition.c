@@ -1033,6 +1033,7 @@ handle_resize (UDisksPartition       *partition,
                                                          &wait_data,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         udisks_base_job_get_cancellable (job),
                                                          NULL);
 
   udisks_partition_complete_resize (partition, invocation);
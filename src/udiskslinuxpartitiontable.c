@@ -180,6 +180,16 @@ udisks_linux_partition_table_update (UDisksLinuxPartitionTable  *table,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static gint
+compare_partitions (gconstpointer a,
+                    gconstpointer b)
+{
+  guint num_a = udisks_partition_get_number (UDISKS_PARTITION ((gpointer) a));
+  guint num_b = udisks_partition_get_number (UDISKS_PARTITION ((gpointer) b));
+
+  return num_a < num_b ? -1 : (num_a > num_b ? 1 : 0);
+}
+
 GList *
 udisks_linux_partition_table_get_partitions (UDisksDaemon         *daemon,
                                              UDisksPartitionTable *table,
@@ -187,36 +197,31 @@ udisks_linux_partition_table_get_partitions (UDisksDaemon         *daemon,
 {
   GList *ret = NULL;
   GDBusObject *table_object;
-  const gchar *table_object_path;
-  GList *l, *object_proxies = NULL;
+  GList *l, *objects = NULL;
   *num_partitions = 0;
 
   table_object = g_dbus_interface_get_object (G_DBUS_INTERFACE (table));
   if (table_object == NULL)
     goto out;
-  table_object_path = g_dbus_object_get_object_path (table_object);
 
-  object_proxies = udisks_daemon_get_objects (daemon);
-  for (l = object_proxies; l != NULL; l = l->next)
+  objects = udisks_daemon_get_child_objects (daemon,
+                                             g_dbus_object_get_object_path (table_object),
+                                             UDISKS_OBJECT_RELATION_PARTITION);
+  for (l = objects; l != NULL; l = l->next)
     {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
       UDisksPartition *partition;
 
-      partition = udisks_object_get_partition (object);
+      partition = udisks_object_get_partition (UDISKS_OBJECT (l->data));
       if (partition == NULL)
         continue;
 
-      if (g_strcmp0 (udisks_partition_get_table (partition), table_object_path) == 0)
-        {
-          ret = g_list_prepend (ret, g_object_ref (partition));
-          (*num_partitions)++;
-        }
-
-      g_object_unref (partition);
+      ret = g_list_prepend (ret, partition);
+      (*num_partitions)++;
     }
-  ret = g_list_reverse (ret);
+  /* keep the Partitions property stable across updates */
+  ret = g_list_sort (ret, compare_partitions);
  out:
-  g_list_free_full (object_proxies, g_object_unref);
+  g_list_free_full (objects, g_object_unref);
   return ret;
 }
 
@@ -237,27 +242,25 @@ wait_for_partition (UDisksDaemon *daemon,
   UDisksObject *ret = NULL;
   GList *objects, *l;
 
-  objects = udisks_daemon_get_objects (daemon);
+  objects = udisks_daemon_get_child_objects (daemon,
+                                             g_dbus_object_get_object_path (G_DBUS_OBJECT (data->partition_table_object)),
+                                             UDISKS_OBJECT_RELATION_PARTITION);
   for (l = objects; l != NULL; l = l->next)
     {
       UDisksObject *object = UDISKS_OBJECT (l->data);
       UDisksPartition *partition = udisks_object_get_partition (object);
       if (partition != NULL)
         {
-          if (g_strcmp0 (udisks_partition_get_table (partition),
-                         g_dbus_object_get_object_path (G_DBUS_OBJECT (data->partition_table_object))) == 0)
-            {
-              guint64 offset = udisks_partition_get_offset (partition);
-              guint64 size = udisks_partition_get_size (partition);
+          guint64 offset = udisks_partition_get_offset (partition);
+          guint64 size = udisks_partition_get_size (partition);
 
-              if (data->pos_to_wait_for >= offset && data->pos_to_wait_for < offset + size)
+          if (data->pos_to_wait_for >= offset && data->pos_to_wait_for < offset + size)
+            {
+              if (!(udisks_partition_get_is_container (partition) && data->ignore_container))
                 {
-                  if (!(udisks_partition_get_is_container (partition) && data->ignore_container))
-                    {
-                      g_object_unref (partition);
-                      ret = g_object_ref (object);
-                      goto out;
-                    }
+                  g_object_unref (partition);
+                  ret = g_object_ref (object);
+                  goto out;
                 }
             }
           g_object_unref (partition);
@@ -560,6 +563,7 @@ udisks_linux_partition_table_handle_create_partition (UDisksPartitionTable   *ta
                                                          wait_data,
                                                          NULL,
                                                          UDISKS_DEFAULT_WAIT_TIMEOUT,
+                                                         udisks_base_job_get_cancellable (job),
                                                          &error);
   if (partition_object == NULL)
     {
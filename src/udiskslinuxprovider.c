@@ -29,11 +29,15 @@
 #include "udisksprovider.h"
 #include "udiskslinuxprovider.h"
 #include "udiskslinuxblockobject.h"
+#include "udiskslinuxblock.h"
 #include "udiskslinuxdriveobject.h"
 #include "udiskslinuxmdraidobject.h"
 #include "udiskslinuxmanager.h"
 #include "udiskslinuxmanagernvme.h"
+#include "udiskslinuxmanagerstats.h"
+#include "udisksstats.h"
 #include "udisksstate.h"
+#include "udisksworkerpool.h"
 #include "udiskslinuxdevice.h"
 #include "udisksmodulemanager.h"
 #include "udisksmodule.h"
@@ -52,6 +56,7 @@
  */
 
 typedef struct _UDisksLinuxProviderClass   UDisksLinuxProviderClass;
+typedef struct _ProbeWorker                ProbeWorker;
 
 /**
  * UDisksLinuxProvider:
@@ -67,11 +72,30 @@ struct _UDisksLinuxProvider
   GMainContext *uevent_monitor_context;
   GMainLoop *uevent_monitor_loop;
   GThread *uevent_monitor_thread;
-  GAsyncQueue *probe_request_queue;
-  GThread *probe_request_thread;
+
+  /* uevents are probed by a pool of workers, sharded by the parent device */
+  ProbeWorker *probe_workers;
+  guint n_probe_workers;
+
+  /* probed uevents waiting to be handled in the main thread, in arrival order */
+  GMutex pending_lock;
+  GQueue pending_requests;
+  GHashTable *pending_changes;         /* sysfs path -> GList link of a foldable request */
+  guint pending_source_id;
+  guint uevent_coalesce_window;        /* milliseconds */
+
+  /* uevent batching statistics, protected by pending_lock */
+  guint64 n_uevent_batches;
+  guint64 n_uevents_handled;
+  guint64 n_uevents_coalesced;
+  guint max_uevent_batch_size;
 
   UDisksObjectSkeleton *manager_object;
 
+  /* protects sysfs_to_block, the drive and mdraid maps and nvme_ns_to_ctrls
+   * against readers not holding provider_lock; writers hold both locks */
+  GMutex index_lock;
+
   /* maps from sysfs path to UDisksLinuxBlockObject objects */
   GHashTable *sysfs_to_block;
 
@@ -91,6 +115,10 @@ struct _UDisksLinuxProvider
   GHashTable *sysfs_path_to_nvme_subsys;
   GHashTable *nvme_subsystems;
 
+  /* maps from NVMe namespace sysfs path to NULL-terminated array of controller sysfs paths */
+  GHashTable *nvme_ns_to_ctrls;
+  guint nvme_ns_to_ctrls_generation;
+
   GUnixMountMonitor *mount_monitor;
   GFileMonitor *etc_udisks2_dir_monitor;
 
@@ -103,6 +131,7 @@ struct _UDisksLinuxProvider
   guint housekeeping_timeout;
   guint64 housekeeping_last;
   gboolean housekeeping_running;
+  UDisksWorkerPool *housekeeping_pool;
 };
 
 G_LOCK_DEFINE_STATIC (provider_lock);
@@ -121,7 +150,20 @@ static void udisks_linux_provider_handle_uevent (UDisksLinuxProvider *provider,
                                                  const gchar         *action,
                                                  UDisksLinuxDevice   *device);
 
+typedef struct _ProbeRequest ProbeRequest;
+static void probe_request_free (ProbeRequest *request);
+
 static gboolean on_housekeeping_timeout (gpointer user_data);
+static void housekeeping_drive_func (gpointer      data,
+                                     GCancellable *cancellable,
+                                     gpointer      user_data);
+static void on_housekeeping_drive_timeout (gpointer data,
+                                           gpointer user_data);
+static void housekeeping_item_free (gpointer data);
+static void schedule_drive_housekeeping (UDisksLinuxProvider    *provider,
+                                         UDisksLinuxDriveObject *object,
+                                         guint                   secs_since_last,
+                                         guint                   jitter_msec);
 
 static void mount_monitor_on_mountpoints_changed (GUnixMountMonitor *monitor,
                                                   gpointer           user_data);
@@ -167,6 +209,7 @@ udisks_linux_provider_finalize (GObject *object)
   UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (object);
   UDisksDaemon *daemon;
   UDisksModuleManager *module_manager;
+  guint n;
 
   /* stop the uevent monitor thread and wait for it */
   g_main_loop_quit (provider->uevent_monitor_loop);
@@ -174,10 +217,21 @@ udisks_linux_provider_finalize (GObject *object)
   g_main_loop_unref (provider->uevent_monitor_loop);
   g_main_context_unref (provider->uevent_monitor_context);
 
-  /* stop the request thread and wait for it */
-  g_async_queue_push (provider->probe_request_queue, (gpointer) 0xdeadbeef);
-  g_thread_join (provider->probe_request_thread);
-  g_async_queue_unref (provider->probe_request_queue);
+  /* stop the probing threads and wait for them */
+  for (n = 0; n < provider->n_probe_workers; n++)
+    g_async_queue_push (provider->probe_workers[n].queue, PROBE_WORKER_QUIT);
+  for (n = 0; n < provider->n_probe_workers; n++)
+    {
+      g_thread_join (provider->probe_workers[n].thread);
+      g_async_queue_unref (provider->probe_workers[n].queue);
+    }
+  g_free (provider->probe_workers);
+
+  /* the dispatch source holds a reference, nothing can be pending by now */
+  g_warn_if_fail (provider->pending_source_id == 0);
+  g_queue_clear_full (&provider->pending_requests, (GDestroyNotify) probe_request_free);
+  g_hash_table_unref (provider->pending_changes);
+  g_mutex_clear (&provider->pending_lock);
 
   daemon = udisks_provider_get_daemon (UDISKS_PROVIDER (provider));
 
@@ -202,6 +256,8 @@ udisks_linux_provider_finalize (GObject *object)
   g_hash_table_unref (provider->module_objects);
   g_hash_table_unref (provider->sysfs_path_to_nvme_subsys);
   g_hash_table_unref (provider->nvme_subsystems);
+  g_hash_table_unref (provider->nvme_ns_to_ctrls);
+  g_mutex_clear (&provider->index_lock);
   g_object_unref (provider->gudev_client);
 
   g_hash_table_unref (provider->module_ifaces);
@@ -211,6 +267,8 @@ udisks_linux_provider_finalize (GObject *object)
 
   if (provider->housekeeping_timeout > 0)
     g_source_remove (provider->housekeeping_timeout);
+  /* queued items hold a reference to the provider, nothing is left to wait for */
+  g_object_unref (provider->housekeeping_pool);
 
   g_signal_handlers_disconnect_by_func (provider->mount_monitor,
                                         G_CALLBACK (mount_monitor_on_mountpoints_changed),
@@ -230,13 +288,46 @@ udisks_linux_provider_finalize (GObject *object)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
-typedef struct
+/* Maximum number of probing threads */
+#define PROBE_WORKERS_MAX        8
+
+/* Delay between checks whether udev has finished processing a device */
+#define PROBE_INIT_RETRY_USEC    (100 * 1000)
+#define PROBE_INIT_MAX_TRIES     5
+
+/* used by _finalize() to stop the probing threads */
+#define PROBE_WORKER_QUIT        ((gpointer) 0xdeadbeef)
+
+/* Maximum number of drives refreshed in parallel, not counting the ones that timed out */
+#define HOUSEKEEPING_WORKERS_MAX         4
+
+/* Time after which housekeeping of a drive is cancelled and no longer waited for */
+#define HOUSEKEEPING_DRIVE_TIMEOUT_SECS  60
+
+/* Periodic housekeeping of the individual drives is spread over this interval */
+#define HOUSEKEEPING_JITTER_MSEC         (30 * 1000)
+
+struct _ProbeWorker
+{
+  GAsyncQueue *queue;
+  GThread *thread;
+
+  /* requests waiting for udev to initialize the device, in arrival order;
+   * only ever touched from the worker thread */
+  GQueue deferred;
+};
+
+struct _ProbeRequest
 {
   UDisksLinuxProvider *provider;
   GUdevDevice *udev_device;
   UDisksLinuxDevice *udisks_device;
   gboolean known_block;
-} ProbeRequest;
+  gchar *sysfs_path;
+  guint n_tries;
+  gint64 retry_at;
+  gint64 probed_at;    /* for UDisksStats, 0 if disabled */
+};
 
 static void
 probe_request_free (ProbeRequest *request)
@@ -244,27 +335,113 @@ probe_request_free (ProbeRequest *request)
   g_clear_object (&request->provider);
   g_clear_object (&request->udev_device);
   g_clear_object (&request->udisks_device);
+  g_free (request->sysfs_path);
   g_free (request);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
 
-/* called in main thread with a processed ProbeRequest struct - see probe_request_thread_func() */
+/* called in main thread with the batch of processed ProbeRequest structs - see queue_probed_request() */
 static gboolean
-on_idle_with_probed_uevent (gpointer user_data)
+on_idle_with_probed_uevents (gpointer user_data)
 {
-  ProbeRequest *request = user_data;
+  UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (user_data);
+  UDisksStats *stats;
+  ProbeRequest *request;
+  GQueue batch;
+
+  stats = udisks_daemon_get_stats (udisks_provider_get_daemon (UDISKS_PROVIDER (provider)));
+
+  g_mutex_lock (&provider->pending_lock);
+  batch = provider->pending_requests;
+  g_queue_init (&provider->pending_requests);
+  g_hash_table_remove_all (provider->pending_changes);
+  provider->pending_source_id = 0;
+  provider->n_uevent_batches++;
+  provider->n_uevents_handled += batch.length;
+  provider->max_uevent_batch_size = MAX (provider->max_uevent_batch_size, batch.length);
+  g_mutex_unlock (&provider->pending_lock);
+
+  if (batch.length > 1)
+    udisks_debug ("Handling a batch of %u uevents", batch.length);
+
+  while ((request = g_queue_pop_head (&batch)) != NULL)
+    {
+      udisks_stats_finish (stats, UDISKS_STATS_HISTOGRAM_UEVENT_DISPATCH_DELAY, request->probed_at);
+      udisks_linux_provider_handle_uevent (provider,
+                                           g_udev_device_get_action (request->udev_device),
+                                           request->udisks_device);
+      g_signal_emit (provider,
+                     signals[UEVENT_PROBED_SIGNAL],
+                     0,
+                     g_udev_device_get_action (request->udev_device),
+                     request->udisks_device);
+      probe_request_free (request);
+    }
 
-  udisks_linux_provider_handle_uevent (request->provider,
-                                       g_udev_device_get_action (request->udev_device),
-                                       request->udisks_device);
-  g_signal_emit (request->provider,
-                 signals[UEVENT_PROBED_SIGNAL],
-                 0,
-                 g_udev_device_get_action (request->udev_device),
-                 request->udisks_device);
-  probe_request_free (request);
-  return FALSE; /* remove source */
+  /* objects have been updated, wake up anyone waiting for them */
+  udisks_daemon_notify_objects_changed (udisks_provider_get_daemon (UDISKS_PROVIDER (provider)));
+  return G_SOURCE_REMOVE;
+}
+
+/* Only plain 'change' uevents may be replaced by a later one for the same
+ * device - synthesized uevents are waited for by udisks_daemon_util_trigger_uevent_sync().
+ */
+static gboolean
+probe_request_is_foldable (ProbeRequest *request)
+{
+  return g_strcmp0 (g_udev_device_get_action (request->udev_device), "change") == 0 &&
+         !g_udev_device_has_property (request->udev_device, "SYNTH_ARG_UDISKSSERIAL");
+}
+
+/* Posts a probed request to the main thread, takes ownership of @request.
+ *
+ * Requests are handled in batches at most uevent_coalesce_window milliseconds
+ * after the first one has been queued. A foldable request replaces an earlier
+ * foldable request for the same device still waiting in the batch - the
+ * newer probed data supersedes it.
+ */
+static void
+queue_probed_request (UDisksLinuxProvider *provider,
+                      ProbeRequest        *request)
+{
+  GList *link;
+  gboolean foldable;
+
+  foldable = probe_request_is_foldable (request);
+
+  g_mutex_lock (&provider->pending_lock);
+  link = g_hash_table_lookup (provider->pending_changes, request->sysfs_path);
+  if (link != NULL)
+    {
+      g_hash_table_remove (provider->pending_changes, request->sysfs_path);
+      if (foldable)
+        {
+          probe_request_free (link->data);
+          g_queue_delete_link (&provider->pending_requests, link);
+          provider->n_uevents_coalesced++;
+        }
+    }
+
+  g_queue_push_tail (&provider->pending_requests, request);
+  if (foldable)
+    g_hash_table_insert (provider->pending_changes, request->sysfs_path, provider->pending_requests.tail);
+
+  if (provider->pending_source_id == 0)
+    {
+      if (provider->uevent_coalesce_window > 0)
+        provider->pending_source_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                                          provider->uevent_coalesce_window,
+                                                          on_idle_with_probed_uevents,
+                                                          g_object_ref (provider),
+                                                          g_object_unref);
+      else
+        provider->pending_source_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                                                       on_idle_with_probed_uevents,
+                                                       g_object_ref (provider),
+                                                       g_object_unref);
+    }
+  g_mutex_unlock (&provider->pending_lock);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -293,60 +470,181 @@ uevent_is_spurious (GUdevDevice *dev)
   return FALSE;
 }
 
+/* Checks whether the device of @request has been initialized(*) by udev
+ * or whether we've waited long enough. If not, schedules another check.
+ *
+ * (*) "Check if udev has already handled the device and has set up device
+ *      node permissions and context, or has renamed a network device.
+ *      This is only implemented for devices with a device node or network
+ *      interfaces. All other devices return 1 here."
+ *        -- UDEV docs
+ */
+static gboolean
+probe_request_is_ready (ProbeRequest *request)
+{
+  if (g_udev_device_get_is_initialized (request->udev_device))
+    return TRUE;
+
+  if (request->n_tries >= PROBE_INIT_MAX_TRIES)
+    return TRUE;
+
+  request->n_tries++;
+  request->retry_at = g_get_monotonic_time () + PROBE_INIT_RETRY_USEC;
+  return FALSE;
+}
+
+/* probes the device and posts the request back to the main thread, takes ownership of @request */
+static void
+probe_request_finish (ProbeRequest *request)
+{
+  UDisksStats *stats;
+  gint64 start_time;
+
+  /* ignore spurious uevents */
+  if (!request->known_block && uevent_is_spurious (request->udev_device))
+    {
+      probe_request_free (request);
+      return;
+    }
+
+  /* probe the device - this may take a while */
+  stats = udisks_daemon_get_stats (udisks_provider_get_daemon (UDISKS_PROVIDER (request->provider)));
+  start_time = udisks_stats_start (stats);
+  request->udisks_device = udisks_linux_device_new_sync (request->udev_device, request->provider->gudev_client);
+  udisks_stats_finish (stats, UDISKS_STATS_HISTOGRAM_PROBE_LATENCY, start_time);
+  udisks_stats_add (stats, UDISKS_STATS_COUNTER_UEVENTS_PROBED, 1);
+  request->probed_at = udisks_stats_start (stats);
+
+  /* now that we've probed the device, post the request back to the main thread */
+  queue_probed_request (request->provider, request);
+}
+
+static gboolean
+probe_worker_has_deferred (ProbeWorker *worker,
+                           const gchar *sysfs_path)
+{
+  GList *l;
+
+  for (l = worker->deferred.head; l != NULL; l = l->next)
+    {
+      ProbeRequest *request = l->data;
+      if (g_strcmp0 (request->sysfs_path, sysfs_path) == 0)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+/* Goes through the deferred requests and finishes those that are ready.
+ * Only the oldest request for each device is ever considered so that
+ * uevents for a device are always delivered in order.
+ *
+ * Returns: The monotonic time of the next scheduled check or 0 if nothing is deferred.
+ */
+static gint64
+probe_worker_process_deferred (ProbeWorker *worker)
+{
+  GHashTable *blocked;
+  GList *l, *next;
+  gint64 now;
+  gint64 next_retry = 0;
+
+  if (g_queue_is_empty (&worker->deferred))
+    return 0;
+
+  now = g_get_monotonic_time ();
+  blocked = g_hash_table_new (g_str_hash, g_str_equal);
+  for (l = worker->deferred.head; l != NULL; l = next)
+    {
+      ProbeRequest *request = l->data;
+
+      next = l->next;
+      if (g_hash_table_contains (blocked, request->sysfs_path))
+        continue;
+
+      if (request->retry_at > now || !probe_request_is_ready (request))
+        {
+          g_hash_table_add (blocked, request->sysfs_path);
+          if (next_retry == 0 || request->retry_at < next_retry)
+            next_retry = request->retry_at;
+          continue;
+        }
+
+      g_queue_delete_link (&worker->deferred, l);
+      probe_request_finish (request);
+    }
+  g_hash_table_destroy (blocked);
+
+  return next_retry;
+}
+
 static gpointer
-probe_request_thread_func (gpointer user_data)
+probe_worker_thread_func (gpointer user_data)
 {
-  UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (user_data);
+  ProbeWorker *worker = user_data;
   ProbeRequest *request;
-  gboolean dev_initialized = FALSE;
-  guint n_tries = 0;
+  gint64 next_retry = 0;
 
   do
     {
-      request = g_async_queue_pop (provider->probe_request_queue);
+      if (next_retry == 0)
+        request = g_async_queue_pop (worker->queue);
+      else
+        request = g_async_queue_timeout_pop (worker->queue, MAX (next_retry - g_get_monotonic_time (), 0));
 
       /* used by _finalize() above to stop this thread - if received, we can
        * no longer use @provider
        */
-      if (request == (gpointer) 0xdeadbeef)
-        goto out;
+      if (request == PROBE_WORKER_QUIT)
+        break;
 
-      /* Try to wait for the device to become initialized(*) before we start
-       * gathering data for it.
-       *
-       * (*) "Check if udev has already handled the device and has set up device
-       *      node permissions and context, or has renamed a network device.
-       *      This is only implemented for devices with a device node or network
-       *      interfaces. All other devices return 1 here."
-       *        -- UDEV docs
-       *
-       * */
-      dev_initialized = g_udev_device_get_is_initialized (request->udev_device);
-      for (n_tries = 5; !dev_initialized && (n_tries > 0); n_tries--)
+      if (request != NULL)
         {
-          g_usleep (100000);      /* microseconds */
-          dev_initialized = g_udev_device_get_is_initialized (request->udev_device);
-        }
-
-      /* ignore spurious uevents */
-      if (!request->known_block && uevent_is_spurious (request->udev_device))
-        {
-          probe_request_free (request);
-          continue;
+          /* Rather than blocking the thread while waiting for udev to finish
+           * processing the device, put the request aside and keep serving
+           * other devices. Later uevents for the same device need to queue
+           * up behind it.
+           */
+          if (probe_worker_has_deferred (worker, request->sysfs_path) ||
+              !probe_request_is_ready (request))
+            g_queue_push_tail (&worker->deferred, request);
+          else
+            probe_request_finish (request);
         }
 
-      /* probe the device - this may take a while */
-      request->udisks_device = udisks_linux_device_new_sync (request->udev_device, provider->gudev_client);
-
-      /* now that we've probed the device, post the request back to the main thread */
-      g_idle_add (on_idle_with_probed_uevent, request);
+      next_retry = probe_worker_process_deferred (worker);
     }
   while (TRUE);
 
- out:
+  g_queue_clear_full (&worker->deferred, (GDestroyNotify) probe_request_free);
+
   return NULL;
 }
 
+/* Picks the probing thread for @device. Partitions are handled by the same
+ * thread as their whole-disk device to keep related uevents in order.
+ */
+static ProbeWorker *
+probe_worker_for_device (UDisksLinuxProvider *provider,
+                         GUdevDevice         *device)
+{
+  GUdevDevice *parent = NULL;
+  const gchar *shard_key;
+  guint n;
+
+  shard_key = g_udev_device_get_sysfs_path (device);
+  if (g_strcmp0 (g_udev_device_get_devtype (device), "partition") == 0)
+    {
+      parent = g_udev_device_get_parent (device);
+      if (parent != NULL)
+        shard_key = g_udev_device_get_sysfs_path (parent);
+    }
+
+  n = shard_key != NULL ? g_str_hash (shard_key) % provider->n_probe_workers : 0;
+  g_clear_object (&parent);
+
+  return &provider->probe_workers[n];
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 static void
@@ -359,15 +657,22 @@ on_uevent (GUdevClient  *client,
   ProbeRequest *request;
   const gchar *sysfs_path;
 
+  udisks_stats_add (udisks_daemon_get_stats (udisks_provider_get_daemon (UDISKS_PROVIDER (provider))),
+                    UDISKS_STATS_COUNTER_UEVENTS_RECEIVED, 1);
+
   request = g_new0 (ProbeRequest, 1);
   request->provider = g_object_ref (provider);
   request->udev_device = g_object_ref (device);
 
   sysfs_path = g_udev_device_get_sysfs_path (device);
-  request->known_block = sysfs_path != NULL && g_hash_table_contains (provider->sysfs_to_block, sysfs_path);
-
-  /* process uevent in "probing-thread" */
-  g_async_queue_push (provider->probe_request_queue, request);
+  request->sysfs_path = g_strdup (sysfs_path != NULL ? sysfs_path : "");
+  g_mutex_lock (&provider->index_lock);
+  request->known_block = sysfs_path != NULL && provider->sysfs_to_block != NULL &&
+                         g_hash_table_contains (provider->sysfs_to_block, sysfs_path);
+  g_mutex_unlock (&provider->index_lock);
+
+  /* process uevent in one of the "probing-threads" */
+  g_async_queue_push (probe_worker_for_device (provider, device)->queue, request);
 }
 
 
@@ -403,6 +708,10 @@ uevent_monitor_thread_func (gpointer user_data)
 static void
 udisks_linux_provider_init (UDisksLinuxProvider *provider)
 {
+  g_mutex_init (&provider->index_lock);
+  g_mutex_init (&provider->pending_lock);
+  g_queue_init (&provider->pending_requests);
+  provider->pending_changes = g_hash_table_new (g_str_hash, g_str_equal);
 }
 
 static void
@@ -413,6 +722,7 @@ udisks_linux_provider_constructed (GObject *object)
   UDisksConfigManager *config_manager;
   GFile *file;
   GError *error = NULL;
+  guint n;
 
   daemon = udisks_provider_get_daemon (UDISKS_PROVIDER (provider));
   config_manager = udisks_daemon_get_config_manager (daemon);
@@ -420,10 +730,28 @@ udisks_linux_provider_constructed (GObject *object)
   /* get ourselves an udev client */
   provider->gudev_client = g_udev_client_new (udev_subsystems);
 
-  provider->probe_request_queue = g_async_queue_new ();
-  provider->probe_request_thread = g_thread_new ("udisks-probing-thread",
-                                                 probe_request_thread_func,
-                                                 provider);
+  provider->uevent_coalesce_window = udisks_config_manager_get_uevent_coalesce_window (config_manager);
+
+  provider->n_probe_workers = CLAMP (g_get_num_processors (), 1, PROBE_WORKERS_MAX);
+  provider->probe_workers = g_new0 (ProbeWorker, provider->n_probe_workers);
+  for (n = 0; n < provider->n_probe_workers; n++)
+    {
+      ProbeWorker *worker = &provider->probe_workers[n];
+      gchar *name;
+
+      worker->queue = g_async_queue_new ();
+      g_queue_init (&worker->deferred);
+      name = g_strdup_printf ("udisks-probing-thread-%u", n);
+      worker->thread = g_thread_new (name, probe_worker_thread_func, worker);
+      g_free (name);
+    }
+
+  provider->housekeeping_pool = udisks_worker_pool_new (housekeeping_drive_func,
+                                                        on_housekeeping_drive_timeout,
+                                                        NULL,
+                                                        housekeeping_item_free,
+                                                        HOUSEKEEPING_WORKERS_MAX,
+                                                        HOUSEKEEPING_DRIVE_TIMEOUT_SECS * 1000);
 
   provider->uevent_monitor_context = g_main_context_new ();
   provider->uevent_monitor_loop = g_main_loop_new (provider->uevent_monitor_context, FALSE);
@@ -555,12 +883,46 @@ udev_device_name_cmp (GUdevDevice *a,
   return device_name_cmp (g_udev_device_get_name (a), g_udev_device_get_name (b));
 }
 
+typedef struct
+{
+  GUdevClient *gudev_client;
+  GUdevDevice **udev_devices;
+  UDisksLinuxDevice **udisks_devices;
+  guint n_pending;
+  GMutex lock;
+  GCond cond;
+} ColdplugProbeData;
+
+/* runs in a thread pool thread, @data is the index of the device + 1 */
+static void
+coldplug_probe_func (gpointer data,
+                     gpointer user_data)
+{
+  ColdplugProbeData *probe_data = user_data;
+  guint n = GPOINTER_TO_UINT (data) - 1;
+
+  probe_data->udisks_devices[n] = udisks_linux_device_new_sync (probe_data->udev_devices[n],
+                                                                probe_data->gudev_client);
+
+  g_mutex_lock (&probe_data->lock);
+  if (--probe_data->n_pending == 0)
+    g_cond_signal (&probe_data->cond);
+  g_mutex_unlock (&probe_data->lock);
+}
+
 static GList *
 get_udisks_devices (UDisksLinuxProvider *provider)
 {
   GList *devices;
   GList *udisks_devices;
   GList *l;
+  ColdplugProbeData probe_data = { 0, };
+  GThreadPool *pool;
+  guint n_devices;
+  guint n;
+  gint64 start_time;
+
+  start_time = g_get_monotonic_time ();
 
   devices = g_udev_client_query_by_subsystem (provider->gudev_client, "block");
   devices = g_list_concat (devices, g_udev_client_query_by_subsystem (provider->gudev_client, "nvme"));
@@ -571,15 +933,48 @@ get_udisks_devices (UDisksLinuxProvider *provider)
   /* make sure to process NVMe subsystems first */
   devices = g_list_concat (g_udev_client_query_by_subsystem (provider->gudev_client, "nvme-subsystem"), devices);
 
-  udisks_devices = NULL;
-  for (l = devices; l != NULL; l = l->next)
+  /* Probing (ATA IDENTIFY, NVMe identify, ...) may take a while for each device,
+   * do it in parallel. The resulting list is in the same order as @devices.
+   */
+  n_devices = g_list_length (devices);
+  probe_data.gudev_client = provider->gudev_client;
+  probe_data.udev_devices = g_new0 (GUdevDevice *, n_devices);
+  probe_data.udisks_devices = g_new0 (UDisksLinuxDevice *, n_devices);
+  g_mutex_init (&probe_data.lock);
+  g_cond_init (&probe_data.cond);
+
+  pool = g_thread_pool_new (coldplug_probe_func, &probe_data,
+                            provider->n_probe_workers, TRUE, NULL);
+  g_mutex_lock (&probe_data.lock);
+  for (l = devices, n = 0; l != NULL; l = l->next, n++)
     {
       GUdevDevice *device = G_UDEV_DEVICE (l->data);
       if (!g_udev_device_get_is_initialized (device))
         continue;
-      udisks_devices = g_list_prepend (udisks_devices, udisks_linux_device_new_sync (device, provider->gudev_client));
+      probe_data.udev_devices[n] = device;
+      probe_data.n_pending++;
+      g_thread_pool_push (pool, GUINT_TO_POINTER (n + 1), NULL);
     }
+  while (probe_data.n_pending > 0)
+    g_cond_wait (&probe_data.cond, &probe_data.lock);
+  g_mutex_unlock (&probe_data.lock);
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  udisks_devices = NULL;
+  for (n = 0; n < n_devices; n++)
+    if (probe_data.udisks_devices[n] != NULL)
+      udisks_devices = g_list_prepend (udisks_devices, probe_data.udisks_devices[n]);
   udisks_devices = g_list_reverse (udisks_devices);
+
+  udisks_info ("Probed %u devices in %.3f seconds using %u threads",
+               g_list_length (udisks_devices),
+               (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC,
+               provider->n_probe_workers);
+
+  g_mutex_clear (&probe_data.lock);
+  g_cond_clear (&probe_data.cond);
+  g_free (probe_data.udev_devices);
+  g_free (probe_data.udisks_devices);
   g_list_free_full (devices, g_object_unref);
 
   return udisks_devices;
@@ -619,6 +1014,7 @@ ensure_modules (UDisksLinuxProvider *provider)
   UDisksModuleManager *module_manager;
   GList *udisks_devices;
   GList *modules;
+  gint64 start_time;
 
   daemon = udisks_provider_get_daemon (UDISKS_PROVIDER (provider));
   module_manager = udisks_daemon_get_module_manager (daemon);
@@ -659,10 +1055,12 @@ ensure_modules (UDisksLinuxProvider *provider)
 
   /* Perform coldplug */
   udisks_debug ("Performing coldplug...");
+  start_time = g_get_monotonic_time ();
   udisks_devices = get_udisks_devices (provider);
   do_coldplug (provider, udisks_devices);
   g_list_free_full (udisks_devices, g_object_unref);
-  udisks_debug ("Coldplug complete");
+  udisks_debug ("Coldplug complete (%.3f seconds)",
+                (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC);
 }
 
 /*
@@ -738,16 +1136,19 @@ udisks_linux_provider_start (UDisksProvider *_provider)
   UDisksDaemon *daemon;
   UDisksManager *manager;
   UDisksManagerNVMe *manager_nvme;
+  UDisksManagerStats *manager_stats;
   UDisksModuleManager *module_manager;
   GList *udisks_devices;
   guint n;
   GDBusConnection *dbus_conn;
+  gint64 start_time;
 
   provider->coldplug = TRUE;
 
   if (UDISKS_PROVIDER_CLASS (udisks_linux_provider_parent_class)->start != NULL)
     UDISKS_PROVIDER_CLASS (udisks_linux_provider_parent_class)->start (_provider);
 
+  g_mutex_lock (&provider->index_lock);
   provider->sysfs_to_block = g_hash_table_new_full (g_str_hash,
                                                     g_str_equal,
                                                     g_free,
@@ -784,6 +1185,11 @@ udisks_linux_provider_start (UDisksProvider *_provider)
                                                      g_str_equal,
                                                      g_free,
                                                      (GDestroyNotify) g_hash_table_unref);
+  provider->nvme_ns_to_ctrls = g_hash_table_new_full (g_str_hash,
+                                                      g_str_equal,
+                                                      g_free,
+                                                      (GDestroyNotify) g_strfreev);
+  g_mutex_unlock (&provider->index_lock);
 
   daemon = udisks_provider_get_daemon (UDISKS_PROVIDER (provider));
 
@@ -794,6 +1200,12 @@ udisks_linux_provider_start (UDisksProvider *_provider)
   manager_nvme = udisks_linux_manager_nvme_new (daemon);
   udisks_object_skeleton_set_manager_nvme (provider->manager_object, manager_nvme);
   g_object_unref (manager_nvme);
+  if (udisks_stats_get_enabled (udisks_daemon_get_stats (daemon)))
+    {
+      manager_stats = udisks_linux_manager_stats_new (daemon);
+      udisks_object_skeleton_set_manager_stats (provider->manager_object, manager_stats);
+      g_object_unref (manager_stats);
+    }
 
   module_manager = udisks_daemon_get_module_manager (daemon);
   g_signal_connect_swapped (module_manager, "modules-activated", G_CALLBACK (ensure_modules), provider);
@@ -803,6 +1215,7 @@ udisks_linux_provider_start (UDisksProvider *_provider)
 
   /* probe for extra data we don't get from udev */
   udisks_info ("Initialization (device probing)");
+  start_time = g_get_monotonic_time ();
   udisks_devices = get_udisks_devices (provider);
 
   /* do two coldplug runs to handle dependencies between devices */
@@ -812,7 +1225,8 @@ udisks_linux_provider_start (UDisksProvider *_provider)
       do_coldplug (provider, udisks_devices);
     }
   g_list_free_full (udisks_devices, g_object_unref);
-  udisks_info ("Initialization complete");
+  udisks_info ("Initialization complete (%.3f seconds)",
+               (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC);
 
   /* schedule housekeeping for every 10 minutes */
   provider->housekeeping_timeout = g_timeout_add_seconds (10*60,
@@ -943,28 +1357,181 @@ udisks_linux_provider_get_coldplug (UDisksLinuxProvider *provider)
   return provider->coldplug;
 }
 
+/**
+ * udisks_linux_provider_get_uevent_stats:
+ * @provider: A #UDisksLinuxProvider.
+ * @out_n_batches: (out) (optional): Return location for the number of uevent batches handled or %NULL.
+ * @out_n_uevents: (out) (optional): Return location for the number of uevents handled or %NULL.
+ * @out_n_coalesced: (out) (optional): Return location for the number of uevents dropped in favor of a later one or %NULL.
+ * @out_max_batch_size: (out) (optional): Return location for the size of the largest batch or %NULL.
+ *
+ * Gets statistics of the uevent coalescing stage, useful for tuning the
+ * <literal>uevent_coalesce_window</literal> configuration option.
+ *
+ * This can be called from any thread.
+ */
+void
+udisks_linux_provider_get_uevent_stats (UDisksLinuxProvider *provider,
+                                        guint64             *out_n_batches,
+                                        guint64             *out_n_uevents,
+                                        guint64             *out_n_coalesced,
+                                        guint               *out_max_batch_size)
+{
+  g_return_if_fail (UDISKS_IS_LINUX_PROVIDER (provider));
+
+  g_mutex_lock (&provider->pending_lock);
+  if (out_n_batches != NULL)
+    *out_n_batches = provider->n_uevent_batches;
+  if (out_n_uevents != NULL)
+    *out_n_uevents = provider->n_uevents_handled;
+  if (out_n_coalesced != NULL)
+    *out_n_coalesced = provider->n_uevents_coalesced;
+  if (out_max_batch_size != NULL)
+    *out_max_batch_size = provider->max_uevent_batch_size;
+  g_mutex_unlock (&provider->pending_lock);
+}
+
+/**
+ * udisks_linux_provider_find_drive_object:
+ * @provider: A #UDisksLinuxProvider.
+ * @sysfs_path: The sysfs path of a device backing the drive.
+ *
+ * Looks up the drive object that @sysfs_path (a whole-disk block
+ * device or a NVMe controller) belongs to. This is a thread-safe
+ * hash table lookup and may be called with or without the provider
+ * processing an uevent.
+ *
+ * Returns: (transfer full) (nullable): A #UDisksLinuxDriveObject or
+ *   %NULL if not found. Free with g_object_unref().
+ */
+UDisksLinuxDriveObject *
+udisks_linux_provider_find_drive_object (UDisksLinuxProvider *provider,
+                                         const gchar         *sysfs_path)
+{
+  UDisksLinuxDriveObject *ret = NULL;
+
+  g_return_val_if_fail (UDISKS_IS_LINUX_PROVIDER (provider), NULL);
+
+  if (sysfs_path == NULL)
+    return NULL;
+
+  g_mutex_lock (&provider->index_lock);
+  if (provider->sysfs_path_to_drive != NULL)
+    ret = g_hash_table_lookup (provider->sysfs_path_to_drive, sysfs_path);
+  if (ret != NULL)
+    g_object_ref (ret);
+  g_mutex_unlock (&provider->index_lock);
+
+  return ret;
+}
+
+/**
+ * udisks_linux_provider_find_mdraid_object:
+ * @provider: A #UDisksLinuxProvider.
+ * @uuid: The UUID of a MD RAID array.
+ *
+ * Looks up the MD RAID object for the array with @uuid. This is a
+ * thread-safe hash table lookup.
+ *
+ * Returns: (transfer full) (nullable): A #UDisksLinuxMDRaidObject or
+ *   %NULL if not found. Free with g_object_unref().
+ */
+UDisksLinuxMDRaidObject *
+udisks_linux_provider_find_mdraid_object (UDisksLinuxProvider *provider,
+                                          const gchar         *uuid)
+{
+  UDisksLinuxMDRaidObject *ret = NULL;
+
+  g_return_val_if_fail (UDISKS_IS_LINUX_PROVIDER (provider), NULL);
+
+  if (uuid == NULL)
+    return NULL;
+
+  g_mutex_lock (&provider->index_lock);
+  if (provider->uuid_to_mdraid != NULL)
+    ret = g_hash_table_lookup (provider->uuid_to_mdraid, uuid);
+  if (ret != NULL)
+    g_object_ref (ret);
+  g_mutex_unlock (&provider->index_lock);
+
+  return ret;
+}
+
+/**
+ * udisks_linux_provider_dup_nvme_ctrls_for_ns:
+ * @provider: A #UDisksLinuxProvider.
+ * @ns_sysfs_path: The sysfs path of a NVMe namespace block device.
+ * @subsysnqn: The NQN of the NVMe subsystem the namespace belongs to.
+ *
+ * Gets sysfs paths of the NVMe controllers providing the namespace.
+ * The result of the sysfs scan is kept until a NVMe controller uevent
+ * or removal of the namespace is seen.
+ *
+ * Returns: (transfer full) (nullable): A %NULL-terminated array of
+ *   sysfs paths or %NULL if no controller was found. Free with g_strfreev().
+ */
+gchar **
+udisks_linux_provider_dup_nvme_ctrls_for_ns (UDisksLinuxProvider *provider,
+                                             const gchar         *ns_sysfs_path,
+                                             const gchar         *subsysnqn)
+{
+  gchar **ctrls = NULL;
+  gboolean found = FALSE;
+  guint generation;
+
+  g_return_val_if_fail (UDISKS_IS_LINUX_PROVIDER (provider), NULL);
+  g_return_val_if_fail (ns_sysfs_path != NULL, NULL);
+
+  g_mutex_lock (&provider->index_lock);
+  if (provider->nvme_ns_to_ctrls != NULL)
+    found = g_hash_table_lookup_extended (provider->nvme_ns_to_ctrls, ns_sysfs_path, NULL, (gpointer *) &ctrls);
+  ctrls = g_strdupv (ctrls);
+  generation = provider->nvme_ns_to_ctrls_generation;
+  g_mutex_unlock (&provider->index_lock);
+
+  if (found)
+    return ctrls;
+
+  /* not cached, scan sysfs without holding the lock */
+  ctrls = bd_nvme_find_ctrls_for_ns (ns_sysfs_path, subsysnqn, NULL, NULL, NULL);
+
+  g_mutex_lock (&provider->index_lock);
+  /* don't cache the result if the controllers changed in the meantime */
+  if (provider->nvme_ns_to_ctrls != NULL && generation == provider->nvme_ns_to_ctrls_generation)
+    g_hash_table_replace (provider->nvme_ns_to_ctrls, g_strdup (ns_sysfs_path), g_strdupv (ctrls));
+  g_mutex_unlock (&provider->index_lock);
+
+  return ctrls;
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* called with lock held - all modifications of the lookup maps go through these
+ * so that the udisks_linux_provider_find_*() functions may be used without it */
+
 static void
-perform_initial_housekeeping_for_drive (GTask           *task,
-                                        gpointer         source_object,
-                                        gpointer         task_data,
-                                        GCancellable    *cancellable)
+index_insert (UDisksLinuxProvider *provider,
+              GHashTable          *table,
+              const gchar         *key,
+              gpointer             value)
 {
-  UDisksLinuxDriveObject *object = UDISKS_LINUX_DRIVE_OBJECT (source_object);
-  GError *error;
+  g_mutex_lock (&provider->index_lock);
+  g_hash_table_insert (table, g_strdup (key), value);
+  g_mutex_unlock (&provider->index_lock);
+}
 
-  error = NULL;
-  if (!udisks_linux_drive_object_housekeeping (object, 0,
-                                               NULL, /* TODO: cancellable */
-                                               &error))
-    {
-      udisks_warning ("Error performing initial housekeeping for drive %s: %s (%s, %d)",
-                      g_dbus_object_get_object_path (G_DBUS_OBJECT (object)),
-                      error->message, g_quark_to_string (error->domain), error->code);
-      g_clear_error (&error);
-    }
-  g_task_return_boolean (task, TRUE);
+static gboolean
+index_remove (UDisksLinuxProvider *provider,
+              GHashTable          *table,
+              const gchar         *key)
+{
+  gboolean ret;
+
+  g_mutex_lock (&provider->index_lock);
+  ret = g_hash_table_remove (table, key);
+  g_mutex_unlock (&provider->index_lock);
+
+  return ret;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -987,7 +1554,7 @@ maybe_remove_mdraid_object (UDisksLinuxProvider     *provider,
   object_uuid = g_strdup (udisks_linux_mdraid_object_get_uuid (object));
   g_dbus_object_manager_server_unexport (udisks_daemon_get_object_manager (daemon),
                                          g_dbus_object_get_object_path (G_DBUS_OBJECT (object)));
-  g_warn_if_fail (g_hash_table_remove (provider->uuid_to_mdraid, object_uuid));
+  g_warn_if_fail (index_remove (provider, provider->uuid_to_mdraid, object_uuid));
 
  out:
   g_free (object_uuid);
@@ -1033,7 +1600,7 @@ handle_block_uevent_for_mdraid_with_uuid (UDisksLinuxProvider *provider,
       if (object != NULL)
         {
           udisks_linux_mdraid_object_uevent (object, action, device, TRUE /* is_member */);
-          g_warn_if_fail (g_hash_table_remove (provider->sysfs_path_to_mdraid_members, sysfs_path));
+          g_warn_if_fail (index_remove (provider, provider->sysfs_path_to_mdraid_members, sysfs_path));
           maybe_remove_mdraid_object (provider, object);
         }
 
@@ -1042,7 +1609,7 @@ handle_block_uevent_for_mdraid_with_uuid (UDisksLinuxProvider *provider,
       if (object != NULL)
         {
           udisks_linux_mdraid_object_uevent (object, action, device, FALSE /* is_member */);
-          g_warn_if_fail (g_hash_table_remove (provider->sysfs_path_to_mdraid, sysfs_path));
+          g_warn_if_fail (index_remove (provider, provider->sysfs_path_to_mdraid, sysfs_path));
           maybe_remove_mdraid_object (provider, object);
         }
     }
@@ -1057,12 +1624,12 @@ handle_block_uevent_for_mdraid_with_uuid (UDisksLinuxProvider *provider,
           if (is_member)
             {
               if (g_hash_table_lookup (provider->sysfs_path_to_mdraid_members, sysfs_path) == NULL)
-                g_hash_table_insert (provider->sysfs_path_to_mdraid_members, g_strdup (sysfs_path), object);
+                index_insert (provider, provider->sysfs_path_to_mdraid_members, sysfs_path, object);
             }
           else
             {
               if (g_hash_table_lookup (provider->sysfs_path_to_mdraid, sysfs_path) == NULL)
-                g_hash_table_insert (provider->sysfs_path_to_mdraid, g_strdup (sysfs_path), object);
+                index_insert (provider, provider->sysfs_path_to_mdraid, sysfs_path, object);
             }
           udisks_linux_mdraid_object_uevent (object, action, device, is_member);
         }
@@ -1072,11 +1639,11 @@ handle_block_uevent_for_mdraid_with_uuid (UDisksLinuxProvider *provider,
           udisks_linux_mdraid_object_uevent (object, action, device, is_member);
           g_dbus_object_manager_server_export_uniquely (udisks_daemon_get_object_manager (daemon),
                                                         G_DBUS_OBJECT_SKELETON (object));
-          g_hash_table_insert (provider->uuid_to_mdraid, g_strdup (uuid), object);
+          index_insert (provider, provider->uuid_to_mdraid, uuid, object);
           if (is_member)
-            g_hash_table_insert (provider->sysfs_path_to_mdraid_members, g_strdup (sysfs_path), object);
+            index_insert (provider, provider->sysfs_path_to_mdraid_members, sysfs_path, object);
           else
-            g_hash_table_insert (provider->sysfs_path_to_mdraid, g_strdup (sysfs_path), object);
+            index_insert (provider, provider->sysfs_path_to_mdraid, sysfs_path, object);
         }
     }
 
@@ -1122,7 +1689,6 @@ handle_block_uevent_for_drive (UDisksLinuxProvider *provider,
 {
   UDisksLinuxDriveObject *object;
   UDisksDaemon *daemon;
-  GTask *task;
   const gchar *sysfs_path;
   gchar *vpd;
 
@@ -1139,7 +1705,7 @@ handle_block_uevent_for_drive (UDisksLinuxProvider *provider,
 
           udisks_linux_drive_object_uevent (object, action, device);
 
-          g_warn_if_fail (g_hash_table_remove (provider->sysfs_path_to_drive, sysfs_path));
+          g_warn_if_fail (index_remove (provider, provider->sysfs_path_to_drive, sysfs_path));
 
           devices = udisks_linux_drive_object_get_devices (object);
           if (devices == NULL)
@@ -1148,7 +1714,7 @@ handle_block_uevent_for_drive (UDisksLinuxProvider *provider,
               existing_vpd = g_object_get_data (G_OBJECT (object), "x-vpd");
               g_dbus_object_manager_server_unexport (udisks_daemon_get_object_manager (daemon),
                                                      g_dbus_object_get_object_path (G_DBUS_OBJECT (object)));
-              g_warn_if_fail (g_hash_table_remove (provider->vpd_to_drive, existing_vpd));
+              g_warn_if_fail (index_remove (provider, provider->vpd_to_drive, existing_vpd));
             }
           g_list_free_full (devices, g_object_unref);
         }
@@ -1168,7 +1734,7 @@ handle_block_uevent_for_drive (UDisksLinuxProvider *provider,
       if (object != NULL)
         {
           if (g_hash_table_lookup (provider->sysfs_path_to_drive, sysfs_path) == NULL)
-            g_hash_table_insert (provider->sysfs_path_to_drive, g_strdup (sysfs_path), object);
+            index_insert (provider, provider->sysfs_path_to_drive, sysfs_path, object);
           udisks_linux_drive_object_uevent (object, action, device);
         }
       else
@@ -1181,15 +1747,13 @@ handle_block_uevent_for_drive (UDisksLinuxProvider *provider,
                   g_object_set_data_full (G_OBJECT (object), "x-vpd", g_strdup (vpd), g_free);
                   g_dbus_object_manager_server_export_uniquely (udisks_daemon_get_object_manager (daemon),
                                                                 G_DBUS_OBJECT_SKELETON (object));
-                  g_hash_table_insert (provider->vpd_to_drive, g_strdup (vpd), object);
-                  g_hash_table_insert (provider->sysfs_path_to_drive, g_strdup (sysfs_path), object);
+                  index_insert (provider, provider->vpd_to_drive, vpd, object);
+                  index_insert (provider, provider->sysfs_path_to_drive, sysfs_path, object);
 
                   /* schedule initial housekeeping for the drive unless coldplugging */
                   if (!provider->coldplug)
                     {
-                      task = g_task_new (object, NULL, NULL, NULL);
-                      g_task_run_in_thread (task, perform_initial_housekeeping_for_drive);
-                      g_object_unref (task);
+                      schedule_drive_housekeeping (provider, object, 0, 0);
                     }
                 }
             }
@@ -1468,9 +2032,10 @@ handle_block_uevent_for_block (UDisksLinuxProvider *provider,
            *       the block object may never get freed.
            */
           block_pre_remove (provider, object);
+          udisks_daemon_unindex_block_object (daemon, UDISKS_OBJECT (object));
           g_dbus_object_manager_server_unexport (udisks_daemon_get_object_manager (daemon),
                                                  g_dbus_object_get_object_path (G_DBUS_OBJECT (object)));
-          g_warn_if_fail (g_hash_table_remove (provider->sysfs_to_block, sysfs_path));
+          g_warn_if_fail (index_remove (provider, provider->sysfs_to_block, sysfs_path));
         }
     }
   else
@@ -1485,8 +2050,10 @@ handle_block_uevent_for_block (UDisksLinuxProvider *provider,
           object = udisks_linux_block_object_new (daemon, device);
           g_dbus_object_manager_server_export_uniquely (udisks_daemon_get_object_manager (daemon),
                                                         G_DBUS_OBJECT_SKELETON (object));
-          g_hash_table_insert (provider->sysfs_to_block, g_strdup (sysfs_path), object);
+          index_insert (provider, provider->sysfs_to_block, sysfs_path, object);
         }
+      /* device file, symlinks or the device number might have changed */
+      udisks_daemon_index_block_object (daemon, UDISKS_OBJECT (object));
     }
 }
 
@@ -1623,6 +2190,32 @@ handle_block_uevent_for_modules (UDisksLinuxProvider *provider,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* called with lock held */
+static void
+invalidate_nvme_ctrls (UDisksLinuxProvider *provider,
+                       UDisksUeventAction   action,
+                       UDisksLinuxDevice   *device)
+{
+  const gchar *subsystem;
+
+  subsystem = g_udev_device_get_subsystem (device->udev_device);
+
+  g_mutex_lock (&provider->index_lock);
+  if (g_strcmp0 (subsystem, "nvme") == 0)
+    {
+      /* a controller appeared, went away or had its namespaces changed */
+      g_hash_table_remove_all (provider->nvme_ns_to_ctrls);
+      provider->nvme_ns_to_ctrls_generation++;
+    }
+  else if (action == UDISKS_UEVENT_ACTION_REMOVE)
+    {
+      g_hash_table_remove (provider->nvme_ns_to_ctrls,
+                           g_udev_device_get_sysfs_path (device->udev_device));
+      provider->nvme_ns_to_ctrls_generation++;
+    }
+  g_mutex_unlock (&provider->index_lock);
+}
+
 /* called with lock held */
 static void
 handle_block_uevent (UDisksLinuxProvider *provider,
@@ -1638,6 +2231,8 @@ handle_block_uevent (UDisksLinuxProvider *provider,
    * objects. Ensure that drive and mdraid objects are added before
    * and removed after block objects.
    */
+  invalidate_nvme_ctrls (provider, action, device);
+
   if (action == UDISKS_UEVENT_ACTION_REMOVE)
     {
       handle_block_uevent_for_block (provider, action, device);
@@ -1669,8 +2264,12 @@ handle_block_uevent (UDisksLinuxProvider *provider,
 
   if (action != UDISKS_UEVENT_ACTION_ADD)
     {
-      /* Possibly need to clean up */
-      udisks_state_check (udisks_daemon_get_state (udisks_provider_get_daemon (UDISKS_PROVIDER (provider))));
+      dev_t dev;
+
+      /* Possibly need to clean up - only entries related to this device */
+      dev = g_udev_device_get_device_number (device->udev_device);
+      if (dev != 0)
+        udisks_state_check_device (udisks_daemon_get_state (udisks_provider_get_daemon (UDISKS_PROVIDER (provider))), dev);
     }
 }
 
@@ -1727,7 +2326,102 @@ udisks_linux_provider_handle_uevent (UDisksLinuxProvider *provider,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
-/* Runs in housekeeping thread - called without lock held */
+typedef struct
+{
+  UDisksLinuxProvider *provider;
+  UDisksLinuxDriveObject *object;
+  guint secs_since_last;
+} HousekeepingItem;
+
+static void
+housekeeping_item_free (gpointer data)
+{
+  HousekeepingItem *item = data;
+
+  g_object_unref (item->object);
+  g_object_unref (item->provider);
+  g_free (item);
+}
+
+/* called in the main thread when housekeeping of a drive takes too long */
+static void
+on_housekeeping_drive_timeout (gpointer data,
+                               gpointer user_data)
+{
+  HousekeepingItem *item = data;
+
+  udisks_warning ("Housekeeping for drive %s did not complete within %d seconds, cancelled",
+                  g_dbus_object_get_object_path (G_DBUS_OBJECT (item->object)),
+                  HOUSEKEEPING_DRIVE_TIMEOUT_SECS);
+}
+
+/* Runs in one of the housekeeping pool threads - called without lock held
+ *
+ * A drive that doesn't respond must not hold up the others - libblockdev
+ * calls can't be interrupted but the drive object bails out at the next
+ * cancellation point and refuses to run again until the hung call returns.
+ * Meanwhile the pool runs another thread in place of this one.
+ */
+static void
+housekeeping_drive_func (gpointer      data,
+                         GCancellable *cancellable,
+                         gpointer      user_data)
+{
+  HousekeepingItem *item = data;
+  UDisksStats *stats;
+  gint64 start_time;
+  GError *error = NULL;
+
+  stats = udisks_daemon_get_stats (udisks_provider_get_daemon (UDISKS_PROVIDER (item->provider)));
+  start_time = udisks_stats_start (stats);
+  if (!udisks_linux_drive_object_housekeeping (item->object,
+                                               item->secs_since_last,
+                                               cancellable,
+                                               &error))
+    {
+      udisks_warning ("Error performing housekeeping for drive %s: %s (%s, %d)",
+                      g_dbus_object_get_object_path (G_DBUS_OBJECT (item->object)),
+                      error->message, g_quark_to_string (error->domain), error->code);
+      g_clear_error (&error);
+    }
+  udisks_stats_finish (stats, UDISKS_STATS_HISTOGRAM_HOUSEKEEPING, start_time);
+}
+
+/* called in the main thread once the jitter delay of a drive expires */
+static gboolean
+on_housekeeping_item_due (gpointer user_data)
+{
+  HousekeepingItem *item = user_data;
+
+  udisks_worker_pool_push (item->provider->housekeeping_pool, item);
+  return G_SOURCE_REMOVE;
+}
+
+/* Can be called from any thread, with or without lock held
+ *
+ * Queues housekeeping of @object in the housekeeping pool, after a
+ * random delay of up to @jitter_msec milliseconds.
+ */
+static void
+schedule_drive_housekeeping (UDisksLinuxProvider    *provider,
+                             UDisksLinuxDriveObject *object,
+                             guint                   secs_since_last,
+                             guint                   jitter_msec)
+{
+  HousekeepingItem *item;
+
+  item = g_new0 (HousekeepingItem, 1);
+  item->provider = g_object_ref (provider);
+  item->object = g_object_ref (object);
+  item->secs_since_last = secs_since_last;
+
+  if (jitter_msec > 0)
+    g_timeout_add (g_random_int_range (0, jitter_msec), on_housekeeping_item_due, item);
+  else
+    udisks_worker_pool_push (provider->housekeeping_pool, item);
+}
+
+/* Runs in the main thread - called without lock held */
 static void
 housekeeping_all_drives (UDisksLinuxProvider *provider,
                          guint                secs_since_last)
@@ -1740,23 +2434,12 @@ housekeeping_all_drives (UDisksLinuxProvider *provider,
   g_list_foreach (objects, (GFunc) udisks_g_object_ref_foreach, NULL);
   G_UNLOCK (provider_lock);
 
+  /* don't jitter the initial run, the drives are waiting for their SMART data */
   for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksLinuxDriveObject *object = UDISKS_LINUX_DRIVE_OBJECT (l->data);
-      GError *error;
-
-      error = NULL;
-      if (!udisks_linux_drive_object_housekeeping (object,
-                                                   secs_since_last,
-                                                   NULL, /* TODO: cancellable */
-                                                   &error))
-        {
-          udisks_warning ("Error performing housekeeping for drive %s: %s (%s, %d)",
-                          g_dbus_object_get_object_path (G_DBUS_OBJECT (object)),
-                          error->message, g_quark_to_string (error->domain), error->code);
-          g_clear_error (&error);
-        }
-    }
+    schedule_drive_housekeeping (provider,
+                                 UDISKS_LINUX_DRIVE_OBJECT (l->data),
+                                 secs_since_last,
+                                 provider->housekeeping_last > 0 ? HOUSEKEEPING_JITTER_MSEC : 0);
 
   g_list_free_full (objects, g_object_unref);
 }
@@ -1812,23 +2495,9 @@ housekeeping_thread_func (GTask           *task,
                           GCancellable    *cancellable)
 {
   UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (source_object);
-  guint secs_since_last;
-  guint64 now;
-
-  /* TODO: probably want some kind of timeout here to avoid faulty devices/drives blocking forever */
-
-  secs_since_last = 0;
-  now = time (NULL);
-  if (provider->housekeeping_last > 0)
-    secs_since_last = now - provider->housekeeping_last;
-  provider->housekeeping_last = now;
-
-  udisks_info ("Housekeeping initiated (%u seconds since last housekeeping)", secs_since_last);
 
-  housekeeping_all_drives (provider, secs_since_last);
-  housekeeping_all_modules (provider, secs_since_last);
+  housekeeping_all_modules (provider, GPOINTER_TO_UINT (task_data));
 
-  udisks_info ("Housekeeping complete");
   G_LOCK (provider_lock);
   provider->housekeeping_running = FALSE;
   G_UNLOCK (provider_lock);
@@ -1840,13 +2509,28 @@ static gboolean
 on_housekeeping_timeout (gpointer user_data)
 {
   UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (user_data);
+  guint secs_since_last;
+  guint64 now;
   GTask *task;
 
+  secs_since_last = 0;
+  now = time (NULL);
+  if (provider->housekeeping_last > 0)
+    secs_since_last = now - provider->housekeeping_last;
+
+  udisks_info ("Housekeeping initiated (%u seconds since last housekeeping)", secs_since_last);
+
+  /* drives are refreshed in parallel, each on its own schedule */
+  housekeeping_all_drives (provider, secs_since_last);
+  provider->housekeeping_last = now;
+
+  /* modules are run serially in a separate thread, unless still busy from the last time */
   G_LOCK (provider_lock);
   if (provider->housekeeping_running)
     goto out;
   provider->housekeeping_running = TRUE;
   task = g_task_new (provider, NULL, NULL, NULL);
+  g_task_set_task_data (task, GUINT_TO_POINTER (secs_since_last), NULL);
   g_task_run_in_thread (task, housekeeping_thread_func);
   g_object_unref (task);
 
@@ -1901,6 +2585,7 @@ mount_monitor_on_mountpoints_changed (GUnixMountMonitor *monitor,
 {
   UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (user_data);
   /* TODO: compare differences and only update relevant objects */
+  udisks_linux_block_invalidate_etctabs ();
   update_block_objects (provider, NULL);
 }
 
@@ -1910,6 +2595,9 @@ crypttab_monitor_on_entry_added (UDisksCrypttabMonitor *monitor,
                                  gpointer               user_data)
 {
   UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (user_data);
+  /* The cache is keyed by the stat() data of /etc/crypttab, which may have
+   * been picked up before the monitor reloaded the entries. */
+  udisks_linux_block_invalidate_etctabs ();
   update_block_objects (provider, NULL);
 }
 
@@ -1919,6 +2607,7 @@ crypttab_monitor_on_entry_removed (UDisksCrypttabMonitor *monitor,
                                    gpointer               user_data)
 {
   UDisksLinuxProvider *provider = UDISKS_LINUX_PROVIDER (user_data);
+  udisks_linux_block_invalidate_etctabs ();
   update_block_objects (provider, NULL);
 }
 
@@ -34,6 +34,19 @@ GType                  udisks_linux_provider_get_type        (void) G_GNUC_CONST
 UDisksLinuxProvider   *udisks_linux_provider_new             (UDisksDaemon        *daemon);
 GUdevClient           *udisks_linux_provider_get_udev_client (UDisksLinuxProvider *provider);
 gboolean               udisks_linux_provider_get_coldplug    (UDisksLinuxProvider *provider);
+void                   udisks_linux_provider_get_uevent_stats (UDisksLinuxProvider *provider,
+                                                               guint64             *out_n_batches,
+                                                               guint64             *out_n_uevents,
+                                                               guint64             *out_n_coalesced,
+                                                               guint               *out_max_batch_size);
+
+UDisksLinuxDriveObject  *udisks_linux_provider_find_drive_object     (UDisksLinuxProvider *provider,
+                                                                      const gchar         *sysfs_path);
+UDisksLinuxMDRaidObject *udisks_linux_provider_find_mdraid_object    (UDisksLinuxProvider *provider,
+                                                                      const gchar         *uuid);
+gchar                  **udisks_linux_provider_dup_nvme_ctrls_for_ns (UDisksLinuxProvider *provider,
+                                                                      const gchar         *ns_sysfs_path,
+                                                                      const gchar         *subsysnqn);
 
 void                   udisks_linux_provider_trigger_nvme_subsystem_uevent (UDisksLinuxProvider *provider,
                                                                             const gchar         *subsys_nqn,
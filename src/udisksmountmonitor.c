@@ -29,6 +29,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <mntent.h>
 
 #include <glib.h>
@@ -56,6 +59,8 @@
  * <literal>/proc/swaps</literal> files.
  */
 
+typedef struct _MountsSnapshot MountsSnapshot;
+
 /**
  * UDisksMountMonitor:
  *
@@ -72,16 +77,53 @@ struct _UDisksMountMonitor
   GIOChannel *swaps_channel;
   GSource *swaps_watch_source;
 
-  GList *mounts;
-  GList *old_mounts;
-  GMutex mounts_mutex;
+  /* private descriptors only used for checking whether the files changed
+   * since they were last read, see proc_file_changed() */
+  gint mountinfo_fd;
+  gint swaps_fd;
+  gboolean have_mountinfo;
+  gboolean have_swaps;
 
-  gchar *mountinfo_checksum;
-  gchar *swaps_checksum;
+  GMutex mounts_mutex;
+  guint64 generation;           /* bumped whenever the set of mounts changes */
+  GHashTable *mounts;           /* UDisksMount -> number of mountinfo lines or swaps referring to it */
+  GHashTable *mountinfo_lines;  /* mount ID -> MountInfoLine */
+  GPtrArray *mountinfo_order;   /* MountInfoLine objects in the order of /proc/self/mountinfo */
+  GList *swaps;                 /* UDisksMount objects (owned by @mounts) for /proc/swaps */
+  gchar *swaps_contents;
+  GPtrArray *pending;           /* mounts that may have been added or removed since last reload_mounts() */
+  MountsSnapshot *snapshot;     /* current state for lookups, replaced (never modified) on changes */
+  gint snapshot_readers;        /* lookups between fetching @snapshot and taking a reference to it */
+
+  /* only used from the monitor_context */
+  GHashTable *announced;        /* mounts that ::mount-added has been emitted for */
 
   GMainContext *monitor_context;
 };
 
+typedef struct
+{
+  gchar *line;
+  UDisksMount *mount;           /* owned by @mounts, %NULL if the line is not of interest */
+} MountInfoLine;
+
+/* Immutable view of the mounts at a given generation. Lookups take a
+ * reference to the current snapshot without taking the mounts_mutex and
+ * then work on it, see udisks_mount_monitor_dup_snapshot().
+ */
+struct _MountsSnapshot
+{
+  guint64 generation;
+  GHashTable *by_dev;           /* dev_t -> DevMounts */
+  GHashTable *by_path;          /* mount path -> topmost UDisksMount mounted there (owned by @by_dev) */
+};
+
+typedef struct
+{
+  guint64 dev;
+  GPtrArray *mounts;            /* UDisksMount objects sorted by udisks_mount_compare() */
+} DevMounts;
+
 typedef struct _UDisksMountMonitorClass UDisksMountMonitorClass;
 
 struct _UDisksMountMonitorClass
@@ -110,10 +152,67 @@ G_DEFINE_TYPE (UDisksMountMonitor, udisks_mount_monitor, G_TYPE_OBJECT)
 static void udisks_mount_monitor_ensure (UDisksMountMonitor *monitor);
 static void udisks_mount_monitor_constructed (GObject *object);
 
+static guint
+mount_hash (gconstpointer key)
+{
+  UDisksMount *mount = UDISKS_MOUNT (key);
+  guint64 dev = udisks_mount_get_dev (mount);
+  guint ret;
+
+  ret = (guint) (dev ^ (dev >> 32)) ^ udisks_mount_get_mount_type (mount);
+  if (udisks_mount_get_mount_type (mount) == UDISKS_MOUNT_TYPE_FILESYSTEM)
+    ret ^= g_str_hash (udisks_mount_get_mount_path (mount));
+
+  return ret;
+}
+
+static gboolean
+mount_equal (gconstpointer a,
+             gconstpointer b)
+{
+  return udisks_mount_compare (UDISKS_MOUNT (a), UDISKS_MOUNT (b)) == 0;
+}
+
+static void
+mount_info_line_free (MountInfoLine *info_line)
+{
+  g_free (info_line->line);
+  g_free (info_line);
+}
+
+static void
+dev_mounts_free (DevMounts *dev_mounts)
+{
+  g_ptr_array_unref (dev_mounts->mounts);
+  g_free (dev_mounts);
+}
+
+static void
+mounts_snapshot_clear (MountsSnapshot *snapshot)
+{
+  g_hash_table_destroy (snapshot->by_path);
+  g_hash_table_destroy (snapshot->by_dev);
+}
+
+static void
+mounts_snapshot_unref (MountsSnapshot *snapshot)
+{
+  g_atomic_rc_box_release_full (snapshot, (GDestroyNotify) mounts_snapshot_clear);
+}
+
+static gint
+compare_mounts_ptr (gconstpointer a,
+                    gconstpointer b)
+{
+  return udisks_mount_compare (*((UDisksMount **) a), *((UDisksMount **) b));
+}
+
 static void
 udisks_mount_monitor_finalize (GObject *object)
 {
   UDisksMountMonitor *monitor = UDISKS_MOUNT_MONITOR (object);
+  GHashTableIter iter;
+  gpointer key;
 
   if (monitor->mounts_channel != NULL)
     g_io_channel_unref (monitor->mounts_channel);
@@ -128,11 +227,23 @@ udisks_mount_monitor_finalize (GObject *object)
   if (monitor->monitor_context != NULL)
     g_main_context_unref (monitor->monitor_context);
 
-  g_list_free_full (monitor->mounts, g_object_unref);
-  g_list_free_full (monitor->old_mounts, g_object_unref);
-
-  g_free (monitor->mountinfo_checksum);
-  g_free (monitor->swaps_checksum);
+  if (monitor->mountinfo_fd >= 0)
+    close (monitor->mountinfo_fd);
+  if (monitor->swaps_fd >= 0)
+    close (monitor->swaps_fd);
+
+  g_clear_pointer (&monitor->snapshot, mounts_snapshot_unref);
+  g_ptr_array_unref (monitor->mountinfo_order);
+  g_hash_table_destroy (monitor->mountinfo_lines);
+  g_list_free (monitor->swaps);
+  g_free (monitor->swaps_contents);
+  /* the keys hold the references */
+  g_hash_table_iter_init (&iter, monitor->mounts);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    g_object_unref (key);
+  g_hash_table_destroy (monitor->mounts);
+  g_ptr_array_unref (monitor->pending);
+  g_hash_table_destroy (monitor->announced);
 
   g_mutex_clear (&monitor->mounts_mutex);
 
@@ -143,9 +254,16 @@ udisks_mount_monitor_finalize (GObject *object)
 static void
 udisks_mount_monitor_init (UDisksMountMonitor *monitor)
 {
-  monitor->mounts = NULL;
-  monitor->old_mounts = NULL;
+  monitor->mountinfo_fd = -1;
+  monitor->swaps_fd = -1;
   g_mutex_init (&monitor->mounts_mutex);
+  /* no key_destroy_func, the references are managed in mount_ref()/mount_unref() */
+  monitor->mounts = g_hash_table_new (mount_hash, mount_equal);
+  monitor->mountinfo_lines = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                    NULL, (GDestroyNotify) mount_info_line_free);
+  monitor->mountinfo_order = g_ptr_array_new ();
+  monitor->pending = g_ptr_array_new_with_free_func (g_object_unref);
+  monitor->announced = g_hash_table_new_full (mount_hash, mount_equal, g_object_unref, NULL);
 }
 
 static void
@@ -202,83 +320,56 @@ udisks_mount_monitor_class_init (UDisksMountMonitorClass *klass)
 }
 
 static void
-diff_sorted_lists (GList *list1,
-                   GList *list2,
-                   GCompareFunc compare,
-                   GList **added,
-                   GList **removed)
+reload_mounts (UDisksMountMonitor *monitor)
 {
-  int order;
+  GPtrArray *pending;
+  GPtrArray *added;
+  GPtrArray *removed;
+  guint n;
 
-  *added = *removed = NULL;
+  udisks_mount_monitor_ensure (monitor);
+
+  added = g_ptr_array_new_with_free_func (g_object_unref);
+  removed = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_mutex_lock (&monitor->mounts_mutex);
+  pending = monitor->pending;
+  monitor->pending = g_ptr_array_new_with_free_func (g_object_unref);
 
-  while (list1 != NULL && list2 != NULL)
+  /* Only the mounts touched since the last run need to be checked. A mount
+   * that came and went in the meantime is neither added nor removed.
+   */
+  for (n = 0; n < pending->len; n++)
     {
-      order = (*compare) (list1->data, list2->data);
-      if (order < 0)
+      UDisksMount *mount = UDISKS_MOUNT (pending->pdata[n]);
+      gboolean present;
+      gpointer announced_mount;
+
+      present = g_hash_table_contains (monitor->mounts, mount);
+      if (g_hash_table_steal_extended (monitor->announced, mount, &announced_mount, NULL))
         {
-          *removed = g_list_prepend (*removed, list1->data);
-          list1 = list1->next;
+          if (present)
+            g_hash_table_add (monitor->announced, announced_mount);
+          else
+            g_ptr_array_add (removed, announced_mount);
         }
-      else if (order > 0)
+      else if (present)
         {
-          *added = g_list_prepend (*added, list2->data);
-          list2 = list2->next;
-        }
-      else
-        { /* same item */
-          list1 = list1->next;
-          list2 = list2->next;
+          g_hash_table_add (monitor->announced, g_object_ref (mount));
+          g_ptr_array_add (added, g_object_ref (mount));
         }
     }
-
-  while (list1 != NULL)
-    {
-      *removed = g_list_prepend (*removed, list1->data);
-      list1 = list1->next;
-    }
-  while (list2 != NULL)
-    {
-      *added = g_list_prepend (*added, list2->data);
-      list2 = list2->next;
-    }
-}
-
-static void
-reload_mounts (UDisksMountMonitor *monitor)
-{
-  GList *cur_mounts;
-  GList *added;
-  GList *removed;
-  GList *l;
-  GList *old_mounts;
-
-  udisks_mount_monitor_ensure (monitor);
-
-  g_mutex_lock (&monitor->mounts_mutex);
-  cur_mounts = g_list_copy_deep (monitor->mounts, (GCopyFunc) udisks_g_object_ref_copy, NULL);
-  cur_mounts = g_list_sort (cur_mounts, (GCompareFunc) udisks_mount_compare);
-  old_mounts = monitor->old_mounts;
-  monitor->old_mounts = cur_mounts;
   g_mutex_unlock (&monitor->mounts_mutex);
 
-  diff_sorted_lists (old_mounts, cur_mounts, (GCompareFunc) udisks_mount_compare, &added, &removed);
+  for (n = 0; n < removed->len; n++)
+    g_signal_emit (monitor, signals[MOUNT_REMOVED_SIGNAL], 0, UDISKS_MOUNT (removed->pdata[n]));
 
-  for (l = removed; l != NULL; l = l->next)
-    {
-      UDisksMount *mount = UDISKS_MOUNT (l->data);
-      g_signal_emit (monitor, signals[MOUNT_REMOVED_SIGNAL], 0, mount);
-    }
-
-  for (l = added; l != NULL; l = l->next)
-    {
-      UDisksMount *mount = UDISKS_MOUNT (l->data);
-      g_signal_emit (monitor, signals[MOUNT_ADDED_SIGNAL], 0, mount);
-    }
+  for (n = 0; n < added->len; n++)
+    g_signal_emit (monitor, signals[MOUNT_ADDED_SIGNAL], 0, UDISKS_MOUNT (added->pdata[n]));
 
-  g_list_free_full (old_mounts, g_object_unref);
-  g_list_free (removed);
-  g_list_free (added);
+  g_ptr_array_unref (pending);
+  g_ptr_array_unref (added);
+  g_ptr_array_unref (removed);
 }
 
 static gboolean
@@ -326,6 +417,12 @@ udisks_mount_monitor_constructed (GObject *object)
 
   monitor->monitor_context = g_main_context_ref_thread_default ();
 
+  /* these need to be opened before the initial read so that no change is missed */
+  monitor->mountinfo_fd = open ("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+  if (monitor->mountinfo_fd < 0)
+    udisks_warning ("Error opening /proc/self/mountinfo: %m");
+  monitor->swaps_fd = open ("/proc/swaps", O_RDONLY | O_CLOEXEC);
+
   /* fetch initial data */
   udisks_mount_monitor_ensure (monitor);
 
@@ -406,37 +503,79 @@ udisks_mount_monitor_new (void)
   return UDISKS_MOUNT_MONITOR (g_object_new (UDISKS_TYPE_MOUNT_MONITOR, NULL));
 }
 
-static gboolean
-have_mount (UDisksMountMonitor *monitor,
-            dev_t               dev,
-            const gchar        *mount_point)
-{
-  GList *l;
-  gboolean ret;
+/* ---------------------------------------------------------------------------------------------------- */
 
-  ret = FALSE;
+/* must be called with mounts_mutex held, returns the mount equal to the
+ * passed one that is owned by monitor->mounts */
+static UDisksMount *
+mount_ref (UDisksMountMonitor *monitor,
+           dev_t               dev,
+           const gchar        *mount_point,
+           UDisksMountType     type)
+{
+  UDisksMount *mount;
+  gpointer orig_mount;
+  gpointer count;
 
-  for (l = monitor->mounts; l != NULL; l = l->next)
+  mount = _udisks_mount_new (dev, mount_point, type);
+  if (g_hash_table_lookup_extended (monitor->mounts, mount, &orig_mount, &count))
+    {
+      g_object_unref (mount);
+      mount = UDISKS_MOUNT (orig_mount);
+      g_hash_table_insert (monitor->mounts, mount, GUINT_TO_POINTER (GPOINTER_TO_UINT (count) + 1));
+    }
+  else
     {
-      UDisksMount *mount = UDISKS_MOUNT (l->data);
+      /* the reference is transferred to the table */
+      g_hash_table_insert (monitor->mounts, mount, GUINT_TO_POINTER (1));
+      g_ptr_array_add (monitor->pending, g_object_ref (mount));
+    }
 
-      if (udisks_mount_get_dev (mount) != dev)
-        continue;
+  return mount;
+}
 
-      if (mount_point != NULL)
-        {
-          if (udisks_mount_get_mount_type (mount) != UDISKS_MOUNT_TYPE_FILESYSTEM)
-            continue;
+/* must be called with mounts_mutex held */
+static void
+mount_unref (UDisksMountMonitor *monitor,
+             UDisksMount        *mount)
+{
+  guint count;
 
-          if (g_strcmp0 (udisks_mount_get_mount_path (mount), mount_point) != 0)
-            continue;
-        }
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (monitor->mounts, mount));
+  g_return_if_fail (count > 0);
 
-      ret = TRUE;
-      break;
+  if (count > 1)
+    {
+      g_hash_table_insert (monitor->mounts, mount, GUINT_TO_POINTER (count - 1));
+      return;
     }
 
-  return ret;
+  g_hash_table_remove (monitor->mounts, mount);
+  /* the reference owned by the table is transferred to the pending array */
+  g_ptr_array_add (monitor->pending, mount);
+}
+
+/* Checks whether the proc file behind @fd changed since the last check. The
+ * kernel signals changes of /proc/self/mountinfo and /proc/swaps with
+ * POLLPRI|POLLERR for each open file separately so this doesn't interfere
+ * with the watch sources attached to the main loop.
+ */
+static gboolean
+proc_file_changed (gint     fd,
+                   gboolean have_contents)
+{
+  struct pollfd pfd;
+
+  if (fd < 0 || !have_contents)
+    return TRUE;
+
+  pfd.fd = fd;
+  pfd.events = POLLPRI;
+  pfd.revents = 0;
+  if (poll (&pfd, 1, 0) < 0)
+    return TRUE;
+
+  return (pfd.revents & (POLLPRI | POLLERR)) != 0;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -458,117 +597,189 @@ udisks_mount_monitor_read_mountinfo (gchar  **contents,
   return TRUE;
 }
 
-static void
-udisks_mount_monitor_parse_mountinfo (UDisksMountMonitor  *monitor,
-                                      const gchar         *contents)
+/* returns %FALSE if @line doesn't describe a mount of a block device */
+static gboolean
+parse_mountinfo_line (const gchar  *line,
+                      dev_t        *out_dev,
+                      gchar       **out_mount_point)
 {
+  guint mount_id;
+  guint parent_id;
+  guint major, minor;
+  gchar encoded_root[PATH_MAX + 1];
+  gchar encoded_mount_point[PATH_MAX + 1];
+  dev_t dev;
+
+  if (sscanf (line,
+              "%u %u %u:%u " PATH_MAX_FMT " " PATH_MAX_FMT,
+              &mount_id,
+              &parent_id,
+              &major,
+              &minor,
+              encoded_root,
+              encoded_mount_point) != 6)
+    {
+      udisks_warning ("Error parsing line '%s'", line);
+      return FALSE;
+    }
+  encoded_root[sizeof encoded_root - 1] = '\0';
+  encoded_mount_point[sizeof encoded_mount_point - 1] = '\0';
+
+  /* Temporary work-around for btrfs, see
+   *
+   *  https://bugzilla.redhat.com/show_bug.cgi?id=495152#c31
+   *  http://article.gmane.org/gmane.comp.file-systems.btrfs/2851
+   *
+   * for details.
+   */
+  if (major == 0)
+    {
+      const gchar *sep;
+      sep = strstr (line, " - ");
+      if (sep != NULL)
+        {
+          gchar fstype[PATH_MAX + 1];
+          gchar mount_source[PATH_MAX + 1];
+          struct stat statbuf;
+
+          if (sscanf (sep + 3, PATH_MAX_FMT " " PATH_MAX_FMT, fstype, mount_source) != 2)
+            {
+              udisks_warning ("Error parsing things past - for '%s'", line);
+              return FALSE;
+            }
+          fstype[sizeof fstype - 1] = '\0';
+          mount_source[sizeof mount_source - 1] = '\0';
+
+          if (g_strcmp0 (fstype, "btrfs") != 0)
+            return FALSE;
+
+          if (!g_str_has_prefix (mount_source, "/dev/"))
+            return FALSE;
+
+          if (stat (mount_source, &statbuf) != 0)
+            {
+              udisks_warning ("Error statting %s: %m", mount_source);
+              return FALSE;
+            }
+
+          if (!S_ISBLK (statbuf.st_mode))
+            {
+              udisks_warning ("%s is not a block device", mount_source);
+              return FALSE;
+            }
+
+          dev = statbuf.st_rdev;
+        }
+      else
+        {
+          return FALSE;
+        }
+    }
+  else
+    {
+      dev = makedev (major, minor);
+    }
+
+  *out_dev = dev;
+  *out_mount_point = g_strcompress (encoded_mount_point);
+  return TRUE;
+}
+
+/* must be called with mounts_mutex held, returns %TRUE if any line changed */
+static gboolean
+udisks_mount_monitor_update_mountinfo (UDisksMountMonitor  *monitor,
+                                       const gchar         *contents)
+{
+  GHashTable *old_lines;
+  GHashTableIter iter;
+  gpointer value;
   gchar **lines;
+  gboolean changed = FALSE;
   guint n;
 
   /* See Documentation/filesystems/proc.txt for the format of /proc/self/mountinfo
    *
    * Note that things like space are encoded as \020.
+   *
+   * Every line starts with a unique mount ID so only the lines that are new or
+   * differ from the previous read need to be parsed.
    */
-  if (contents == NULL)
-    return;
+  old_lines = monitor->mountinfo_lines;
+  monitor->mountinfo_lines = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                    NULL, (GDestroyNotify) mount_info_line_free);
+  g_ptr_array_set_size (monitor->mountinfo_order, 0);
 
-  lines = g_strsplit (contents, "\n", 0);
+  lines = g_strsplit (contents != NULL ? contents : "", "\n", 0);
   for (n = 0; lines[n] != NULL; n++)
     {
+      MountInfoLine *info_line = NULL;
+      MountInfoLine *stale_line = NULL;
       guint mount_id;
-      guint parent_id;
-      guint major, minor;
-      gchar encoded_root[PATH_MAX + 1];
-      gchar encoded_mount_point[PATH_MAX + 1];
-      gchar *mount_point;
+      gchar *endp;
       dev_t dev;
+      gchar *mount_point;
 
       if (strlen (lines[n]) == 0)
         continue;
 
-      if (sscanf (lines[n],
-                  "%u %u %u:%u " PATH_MAX_FMT " " PATH_MAX_FMT,
-                  &mount_id,
-                  &parent_id,
-                  &major,
-                  &minor,
-                  encoded_root,
-                  encoded_mount_point) != 6)
+      mount_id = (guint) g_ascii_strtoull (lines[n], &endp, 10);
+      if (endp == lines[n] || *endp != ' ')
         {
           udisks_warning ("Error parsing line '%s'", lines[n]);
           continue;
         }
-      encoded_root[sizeof encoded_root - 1] = '\0';
-      encoded_mount_point[sizeof encoded_mount_point - 1] = '\0';
-
-      /* Temporary work-around for btrfs, see
-       *
-       *  https://bugzilla.redhat.com/show_bug.cgi?id=495152#c31
-       *  http://article.gmane.org/gmane.comp.file-systems.btrfs/2851
-       *
-       * for details.
-       */
-      if (major == 0)
+      if (g_hash_table_contains (monitor->mountinfo_lines, GUINT_TO_POINTER (mount_id)))
         {
-          const gchar *sep;
-          sep = strstr (lines[n], " - ");
-          if (sep != NULL)
-            {
-              gchar fstype[PATH_MAX + 1];
-              gchar mount_source[PATH_MAX + 1];
-              struct stat statbuf;
-
-              if (sscanf (sep + 3, PATH_MAX_FMT " " PATH_MAX_FMT, fstype, mount_source) != 2)
-                {
-                  udisks_warning ("Error parsing things past - for '%s'", lines[n]);
-                  continue;
-                }
-              fstype[sizeof fstype - 1] = '\0';
-              mount_source[sizeof mount_source - 1] = '\0';
-
-              if (g_strcmp0 (fstype, "btrfs") != 0)
-                continue;
-
-              if (!g_str_has_prefix (mount_source, "/dev/"))
-                continue;
-
-              if (stat (mount_source, &statbuf) != 0)
-                {
-                  udisks_warning ("Error statting %s: %m", mount_source);
-                  continue;
-                }
-
-              if (!S_ISBLK (statbuf.st_mode))
-                {
-                  udisks_warning ("%s is not a block device", mount_source);
-                  continue;
-                }
-
-              dev = statbuf.st_rdev;
-            }
-          else
-            {
-              continue;
-            }
+          udisks_warning ("Duplicate mount ID in line '%s'", lines[n]);
+          continue;
         }
-      else
+
+      if (g_hash_table_steal_extended (old_lines, GUINT_TO_POINTER (mount_id), NULL, (gpointer *) &info_line) &&
+          g_strcmp0 (info_line->line, lines[n]) != 0)
         {
-          dev = makedev (major, minor);
+          /* remounted or the mount ID has been reused */
+          stale_line = info_line;
+          info_line = NULL;
         }
 
-      mount_point = g_strcompress (encoded_mount_point);
+      if (info_line == NULL)
+        {
+          info_line = g_new0 (MountInfoLine, 1);
+          info_line->line = g_strdup (lines[n]);
+          if (parse_mountinfo_line (info_line->line, &dev, &mount_point))
+            {
+              info_line->mount = mount_ref (monitor, dev, mount_point, UDISKS_MOUNT_TYPE_FILESYSTEM);
+              g_free (mount_point);
+            }
+          changed = TRUE;
+        }
 
-      /* TODO: we can probably use a hash table or something if this turns out to be slow */
-      if (!have_mount (monitor, dev, mount_point))
+      /* only released now so that an unchanged mount is kept */
+      if (stale_line != NULL)
         {
-          UDisksMount *mount;
-          mount = _udisks_mount_new (dev, mount_point, UDISKS_MOUNT_TYPE_FILESYSTEM);
-          monitor->mounts = g_list_prepend (monitor->mounts, mount);
+          if (stale_line->mount != NULL)
+            mount_unref (monitor, stale_line->mount);
+          mount_info_line_free (stale_line);
         }
 
-      g_free (mount_point);
+      g_hash_table_insert (monitor->mountinfo_lines, GUINT_TO_POINTER (mount_id), info_line);
+      g_ptr_array_add (monitor->mountinfo_order, info_line);
+    }
+
+  /* whatever is left has been unmounted */
+  g_hash_table_iter_init (&iter, old_lines);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      MountInfoLine *info_line = value;
+      if (info_line->mount != NULL)
+        mount_unref (monitor, info_line->mount);
+      changed = TRUE;
     }
+  g_hash_table_destroy (old_lines);
+
   g_strfreev (lines);
+
+  return changed;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -598,17 +809,29 @@ udisks_mount_monitor_read_swaps (gchar  **contents,
   return TRUE;
 }
 
-static void
-udisks_mount_monitor_parse_swaps (UDisksMountMonitor  *monitor,
-                                  const gchar         *contents)
+/* must be called with mounts_mutex held, returns %TRUE if the swaps changed */
+static gboolean
+udisks_mount_monitor_update_swaps (UDisksMountMonitor  *monitor,
+                                   gchar               *contents)
 {
+  GList *old_swaps;
+  GList *l;
   gchar **lines;
   guint n;
 
-  if (contents == NULL)
-    return;
+  /* /proc/swaps is tiny, just compare the contents */
+  if (g_strcmp0 (contents, monitor->swaps_contents) == 0)
+    {
+      g_free (contents);
+      return FALSE;
+    }
+  g_free (monitor->swaps_contents);
+  monitor->swaps_contents = contents;
+
+  old_swaps = monitor->swaps;
+  monitor->swaps = NULL;
 
-  lines = g_strsplit (contents, "\n", 0);
+  lines = g_strsplit (contents != NULL ? contents : "", "\n", 0);
   for (n = 0; lines[n] != NULL; n++)
     {
       gchar filename[PATH_MAX + 1];
@@ -637,78 +860,175 @@ udisks_mount_monitor_parse_swaps (UDisksMountMonitor  *monitor,
 
       dev = statbuf.st_rdev;
 
-      if (!have_mount (monitor, dev, NULL))
-        {
-          UDisksMount *mount;
-          mount = _udisks_mount_new (dev, NULL, UDISKS_MOUNT_TYPE_SWAP);
-          monitor->mounts = g_list_prepend (monitor->mounts, mount);
-        }
+      monitor->swaps = g_list_prepend (monitor->swaps,
+                                       mount_ref (monitor, dev, NULL, UDISKS_MOUNT_TYPE_SWAP));
     }
   g_strfreev (lines);
+
+  /* release the old ones only now so that unchanged swaps are kept */
+  for (l = old_swaps; l != NULL; l = l->next)
+    mount_unref (monitor, UDISKS_MOUNT (l->data));
+  g_list_free (old_swaps);
+
+  return TRUE;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* must be called with mounts_mutex held */
+static MountsSnapshot *
+mounts_snapshot_new (UDisksMountMonitor *monitor)
+{
+  MountsSnapshot *snapshot;
+  GHashTableIter iter;
+  gpointer key;
+  guint n;
+
+  snapshot = g_atomic_rc_box_new0 (MountsSnapshot);
+  snapshot->generation = monitor->generation;
+  snapshot->by_dev = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, (GDestroyNotify) dev_mounts_free);
+  snapshot->by_path = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_hash_table_iter_init (&iter, monitor->mounts);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      UDisksMount *mount = UDISKS_MOUNT (key);
+      guint64 dev = udisks_mount_get_dev (mount);
+      DevMounts *dev_mounts;
+
+      dev_mounts = g_hash_table_lookup (snapshot->by_dev, &dev);
+      if (dev_mounts == NULL)
+        {
+          dev_mounts = g_new0 (DevMounts, 1);
+          dev_mounts->dev = dev;
+          dev_mounts->mounts = g_ptr_array_new_with_free_func (g_object_unref);
+          g_hash_table_insert (snapshot->by_dev, &dev_mounts->dev, dev_mounts);
+        }
+      g_ptr_array_add (dev_mounts->mounts, g_object_ref (mount));
+    }
+
+  /* ensure that shortest mount paths appear first */
+  g_hash_table_iter_init (&iter, snapshot->by_dev);
+  while (g_hash_table_iter_next (&iter, NULL, &key))
+    {
+      DevMounts *dev_mounts = key;
+      g_ptr_array_sort (dev_mounts->mounts, compare_mounts_ptr);
+    }
+
+  /* the last line for a mount path is the mount on top */
+  for (n = 0; n < monitor->mountinfo_order->len; n++)
+    {
+      MountInfoLine *info_line = monitor->mountinfo_order->pdata[n];
+
+      if (info_line->mount != NULL)
+        g_hash_table_insert (snapshot->by_path,
+                             (gpointer) udisks_mount_get_mount_path (info_line->mount),
+                             info_line->mount);
+    }
+
+  return snapshot;
+}
+
+/* must be called with mounts_mutex held, takes ownership of @snapshot */
 static void
-udisks_mount_monitor_ensure (UDisksMountMonitor *monitor)
+mounts_snapshot_publish (UDisksMountMonitor *monitor,
+                         MountsSnapshot     *snapshot)
 {
-  gchar *mountinfo_contents = NULL;
-  gchar *swaps_contents = NULL;
-  gsize mountinfo_length = 0;
-  gsize swaps_length = 0;
-  gchar *mountinfo_checksum = NULL;
-  gchar *swaps_checksum = NULL;
+  MountsSnapshot *old_snapshot;
+
+  /* the mounts_mutex serializes the writers */
+  old_snapshot = g_atomic_pointer_get (&monitor->snapshot);
+  g_atomic_pointer_set (&monitor->snapshot, snapshot);
+
+  /* A lookup may have fetched the old snapshot without having taken its
+   * reference yet. That's only a couple of instructions, so just wait for
+   * such lookups before dropping our reference. Lookups starting now get
+   * the new snapshot.
+   */
+  while (g_atomic_int_get (&monitor->snapshot_readers) > 0)
+    g_thread_yield ();
+
+  /* readers may still hold the old snapshot, it's freed with the last reference */
+  if (old_snapshot != NULL)
+    mounts_snapshot_unref (old_snapshot);
+}
+
+/* must be called with mounts_mutex held */
+static void
+udisks_mount_monitor_ensure_locked (UDisksMountMonitor *monitor)
+{
+  gchar *contents = NULL;
+  gsize length = 0;
+  gboolean changed = FALSE;
   GSource *idle_source;
-  gboolean have_mountinfo;
-  gboolean have_swaps;
 
-  g_mutex_lock (&monitor->mounts_mutex);
+  /* Only re-read the files if the kernel says they changed, that's a single
+   * poll() per file on the fast path.
+   */
+  if (proc_file_changed (monitor->mountinfo_fd, monitor->have_mountinfo))
+    {
+      if (udisks_mount_monitor_read_mountinfo (&contents, &length))
+        {
+          monitor->have_mountinfo = TRUE;
+          changed |= udisks_mount_monitor_update_mountinfo (monitor, contents);
+        }
+      g_clear_pointer (&contents, g_free);
+    }
 
-  have_mountinfo = udisks_mount_monitor_read_mountinfo (&mountinfo_contents, &mountinfo_length);
-  have_swaps = udisks_mount_monitor_read_swaps (&swaps_contents, &swaps_length);
-  if (have_mountinfo || have_swaps)
+  if (proc_file_changed (monitor->swaps_fd, monitor->have_swaps))
     {
-      /* compute contents checksums and compare them against current cache */
-      if (mountinfo_contents)
-        mountinfo_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
-                                                          (const guchar *) mountinfo_contents,
-                                                          mountinfo_length);
-      if (swaps_contents)
-        swaps_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1,
-                                                      (const guchar *) swaps_contents,
-                                                      swaps_length);
-      if (g_strcmp0 (mountinfo_checksum, monitor->mountinfo_checksum) != 0 ||
-          g_strcmp0 (swaps_checksum, monitor->swaps_checksum) != 0)
+      if (udisks_mount_monitor_read_swaps (&contents, &length))
         {
-          g_list_free_full (monitor->mounts, g_object_unref);
-          monitor->mounts = NULL;
-
-          udisks_mount_monitor_parse_mountinfo (monitor, mountinfo_contents);
-          udisks_mount_monitor_parse_swaps (monitor, swaps_contents);
-
-          /* save current checksums */
-          g_free (monitor->mountinfo_checksum);
-          g_free (monitor->swaps_checksum);
-          monitor->mountinfo_checksum = g_strdup (mountinfo_checksum);
-          monitor->swaps_checksum = g_strdup (swaps_checksum);
-
-          /* notify about the changes */
-          idle_source = g_idle_source_new ();
-          g_source_set_priority (idle_source, G_PRIORITY_DEFAULT_IDLE);
-          g_source_set_callback (idle_source, (GSourceFunc) mounts_changed_idle_cb, monitor, NULL);
-          g_source_attach (idle_source, monitor->monitor_context);
-          g_source_unref (idle_source);
+          monitor->have_swaps = TRUE;
+          /* takes ownership of contents */
+          changed |= udisks_mount_monitor_update_swaps (monitor, g_steal_pointer (&contents));
         }
+      g_clear_pointer (&contents, g_free);
+    }
+
+  if (changed || monitor->snapshot == NULL)
+    {
+      monitor->generation++;
+      mounts_snapshot_publish (monitor, mounts_snapshot_new (monitor));
+    }
 
-      g_free (mountinfo_checksum);
-      g_free (swaps_checksum);
+  if (changed)
+    {
+      /* notify about the changes */
+      idle_source = g_idle_source_new ();
+      g_source_set_priority (idle_source, G_PRIORITY_DEFAULT_IDLE);
+      g_source_set_callback (idle_source, (GSourceFunc) mounts_changed_idle_cb, monitor, NULL);
+      g_source_attach (idle_source, monitor->monitor_context);
+      g_source_unref (idle_source);
     }
-  g_free (mountinfo_contents);
-  g_free (swaps_contents);
+}
 
+static void
+udisks_mount_monitor_ensure (UDisksMountMonitor *monitor)
+{
+  g_mutex_lock (&monitor->mounts_mutex);
+  udisks_mount_monitor_ensure_locked (monitor);
   g_mutex_unlock (&monitor->mounts_mutex);
 }
 
+/* Returns the current snapshot, free with mounts_snapshot_unref(). The
+ * snapshot is replaced as soon as the change notification of the proc files
+ * is handled in the monitor_context, so this takes neither the mounts_mutex
+ * nor does it look at the files.
+ */
+static MountsSnapshot *
+udisks_mount_monitor_dup_snapshot (UDisksMountMonitor *monitor)
+{
+  MountsSnapshot *snapshot;
+
+  /* see mounts_snapshot_publish() */
+  g_atomic_int_inc (&monitor->snapshot_readers);
+  snapshot = g_atomic_rc_box_acquire (g_atomic_pointer_get (&monitor->snapshot));
+  g_atomic_int_add (&monitor->snapshot_readers, -1);
+
+  return snapshot;
+}
+
 /**
  * udisks_mount_monitor_get_mounts_for_dev:
  * @monitor: A #UDisksMountMonitor.
@@ -724,29 +1044,22 @@ GList *
 udisks_mount_monitor_get_mounts_for_dev (UDisksMountMonitor *monitor,
                                          dev_t               dev)
 {
+  MountsSnapshot *snapshot;
+  DevMounts *dev_mounts;
+  guint64 key = dev;
   GList *ret;
-  GList *l;
+  guint n;
 
   ret = NULL;
 
-  udisks_mount_monitor_ensure (monitor);
-
-  g_mutex_lock (&monitor->mounts_mutex);
-
-  for (l = monitor->mounts; l != NULL; l = l->next)
-    {
-      UDisksMount *mount = UDISKS_MOUNT (l->data);
-
-      if (udisks_mount_get_dev (mount) == dev)
-        {
-          ret = g_list_prepend (ret, g_object_ref (mount));
-        }
-    }
+  snapshot = udisks_mount_monitor_dup_snapshot (monitor);
 
-  g_mutex_unlock (&monitor->mounts_mutex);
+  /* the array is sorted so that shortest mount paths appear first */
+  dev_mounts = g_hash_table_lookup (snapshot->by_dev, &key);
+  for (n = dev_mounts != NULL ? dev_mounts->mounts->len : 0; n > 0; n--)
+    ret = g_list_prepend (ret, g_object_ref (dev_mounts->mounts->pdata[n - 1]));
 
-  /* Sort the list to ensure that shortest mount paths appear first */
-  ret = g_list_sort (ret, (GCompareFunc) udisks_mount_compare);
+  mounts_snapshot_unref (snapshot);
 
   return ret;
 }
@@ -766,29 +1079,23 @@ udisks_mount_monitor_is_dev_in_use (UDisksMountMonitor  *monitor,
                                     dev_t                dev,
                                     UDisksMountType     *out_type)
 {
+  MountsSnapshot *snapshot;
+  DevMounts *dev_mounts;
+  guint64 key = dev;
   gboolean ret;
-  GList *l;
 
   ret = FALSE;
-  udisks_mount_monitor_ensure (monitor);
-
-  g_mutex_lock (&monitor->mounts_mutex);
+  snapshot = udisks_mount_monitor_dup_snapshot (monitor);
 
-  for (l = monitor->mounts; l != NULL; l = l->next)
+  dev_mounts = g_hash_table_lookup (snapshot->by_dev, &key);
+  if (dev_mounts != NULL && dev_mounts->mounts->len > 0)
     {
-      UDisksMount *mount = UDISKS_MOUNT (l->data);
-
-      if (udisks_mount_get_dev (mount) == dev)
-        {
-          if (out_type != NULL)
-            *out_type = udisks_mount_get_mount_type (mount);
-          ret = TRUE;
-          goto out;
-        }
+      if (out_type != NULL)
+        *out_type = udisks_mount_get_mount_type (UDISKS_MOUNT (dev_mounts->mounts->pdata[0]));
+      ret = TRUE;
     }
 
- out:
-  g_mutex_unlock (&monitor->mounts_mutex);
+  mounts_snapshot_unref (snapshot);
   return ret;
 }
 
@@ -807,28 +1114,18 @@ UDisksMount *
 udisks_mount_monitor_get_mount_for_path (UDisksMountMonitor  *monitor,
                                          const gchar         *mount_path)
 {
-  GList *l;
+  MountsSnapshot *snapshot;
+  UDisksMount *mount;
 
   g_return_val_if_fail (UDISKS_IS_MOUNT_MONITOR (monitor), NULL);
   g_return_val_if_fail (mount_path != NULL, NULL);
 
-  udisks_mount_monitor_ensure (monitor);
-
-  g_mutex_lock (&monitor->mounts_mutex);
-
-  for (l = monitor->mounts; l != NULL; l = l->next)
-    {
-      UDisksMount *mount = UDISKS_MOUNT (l->data);
+  snapshot = udisks_mount_monitor_dup_snapshot (monitor);
 
-      if (udisks_mount_get_mount_type (mount) == UDISKS_MOUNT_TYPE_FILESYSTEM &&
-          g_strcmp0 (udisks_mount_get_mount_path (mount), mount_path) == 0)
-        {
-          g_object_ref (mount);
-          g_mutex_unlock (&monitor->mounts_mutex);
-          return mount;
-        }
-    }
+  mount = g_hash_table_lookup (snapshot->by_path, mount_path);
+  if (mount != NULL)
+    g_object_ref (mount);
 
-  g_mutex_unlock (&monitor->mounts_mutex);
-  return NULL;
+  mounts_snapshot_unref (snapshot);
+  return mount;
 }
@@ -35,6 +35,7 @@
 #include "udisks-daemon-marshal.h"
 #include "udisksdaemon.h"
 #include "udisksdaemonutil.h"
+#include "udisksstats.h"
 
 /**
  * SECTION:udisksspawnedjob
@@ -73,6 +74,7 @@ struct _UDisksSpawnedJob
   const gchar *input_string_cursor;
 
   GPid child_pid;
+  gint64 child_start_time;    /* for UDisksStats, 0 if disabled */
   gint child_stdin_fd;
   gint child_stdout_fd;
   gint child_stderr_fd;
@@ -354,6 +356,7 @@ child_watch_cb (GPid     pid,
                 gpointer user_data)
 {
   UDisksSpawnedJob *job = UDISKS_SPAWNED_JOB (user_data);
+  UDisksDaemon *daemon;
   gchar *buf;
   gsize buf_size;
   gboolean ret;
@@ -373,6 +376,10 @@ child_watch_cb (GPid     pid,
 
   //g_debug ("helper(pid %5d): completed with exit code %d\n", job->child_pid, WEXITSTATUS (status));
 
+  daemon = udisks_base_job_get_daemon (UDISKS_BASE_JOB (job));
+  if (daemon != NULL)
+    udisks_stats_finish (udisks_daemon_get_stats (daemon), UDISKS_STATS_HISTOGRAM_SPAWNED_JOB, job->child_start_time);
+
   /* take a reference so it's safe for a signal-handler to release the last one */
   g_object_ref (job);
   g_signal_emit (job,
@@ -989,6 +996,9 @@ void udisks_spawned_job_start (UDisksSpawnedJob *job)
       goto out;
     }
 
+  if (udisks_base_job_get_daemon (UDISKS_BASE_JOB (job)) != NULL)
+    job->child_start_time = udisks_stats_start (udisks_daemon_get_stats (udisks_base_job_get_daemon (UDISKS_BASE_JOB (job))));
+
   job->child_watch_source = g_child_watch_source_new (job->child_pid);
 #if __GNUC__ >= 8
 #pragma GCC diagnostic push
@@ -32,6 +32,8 @@
 
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <errno.h>
 
 #include "udisksdaemon.h"
@@ -156,7 +158,18 @@
  * filesystem, removing a mount point or tearing down a device-mapper
  * device when needed. The clean-up thread itself needs to be manually
  * kicked using e.g. udisks_state_check() from suitable places in
- * the #UDisksDaemon and #UDisksProvider implementations.
+ * the #UDisksDaemon and #UDisksProvider implementations. Uevents only
+ * queue the affected device using udisks_state_check_device() - requests
+ * are coalesced and only entries related to the queued devices are
+ * checked. A full check is also done periodically.
+ *
+ * The entries are kept in memory, indexed by their key and the device
+ * they refer to. Changes are appended to a journal file stored next to
+ * each state file (e.g. <filename>/run/udisks2/mounted-fs.journal</filename>)
+ * and synced to disk, the state file itself is only rewritten once the
+ * journal grows, after a full check and when the clean-up thread is
+ * started and stopped. The state files therefore always use the format
+ * described above and a journal not matching its state file is ignored.
  *
  * Since cleaning up is only necessary when a device has been removed
  * without having been properly stopped or shut down, the fact that it
@@ -172,6 +185,51 @@
 #define UDISKS_STATE_FILE_MDRAID                 "mdraid"
 #define UDISKS_STATE_FILE_MODULES                "modules"
 
+/* Interval of the periodic full clean-up check */
+#define FULL_CHECK_INTERVAL_SECONDS              (10 * 60)
+
+/* Number of journal records after which the state file is rewritten */
+#define STATE_JOURNAL_MAX_RECORDS                128
+
+/* Journal records are a little-endian guint32 size followed by a serialized
+ * (operation, key, details) tuple. The first record is a header holding the
+ * checksum of the state file the journal applies to.
+ */
+#define JOURNAL_RECORD_TYPE                      "(yva{sv})"
+#define JOURNAL_OP_HEADER                        'H'
+#define JOURNAL_OP_PUT                           '+'
+#define JOURNAL_OP_REMOVE                        '-'
+
+typedef struct
+{
+  const gchar *key;
+  const gchar *type;
+  const gchar *dev_detail;     /* 't' detail to index entries by or NULL */
+} StateFileInfo;
+
+static const StateFileInfo state_files[] =
+{
+  { UDISKS_STATE_FILE_MOUNTED_FS,            "a{sa{sv}}", "block-device" },
+  { UDISKS_STATE_FILE_MOUNTED_FS_PERSISTENT, "a{sa{sv}}", "block-device" },
+  { UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV,   "a{ta{sv}}", "crypto-device" },
+  { UDISKS_STATE_FILE_LOOP,                  "a{sa{sv}}", NULL },
+  { UDISKS_STATE_FILE_MDRAID,                "a{ta{sv}}", NULL },
+  { UDISKS_STATE_FILE_MODULES,               "a{sa{sv}}", NULL },
+};
+
+/* In-memory contents of a state file */
+typedef struct
+{
+  const StateFileInfo *info;
+  gchar *path;
+  gchar *journal_path;
+  GHashTable *entries;         /* key GVariant -> details GVariant */
+  GHashTable *by_dev;          /* guint64 -> GPtrArray of key GVariants, oldest first */
+  gchar *snapshot_checksum;    /* checksum of the state file on disk */
+  gboolean journal_started;
+  guint journal_records;
+} StateTable;
+
 /**
  * UDisksState:
  *
@@ -190,8 +248,14 @@ struct _UDisksState
   GMainContext *context;
   GMainLoop *loop;
 
-  /* key-path -> GVariant */
-  GHashTable *cache;
+  /* state file key -> StateTable, loaded on first use */
+  GHashTable *tables;
+
+  /* pending clean-up requests, coalesced until the clean-up thread gets to them */
+  GMutex queue_lock;
+  GHashTable *queued_devs;    /* set of guint64 device numbers */
+  gboolean full_check_queued;
+  gboolean queue_scheduled;
 };
 
 typedef struct _UDisksStateClass UDisksStateClass;
@@ -207,28 +271,43 @@ enum
   PROP_DAEMON
 };
 
-static void      udisks_state_check_in_thread     (UDisksState          *state);
+static void      udisks_state_check_in_thread     (UDisksState          *state,
+                                                   GHashTable           *check_devs);
 static void      udisks_state_check_mounted_fs    (UDisksState          *state,
                                                    const gchar          *key,
                                                    GArray               *devs_to_clean,
+                                                   GHashTable           *check_devs,
                                                    dev_t                 match_block_device);
 static void      udisks_state_check_unlocked_crypto_dev (UDisksState          *state,
                                                          gboolean              check_only,
-                                                         GArray               *devs_to_clean);
+                                                         GArray               *devs_to_clean,
+                                                         GHashTable           *check_devs);
 static void      udisks_state_check_loop          (UDisksState          *state,
                                                    gboolean              check_only,
-                                                   GArray               *devs_to_clean);
+                                                   GArray               *devs_to_clean,
+                                                   GHashTable           *check_devs);
 static void      udisks_state_check_mdraid        (UDisksState          *state,
                                                    gboolean              check_only,
-                                                   GArray               *devs_to_clean);
+                                                   GArray               *devs_to_clean,
+                                                   GHashTable           *check_devs);
+static gboolean  udisks_state_full_check_timeout_func (gpointer          user_data);
 static gchar    *get_state_file_path              (const gchar          *key);
-static GVariant *udisks_state_get                 (UDisksState          *state,
-                                                   const gchar          *key,
-                                                   const GVariantType   *type);
-static gboolean  udisks_state_set                 (UDisksState          *state,
-                                                   const gchar          *key,
-                                                   const GVariantType   *type,
-                                                   GVariant             *value);
+static void      state_table_free                 (StateTable           *table);
+static StateTable *state_table_get                (UDisksState          *state,
+                                                   const gchar          *key);
+static GVariant *state_table_lookup               (StateTable           *table,
+                                                   GVariant             *key);
+static GVariant *state_table_lookup_by_dev        (StateTable           *table,
+                                                   dev_t                 dev,
+                                                   GVariant            **out_details);
+static GVariant *state_table_dup_contents         (StateTable           *table);
+static void      state_table_put                  (StateTable           *table,
+                                                   GVariant             *key,
+                                                   GVariant             *details);
+static void      state_table_remove               (StateTable           *table,
+                                                   GVariant             *key);
+static void      state_table_clear                (StateTable           *table);
+static void      udisks_state_compact             (UDisksState          *state);
 
 G_DEFINE_TYPE (UDisksState, udisks_state, G_TYPE_OBJECT);
 
@@ -236,7 +315,9 @@ static void
 udisks_state_init (UDisksState *state)
 {
   g_mutex_init (&state->lock);
-  state->cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_variant_unref);
+  state->tables = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) state_table_free);
+  g_mutex_init (&state->queue_lock);
+  state->queued_devs = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
 }
 
 static void
@@ -244,8 +325,10 @@ udisks_state_finalize (GObject *object)
 {
   UDisksState *state = UDISKS_STATE (object);
 
-  g_hash_table_unref (state->cache);
+  g_hash_table_unref (state->tables);
   g_mutex_clear (&state->lock);
+  g_hash_table_unref (state->queued_devs);
+  g_mutex_clear (&state->queue_lock);
 
   G_OBJECT_CLASS (udisks_state_parent_class)->finalize (object);
 }
@@ -369,11 +452,28 @@ udisks_state_thread_func (gpointer user_data)
 void
 udisks_state_start_cleanup (UDisksState *state)
 {
+  GSource *source;
+  guint n;
+
   g_return_if_fail (UDISKS_IS_STATE (state));
   g_return_if_fail (state->thread == NULL);
 
+  /* fold the journals left behind by a crash into the state files */
+  g_mutex_lock (&state->lock);
+  for (n = 0; n < G_N_ELEMENTS (state_files); n++)
+    state_table_get (state, state_files[n].key);
+  udisks_state_compact (state);
+  g_mutex_unlock (&state->lock);
+
   state->context = g_main_context_new ();
   state->loop = g_main_loop_new (state->context, FALSE);
+
+  /* catch anything the targeted checks queued from uevents might miss */
+  source = g_timeout_source_new_seconds (FULL_CHECK_INTERVAL_SECONDS);
+  g_source_set_callback (source, udisks_state_full_check_timeout_func, state, NULL);
+  g_source_attach (source, state->context);
+  g_source_unref (source);
+
   state->thread = g_thread_new ("cleanup",
                                 udisks_state_thread_func,
                                 g_object_ref (state));
@@ -396,14 +496,54 @@ udisks_state_stop_cleanup (UDisksState *state)
   thread = state->thread;
   g_main_loop_quit (state->loop);
   g_thread_join (thread);
+
+  /* leave state files readable without the journals behind */
+  g_mutex_lock (&state->lock);
+  udisks_state_compact (state);
+  g_mutex_unlock (&state->lock);
 }
 
+/* must be called from state thread */
 static gboolean
-udisks_state_check_func (gpointer user_data)
+udisks_state_process_queue_func (gpointer user_data)
 {
   UDisksState *state = UDISKS_STATE (user_data);
-  udisks_state_check_in_thread (state);
-  return FALSE;
+  GHashTable *check_devs;
+  gboolean full_check;
+
+  g_mutex_lock (&state->queue_lock);
+  full_check = state->full_check_queued;
+  check_devs = state->queued_devs;
+  state->queued_devs = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+  state->full_check_queued = FALSE;
+  state->queue_scheduled = FALSE;
+  g_mutex_unlock (&state->queue_lock);
+
+  /* a full check covers all the queued devices */
+  if (full_check)
+    udisks_state_check_in_thread (state, NULL);
+  else if (g_hash_table_size (check_devs) > 0)
+    udisks_state_check_in_thread (state, check_devs);
+
+  g_hash_table_unref (check_devs);
+  return G_SOURCE_REMOVE;
+}
+
+/* called with queue_lock held */
+static void
+udisks_state_schedule_queue (UDisksState *state)
+{
+  GSource *source;
+
+  if (state->queue_scheduled)
+    return;
+
+  /* always defer to the main loop of the clean-up thread, even when called from it */
+  source = g_idle_source_new ();
+  g_source_set_callback (source, udisks_state_process_queue_func, state, NULL);
+  g_source_attach (source, state->context);
+  g_source_unref (source);
+  state->queue_scheduled = TRUE;
 }
 
 /**
@@ -411,6 +551,8 @@ udisks_state_check_func (gpointer user_data)
  * @state: A #UDisksState.
  *
  * Causes the clean-up thread for @state to check if anything should be cleaned up.
+ * Multiple requests made before the clean-up thread gets to them are
+ * coalesced into a single check.
  *
  * This can be called from any thread and will not block the calling thread.
  */
@@ -420,9 +562,49 @@ udisks_state_check (UDisksState *state)
   g_return_if_fail (UDISKS_IS_STATE (state));
   g_return_if_fail (state->thread != NULL);
 
-  g_main_context_invoke (state->context,
-                         udisks_state_check_func,
-                         state);
+  g_mutex_lock (&state->queue_lock);
+  state->full_check_queued = TRUE;
+  udisks_state_schedule_queue (state);
+  g_mutex_unlock (&state->queue_lock);
+}
+
+/**
+ * udisks_state_check_device:
+ * @state: A #UDisksState.
+ * @device: Device number of a block device that has changed or has been removed.
+ *
+ * Causes the clean-up thread for @state to check the entries related to
+ * @device - mounted filesystems on @device or its partitions, devices
+ * unlocked from or as @device, and loop and RAID devices being @device.
+ * Requests made before the clean-up thread gets to them are coalesced.
+ *
+ * This can be called from any thread and will not block the calling thread.
+ */
+void
+udisks_state_check_device (UDisksState *state,
+                           dev_t        device)
+{
+  guint64 *key;
+
+  g_return_if_fail (UDISKS_IS_STATE (state));
+  g_return_if_fail (state->thread != NULL);
+
+  g_mutex_lock (&state->queue_lock);
+  if (!state->full_check_queued)
+    {
+      key = g_new (guint64, 1);
+      *key = device;
+      g_hash_table_add (state->queued_devs, key);
+    }
+  udisks_state_schedule_queue (state);
+  g_mutex_unlock (&state->queue_lock);
+}
+
+static gboolean
+udisks_state_full_check_timeout_func (gpointer user_data)
+{
+  udisks_state_check (UDISKS_STATE (user_data));
+  return G_SOURCE_CONTINUE;
 }
 
 /**
@@ -447,10 +629,12 @@ udisks_state_check_block (UDisksState   *state,
   udisks_state_check_mounted_fs (state,
                                  UDISKS_STATE_FILE_MOUNTED_FS,
                                  NULL,
+                                 NULL,
                                  block_device);
   udisks_state_check_mounted_fs (state,
                                  UDISKS_STATE_FILE_MOUNTED_FS_PERSISTENT,
                                  NULL,
+                                 NULL,
                                  block_device);
 
   g_mutex_unlock (&state->lock);
@@ -473,11 +657,17 @@ udisks_state_get_daemon (UDisksState *state)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
-/* must be called from state thread */
+/* must be called from state thread
+ *
+ * If @check_devs is not %NULL, only entries related to the device numbers
+ * in the set are checked, otherwise all entries are.
+ */
 static void
-udisks_state_check_in_thread (UDisksState *state)
+udisks_state_check_in_thread (UDisksState *state,
+                              GHashTable  *check_devs)
 {
   GArray *devs_to_clean;
+  guint n;
 
   g_mutex_lock (&state->lock);
 
@@ -485,7 +675,10 @@ udisks_state_check_in_thread (UDisksState *state)
    * can't be stopped if they are in use
    */
 
-  udisks_info ("Cleanup check start");
+  if (check_devs == NULL)
+    udisks_info ("Cleanup check start");
+  else
+    udisks_debug ("Cleanup check start (%u devices)", g_hash_table_size (check_devs));
 
   /* First go through all block devices we might tear down
    * but only check + record devices marked for cleaning
@@ -493,14 +686,28 @@ udisks_state_check_in_thread (UDisksState *state)
   devs_to_clean = g_array_new (FALSE, FALSE, sizeof (dev_t));
   udisks_state_check_unlocked_crypto_dev (state,
                                           TRUE, /* check_only */
-                                          devs_to_clean);
+                                          devs_to_clean,
+                                          check_devs);
   udisks_state_check_loop (state,
                            TRUE, /* check_only */
-                           devs_to_clean);
+                           devs_to_clean,
+                           check_devs);
 
   udisks_state_check_mdraid (state,
                              TRUE, /* check_only */
-                             devs_to_clean);
+                             devs_to_clean,
+                             check_devs);
+
+  /* Filesystems mounted on the devices we intend to clean depend on them */
+  if (check_devs != NULL)
+    {
+      for (n = 0; n < devs_to_clean->len; n++)
+        {
+          guint64 *key = g_new (guint64, 1);
+          *key = g_array_index (devs_to_clean, dev_t, n);
+          g_hash_table_add (check_devs, key);
+        }
+    }
 
   /* Then go through all mounted filesystems and pass the
    * devices that we intend to clean...
@@ -508,10 +715,12 @@ udisks_state_check_in_thread (UDisksState *state)
   udisks_state_check_mounted_fs (state,
                                  UDISKS_STATE_FILE_MOUNTED_FS,
                                  devs_to_clean,
+                                 check_devs,
                                  0);
   udisks_state_check_mounted_fs (state,
                                  UDISKS_STATE_FILE_MOUNTED_FS_PERSISTENT,
                                  devs_to_clean,
+                                 check_devs,
                                  0);
 
   /* Then go through all block devices and clear them up
@@ -519,22 +728,78 @@ udisks_state_check_in_thread (UDisksState *state)
    */
   udisks_state_check_unlocked_crypto_dev (state,
                                           FALSE, /* check_only */
-                                          NULL);
+                                          NULL,
+                                          check_devs);
   udisks_state_check_loop (state,
                            FALSE, /* check_only */
-                           NULL);
+                           NULL,
+                           check_devs);
 
   udisks_state_check_mdraid (state,
                              FALSE, /* check_only */
-                             NULL);
+                             NULL,
+                             check_devs);
 
   g_array_free (devs_to_clean, TRUE);
 
-  udisks_info ("Cleanup check end");
+  if (check_devs == NULL)
+    {
+      udisks_state_compact (state);
+      udisks_info ("Cleanup check end");
+    }
+  else
+    udisks_debug ("Cleanup check end");
 
   g_mutex_unlock (&state->lock);
 }
 
+/* called with mutex->lock held */
+static gboolean
+dev_is_checked (GHashTable *check_devs,
+                dev_t       dev)
+{
+  guint64 key = dev;
+
+  return check_devs == NULL || g_hash_table_contains (check_devs, &key);
+}
+
+/* called with mutex->lock held
+ *
+ * Like dev_is_checked() but also considers the whole disk of a partition
+ * since media removal only generates a 'change' uevent for the disk.
+ */
+static gboolean
+dev_or_disk_is_checked (UDisksState *state,
+                        GHashTable  *check_devs,
+                        dev_t        dev)
+{
+  GUdevClient *udev_client;
+  GUdevDevice *udev_device;
+  GUdevDevice *disk;
+  gboolean ret = FALSE;
+
+  if (dev_is_checked (check_devs, dev))
+    return TRUE;
+
+  udev_client = udisks_linux_provider_get_udev_client (udisks_daemon_get_linux_provider (state->daemon));
+  udev_device = g_udev_client_query_by_device_number (udev_client, G_UDEV_DEVICE_TYPE_BLOCK, dev);
+  if (udev_device == NULL)
+    return FALSE;
+
+  if (g_strcmp0 (g_udev_device_get_devtype (udev_device), "partition") == 0)
+    {
+      disk = g_udev_device_get_parent_with_subsystem (udev_device, "block", "disk");
+      if (disk != NULL)
+        {
+          ret = dev_is_checked (check_devs, g_udev_device_get_device_number (disk));
+          g_object_unref (disk);
+        }
+    }
+  g_object_unref (udev_device);
+
+  return ret;
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 static GVariant *
@@ -574,6 +839,7 @@ static gboolean
 udisks_state_check_mounted_fs_entry (UDisksState  *state,
                                      GVariant     *value,
                                      GArray       *devs_to_clean,
+                                     GHashTable   *check_devs,
                                      dev_t         match_block_device)
 {
   const gchar *mount_point_str;
@@ -632,6 +898,13 @@ udisks_state_check_mounted_fs_entry (UDisksState  *state,
       goto out;
     }
 
+  if (!dev_or_disk_is_checked (state, check_devs, block_device))
+    {
+      /* not related to the queued devices */
+      keep = TRUE;
+      goto out;
+    }
+
   block_object = udisks_daemon_find_block (state->daemon, block_device);
   /* skip locking if called from udisks_state_check_block() */
   if (block_object != NULL && match_block_device == 0)
@@ -851,52 +1124,30 @@ static void
 udisks_state_check_mounted_fs (UDisksState *state,
                                const gchar *key,
                                GArray      *devs_to_clean,
+                               GHashTable  *check_devs,
                                dev_t        match_block_device)
 {
-  gboolean changed;
+  StateTable *table;
   GVariant *value;
-  GVariant *new_value;
-  GVariantBuilder builder;
-
-  changed = FALSE;
+  GVariantIter iter;
+  GVariant *child;
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            key,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
+  table = state_table_get (state, key);
 
-  /* check valid entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
-  if (value != NULL)
+  /* check a copy of the entries, removing those that should not be kept */
+  value = state_table_dup_contents (table);
+  g_variant_iter_init (&iter, value);
+  while ((child = g_variant_iter_next_value (&iter)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
+      if (!udisks_state_check_mounted_fs_entry (state, child, devs_to_clean, check_devs, match_block_device))
         {
-          if (udisks_state_check_mounted_fs_entry (state, child, devs_to_clean, match_block_device))
-            g_variant_builder_add_value (&builder, child);
-          else
-            changed = TRUE;
-          g_variant_unref (child);
+          GVariant *entry_key = g_variant_get_child_value (child, 0);
+          state_table_remove (table, entry_key);
+          g_variant_unref (entry_key);
         }
-      g_variant_unref (value);
-    }
-
-  new_value = g_variant_builder_end (&builder);
-
-  /* save new entries */
-  if (changed)
-    {
-      udisks_state_set (state,
-                        key,
-                        G_VARIANT_TYPE ("a{sa{sv}}"),
-                        new_value /* consumes new_value */);
-    }
-  else
-    {
-      g_variant_unref (new_value);
+      g_variant_unref (child);
     }
+  g_variant_unref (value);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -921,10 +1172,7 @@ udisks_state_add_mounted_fs (UDisksState    *state,
                              gboolean        fstab_mount,
                              gboolean        persistent)
 {
-  GVariant *value;
-  GVariant *new_value;
-  GVariant *details_value;
-  GVariantBuilder builder;
+  StateTable *table;
   GVariantBuilder details_builder;
 
   g_return_if_fail (UDISKS_IS_STATE (state));
@@ -932,36 +1180,14 @@ udisks_state_add_mounted_fs (UDisksState    *state,
 
   g_mutex_lock (&state->lock);
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            persistent ? UDISKS_STATE_FILE_MOUNTED_FS_PERSISTENT : UDISKS_STATE_FILE_MOUNTED_FS,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
+  table = state_table_get (state,
+                           persistent ? UDISKS_STATE_FILE_MOUNTED_FS_PERSISTENT : UDISKS_STATE_FILE_MOUNTED_FS);
 
-  /* start by including existing entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
-  if (value != NULL)
+  /* the new entry replaces any stale one */
+  if (state_table_lookup (table, g_variant_new_string (mount_point)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
-        {
-          const gchar *entry_mount_point;
-          g_variant_get (child, "{&s@a{sv}}", &entry_mount_point, NULL);
-          /* Skip/remove stale entries */
-          if (g_strcmp0 (entry_mount_point, mount_point) == 0)
-            {
-              udisks_warning ("Removing stale entry for mount point `%s' in /run/udisks/mounted-fs file",
-                              entry_mount_point);
-            }
-          else
-            {
-              g_variant_builder_add_value (&builder, child);
-            }
-          g_variant_unref (child);
-        }
-      g_variant_unref (value);
+      udisks_warning ("Removing stale entry for mount point `%s' in /run/udisks/mounted-fs file",
+                      mount_point);
     }
 
   /* build the details */
@@ -978,20 +1204,11 @@ udisks_state_add_mounted_fs (UDisksState    *state,
                          "{sv}",
                          "fstab-mount",
                          g_variant_new_boolean (fstab_mount));
-  details_value = g_variant_builder_end (&details_builder);
-
-  /* finally add the new entry */
-  g_variant_builder_add (&builder,
-                         "{s@a{sv}}",
-                         mount_point,
-                         details_value); /* consumes details_value */
-  new_value = g_variant_builder_end (&builder);
 
-  /* save new entries */
-  udisks_state_set (state,
-                    persistent ? UDISKS_STATE_FILE_MOUNTED_FS_PERSISTENT : UDISKS_STATE_FILE_MOUNTED_FS,
-                    G_VARIANT_TYPE ("a{sa{sv}}"),
-                    new_value /* consumes new_value */);
+  /* add the new entry */
+  state_table_put (table,
+                   g_variant_new_string (mount_point),
+                   g_variant_builder_end (&details_builder));
 
   g_mutex_unlock (&state->lock);
 }
@@ -1004,77 +1221,38 @@ find_mounted_fs_for_key (UDisksState   *state,
                          uid_t         *out_uid,
                          gboolean      *out_fstab_mount)
 {
-  gchar *ret = NULL;
-  GVariant *value;
+  StateTable *table;
+  GVariant *mount_point;
+  GVariant *details = NULL;
+  GVariant *lookup_value;
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            key,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
+  table = state_table_get (state, key);
+  mount_point = state_table_lookup_by_dev (table, block_device, &details);
+  if (mount_point == NULL)
+    return NULL;
 
-  /* look through list */
-  if (value != NULL)
+  if (out_uid != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
+      lookup_value = lookup_asv (details, "mounted-by-uid");
+      *out_uid = 0;
+      if (lookup_value != NULL)
         {
-          const gchar *mount_point;
-          GVariant *details;
-          GVariant *block_device_value;
-
-          g_variant_get (child,
-                         "{&s@a{sv}}",
-                         &mount_point,
-                         &details);
-
-          block_device_value = lookup_asv (details, "block-device");
-          if (block_device_value != NULL)
-            {
-              dev_t iter_block_device;
-              iter_block_device = g_variant_get_uint64 (block_device_value);
-              if (iter_block_device == block_device)
-                {
-                  ret = g_strdup (mount_point);
-                  if (out_uid != NULL)
-                    {
-                      GVariant *lookup_value;
-                      lookup_value = lookup_asv (details, "mounted-by-uid");
-                      *out_uid = 0;
-                      if (lookup_value != NULL)
-                        {
-                          *out_uid = g_variant_get_uint32 (lookup_value);
-                          g_variant_unref (lookup_value);
-                        }
-                    }
-                  if (out_fstab_mount != NULL)
-                    {
-                      GVariant *lookup_value;
-                      lookup_value = lookup_asv (details, "fstab-mount");
-                      *out_fstab_mount = FALSE;
-                      if (lookup_value != NULL)
-                        {
-                          *out_fstab_mount = g_variant_get_boolean (lookup_value);
-                          g_variant_unref (lookup_value);
-                        }
-                    }
-                  g_variant_unref (block_device_value);
-                  g_variant_unref (details);
-                  g_variant_unref (child);
-                  goto out;
-                }
-              g_variant_unref (block_device_value);
-            }
-          g_variant_unref (details);
-          g_variant_unref (child);
+          *out_uid = g_variant_get_uint32 (lookup_value);
+          g_variant_unref (lookup_value);
+        }
+    }
+  if (out_fstab_mount != NULL)
+    {
+      lookup_value = lookup_asv (details, "fstab-mount");
+      *out_fstab_mount = FALSE;
+      if (lookup_value != NULL)
+        {
+          *out_fstab_mount = g_variant_get_boolean (lookup_value);
+          g_variant_unref (lookup_value);
         }
     }
 
- out:
-  if (value != NULL)
-    g_variant_unref (value);
-  return ret;
+  return g_variant_dup_string (mount_point, NULL);
 }
 
 /**
@@ -1124,7 +1302,8 @@ static gboolean
 udisks_state_check_unlocked_crypto_dev_entry (UDisksState  *state,
                                               GVariant     *value,
                                               gboolean      check_only,
-                                              GArray       *devs_to_clean)
+                                              GArray       *devs_to_clean,
+                                              GHashTable   *check_devs)
 {
   guint64 cleartext_device;
   GVariant *details;
@@ -1169,6 +1348,13 @@ udisks_state_check_unlocked_crypto_dev_entry (UDisksState  *state,
     }
   crypto_device = g_variant_get_uint64 (crypto_device_value);
 
+  if (!dev_is_checked (check_devs, cleartext_device) && !dev_is_checked (check_devs, crypto_device))
+    {
+      /* not related to the queued devices */
+      keep = TRUE;
+      goto out2;
+    }
+
   dm_uuid_value = lookup_asv (details, "dm-uuid");
   if (dm_uuid_value == NULL)
     {
@@ -1285,52 +1471,30 @@ udisks_state_check_unlocked_crypto_dev_entry (UDisksState  *state,
 static void
 udisks_state_check_unlocked_crypto_dev (UDisksState *state,
                                         gboolean     check_only,
-                                        GArray      *devs_to_clean)
+                                        GArray      *devs_to_clean,
+                                        GHashTable  *check_devs)
 {
-  gboolean changed;
+  StateTable *table;
   GVariant *value;
-  GVariant *new_value;
-  GVariantBuilder builder;
-
-  changed = FALSE;
+  GVariantIter iter;
+  GVariant *child;
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV,
-                            G_VARIANT_TYPE ("a{ta{sv}}"));
+  table = state_table_get (state, UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV);
 
-  /* check valid entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ta{sv}}"));
-  if (value != NULL)
+  /* check a copy of the entries, removing those that should not be kept */
+  value = state_table_dup_contents (table);
+  g_variant_iter_init (&iter, value);
+  while ((child = g_variant_iter_next_value (&iter)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
+      if (!udisks_state_check_unlocked_crypto_dev_entry (state, child, check_only, devs_to_clean, check_devs))
         {
-          if (udisks_state_check_unlocked_crypto_dev_entry (state, child, check_only, devs_to_clean))
-            g_variant_builder_add_value (&builder, child);
-          else
-            changed = TRUE;
-          g_variant_unref (child);
+          GVariant *entry_key = g_variant_get_child_value (child, 0);
+          state_table_remove (table, entry_key);
+          g_variant_unref (entry_key);
         }
-      g_variant_unref (value);
-    }
-
-  new_value = g_variant_builder_end (&builder);
-
-  /* save new entries */
-  if (changed)
-    {
-      udisks_state_set (state,
-                        UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV,
-                        G_VARIANT_TYPE ("a{ta{sv}}"),
-                        new_value /* consumes new_value */);
-    }
-  else
-    {
-      g_variant_unref (new_value);
+      g_variant_unref (child);
     }
+  g_variant_unref (value);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -1353,10 +1517,7 @@ udisks_state_add_unlocked_crypto_dev (UDisksState  *state,
                                       const gchar  *dm_uuid,
                                       uid_t         uid)
 {
-  GVariant *value;
-  GVariant *new_value;
-  GVariant *details_value;
-  GVariantBuilder builder;
+  StateTable *table;
   GVariantBuilder details_builder;
 
   g_return_if_fail (UDISKS_IS_STATE (state));
@@ -1364,36 +1525,14 @@ udisks_state_add_unlocked_crypto_dev (UDisksState  *state,
 
   g_mutex_lock (&state->lock);
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV,
-                            G_VARIANT_TYPE ("a{ta{sv}}"));
+  table = state_table_get (state, UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV);
 
-  /* start by including existing entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ta{sv}}"));
-  if (value != NULL)
+  /* the new entry replaces any stale one */
+  if (state_table_lookup (table, g_variant_new_uint64 (cleartext_device)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
-        {
-          guint64 entry_cleartext_device;
-          g_variant_get (child, "{t@a{sv}}", &entry_cleartext_device, NULL);
-          /* Skip/remove stale entries */
-          if ((dev_t) entry_cleartext_device == cleartext_device)
-            {
-              udisks_warning ("Removing stale entry for cleartext device %d:%d in /run/udisks2/unlocked-crypto-dev file",
-                              (gint) major (entry_cleartext_device),
-                              (gint) minor (entry_cleartext_device));
-            }
-          else
-            {
-              g_variant_builder_add_value (&builder, child);
-            }
-          g_variant_unref (child);
-        }
-      g_variant_unref (value);
+      udisks_warning ("Removing stale entry for cleartext device %d:%d in /run/udisks2/unlocked-crypto-dev file",
+                      (gint) major (cleartext_device),
+                      (gint) minor (cleartext_device));
     }
 
   /* build the details */
@@ -1410,20 +1549,11 @@ udisks_state_add_unlocked_crypto_dev (UDisksState  *state,
                          "{sv}",
                          "unlocked-by-uid",
                          g_variant_new_uint32 (uid));
-  details_value = g_variant_builder_end (&details_builder);
-
-  /* finally add the new entry */
-  g_variant_builder_add (&builder,
-                         "{t@a{sv}}",
-                         (guint64) cleartext_device,
-                         details_value); /* consumes details_value */
-  new_value = g_variant_builder_end (&builder);
 
-  /* save new entries */
-  udisks_state_set (state,
-                    UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV,
-                    G_VARIANT_TYPE ("a{ta{sv}}"),
-                    new_value /* consumes new_value */);
+  /* add the new entry */
+  state_table_put (table,
+                   g_variant_new_uint64 (cleartext_device),
+                   g_variant_builder_end (&details_builder));
 
   g_mutex_unlock (&state->lock);
 }
@@ -1444,72 +1574,33 @@ udisks_state_find_unlocked_crypto_dev (UDisksState   *state,
                                        dev_t          crypto_device,
                                        uid_t         *out_uid)
 {
-  dev_t ret;
-  GVariant *value;
+  StateTable *table;
+  GVariant *cleartext_device;
+  GVariant *details = NULL;
+  dev_t ret = 0;
 
   g_return_val_if_fail (UDISKS_IS_STATE (state), 0);
 
   g_mutex_lock (&state->lock);
 
-  ret = 0;
-  value = NULL;
-
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV,
-                            G_VARIANT_TYPE ("a{ta{sv}}"));
-
-  /* look through list */
-  if (value != NULL)
+  table = state_table_get (state, UDISKS_STATE_FILE_UNLOCKED_CRYPTO_DEV);
+  cleartext_device = state_table_lookup_by_dev (table, crypto_device, &details);
+  if (cleartext_device != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
+      ret = g_variant_get_uint64 (cleartext_device);
+      if (out_uid != NULL)
         {
-          guint64 cleartext_device;
-          GVariant *details;
-          GVariant *crypto_device_value;
-
-          g_variant_get (child,
-                         "{t@a{sv}}",
-                         &cleartext_device,
-                         &details);
-
-          crypto_device_value = lookup_asv (details, "crypto-device");
-          if (crypto_device_value != NULL)
+          GVariant *lookup_value;
+          lookup_value = lookup_asv (details, "unlocked-by-uid");
+          *out_uid = 0;
+          if (lookup_value != NULL)
             {
-              dev_t iter_crypto_device;
-              iter_crypto_device = g_variant_get_uint64 (crypto_device_value);
-              if (iter_crypto_device == crypto_device)
-                {
-                  ret = cleartext_device;
-                  if (out_uid != NULL)
-                    {
-                      GVariant *lookup_value;
-                      lookup_value = lookup_asv (details, "unlocked-by-uid");
-                      *out_uid = 0;
-                      if (lookup_value != NULL)
-                        {
-                          *out_uid = g_variant_get_uint32 (lookup_value);
-                          g_variant_unref (lookup_value);
-                        }
-                    }
-                  g_variant_unref (crypto_device_value);
-                  g_variant_unref (details);
-                  g_variant_unref (child);
-                  goto out;
-                }
-              g_variant_unref (crypto_device_value);
+              *out_uid = g_variant_get_uint32 (lookup_value);
+              g_variant_unref (lookup_value);
             }
-          g_variant_unref (details);
-          g_variant_unref (child);
         }
     }
 
- out:
-  if (value != NULL)
-    g_variant_unref (value);
   g_mutex_unlock (&state->lock);
   return ret;
 }
@@ -1521,7 +1612,8 @@ static gboolean
 udisks_state_check_loop_entry (UDisksState  *state,
                                GVariant     *value,
                                gboolean      check_only,
-                               GArray       *devs_to_clean)
+                               GArray       *devs_to_clean,
+                               GHashTable   *check_devs)
 {
   const gchar *loop_device;
   GVariant *details = NULL;
@@ -1557,6 +1649,12 @@ udisks_state_check_loop_entry (UDisksState  *state,
       udisks_info ("udisks_state_check_loop_entry: no udev device for %s", loop_device);
       goto out;
     }
+  if (!dev_is_checked (check_devs, g_udev_device_get_device_number (device)))
+    {
+      /* not related to the queued devices */
+      keep = TRUE;
+      goto out2;
+    }
   if (g_udev_device_get_sysfs_attr (device, "loop/offset") == NULL)
     {
       udisks_info ("udisks_state_check_loop_entry: loop device %s is not setup  (no loop/offset sysfs file)", loop_device);
@@ -1612,52 +1710,30 @@ udisks_state_check_loop_entry (UDisksState  *state,
 static void
 udisks_state_check_loop (UDisksState *state,
                          gboolean     check_only,
-                         GArray      *devs_to_clean)
+                         GArray      *devs_to_clean,
+                         GHashTable  *check_devs)
 {
-  gboolean changed;
+  StateTable *table;
   GVariant *value;
-  GVariant *new_value;
-  GVariantBuilder builder;
-
-  changed = FALSE;
+  GVariantIter iter;
+  GVariant *child;
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_LOOP,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
+  table = state_table_get (state, UDISKS_STATE_FILE_LOOP);
 
-  /* check valid entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
-  if (value != NULL)
+  /* check a copy of the entries, removing those that should not be kept */
+  value = state_table_dup_contents (table);
+  g_variant_iter_init (&iter, value);
+  while ((child = g_variant_iter_next_value (&iter)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
+      if (!udisks_state_check_loop_entry (state, child, check_only, devs_to_clean, check_devs))
         {
-          if (udisks_state_check_loop_entry (state, child, check_only, devs_to_clean))
-            g_variant_builder_add_value (&builder, child);
-          else
-            changed = TRUE;
-          g_variant_unref (child);
+          GVariant *entry_key = g_variant_get_child_value (child, 0);
+          state_table_remove (table, entry_key);
+          g_variant_unref (entry_key);
         }
-      g_variant_unref (value);
-    }
-
-  new_value = g_variant_builder_end (&builder);
-
-  /* save new entries */
-  if (changed)
-    {
-      udisks_state_set (state,
-                        UDISKS_STATE_FILE_LOOP,
-                        G_VARIANT_TYPE ("a{sa{sv}}"),
-                        new_value /* consumes new_value */);
-    }
-  else
-    {
-      g_variant_unref (new_value);
+      g_variant_unref (child);
     }
+  g_variant_unref (value);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -1680,10 +1756,7 @@ udisks_state_add_loop (UDisksState   *state,
                        dev_t          backing_file_device,
                        uid_t          uid)
 {
-  GVariant *value;
-  GVariant *new_value;
-  GVariant *details_value;
-  GVariantBuilder builder;
+  StateTable *table;
   GVariantBuilder details_builder;
 
   g_return_if_fail (UDISKS_IS_STATE (state));
@@ -1692,35 +1765,13 @@ udisks_state_add_loop (UDisksState   *state,
 
   g_mutex_lock (&state->lock);
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_LOOP,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
+  table = state_table_get (state, UDISKS_STATE_FILE_LOOP);
 
-  /* start by including existing entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
-  if (value != NULL)
+  /* the new entry replaces any stale one */
+  if (state_table_lookup (table, g_variant_new_string (device_file)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
-        {
-          const gchar *entry_loop_device;
-          g_variant_get (child, "{&s@a{sv}}", &entry_loop_device, NULL);
-          /* Skip/remove stale entries */
-          if (g_strcmp0 (entry_loop_device, device_file) == 0)
-            {
-              udisks_warning ("Removing stale entry for loop device `%s' in /run/udisks2/loop file",
-                              entry_loop_device);
-            }
-          else
-            {
-              g_variant_builder_add_value (&builder, child);
-            }
-          g_variant_unref (child);
-        }
-      g_variant_unref (value);
+      udisks_warning ("Removing stale entry for loop device `%s' in /run/udisks2/loop file",
+                      device_file);
     }
 
   /* build the details */
@@ -1737,138 +1788,53 @@ udisks_state_add_loop (UDisksState   *state,
                          "{sv}",
                          "setup-by-uid",
                          g_variant_new_uint32 (uid));
-  details_value = g_variant_builder_end (&details_builder);
-
-  /* finally add the new entry */
-  g_variant_builder_add (&builder,
-                         "{s@a{sv}}",
-                         device_file,
-                         details_value); /* consumes details_value */
-  new_value = g_variant_builder_end (&builder);
 
-  /* save new entries */
-  udisks_state_set (state,
-                    UDISKS_STATE_FILE_LOOP,
-                    G_VARIANT_TYPE ("a{sa{sv}}"),
-                    new_value /* consumes new_value */);
+  /* add the new entry */
+  state_table_put (table,
+                   g_variant_new_string (device_file),
+                   g_variant_builder_end (&details_builder));
 
   g_mutex_unlock (&state->lock);
 }
 
 /**
- * node_cb:
- * @child:          Element in the list you are visiting
- * @compare_data:   Data used for comparison
- * @user_data:      Data supplied by call to iterate list
+ * udisks_state_has_loop:
+ * @state: A #UDisksState
+ * @device_file: A loop device file.
+ * @out_uid: Return location for the user id who setup the loop device or %NULL.
  *
- * Returns: %TRUE if the iteration should stop, else %FALSE
- */
-typedef gboolean (*node_cb)(GVariant *child, gpointer compare_data,
-                            gpointer user_data);
-
-
-/**
- * iterate_list:
- * @list:           The list to iterate over
- * @visit:          The function called on each element in the list
- * @compare_data:   Data used for comparison
- * @user_data:      Pointer to user supplied data
+ * Checks if @device_file is set up via udisks.
  *
- * Returns: %TRUE if iteration was stopped by node_cb, else %FALSE
- */
-static gboolean
-iterate_list (GVariant *list, node_cb visit, gpointer compare_data,
-              gpointer user_data)
-{
-  gboolean rc = FALSE;
-  GVariantIter iter;
-  GVariant *child = NULL;
-
-  if (!list)
-    return rc;
-
-  g_variant_iter_init (&iter, list);
-
-  while (!rc && ((child = g_variant_iter_next_value (&iter)) != NULL))
-    {
-      rc = visit (child, compare_data, user_data);
-      g_variant_unref (child);
-    }
-
-  return rc;
-}
-
-static gboolean
-_udisks_state_has_loop_list_visitor (GVariant *child,
-                                     gpointer  compare_data,
-                                     gpointer  user_data)
-{
-  gboolean ret = FALSE;
-  const gchar *iter_device_file = NULL;
-  GVariant *details = NULL;
-  uid_t *out_uid = (uid_t *) user_data;
-
-  g_variant_get (child, "{&s@a{sv}}", &iter_device_file, &details);
-
-  if (g_strcmp0 (iter_device_file, ((gchar*) compare_data)) == 0)
-    {
-      ret = TRUE;
-      if (out_uid != NULL)
-        {
-          GVariant *lookup_value;
-          lookup_value = lookup_asv (details, "setup-by-uid");
-          *out_uid = 0;
-          if (lookup_value != NULL)
-            {
-              *out_uid = g_variant_get_uint32 (lookup_value);
-              g_variant_unref (lookup_value);
-            }
-        }
-    }
-  g_variant_unref (details);
-
-  return ret;
-}
-
-/**
- * udisks_state_has_loop:
- * @state: A #UDisksState
- * @device_file: A loop device file.
- * @out_uid: Return location for the user id who setup the loop device or %NULL.
- *
- * Checks if @device_file is set up via udisks.
- *
- * Returns: %TRUE if set up via udisks, otherwise %FALSE or if @error is set.
+ * Returns: %TRUE if set up via udisks, otherwise %FALSE or if @error is set.
  */
 gboolean
 udisks_state_has_loop (UDisksState   *state,
                        const gchar   *device_file,
                        uid_t         *out_uid)
 {
-  gboolean ret;
-  GVariant *value;
+  StateTable *table;
+  GVariant *details;
 
   g_return_val_if_fail (UDISKS_IS_STATE (state), FALSE);
 
   g_mutex_lock (&state->lock);
 
-  ret = 0;
-  value = NULL;
-
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_LOOP,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
-  if (value != NULL)
-   {
-      ret = iterate_list (value,
-                          _udisks_state_has_loop_list_visitor,
-                          (gpointer) device_file, (gpointer) out_uid);
-      g_variant_unref (value);
-   }
+  table = state_table_get (state, UDISKS_STATE_FILE_LOOP);
+  details = state_table_lookup (table, g_variant_new_string (device_file));
+  if (details != NULL && out_uid != NULL)
+    {
+      GVariant *lookup_value;
+      lookup_value = lookup_asv (details, "setup-by-uid");
+      *out_uid = 0;
+      if (lookup_value != NULL)
+        {
+          *out_uid = g_variant_get_uint32 (lookup_value);
+          g_variant_unref (lookup_value);
+        }
+    }
 
   g_mutex_unlock (&state->lock);
-  return ret;
+  return details != NULL;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -1878,7 +1844,8 @@ static gboolean
 udisks_state_check_mdraid_entry (UDisksState  *state,
                                  GVariant     *value,
                                  gboolean      check_only,
-                                 GArray       *devs_to_clean)
+                                 GArray       *devs_to_clean,
+                                 GHashTable   *check_devs)
 {
   dev_t raid_device;
   GVariant *details = NULL;
@@ -1894,6 +1861,13 @@ udisks_state_check_mdraid_entry (UDisksState  *state,
                  &raid_device,
                  &details);
 
+  if (!dev_is_checked (check_devs, raid_device))
+    {
+      /* not related to the queued devices */
+      keep = TRUE;
+      goto out2;
+    }
+
   /* check if the RAID device is still set up */
   device = g_udev_client_query_by_device_number (udev_client, G_UDEV_DEVICE_TYPE_BLOCK, raid_device);
   if (device == NULL)
@@ -1945,52 +1919,30 @@ udisks_state_check_mdraid_entry (UDisksState  *state,
 static void
 udisks_state_check_mdraid (UDisksState *state,
                            gboolean     check_only,
-                           GArray      *devs_to_clean)
+                           GArray      *devs_to_clean,
+                           GHashTable  *check_devs)
 {
-  gboolean changed;
+  StateTable *table;
   GVariant *value;
-  GVariant *new_value;
-  GVariantBuilder builder;
-
-  changed = FALSE;
+  GVariantIter iter;
+  GVariant *child;
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_MDRAID,
-                            G_VARIANT_TYPE ("a{ta{sv}}"));
+  table = state_table_get (state, UDISKS_STATE_FILE_MDRAID);
 
-  /* check valid entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ta{sv}}"));
-  if (value != NULL)
+  /* check a copy of the entries, removing those that should not be kept */
+  value = state_table_dup_contents (table);
+  g_variant_iter_init (&iter, value);
+  while ((child = g_variant_iter_next_value (&iter)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
+      if (!udisks_state_check_mdraid_entry (state, child, check_only, devs_to_clean, check_devs))
         {
-          if (udisks_state_check_mdraid_entry (state, child, check_only, devs_to_clean))
-            g_variant_builder_add_value (&builder, child);
-          else
-            changed = TRUE;
-          g_variant_unref (child);
+          GVariant *entry_key = g_variant_get_child_value (child, 0);
+          state_table_remove (table, entry_key);
+          g_variant_unref (entry_key);
         }
-      g_variant_unref (value);
-    }
-
-  new_value = g_variant_builder_end (&builder);
-
-  /* save new entries */
-  if (changed)
-    {
-      udisks_state_set (state,
-                        UDISKS_STATE_FILE_MDRAID,
-                        G_VARIANT_TYPE ("a{ta{sv}}"),
-                        new_value /* consumes new_value */);
-    }
-  else
-    {
-      g_variant_unref (new_value);
+      g_variant_unref (child);
     }
+  g_variant_unref (value);
 }
 
 /**
@@ -2007,45 +1959,20 @@ udisks_state_add_mdraid (UDisksState   *state,
                          dev_t          raid_device,
                          uid_t          uid)
 {
-  GVariant *value;
-  GVariant *new_value;
-  GVariant *details_value;
-  GVariantBuilder builder;
+  StateTable *table;
   GVariantBuilder details_builder;
 
   g_return_if_fail (UDISKS_IS_STATE (state));
 
   g_mutex_lock (&state->lock);
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_MDRAID,
-                            G_VARIANT_TYPE ("a{ta{sv}}"));
+  table = state_table_get (state, UDISKS_STATE_FILE_MDRAID);
 
-  /* start by including existing entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{ta{sv}}"));
-  if (value != NULL)
+  /* the new entry replaces any stale one */
+  if (state_table_lookup (table, g_variant_new_uint64 (raid_device)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
-        {
-          guint64 entry_raid_device;
-          g_variant_get (child, "{t@a{sv}}", &entry_raid_device, NULL);
-          /* Skip/remove stale entries */
-          if (entry_raid_device == raid_device)
-            {
-              udisks_warning ("Removing stale entry for raid device %u:%u in /run/udisks2/mdraid file",
-                                major (raid_device), minor (raid_device));
-            }
-          else
-            {
-              g_variant_builder_add_value (&builder, child);
-            }
-          g_variant_unref (child);
-        }
-      g_variant_unref (value);
+      udisks_warning ("Removing stale entry for raid device %u:%u in /run/udisks2/mdraid file",
+                      major (raid_device), minor (raid_device));
     }
 
   /* build the details */
@@ -2054,55 +1981,15 @@ udisks_state_add_mdraid (UDisksState   *state,
                          "{sv}",
                          "started-by-uid",
                          g_variant_new_uint32 (uid));
-  details_value = g_variant_builder_end (&details_builder);
-
-  /* finally add the new entry */
-  g_variant_builder_add (&builder,
-                         "{t@a{sv}}",
-                         raid_device,
-                         details_value); /* consumes details_value */
-  new_value = g_variant_builder_end (&builder);
 
-  /* save new entries */
-  udisks_state_set (state,
-                    UDISKS_STATE_FILE_MDRAID,
-                    G_VARIANT_TYPE ("a{ta{sv}}"),
-                    new_value /* consumes new_value */);
+  /* add the new entry */
+  state_table_put (table,
+                   g_variant_new_uint64 (raid_device),
+                   g_variant_builder_end (&details_builder));
 
   g_mutex_unlock (&state->lock);
 }
 
-static gboolean
-_udisks_state_has_mdraid_list_visitor (GVariant *child, gpointer compare_data,
-                                       gpointer user_data )
-{
-  gboolean ret = FALSE;
-  guint64 iter_raid_device;
-  GVariant *details;
-  dev_t *raid_device = (dev_t*) compare_data;
-  uid_t *out_uid = (uid_t*) user_data;
-
-  g_variant_get (child, "{t@a{sv}}", &iter_raid_device, &details);
-
-  if (iter_raid_device == *raid_device)
-    {
-      ret = TRUE;
-      if (out_uid != NULL)
-        {
-          GVariant *lookup_value;
-          lookup_value = lookup_asv (details, "started-by-uid");
-          *out_uid = 0;
-          if (lookup_value != NULL)
-            {
-              *out_uid = g_variant_get_uint32 (lookup_value);
-              g_variant_unref (lookup_value);
-            }
-        }
-    }
-  g_variant_unref (details);
-  return ret;
-}
-
 /**
  * udisks_state_has_mdraid:
  * @state: A #UDisksState
@@ -2118,26 +2005,29 @@ udisks_state_has_mdraid (UDisksState   *state,
                          dev_t          raid_device,
                          uid_t         *out_uid)
 {
-  gboolean ret = FALSE;
-  GVariant *value = NULL;
+  StateTable *table;
+  GVariant *details;
 
   g_return_val_if_fail (UDISKS_IS_STATE (state), FALSE);
 
   g_mutex_lock (&state->lock);
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_MDRAID,
-                            G_VARIANT_TYPE ("a{ta{sv}}"));
-  if (value != NULL)
+  table = state_table_get (state, UDISKS_STATE_FILE_MDRAID);
+  details = state_table_lookup (table, g_variant_new_uint64 (raid_device));
+  if (details != NULL && out_uid != NULL)
     {
-      ret = iterate_list (value, _udisks_state_has_mdraid_list_visitor,
-                          (gpointer) &raid_device, (gpointer) out_uid);
-      g_variant_unref (value);
+      GVariant *lookup_value;
+      lookup_value = lookup_asv (details, "started-by-uid");
+      *out_uid = 0;
+      if (lookup_value != NULL)
+        {
+          *out_uid = g_variant_get_uint32 (lookup_value);
+          g_variant_unref (lookup_value);
+        }
     }
 
   g_mutex_unlock (&state->lock);
-  return ret;
+  return details != NULL;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -2155,57 +2045,25 @@ void
 udisks_state_add_module (UDisksState *state,
                          const gchar *module_name)
 {
-  GVariant *value;
-  GVariant *new_value;
-  GVariantBuilder builder;
+  StateTable *table;
 
   g_return_if_fail (UDISKS_IS_STATE (state));
 
   g_mutex_lock (&state->lock);
 
-  /* load existing entries */
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_MODULES,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
+  table = state_table_get (state, UDISKS_STATE_FILE_MODULES);
 
-  /* start by including existing entries */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sa{sv}}"));
-  if (value != NULL)
+  /* the new entry replaces any stale one */
+  if (state_table_lookup (table, g_variant_new_string (module_name)) != NULL)
     {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
-        {
-          const gchar *entry_module_name;
-          g_variant_get (child, "{&s@a{sv}}", &entry_module_name, NULL);
-          /* Skip/remove stale entries */
-          if (g_strcmp0 (entry_module_name, module_name) == 0)
-            {
-              udisks_warning ("Removing stale entry for module '%s' in /run/udisks2/modules file",
-                              entry_module_name);
-            }
-          else
-            {
-              g_variant_builder_add_value (&builder, child);
-            }
-          g_variant_unref (child);
-        }
-      g_variant_unref (value);
+      udisks_warning ("Removing stale entry for module '%s' in /run/udisks2/modules file",
+                      module_name);
     }
 
-  /* finally add the new entry */
-  g_variant_builder_add (&builder,
-                         "{s@a{sv}}",
-                         module_name,
-                         g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0));
-  new_value = g_variant_builder_end (&builder);
-
-  /* save new entries */
-  udisks_state_set (state,
-                    UDISKS_STATE_FILE_MODULES,
-                    G_VARIANT_TYPE ("a{sa{sv}}"),
-                    new_value /* consumes new_value */);
+  /* add the new entry */
+  state_table_put (table,
+                   g_variant_new_string (module_name),
+                   g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0));
 
   g_mutex_unlock (&state->lock);
 }
@@ -2220,20 +2078,12 @@ udisks_state_add_module (UDisksState *state,
 void
 udisks_state_clear_modules (UDisksState *state)
 {
-  gchar *path;
-
   g_return_if_fail (UDISKS_IS_STATE (state));
 
   g_mutex_lock (&state->lock);
 
   /* just remove the file entirely */
-  path = get_state_file_path (UDISKS_STATE_FILE_MODULES);
-  if (g_unlink (path))
-    {
-      if (errno != ENOENT)
-        g_warning ("Error removing state file %s: %m", path);
-    }
-  g_free (path);
+  state_table_clear (state_table_get (state, UDISKS_STATE_FILE_MODULES));
 
   g_mutex_unlock (&state->lock);
 }
@@ -2250,8 +2100,10 @@ udisks_state_clear_modules (UDisksState *state)
 gchar **
 udisks_state_get_modules (UDisksState *state)
 {
+  StateTable *table;
   GPtrArray *list;
-  GVariant *value;
+  GHashTableIter iter;
+  GVariant *key;
 
   g_return_val_if_fail (UDISKS_IS_STATE (state), NULL);
 
@@ -2259,23 +2111,10 @@ udisks_state_get_modules (UDisksState *state)
 
   list = g_ptr_array_new ();
 
-  value = udisks_state_get (state,
-                            UDISKS_STATE_FILE_MODULES,
-                            G_VARIANT_TYPE ("a{sa{sv}}"));
-  if (value != NULL)
-    {
-      GVariantIter iter;
-      GVariant *child;
-      g_variant_iter_init (&iter, value);
-      while ((child = g_variant_iter_next_value (&iter)) != NULL)
-        {
-          gchar *entry_module_name;
-          g_variant_get (child, "{s@a{sv}}", &entry_module_name, NULL);
-          g_ptr_array_add (list, entry_module_name);
-          g_variant_unref (child);
-        }
-      g_variant_unref (value);
-    }
+  table = state_table_get (state, UDISKS_STATE_FILE_MODULES);
+  g_hash_table_iter_init (&iter, table->entries);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+    g_ptr_array_add (list, g_variant_dup_string (key, NULL));
 
   g_mutex_unlock (&state->lock);
 
@@ -2297,124 +2136,526 @@ get_state_file_path (const gchar *key)
   return g_strdup_printf ("/run/udisks2/%s", key);
 }
 
+static const StateFileInfo *
+get_state_file_info (const gchar *key)
+{
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (state_files); n++)
+    {
+      if (g_str_equal (state_files[n].key, key))
+        return &state_files[n];
+    }
+  g_assert_not_reached ();
+  return NULL;
+}
+
+static void
+state_table_free (StateTable *table)
+{
+  g_hash_table_unref (table->entries);
+  g_hash_table_unref (table->by_dev);
+  g_free (table->snapshot_checksum);
+  g_free (table->journal_path);
+  g_free (table->path);
+  g_free (table);
+}
+
+/* returns the device number @details are indexed by or 0 */
+static guint64
+state_table_get_indexed_dev (StateTable *table,
+                             GVariant   *details)
+{
+  GVariant *dev_value;
+  guint64 dev;
+
+  if (table->info->dev_detail == NULL)
+    return 0;
+
+  dev_value = lookup_asv (details, table->info->dev_detail);
+  if (dev_value == NULL)
+    return 0;
+  dev = g_variant_is_of_type (dev_value, G_VARIANT_TYPE_UINT64) ? g_variant_get_uint64 (dev_value) : 0;
+  g_variant_unref (dev_value);
+
+  return dev;
+}
+
+/* only updates the in-memory table, takes a reference to @key and @details */
+static void
+state_table_insert_entry (StateTable *table,
+                          GVariant   *key,
+                          GVariant   *details)
+{
+  GPtrArray *keys;
+  guint64 dev;
+
+  dev = state_table_get_indexed_dev (table, details);
+  if (dev != 0)
+    {
+      keys = g_hash_table_lookup (table->by_dev, &dev);
+      if (keys == NULL)
+        {
+          keys = g_ptr_array_new_with_free_func ((GDestroyNotify) g_variant_unref);
+          g_hash_table_insert (table->by_dev, g_memdup2 (&dev, sizeof (dev)), keys);
+        }
+      g_ptr_array_add (keys, g_variant_ref (key));
+    }
+
+  g_hash_table_insert (table->entries, g_variant_ref (key), g_variant_ref (details));
+}
+
+/* only updates the in-memory table, returns FALSE if there's no entry for @key */
+static gboolean
+state_table_remove_entry (StateTable *table,
+                          GVariant   *key)
+{
+  GVariant *details;
+  GPtrArray *keys;
+  guint64 dev;
+  guint n;
+
+  details = g_hash_table_lookup (table->entries, key);
+  if (details == NULL)
+    return FALSE;
+
+  dev = state_table_get_indexed_dev (table, details);
+  keys = dev != 0 ? g_hash_table_lookup (table->by_dev, &dev) : NULL;
+  if (keys != NULL)
+    {
+      for (n = 0; n < keys->len; n++)
+        {
+          if (g_variant_equal (g_ptr_array_index (keys, n), key))
+            {
+              g_ptr_array_remove_index (keys, n);
+              break;
+            }
+        }
+      if (keys->len == 0)
+        g_hash_table_remove (table->by_dev, &dev);
+    }
+
+  g_hash_table_remove (table->entries, key);
+  return TRUE;
+}
+
+/* returns the contents of @table in the state file format, free with g_variant_unref() */
 static GVariant *
-udisks_state_get (UDisksState           *state,
-                  const gchar           *key,
-                  const GVariantType    *type)
+state_table_dup_contents (StateTable *table)
 {
-  gchar *path;
-  GVariant *ret;
+  GVariantBuilder builder;
+  GHashTableIter iter;
+  GVariant *key;
+  GVariant *details;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (table->info->type));
+  g_hash_table_iter_init (&iter, table->entries);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &details))
+    g_variant_builder_add_value (&builder, g_variant_new_dict_entry (key, details));
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/* serializes a journal record, returns the size of the data */
+static gsize
+journal_record_new (guchar    op,
+                    GVariant *key,
+                    GVariant *details,
+                    gchar   **out_data)
+{
+  GVariant *record;
+  GVariant *normalized;
+  guint32 size_le;
+  gsize size;
+  gchar *data;
+
+  if (details == NULL)
+    details = g_variant_new_array (G_VARIANT_TYPE ("{sv}"), NULL, 0);
+  record = g_variant_ref_sink (g_variant_new ("(yv@a{sv})", op, key, details));
+  normalized = g_variant_get_normal_form (record);
+
+  size = g_variant_get_size (normalized);
+  data = g_malloc (sizeof (size_le) + size);
+  size_le = GUINT32_TO_LE ((guint32) size);
+  memcpy (data, &size_le, sizeof (size_le));
+  g_variant_store (normalized, data + sizeof (size_le));
+
+  g_variant_unref (normalized);
+  g_variant_unref (record);
+
+  *out_data = data;
+  return sizeof (size_le) + size;
+}
+
+/* applies the journal on top of the loaded state file, stale or corrupted records are ignored */
+static void
+state_table_replay_journal (StateTable *table)
+{
+  const GVariantType *key_type;
   gchar *contents = NULL;
-  GError *local_error = NULL;
   gsize length = 0;
+  gsize offset = 0;
+  guint n_records = 0;
+  GError *error = NULL;
 
-  g_return_val_if_fail (UDISKS_IS_STATE (state), NULL);
-  g_return_val_if_fail (key != NULL, NULL);
-  g_return_val_if_fail (g_variant_type_is_definite (type), NULL);
+  if (!g_file_get_contents (table->journal_path, &contents, &length, &error))
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        udisks_warning ("Error reading state journal %s: %s", table->journal_path, error->message);
+      g_clear_error (&error);
+      return;
+    }
 
-  /* TODO:
-   *
-   * - could use a cache here to avoid loading files all the time
-   * - could also mmap the file
-   */
+  key_type = g_variant_type_key (g_variant_type_element (G_VARIANT_TYPE (table->info->type)));
+
+  while (length - offset >= sizeof (guint32))
+    {
+      guint32 size;
+      GBytes *bytes;
+      GVariant *record;
+      GVariant *key;
+      GVariant *details;
+      guchar op;
+
+      memcpy (&size, contents + offset, sizeof (size));
+      size = GUINT32_FROM_LE (size);
+      offset += sizeof (size);
+      if (size > length - offset)
+        {
+          udisks_warning ("Ignoring truncated record at the end of state journal %s", table->journal_path);
+          break;
+        }
+
+      /* copied, the tables outlive @contents */
+      bytes = g_bytes_new (contents + offset, size);
+      record = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (JOURNAL_RECORD_TYPE), bytes, FALSE));
+      g_bytes_unref (bytes);
+      offset += size;
+
+      g_variant_get (record, "(yv@a{sv})", &op, &key, &details);
+      if (n_records == 0)
+        {
+          /* the journal must have been started for the state file we have loaded */
+          if (op != JOURNAL_OP_HEADER ||
+              !g_variant_is_of_type (key, G_VARIANT_TYPE_STRING) ||
+              g_strcmp0 (g_variant_get_string (key, NULL), table->snapshot_checksum) != 0)
+            {
+              udisks_debug ("Ignoring stale state journal %s", table->journal_path);
+              g_variant_unref (details);
+              g_variant_unref (key);
+              g_variant_unref (record);
+              break;
+            }
+          table->journal_started = TRUE;
+        }
+      else if (op == JOURNAL_OP_PUT && g_variant_is_of_type (key, key_type))
+        {
+          state_table_remove_entry (table, key);
+          state_table_insert_entry (table, key, details);
+        }
+      else if (op == JOURNAL_OP_REMOVE && g_variant_is_of_type (key, key_type))
+        {
+          state_table_remove_entry (table, key);
+        }
+      n_records++;
 
-  path = get_state_file_path (key);
+      g_variant_unref (details);
+      g_variant_unref (key);
+      g_variant_unref (record);
+    }
 
-  /* see if it's already in the cache */
-  ret = g_hash_table_lookup (state->cache, path);
-  if (ret != NULL)
+  table->journal_records = table->journal_started ? n_records - 1 : 0;
+  g_free (contents);
+}
+
+static void
+state_table_load (StateTable *table)
+{
+  GVariant *value;
+  GVariantIter iter;
+  GVariant *child;
+  gchar *contents = NULL;
+  gsize length = 0;
+  GError *error = NULL;
+
+  if (!g_file_get_contents (table->path, &contents, &length, &error))
     {
-      g_variant_ref (ret);
-      goto out;
+      /* a missing file is not an error */
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        udisks_warning ("Error getting state data %s: %s (%s, %d)",
+                        table->info->key,
+                        error->message,
+                        g_quark_to_string (error->domain),
+                        error->code);
+      g_clear_error (&error);
     }
 
-  if (!g_file_get_contents (path,
-                            &contents,
-                            &length,
-                            &local_error))
+  table->snapshot_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) contents, length);
+
+  if (contents != NULL)
     {
-      if (local_error->domain == G_FILE_ERROR && local_error->code == G_FILE_ERROR_NOENT)
+      value = g_variant_new_from_data (G_VARIANT_TYPE (table->info->type),
+                                       (gconstpointer) contents,
+                                       length,
+                                       FALSE,
+                                       g_free,
+                                       contents);
+      g_variant_ref_sink (value);
+      contents = NULL; /* ownership transferred to the GVariant */
+
+      g_variant_iter_init (&iter, value);
+      while ((child = g_variant_iter_next_value (&iter)) != NULL)
         {
-          /* this is not an error */
-          g_clear_error (&local_error);
-          goto out;
-        }
+          GVariant *key = g_variant_get_child_value (child, 0);
+          GVariant *details = g_variant_get_child_value (child, 1);
 
-      udisks_warning ("Error getting state data %s: %s (%s, %d)",
-                      key,
-                      local_error->message,
-                      g_quark_to_string (local_error->domain),
-                      local_error->code);
-      g_clear_error (&local_error);
-      goto out;
+          state_table_remove_entry (table, key);
+          state_table_insert_entry (table, key, details);
+          g_variant_unref (details);
+          g_variant_unref (key);
+          g_variant_unref (child);
+        }
+      g_variant_unref (value);
     }
 
-  ret = g_variant_new_from_data (type,
-                                 (gconstpointer) contents,
-                                 length,
-                                 FALSE,
-                                 g_free,
-                                 contents);
-  g_warn_if_fail (ret != NULL);
-  g_variant_ref_sink (ret);
+  state_table_replay_journal (table);
+}
+
+/* called with state->lock held */
+static StateTable *
+state_table_get (UDisksState *state,
+                 const gchar *key)
+{
+  StateTable *table;
+
+  table = g_hash_table_lookup (state->tables, key);
+  if (table != NULL)
+    return table;
+
+  table = g_new0 (StateTable, 1);
+  table->info = get_state_file_info (key);
+  table->path = get_state_file_path (key);
+  table->journal_path = g_strdup_printf ("%s.journal", table->path);
+  table->entries = g_hash_table_new_full (g_variant_hash, g_variant_equal,
+                                          (GDestroyNotify) g_variant_unref, (GDestroyNotify) g_variant_unref);
+  table->by_dev = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+  state_table_load (table);
+
+  g_hash_table_insert (state->tables, (gpointer) table->info->key, table);
+  return table;
+}
 
-  contents = NULL; /* ownership transferred to the returned GVariant */
+/* called with state->lock held, returns the details for @key or %NULL, consumes a floating @key */
+static GVariant *
+state_table_lookup (StateTable *table,
+                    GVariant   *key)
+{
+  GVariant *details;
 
- out:
-  g_free (contents);
-  g_free (path);
-  return ret;
+  g_variant_ref_sink (key);
+  details = g_hash_table_lookup (table->entries, key);
+  g_variant_unref (key);
+
+  return details;
 }
 
-static gboolean
-udisks_state_set (UDisksState          *state,
-                  const gchar          *key,
-                  const GVariantType   *type,
-                  GVariant             *value)
+/* called with state->lock held, returns the key of the oldest entry whose indexed detail is @dev or %NULL */
+static GVariant *
+state_table_lookup_by_dev (StateTable  *table,
+                           dev_t        dev,
+                           GVariant   **out_details)
 {
-  gboolean ret = FALSE;
+  guint64 key = dev;
+  GPtrArray *keys;
+
+  keys = g_hash_table_lookup (table->by_dev, &key);
+  if (keys == NULL || keys->len == 0)
+    return NULL;
+
+  if (out_details != NULL)
+    *out_details = g_hash_table_lookup (table->entries, g_ptr_array_index (keys, 0));
+  return g_ptr_array_index (keys, 0);
+}
+
+/* called with state->lock held
+ *
+ * Writes the whole table to the state file in the original format and
+ * drops the journal. Crashing in between is fine - the journal will no
+ * longer match the state file and gets ignored.
+ */
+static void
+state_table_compact (StateTable *table)
+{
+  GVariant *value;
+  GVariant *normalized;
   gsize size;
-  gchar *path;
   gchar *data;
-  GVariant *normalized;
   GError *error = NULL;
 
-  g_return_val_if_fail (UDISKS_IS_STATE (state), FALSE);
-  g_return_val_if_fail (key != NULL, FALSE);
-  g_return_val_if_fail (g_variant_type_is_definite (type), FALSE);
-  g_return_val_if_fail (g_variant_is_of_type (value, type), FALSE);
-
-  g_variant_ref_sink (value);
+  value = state_table_dup_contents (table);
   normalized = g_variant_get_normal_form (value);
   size = g_variant_get_size (normalized);
   data = g_malloc (size ? size : 1); /* ensure the buffer is allocated even if size=0 */
   g_variant_store (normalized, data);
 
-  path = get_state_file_path (key);
-  g_hash_table_insert (state->cache, g_strdup (path), g_variant_ref (value));
-
-  if (!g_file_set_contents (path,
-                            data,
-                            size,
-                            &error))
+  if (!g_file_set_contents (table->path, data, size, &error))
     {
-      udisks_warning ("Error setting state data %s: %s (%s, %d)", key,
-                     error->message,
-                     g_quark_to_string (error->domain),
-                     error->code);
+      udisks_warning ("Error setting state data %s: %s (%s, %d)",
+                      table->info->key,
+                      error->message,
+                      g_quark_to_string (error->domain),
+                      error->code);
       g_clear_error (&error);
       goto out;
     }
 
-  ret = TRUE;
+  g_free (table->snapshot_checksum);
+  table->snapshot_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) data, size);
 
- out:
+  if (g_unlink (table->journal_path) != 0 && errno != ENOENT)
+    udisks_warning ("Error removing state journal %s: %m", table->journal_path);
+  table->journal_started = FALSE;
+  table->journal_records = 0;
 
-  g_free (path);
+ out:
   g_free (data);
   g_variant_unref (normalized);
   g_variant_unref (value);
-  return ret;
+}
+
+/* called with state->lock held, falls back to compacting @table when the record can't be written
+ *
+ * The record is on disk once this returns, just like the state file written
+ * by g_file_set_contents().
+ */
+static void
+state_table_append_journal (StateTable *table,
+                            guchar      op,
+                            GVariant   *key,
+                            GVariant   *details)
+{
+  gchar *data;
+  gsize size;
+  gsize written = 0;
+  gint fd;
+  GError *error = NULL;
+
+  if (!table->journal_started)
+    {
+      /* (re)start the journal with a header tying it to the current state file */
+      size = journal_record_new (JOURNAL_OP_HEADER, g_variant_new_string (table->snapshot_checksum), NULL, &data);
+      if (!g_file_set_contents (table->journal_path, data, size, &error))
+        {
+          udisks_warning ("Error creating state journal %s: %s", table->journal_path, error->message);
+          g_clear_error (&error);
+          g_free (data);
+          state_table_compact (table);
+          return;
+        }
+      g_free (data);
+      table->journal_started = TRUE;
+      table->journal_records = 0;
+    }
+
+  size = journal_record_new (op, key, details, &data);
+
+  fd = open (table->journal_path, O_WRONLY | O_APPEND | O_CLOEXEC);
+  if (fd < 0)
+    {
+      udisks_warning ("Error opening state journal %s: %m", table->journal_path);
+      g_free (data);
+      state_table_compact (table);
+      return;
+    }
+  while (written < size)
+    {
+      gssize ret = write (fd, data + written, size - written);
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          break;
+        }
+      written += ret;
+    }
+  if (written == size && fsync (fd) != 0)
+    written = 0;
+  close (fd);
+  g_free (data);
+
+  if (written < size)
+    {
+      /* a truncated record is ignored on replay, just make sure the state file is complete */
+      udisks_warning ("Error writing state journal %s: %m", table->journal_path);
+      state_table_compact (table);
+      return;
+    }
+
+  if (++table->journal_records >= STATE_JOURNAL_MAX_RECORDS)
+    state_table_compact (table);
+}
+
+/* called with state->lock held, adds or replaces the entry for @key, consumes floating @key and @details */
+static void
+state_table_put (StateTable *table,
+                 GVariant   *key,
+                 GVariant   *details)
+{
+  g_variant_ref_sink (key);
+  g_variant_ref_sink (details);
+
+  state_table_remove_entry (table, key);
+  state_table_insert_entry (table, key, details);
+  state_table_append_journal (table, JOURNAL_OP_PUT, key, details);
+
+  g_variant_unref (details);
+  g_variant_unref (key);
+}
+
+/* called with state->lock held */
+static void
+state_table_remove (StateTable *table,
+                    GVariant   *key)
+{
+  g_variant_ref_sink (key);
+
+  if (state_table_remove_entry (table, key))
+    state_table_append_journal (table, JOURNAL_OP_REMOVE, key, NULL);
+
+  g_variant_unref (key);
+}
+
+/* called with state->lock held */
+static void
+state_table_clear (StateTable *table)
+{
+  g_hash_table_remove_all (table->by_dev);
+  g_hash_table_remove_all (table->entries);
+
+  if (g_unlink (table->path) != 0 && errno != ENOENT)
+    udisks_warning ("Error removing state file %s: %m", table->path);
+  if (g_unlink (table->journal_path) != 0 && errno != ENOENT)
+    udisks_warning ("Error removing state journal %s: %m", table->journal_path);
+
+  g_free (table->snapshot_checksum);
+  table->snapshot_checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, NULL, 0);
+  table->journal_started = FALSE;
+  table->journal_records = 0;
+}
+
+/* called with state->lock held */
+static void
+udisks_state_compact (UDisksState *state)
+{
+  GHashTableIter iter;
+  StateTable *table;
+
+  g_hash_table_iter_init (&iter, state->tables);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &table))
+    {
+      if (table->journal_started)
+        state_table_compact (table);
+    }
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -35,6 +35,8 @@ UDisksDaemon  *udisks_state_get_daemon           (UDisksState   *state);
 void           udisks_state_start_cleanup        (UDisksState   *state);
 void           udisks_state_stop_cleanup         (UDisksState   *state);
 void           udisks_state_check                (UDisksState   *state);
+void           udisks_state_check_device         (UDisksState   *state,
+                                                  dev_t          device);
 void           udisks_state_check_block          (UDisksState   *state,
                                                   dev_t          block_device);
 /* mounted-fs */
@@ -0,0 +1,362 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "config.h"
+
+#include <glib/gi18n-lib.h>
+
+#include <string.h>
+
+#include "udisksstats.h"
+
+/**
+ * SECTION:udisksstats
+ * @title: UDisksStats
+ * @short_description: Daemon-wide counters and latency histograms
+ *
+ * This type collects cheap counters and log2-bucketed latency
+ * histograms for the hot paths of the daemon - uevent probing and
+ * dispatch, polkit checks, spawned jobs and housekeeping. Collection
+ * is disabled unless the <literal>collect_stats</literal> key is set
+ * in <filename>udisks2.conf</filename>. While it is disabled, all
+ * recording functions return immediately.
+ *
+ * The data is exported on the org.freedesktop.UDisks2.Manager.Stats
+ * D-Bus interface.
+ */
+
+/* Bucket 0 is for values < 1 usec, bucket n for [2^(n-1), 2^n) usec;
+ * the last bucket is open-ended.
+ */
+#define N_BUCKETS 32
+
+typedef struct
+{
+  guint64 count;
+  guint64 sum;
+  guint64 min;
+  guint64 max;
+  guint64 buckets[N_BUCKETS];
+} Histogram;
+
+struct _UDisksStats
+{
+  GObject parent_instance;
+
+  gboolean enabled;
+
+  GMutex lock;
+  gint64 since;
+  guint64 counters[UDISKS_STATS_N_COUNTERS];
+  Histogram histograms[UDISKS_STATS_N_HISTOGRAMS];
+};
+
+typedef struct _UDisksStatsClass UDisksStatsClass;
+
+struct _UDisksStatsClass
+{
+  GObjectClass parent_class;
+};
+
+static const gchar *counter_names[UDISKS_STATS_N_COUNTERS] =
+{
+  "uevents-received",     /* UDISKS_STATS_COUNTER_UEVENTS_RECEIVED */
+  "uevents-probed",       /* UDISKS_STATS_COUNTER_UEVENTS_PROBED */
+  "auth-cache-hits",      /* UDISKS_STATS_COUNTER_AUTH_CACHE_HITS */
+};
+
+static const gchar *histogram_names[UDISKS_STATS_N_HISTOGRAMS] =
+{
+  "probe-latency",          /* UDISKS_STATS_HISTOGRAM_PROBE_LATENCY */
+  "uevent-dispatch-delay",  /* UDISKS_STATS_HISTOGRAM_UEVENT_DISPATCH_DELAY */
+  "polkit-check",           /* UDISKS_STATS_HISTOGRAM_POLKIT_CHECK */
+  "spawned-job",            /* UDISKS_STATS_HISTOGRAM_SPAWNED_JOB */
+  "housekeeping",           /* UDISKS_STATS_HISTOGRAM_HOUSEKEEPING */
+};
+
+G_DEFINE_TYPE (UDisksStats, udisks_stats, G_TYPE_OBJECT);
+
+static void
+clear_locked (UDisksStats *stats)
+{
+  guint n;
+
+  memset (stats->counters, 0, sizeof (stats->counters));
+  memset (stats->histograms, 0, sizeof (stats->histograms));
+  for (n = 0; n < UDISKS_STATS_N_HISTOGRAMS; n++)
+    stats->histograms[n].min = G_MAXUINT64;
+  stats->since = g_get_real_time ();
+}
+
+static void
+udisks_stats_init (UDisksStats *stats)
+{
+  g_mutex_init (&stats->lock);
+  clear_locked (stats);
+}
+
+static void
+udisks_stats_finalize (GObject *object)
+{
+  UDisksStats *stats = UDISKS_STATS (object);
+
+  g_mutex_clear (&stats->lock);
+
+  G_OBJECT_CLASS (udisks_stats_parent_class)->finalize (object);
+}
+
+static void
+udisks_stats_class_init (UDisksStatsClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = udisks_stats_finalize;
+}
+
+/**
+ * udisks_stats_new:
+ * @enabled: Whether to actually collect anything.
+ *
+ * Creates a new #UDisksStats instance.
+ *
+ * Returns: A new #UDisksStats. Free with g_object_unref().
+ */
+UDisksStats *
+udisks_stats_new (gboolean enabled)
+{
+  UDisksStats *stats;
+
+  stats = UDISKS_STATS (g_object_new (UDISKS_TYPE_STATS, NULL));
+  stats->enabled = enabled;
+  return stats;
+}
+
+/**
+ * udisks_stats_get_enabled:
+ * @stats: A #UDisksStats.
+ *
+ * Gets whether @stats is collecting data.
+ *
+ * Returns: %TRUE if enabled, %FALSE otherwise.
+ */
+gboolean
+udisks_stats_get_enabled (UDisksStats *stats)
+{
+  g_return_val_if_fail (UDISKS_IS_STATS (stats), FALSE);
+  return stats->enabled;
+}
+
+/**
+ * udisks_stats_add:
+ * @stats: A #UDisksStats.
+ * @counter: A #UDisksStatsCounter.
+ * @value: The value to add.
+ *
+ * Adds @value to @counter.
+ *
+ * This function may be called from any thread.
+ */
+void
+udisks_stats_add (UDisksStats        *stats,
+                  UDisksStatsCounter  counter,
+                  guint64             value)
+{
+  g_return_if_fail (UDISKS_IS_STATS (stats));
+  g_return_if_fail (counter < UDISKS_STATS_N_COUNTERS);
+
+  if (!stats->enabled)
+    return;
+
+  g_mutex_lock (&stats->lock);
+  stats->counters[counter] += value;
+  g_mutex_unlock (&stats->lock);
+}
+
+/**
+ * udisks_stats_start:
+ * @stats: A #UDisksStats.
+ *
+ * Gets a timestamp to pass to udisks_stats_finish() when the measured
+ * operation completes.
+ *
+ * Returns: The current monotonic time or 0 if @stats is disabled.
+ */
+gint64
+udisks_stats_start (UDisksStats *stats)
+{
+  g_return_val_if_fail (UDISKS_IS_STATS (stats), 0);
+
+  if (!stats->enabled)
+    return 0;
+  return g_get_monotonic_time ();
+}
+
+/**
+ * udisks_stats_finish:
+ * @stats: A #UDisksStats.
+ * @histogram: A #UDisksStatsHistogram.
+ * @start_time: A value previously returned by udisks_stats_start().
+ *
+ * Records the time elapsed since @start_time in @histogram. Does
+ * nothing if @start_time is 0.
+ *
+ * This function may be called from any thread.
+ */
+void
+udisks_stats_finish (UDisksStats          *stats,
+                     UDisksStatsHistogram  histogram,
+                     gint64                start_time)
+{
+  gint64 now;
+
+  g_return_if_fail (UDISKS_IS_STATS (stats));
+
+  if (!stats->enabled || start_time == 0)
+    return;
+
+  now = g_get_monotonic_time ();
+  udisks_stats_record (stats, histogram, now > start_time ? (guint64) (now - start_time) : 0);
+}
+
+/**
+ * udisks_stats_record:
+ * @stats: A #UDisksStats.
+ * @histogram: A #UDisksStatsHistogram.
+ * @usec: The measured value, in microseconds.
+ *
+ * Records @usec in @histogram.
+ *
+ * This function may be called from any thread.
+ */
+void
+udisks_stats_record (UDisksStats          *stats,
+                     UDisksStatsHistogram  histogram,
+                     guint64               usec)
+{
+  Histogram *h;
+  guint bucket;
+
+  g_return_if_fail (UDISKS_IS_STATS (stats));
+  g_return_if_fail (histogram < UDISKS_STATS_N_HISTOGRAMS);
+
+  if (!stats->enabled)
+    return;
+
+  bucket = usec == 0 ? 0 : MIN (g_bit_storage (usec), N_BUCKETS - 1);
+
+  g_mutex_lock (&stats->lock);
+  h = &stats->histograms[histogram];
+  h->count++;
+  h->sum += usec;
+  h->min = MIN (h->min, usec);
+  h->max = MAX (h->max, usec);
+  h->buckets[bucket]++;
+  g_mutex_unlock (&stats->lock);
+}
+
+/**
+ * udisks_stats_reset:
+ * @stats: A #UDisksStats.
+ *
+ * Clears all counters and histograms and sets the collection start
+ * time to now.
+ */
+void
+udisks_stats_reset (UDisksStats *stats)
+{
+  g_return_if_fail (UDISKS_IS_STATS (stats));
+
+  g_mutex_lock (&stats->lock);
+  clear_locked (stats);
+  g_mutex_unlock (&stats->lock);
+}
+
+/**
+ * udisks_stats_get_since:
+ * @stats: A #UDisksStats.
+ *
+ * Gets the time collection started or was last reset.
+ *
+ * Returns: The wall-clock time in microseconds since the Epoch.
+ */
+gint64
+udisks_stats_get_since (UDisksStats *stats)
+{
+  gint64 ret;
+
+  g_return_val_if_fail (UDISKS_IS_STATS (stats), 0);
+
+  g_mutex_lock (&stats->lock);
+  ret = stats->since;
+  g_mutex_unlock (&stats->lock);
+  return ret;
+}
+
+/**
+ * udisks_stats_snapshot:
+ * @stats: A #UDisksStats.
+ * @out_counters: (out): Return location for a floating 'a{st}' #GVariant.
+ * @out_histograms: (out): Return location for a floating 'a{s(ttttat)}' #GVariant.
+ *
+ * Takes a consistent snapshot of all counters and histograms in the
+ * format used by the org.freedesktop.UDisks2.Manager.Stats.GetStats()
+ * D-Bus method.
+ */
+void
+udisks_stats_snapshot (UDisksStats  *stats,
+                       GVariant    **out_counters,
+                       GVariant    **out_histograms)
+{
+  guint64 counters[UDISKS_STATS_N_COUNTERS];
+  Histogram histograms[UDISKS_STATS_N_HISTOGRAMS];
+  GVariantBuilder builder;
+  guint n;
+
+  g_return_if_fail (UDISKS_IS_STATS (stats));
+  g_return_if_fail (out_counters != NULL && out_histograms != NULL);
+
+  g_mutex_lock (&stats->lock);
+  memcpy (counters, stats->counters, sizeof (counters));
+  memcpy (histograms, stats->histograms, sizeof (histograms));
+  g_mutex_unlock (&stats->lock);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+  for (n = 0; n < UDISKS_STATS_N_COUNTERS; n++)
+    g_variant_builder_add (&builder, "{st}", counter_names[n], counters[n]);
+  *out_counters = g_variant_builder_end (&builder);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{s(ttttat)}"));
+  for (n = 0; n < UDISKS_STATS_N_HISTOGRAMS; n++)
+    {
+      Histogram *h = &histograms[n];
+
+      g_variant_builder_add (&builder, "{s@(ttttat)}",
+                             histogram_names[n],
+                             g_variant_new ("(tttt@at)",
+                                            h->count,
+                                            h->sum,
+                                            h->count > 0 ? h->min : 0,
+                                            h->max,
+                                            g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+                                                                       h->buckets,
+                                                                       N_BUCKETS,
+                                                                       sizeof (guint64))));
+    }
+  *out_histograms = g_variant_builder_end (&builder);
+}
@@ -0,0 +1,89 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __UDISKS_STATS_H__
+#define __UDISKS_STATS_H__
+
+#include "udisksdaemontypes.h"
+
+G_BEGIN_DECLS
+
+#define UDISKS_TYPE_STATS         (udisks_stats_get_type ())
+#define UDISKS_STATS(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), UDISKS_TYPE_STATS, UDisksStats))
+#define UDISKS_IS_STATS(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), UDISKS_TYPE_STATS))
+
+/**
+ * UDisksStatsCounter:
+ * @UDISKS_STATS_COUNTER_UEVENTS_RECEIVED: Uevents received from udev.
+ * @UDISKS_STATS_COUNTER_UEVENTS_PROBED: Uevents probed in the probing threads.
+ * @UDISKS_STATS_COUNTER_AUTH_CACHE_HITS: Authorization checks answered from #UDisksAuthCache.
+ * @UDISKS_STATS_N_COUNTERS: The number of counters.
+ *
+ * Counters kept by #UDisksStats.
+ */
+typedef enum
+{
+  UDISKS_STATS_COUNTER_UEVENTS_RECEIVED,
+  UDISKS_STATS_COUNTER_UEVENTS_PROBED,
+  UDISKS_STATS_COUNTER_AUTH_CACHE_HITS,
+  UDISKS_STATS_N_COUNTERS
+} UDisksStatsCounter;
+
+/**
+ * UDisksStatsHistogram:
+ * @UDISKS_STATS_HISTOGRAM_PROBE_LATENCY: Time spent probing a uevent.
+ * @UDISKS_STATS_HISTOGRAM_UEVENT_DISPATCH_DELAY: Time between a uevent being probed and being handled.
+ * @UDISKS_STATS_HISTOGRAM_POLKIT_CHECK: Duration of polkit authorization checks.
+ * @UDISKS_STATS_HISTOGRAM_SPAWNED_JOB: Duration of spawned jobs.
+ * @UDISKS_STATS_HISTOGRAM_HOUSEKEEPING: Duration of housekeeping runs of individual drives.
+ * @UDISKS_STATS_N_HISTOGRAMS: The number of histograms.
+ *
+ * Latency histograms kept by #UDisksStats.
+ */
+typedef enum
+{
+  UDISKS_STATS_HISTOGRAM_PROBE_LATENCY,
+  UDISKS_STATS_HISTOGRAM_UEVENT_DISPATCH_DELAY,
+  UDISKS_STATS_HISTOGRAM_POLKIT_CHECK,
+  UDISKS_STATS_HISTOGRAM_SPAWNED_JOB,
+  UDISKS_STATS_HISTOGRAM_HOUSEKEEPING,
+  UDISKS_STATS_N_HISTOGRAMS
+} UDisksStatsHistogram;
+
+GType         udisks_stats_get_type      (void) G_GNUC_CONST;
+UDisksStats  *udisks_stats_new           (gboolean              enabled);
+gboolean      udisks_stats_get_enabled   (UDisksStats          *stats);
+void          udisks_stats_add           (UDisksStats          *stats,
+                                          UDisksStatsCounter    counter,
+                                          guint64               value);
+gint64        udisks_stats_start         (UDisksStats          *stats);
+void          udisks_stats_finish        (UDisksStats          *stats,
+                                          UDisksStatsHistogram  histogram,
+                                          gint64                start_time);
+void          udisks_stats_record        (UDisksStats          *stats,
+                                          UDisksStatsHistogram  histogram,
+                                          guint64               usec);
+void          udisks_stats_reset         (UDisksStats          *stats);
+gint64        udisks_stats_get_since     (UDisksStats          *stats);
+void          udisks_stats_snapshot      (UDisksStats          *stats,
+                                          GVariant            **out_counters,
+                                          GVariant            **out_histograms);
+
+G_END_DECLS
+
+#endif /* __UDISKS_STATS_H__ */
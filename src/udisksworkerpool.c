@@ -0,0 +1,266 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "config.h"
+
+#include "udisksworkerpool.h"
+#include "udiskslogging.h"
+
+/**
+ * SECTION:udisksworkerpool
+ * @title: UDisksWorkerPool
+ * @short_description: Bounded thread pool with per-item timeouts
+ *
+ * This type runs pieces of work in a bounded number of threads. Work
+ * that doesn't finish in time gets its #GCancellable cancelled, but
+ * the blocking calls it may be stuck in can't be interrupted. So that
+ * such work doesn't keep the rest of the queue waiting, the pool gets
+ * an extra thread for every piece of work that timed out, until it
+ * finishes.
+ */
+
+struct _UDisksWorkerPool
+{
+  GObject parent_instance;
+
+  UDisksWorkerPoolFunc func;
+  GFunc timeout_func;
+  gpointer user_data;
+  GDestroyNotify data_free_func;
+  guint max_workers;
+  guint timeout_msec;
+
+  GThreadPool *thread_pool;
+
+  GMutex lock;
+  guint n_timed_out;              /* timed out and still running */
+};
+
+typedef struct _UDisksWorkerPoolClass UDisksWorkerPoolClass;
+
+struct _UDisksWorkerPoolClass
+{
+  GObjectClass parent_class;
+};
+
+G_DEFINE_TYPE (UDisksWorkerPool, udisks_worker_pool, G_TYPE_OBJECT);
+
+typedef enum
+{
+  WORK_RUNNING,
+  WORK_TIMED_OUT,
+  WORK_DONE
+} WorkState;
+
+/* shared by the worker thread and the timeout source */
+typedef struct
+{
+  UDisksWorkerPool *pool;
+  gpointer data;
+  GCancellable *cancellable;
+  WorkState state;                /* protected by pool->lock */
+} Work;
+
+static void worker_pool_thread_func (gpointer data,
+                                     gpointer user_data);
+
+static void
+udisks_worker_pool_init (UDisksWorkerPool *pool)
+{
+  g_mutex_init (&pool->lock);
+}
+
+static void
+udisks_worker_pool_finalize (GObject *object)
+{
+  UDisksWorkerPool *pool = UDISKS_WORKER_POOL (object);
+
+  /* every piece of work holds a reference, so the pool is idle by now */
+  g_thread_pool_free (pool->thread_pool, FALSE, FALSE);
+  g_mutex_clear (&pool->lock);
+
+  G_OBJECT_CLASS (udisks_worker_pool_parent_class)->finalize (object);
+}
+
+static void
+udisks_worker_pool_class_init (UDisksWorkerPoolClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = udisks_worker_pool_finalize;
+}
+
+/**
+ * udisks_worker_pool_new:
+ * @func: Function doing the work, called in a pool thread.
+ * @timeout_func: (nullable): Function called in the main thread with the data and @user_data when a piece of work times out.
+ * @user_data: User data passed to @func and @timeout_func.
+ * @data_free_func: (nullable): Function used to free the data passed to udisks_worker_pool_push().
+ * @max_workers: Maximum number of pieces of work done in parallel.
+ * @timeout_msec: Time after which a piece of work is cancelled and no longer waited for.
+ *
+ * Creates a new #UDisksWorkerPool. The timeouts are dispatched in the
+ * global default main context.
+ *
+ * Returns: A #UDisksWorkerPool. Free with g_object_unref().
+ */
+UDisksWorkerPool *
+udisks_worker_pool_new (UDisksWorkerPoolFunc  func,
+                        GFunc                 timeout_func,
+                        gpointer              user_data,
+                        GDestroyNotify        data_free_func,
+                        guint                 max_workers,
+                        guint                 timeout_msec)
+{
+  UDisksWorkerPool *pool;
+
+  g_return_val_if_fail (func != NULL, NULL);
+  g_return_val_if_fail (max_workers > 0, NULL);
+
+  pool = UDISKS_WORKER_POOL (g_object_new (UDISKS_TYPE_WORKER_POOL, NULL));
+  pool->func = func;
+  pool->timeout_func = timeout_func;
+  pool->user_data = user_data;
+  pool->data_free_func = data_free_func;
+  pool->max_workers = max_workers;
+  pool->timeout_msec = timeout_msec;
+  pool->thread_pool = g_thread_pool_new (worker_pool_thread_func, NULL, max_workers, FALSE, NULL);
+
+  return pool;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+work_clear (Work *work)
+{
+  if (work->pool->data_free_func != NULL)
+    work->pool->data_free_func (work->data);
+  g_object_unref (work->cancellable);
+  g_object_unref (work->pool);
+}
+
+static void
+work_release (gpointer data)
+{
+  g_atomic_rc_box_release_full (data, (GDestroyNotify) work_clear);
+}
+
+/* Called with pool->lock held */
+static void
+worker_pool_update_max_threads (UDisksWorkerPool *pool)
+{
+  GError *error = NULL;
+
+  if (!g_thread_pool_set_max_threads (pool->thread_pool, pool->max_workers + pool->n_timed_out, &error))
+    {
+      udisks_warning ("Error resizing worker pool: %s", error->message);
+      g_clear_error (&error);
+    }
+}
+
+/* called in the main thread when a piece of work takes too long */
+static gboolean
+on_work_timeout (gpointer user_data)
+{
+  Work *work = user_data;
+  UDisksWorkerPool *pool = work->pool;
+  gboolean timed_out = FALSE;
+
+  g_mutex_lock (&pool->lock);
+  if (work->state == WORK_RUNNING)
+    {
+      /* the thread is stuck, let another one take over its slot */
+      work->state = WORK_TIMED_OUT;
+      pool->n_timed_out++;
+      worker_pool_update_max_threads (pool);
+      timed_out = TRUE;
+    }
+  g_mutex_unlock (&pool->lock);
+
+  if (timed_out)
+    {
+      g_cancellable_cancel (work->cancellable);
+      if (pool->timeout_func != NULL)
+        pool->timeout_func (work->data, pool->user_data);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Runs in one of the pool threads */
+static void
+worker_pool_thread_func (gpointer data,
+                         gpointer user_data)
+{
+  Work *work = data;
+  UDisksWorkerPool *pool = work->pool;
+  GSource *timeout_source;
+
+  timeout_source = g_timeout_source_new (pool->timeout_msec);
+  g_source_set_callback (timeout_source,
+                         on_work_timeout,
+                         g_atomic_rc_box_acquire (work),
+                         work_release);
+  g_source_attach (timeout_source, NULL);
+
+  pool->func (work->data, work->cancellable, pool->user_data);
+
+  g_mutex_lock (&pool->lock);
+  if (work->state == WORK_TIMED_OUT)
+    {
+      /* give back the extra slot, this thread exits once it returns */
+      pool->n_timed_out--;
+      worker_pool_update_max_threads (pool);
+    }
+  work->state = WORK_DONE;
+  g_mutex_unlock (&pool->lock);
+
+  g_source_destroy (timeout_source);
+  g_source_unref (timeout_source);
+
+  work_release (work);
+}
+
+/**
+ * udisks_worker_pool_push:
+ * @pool: A #UDisksWorkerPool.
+ * @data: Data to pass to the work function.
+ *
+ * Queues a piece of work in @pool. It is done as soon as one of the
+ * threads is free; its timeout starts then.
+ *
+ * Can be called from any thread.
+ */
+void
+udisks_worker_pool_push (UDisksWorkerPool *pool,
+                         gpointer          data)
+{
+  Work *work;
+
+  g_return_if_fail (UDISKS_IS_WORKER_POOL (pool));
+
+  work = g_atomic_rc_box_new0 (Work);
+  work->pool = g_object_ref (pool);
+  work->data = data;
+  work->cancellable = g_cancellable_new ();
+  work->state = WORK_RUNNING;
+
+  g_thread_pool_push (pool->thread_pool, work, NULL);
+}
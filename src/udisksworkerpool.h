@@ -0,0 +1,55 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef __UDISKS_WORKER_POOL_H__
+#define __UDISKS_WORKER_POOL_H__
+
+#include "udisksdaemontypes.h"
+
+G_BEGIN_DECLS
+
+#define UDISKS_TYPE_WORKER_POOL         (udisks_worker_pool_get_type ())
+#define UDISKS_WORKER_POOL(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), UDISKS_TYPE_WORKER_POOL, UDisksWorkerPool))
+#define UDISKS_IS_WORKER_POOL(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), UDISKS_TYPE_WORKER_POOL))
+
+/**
+ * UDisksWorkerPoolFunc:
+ * @data: The data passed to udisks_worker_pool_push().
+ * @cancellable: A #GCancellable cancelled when the work takes too long.
+ * @user_data: The user data passed to udisks_worker_pool_new().
+ *
+ * Type for the function doing a piece of work in a #UDisksWorkerPool
+ * thread.
+ */
+typedef void (*UDisksWorkerPoolFunc) (gpointer      data,
+                                      GCancellable *cancellable,
+                                      gpointer      user_data);
+
+GType              udisks_worker_pool_get_type  (void) G_GNUC_CONST;
+UDisksWorkerPool  *udisks_worker_pool_new       (UDisksWorkerPoolFunc  func,
+                                                 GFunc                 timeout_func,
+                                                 gpointer              user_data,
+                                                 GDestroyNotify        data_free_func,
+                                                 guint                 max_workers,
+                                                 guint                 timeout_msec);
+void               udisks_worker_pool_push      (UDisksWorkerPool     *pool,
+                                                 gpointer              data);
+
+G_END_DECLS
+
+#endif /* __UDISKS_WORKER_POOL_H__ */
@@ -3523,6 +3523,223 @@ handle_command_status (gint        *argc,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static gboolean opt_stats_reset = FALSE;
+static gboolean opt_stats_no_user_interaction = FALSE;
+
+static const GOptionEntry command_stats_entries[] =
+{
+  {
+    "reset",
+    0, /* no short option */
+    0,
+    G_OPTION_ARG_NONE,
+    &opt_stats_reset,
+    "Reset the statistics",
+    NULL
+  },
+  {
+    "no-user-interaction",
+    0, /* no short option */
+    0,
+    G_OPTION_ARG_NONE,
+    &opt_stats_no_user_interaction,
+    "Do not authenticate the user if needed",
+    NULL
+  },
+  {
+    NULL
+  }
+};
+
+static void
+stats_print_histogram (const gchar *name,
+                       GVariant    *histogram)
+{
+  guint64 count, sum, min, max;
+  GVariant *buckets;
+  const guint64 *values;
+  gsize n_values;
+  gsize n;
+
+  g_variant_get (histogram, "(tttt@at)", &count, &sum, &min, &max, &buckets);
+  values = g_variant_get_fixed_array (buckets, &n_values, sizeof (guint64));
+
+  g_print ("  %-22s count %" G_GUINT64_FORMAT, name, count);
+  if (count > 0)
+    g_print (", avg %" G_GUINT64_FORMAT " us, min %" G_GUINT64_FORMAT " us, max %" G_GUINT64_FORMAT " us",
+             sum / count, min, max);
+  g_print ("\n");
+
+  for (n = 0; n < n_values; n++)
+    {
+      gchar *range;
+
+      if (values[n] == 0)
+        continue;
+      if (n == 0)
+        range = g_strdup ("< 1 us");
+      else if (n == n_values - 1)
+        range = g_strdup_printf (">= %" G_GUINT64_FORMAT " us", (guint64) 1 << (n - 1));
+      else
+        range = g_strdup_printf ("%" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT " us",
+                                 (guint64) 1 << (n - 1), ((guint64) 1 << n) - 1);
+      g_print ("    %-24s %" G_GUINT64_FORMAT "\n", range, values[n]);
+      g_free (range);
+    }
+
+  g_variant_unref (buckets);
+}
+
+static gint
+handle_command_stats (gint        *argc,
+                      gchar      **argv[],
+                      gboolean     request_completion,
+                      const gchar *completion_cur,
+                      const gchar *completion_prev)
+{
+  gint ret;
+  GOptionContext *o;
+  gchar *s;
+  UDisksObject *object = NULL;
+  UDisksManagerStats *stats;
+  GVariant *options = NULL;
+  GVariant *counters = NULL;
+  GVariant *histograms = NULL;
+  GVariantBuilder builder;
+  GVariantIter iter;
+  const gchar *name;
+  GVariant *value;
+  guint64 count;
+  GDateTime *since;
+  GError *error;
+
+  ret = 1;
+  opt_stats_reset = FALSE;
+  opt_stats_no_user_interaction = FALSE;
+
+  modify_argv0_for_command (argc, argv, "stats");
+
+  o = g_option_context_new (NULL);
+  if (request_completion)
+    g_option_context_set_ignore_unknown_options (o, TRUE);
+  g_option_context_set_help_enabled (o, !request_completion);
+  g_option_context_set_summary (o, "Show daemon performance statistics.");
+  g_option_context_add_main_entries (o, command_stats_entries, NULL /* GETTEXT_PACKAGE*/);
+
+  if (!g_option_context_parse (o, argc, argv, NULL))
+    {
+      if (!request_completion)
+        {
+          s = g_option_context_get_help (o, FALSE, NULL);
+          g_printerr ("%s", s);
+          g_free (s);
+          goto out;
+        }
+    }
+
+  if (request_completion)
+    {
+      if (!opt_stats_reset)
+        g_print ("--reset \n");
+      if (!opt_stats_no_user_interaction)
+        g_print ("--no-user-interaction \n");
+      goto out;
+    }
+
+  object = lookup_object_by_path ("Manager");
+  stats = object != NULL ? udisks_object_peek_manager_stats (object) : NULL;
+  if (stats == NULL)
+    {
+      g_printerr ("Statistics collection is not enabled, set collect_stats=true in udisks2.conf\n");
+      goto out;
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  if (opt_stats_no_user_interaction)
+    {
+      g_variant_builder_add (&builder,
+                             "{sv}",
+                             "auth.no_user_interaction", g_variant_new_boolean (TRUE));
+    }
+  options = g_variant_builder_end (&builder);
+  g_variant_ref_sink (options);
+
+  if (opt_stats_reset)
+    {
+    try_again:
+      error = NULL;
+      if (!udisks_manager_stats_call_reset_stats_sync (stats,
+                                                       options,
+                                                       NULL,                       /* GCancellable */
+                                                       &error))
+        {
+          if (error->domain == UDISKS_ERROR &&
+              error->code == UDISKS_ERROR_NOT_AUTHORIZED_CAN_OBTAIN &&
+              setup_local_polkit_agent ())
+            {
+              g_clear_error (&error);
+              goto try_again;
+            }
+          g_dbus_error_strip_remote_error (error);
+          g_printerr ("Error resetting statistics: %s (%s, %d)\n",
+                      error->message, g_quark_to_string (error->domain), error->code);
+          g_clear_error (&error);
+          goto out;
+        }
+      ret = 0;
+      goto out;
+    }
+
+  error = NULL;
+  if (!udisks_manager_stats_call_get_stats_sync (stats,
+                                                 options,
+                                                 &counters,
+                                                 &histograms,
+                                                 NULL,                       /* GCancellable */
+                                                 &error))
+    {
+      g_dbus_error_strip_remote_error (error);
+      g_printerr ("Error getting statistics: %s (%s, %d)\n",
+                  error->message, g_quark_to_string (error->domain), error->code);
+      g_clear_error (&error);
+      goto out;
+    }
+
+  since = g_date_time_new_from_unix_local (udisks_manager_stats_get_since (stats) / G_USEC_PER_SEC);
+  s = g_date_time_format (since, "%c");
+  g_print ("Collected since %s\n\n", s);
+  g_free (s);
+  g_date_time_unref (since);
+
+  g_print ("Counters:\n");
+  g_variant_iter_init (&iter, counters);
+  while (g_variant_iter_next (&iter, "{&st}", &name, &count))
+    g_print ("  %-22s %" G_GUINT64_FORMAT "\n", name, count);
+
+  g_print ("\nHistograms:\n");
+  g_variant_iter_init (&iter, histograms);
+  while (g_variant_iter_next (&iter, "{&s@(ttttat)}", &name, &value))
+    {
+      stats_print_histogram (name, value);
+      g_variant_unref (value);
+    }
+
+  ret = 0;
+
+ out:
+  if (counters != NULL)
+    g_variant_unref (counters);
+  if (histograms != NULL)
+    g_variant_unref (histograms);
+  if (options != NULL)
+    g_variant_unref (options);
+  g_clear_object (&object);
+  g_option_context_free (o);
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 static void
 usage (gint *argc, gchar **argv[], gboolean use_stdout)
 {
@@ -3544,6 +3761,7 @@ usage (gint *argc, gchar **argv[], gboolean use_stdout)
                        "  info              Shows information about an object\n"
                        "  dump              Shows information about all objects\n"
                        "  status            Shows high-level status\n"
+                       "  stats             Shows daemon performance statistics\n"
                        "  monitor           Monitor changes to objects\n"
                        "  mount             Mount a filesystem\n"
                        "  unmount           Unmount a filesystem\n"
@@ -3798,6 +4016,15 @@ main (int argc,
                                    completion_prev);
       goto out;
     }
+  else if (g_strcmp0 (command, "stats") == 0)
+    {
+      ret = handle_command_stats (&argc,
+                                  &argv,
+                                  request_completion,
+                                  completion_cur,
+                                  completion_prev);
+      goto out;
+    }
   else if (g_strcmp0 (command, "complete") == 0 && argc == 4 && !request_completion)
     {
       const gchar *completion_line;
@@ -3870,6 +4097,7 @@ main (int argc,
                    "dump \n"
                    "monitor \n"
                    "status \n"
+                   "stats \n"
                    "mount \n"
                    "unmount \n"
                    "lock \n"
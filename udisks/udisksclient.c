@@ -57,8 +57,30 @@ struct _UDisksClient
   GMainContext *context;
 
   GSource *changed_timeout_source;
+
+  /* lookup indexes, maintained from the object manager signal handlers */
+  GMutex index_lock;
+  GHashTable *index;              /* UDisksObject -> IndexEntry */
+  GHashTable *blocks_by_label;    /* label -> set of UDisksObject */
+  GHashTable *blocks_by_uuid;     /* UUID -> set of UDisksObject */
+  GHashTable *blocks_by_dev;      /* guint64 -> set of UDisksObject */
+  GHashTable *blocks_by_drive;    /* drive object path -> set of (non-partition) UDisksObject */
+  GHashTable *partitions_by_table;/* table object path -> set of UDisksObject */
+  GHashTable *jobs_by_object;     /* object path -> set of UDisksObject with a job */
 };
 
+/* the keys an object is currently indexed by */
+typedef struct
+{
+  gboolean has_block;
+  gchar *label;
+  gchar *uuid;
+  guint64 dev;
+  gchar *drive;
+  gchar *table;
+  gchar **job_objects;
+} IndexEntry;
+
 typedef struct
 {
   GObjectClass parent_class;
@@ -111,6 +133,12 @@ static void on_interface_proxy_properties_changed (GDBusObjectManagerClient   *m
 
 static void maybe_emit_changed_now (UDisksClient *client);
 
+static void update_index (UDisksClient *client,
+                          UDisksObject *object);
+
+static void remove_from_index (UDisksClient *client,
+                               UDisksObject *object);
+
 static void init_interface_proxy (UDisksClient *client,
                                   GDBusProxy   *proxy);
 
@@ -158,9 +186,29 @@ udisks_client_finalize (GObject *object)
 
   g_clear_object (&client->bus_connection);
 
+  g_hash_table_destroy (client->blocks_by_label);
+  g_hash_table_destroy (client->blocks_by_uuid);
+  g_hash_table_destroy (client->blocks_by_dev);
+  g_hash_table_destroy (client->blocks_by_drive);
+  g_hash_table_destroy (client->partitions_by_table);
+  g_hash_table_destroy (client->jobs_by_object);
+  g_hash_table_destroy (client->index);
+  g_mutex_clear (&client->index_lock);
+
   G_OBJECT_CLASS (udisks_client_parent_class)->finalize (object);
 }
 
+static void
+index_entry_free (IndexEntry *entry)
+{
+  g_free (entry->label);
+  g_free (entry->uuid);
+  g_free (entry->drive);
+  g_free (entry->table);
+  g_strfreev (entry->job_objects);
+  g_free (entry);
+}
+
 static void
 udisks_client_init (UDisksClient *client)
 {
@@ -171,6 +219,22 @@ udisks_client_init (UDisksClient *client)
    */
   udisks_error_domain = UDISKS_ERROR;
   udisks_error_domain; /* shut up -Wunused-but-set-variable */
+
+  g_mutex_init (&client->index_lock);
+  client->index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                         g_object_unref, (GDestroyNotify) index_entry_free);
+  client->blocks_by_label = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free, (GDestroyNotify) g_hash_table_unref);
+  client->blocks_by_uuid = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, (GDestroyNotify) g_hash_table_unref);
+  client->blocks_by_dev = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+                                                 g_free, (GDestroyNotify) g_hash_table_unref);
+  client->blocks_by_drive = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free, (GDestroyNotify) g_hash_table_unref);
+  client->partitions_by_table = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                       g_free, (GDestroyNotify) g_hash_table_unref);
+  client->jobs_by_object = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                  g_free, (GDestroyNotify) g_hash_table_unref);
 }
 
 static void
@@ -516,6 +580,7 @@ initable_init (GInitable     *initable,
           init_interface_proxy (client, G_DBUS_PROXY (ll->data));
         }
       g_list_free_full (interfaces, g_object_unref);
+      update_index (client, UDISKS_OBJECT (l->data));
     }
   g_list_free_full (objects, g_object_unref);
 
@@ -682,6 +747,167 @@ udisks_client_peek_object (UDisksClient  *client,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* called with index_lock held, takes ownership of @key */
+static void
+index_add (GHashTable   *index,
+           gpointer      key,
+           UDisksObject *object)
+{
+  GHashTable *objects;
+
+  objects = g_hash_table_lookup (index, key);
+  if (objects == NULL)
+    {
+      objects = g_hash_table_new (g_direct_hash, g_direct_equal);
+      g_hash_table_insert (index, key, objects);
+    }
+  else
+    {
+      g_free (key);
+    }
+  g_hash_table_add (objects, object);
+}
+
+/* called with index_lock held */
+static void
+index_remove (GHashTable    *index,
+              gconstpointer  key,
+              UDisksObject  *object)
+{
+  GHashTable *objects;
+
+  objects = g_hash_table_lookup (index, key);
+  if (objects == NULL)
+    return;
+
+  g_hash_table_remove (objects, object);
+  if (g_hash_table_size (objects) == 0)
+    g_hash_table_remove (index, key);
+}
+
+/* returns a list of referenced objects */
+static GList *
+index_lookup (UDisksClient  *client,
+              GHashTable    *index,
+              gconstpointer  key)
+{
+  GHashTable *objects;
+  GList *ret = NULL;
+
+  g_mutex_lock (&client->index_lock);
+  objects = g_hash_table_lookup (index, key);
+  if (objects != NULL)
+    {
+      ret = g_hash_table_get_keys (objects);
+      g_list_foreach (ret, (GFunc) g_object_ref, NULL);
+    }
+  g_mutex_unlock (&client->index_lock);
+
+  return ret;
+}
+
+/* called with index_lock held */
+static void
+index_entry_remove_keys (UDisksClient *client,
+                         UDisksObject *object,
+                         IndexEntry   *entry)
+{
+  guint n;
+
+  if (entry->has_block)
+    {
+      index_remove (client->blocks_by_label, entry->label, object);
+      index_remove (client->blocks_by_uuid, entry->uuid, object);
+      index_remove (client->blocks_by_dev, &entry->dev, object);
+    }
+  if (entry->drive != NULL)
+    index_remove (client->blocks_by_drive, entry->drive, object);
+  if (entry->table != NULL)
+    index_remove (client->partitions_by_table, entry->table, object);
+  for (n = 0; entry->job_objects != NULL && entry->job_objects[n] != NULL; n++)
+    index_remove (client->jobs_by_object, entry->job_objects[n], object);
+}
+
+static void
+remove_from_index (UDisksClient *client,
+                   UDisksObject *object)
+{
+  IndexEntry *entry;
+
+  g_mutex_lock (&client->index_lock);
+  entry = g_hash_table_lookup (client->index, object);
+  if (entry != NULL)
+    {
+      index_entry_remove_keys (client, object, entry);
+      g_hash_table_remove (client->index, object);
+    }
+  g_mutex_unlock (&client->index_lock);
+}
+
+/* (Re-)indexes @object according to its current interfaces and properties */
+static void
+update_index (UDisksClient *client,
+              UDisksObject *object)
+{
+  UDisksBlock *block;
+  UDisksPartition *partition;
+  UDisksJob *job;
+  IndexEntry *entry;
+  IndexEntry *old_entry;
+  const gchar *value;
+  guint n;
+
+  block = udisks_object_peek_block (object);
+  partition = udisks_object_peek_partition (object);
+  job = udisks_object_peek_job (object);
+
+  if (block == NULL && partition == NULL && job == NULL)
+    {
+      remove_from_index (client, object);
+      return;
+    }
+
+  entry = g_new0 (IndexEntry, 1);
+  if (block != NULL)
+    {
+      entry->has_block = TRUE;
+      value = udisks_block_get_id_label (block);
+      entry->label = g_strdup (value != NULL ? value : "");
+      value = udisks_block_get_id_uuid (block);
+      entry->uuid = g_strdup (value != NULL ? value : "");
+      entry->dev = udisks_block_get_device_number (block);
+      if (partition == NULL)
+        entry->drive = g_strdup (udisks_block_get_drive (block));
+    }
+  if (partition != NULL)
+    entry->table = g_strdup (udisks_partition_get_table (partition));
+  if (job != NULL)
+    entry->job_objects = g_strdupv ((gchar **) udisks_job_get_objects (job));
+
+  g_mutex_lock (&client->index_lock);
+  /* drop the old keys first, g_hash_table_replace() frees the old entry */
+  old_entry = g_hash_table_lookup (client->index, object);
+  if (old_entry != NULL)
+    index_entry_remove_keys (client, object, old_entry);
+  g_hash_table_replace (client->index, g_object_ref (object), entry);
+
+  if (entry->has_block)
+    {
+      index_add (client->blocks_by_label, g_strdup (entry->label), object);
+      index_add (client->blocks_by_uuid, g_strdup (entry->uuid), object);
+      index_add (client->blocks_by_dev, g_memdup2 (&entry->dev, sizeof (entry->dev)), object);
+    }
+  if (entry->drive != NULL)
+    index_add (client->blocks_by_drive, g_strdup (entry->drive), object);
+  if (entry->table != NULL)
+    index_add (client->partitions_by_table, g_strdup (entry->table), object);
+  for (n = 0; entry->job_objects != NULL && entry->job_objects[n] != NULL; n++)
+    index_add (client->jobs_by_object, g_strdup (entry->job_objects[n]), object);
+  g_mutex_unlock (&client->index_lock);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 /**
  * udisks_client_get_block_for_label:
  * @client: A #UDisksClient.
@@ -698,28 +924,20 @@ udisks_client_get_block_for_label (UDisksClient        *client,
                                    const gchar         *label)
 {
   GList *ret = NULL;
-  GList *l, *object_proxies = NULL;
+  GList *l, *objects;
 
   g_return_val_if_fail (UDISKS_IS_CLIENT (client), NULL);
   g_return_val_if_fail (label != NULL, NULL);
 
-  object_proxies = g_dbus_object_manager_get_objects (client->object_manager);
-  for (l = object_proxies; l != NULL; l = l->next)
+  objects = index_lookup (client, client->blocks_by_label, label);
+  for (l = objects; l != NULL; l = l->next)
     {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
-
-      block = udisks_object_get_block (object);
-      if (block == NULL)
-        continue;
-
-      if (g_strcmp0 (udisks_block_get_id_label (block), label) == 0)
+      UDisksBlock *block = udisks_object_get_block (UDISKS_OBJECT (l->data));
+      if (block != NULL)
         ret = g_list_prepend (ret, block);
-      else
-        g_object_unref (block);
     }
 
-  g_list_free_full (object_proxies, g_object_unref);
+  g_list_free_full (objects, g_object_unref);
   ret = g_list_reverse (ret);
   return ret;
 }
@@ -742,28 +960,20 @@ udisks_client_get_block_for_uuid (UDisksClient        *client,
                                   const gchar         *uuid)
 {
   GList *ret = NULL;
-  GList *l, *object_proxies = NULL;
+  GList *l, *objects;
 
   g_return_val_if_fail (UDISKS_IS_CLIENT (client), NULL);
   g_return_val_if_fail (uuid != NULL, NULL);
 
-  object_proxies = g_dbus_object_manager_get_objects (client->object_manager);
-  for (l = object_proxies; l != NULL; l = l->next)
+  objects = index_lookup (client, client->blocks_by_uuid, uuid);
+  for (l = objects; l != NULL; l = l->next)
     {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
-
-      block = udisks_object_get_block (object);
-      if (block == NULL)
-        continue;
-
-      if (g_strcmp0 (udisks_block_get_id_uuid (block), uuid) == 0)
+      UDisksBlock *block = udisks_object_get_block (UDISKS_OBJECT (l->data));
+      if (block != NULL)
         ret = g_list_prepend (ret, block);
-      else
-        g_object_unref (block);
     }
 
-  g_list_free_full (object_proxies, g_object_unref);
+  g_list_free_full (objects, g_object_unref);
   ret = g_list_reverse (ret);
   return ret;
 }
@@ -787,30 +997,16 @@ udisks_client_get_block_for_dev (UDisksClient *client,
                                  dev_t         block_device_number)
 {
   UDisksBlock *ret = NULL;
-  GList *l, *object_proxies = NULL;
+  GList *l, *objects;
+  guint64 dev = block_device_number;
 
   g_return_val_if_fail (UDISKS_IS_CLIENT (client), NULL);
 
-  object_proxies = g_dbus_object_manager_get_objects (client->object_manager);
-  for (l = object_proxies; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
-
-      block = udisks_object_get_block (object);
-      if (block == NULL)
-        continue;
-
-      if (udisks_block_get_device_number (block) == block_device_number)
-        {
-          ret = block;
-          goto out;
-        }
-      g_object_unref (block);
-    }
+  objects = index_lookup (client, client->blocks_by_dev, &dev);
+  for (l = objects; l != NULL && ret == NULL; l = l->next)
+    ret = udisks_object_get_block (UDISKS_OBJECT (l->data));
 
- out:
-  g_list_free_full (object_proxies, g_object_unref);
+  g_list_free_full (objects, g_object_unref);
   return ret;
 }
 
@@ -841,34 +1037,9 @@ get_top_level_blocks_for_drive (UDisksClient *client,
                                 const gchar  *drive_object_path)
 {
   GList *ret;
-  GList *l;
-  GList *object_proxies;
-  GDBusObjectManager *object_manager;
 
-  object_manager = udisks_client_get_object_manager (client);
-  object_proxies = g_dbus_object_manager_get_objects (object_manager);
-
-  ret = NULL;
-  for (l = object_proxies; l != NULL; l = l->next)
-    {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksBlock *block;
-      UDisksPartition *partition;
-
-      block = udisks_object_get_block (object);
-      partition = udisks_object_peek_partition (object);
-      if (block == NULL)
-        continue;
-
-      if (g_strcmp0 (udisks_block_get_drive (block), drive_object_path) == 0 &&
-          partition == NULL)
-        {
-          ret = g_list_append (ret, g_object_ref (object));
-        }
-      g_object_unref (block);
-    }
+  ret = index_lookup (client, client->blocks_by_drive, drive_object_path);
   ret = g_list_sort (ret, compare_blocks_by_device);
-  g_list_free_full (object_proxies, g_object_unref);
   return ret;
 }
 
@@ -1397,7 +1568,7 @@ udisks_client_get_partitions (UDisksClient         *client,
   GList *ret = NULL;
   GDBusObject *table_object;
   const gchar *table_object_path;
-  GList *l, *object_proxies = NULL;
+  GList *l, *objects = NULL;
 
   g_return_val_if_fail (UDISKS_IS_CLIENT (client), NULL);
   g_return_val_if_fail (UDISKS_IS_PARTITION_TABLE (table), NULL);
@@ -1407,24 +1578,16 @@ udisks_client_get_partitions (UDisksClient         *client,
     goto out;
   table_object_path = g_dbus_object_get_object_path (table_object);
 
-  object_proxies = g_dbus_object_manager_get_objects (client->object_manager);
-  for (l = object_proxies; l != NULL; l = l->next)
+  objects = index_lookup (client, client->partitions_by_table, table_object_path);
+  for (l = objects; l != NULL; l = l->next)
     {
-      UDisksObject *object = UDISKS_OBJECT (l->data);
-      UDisksPartition *partition;
-
-      partition = udisks_object_get_partition (object);
-      if (partition == NULL)
-        continue;
-
-      if (g_strcmp0 (udisks_partition_get_table (partition), table_object_path) == 0)
-        ret = g_list_prepend (ret, g_object_ref (partition));
-
-      g_object_unref (partition);
+      UDisksPartition *partition = udisks_object_get_partition (UDISKS_OBJECT (l->data));
+      if (partition != NULL)
+        ret = g_list_prepend (ret, partition);
     }
   ret = g_list_reverse (ret);
  out:
-  g_list_free_full (object_proxies, g_object_unref);
+  g_list_free_full (objects, g_object_unref);
   return ret;
 }
 
@@ -1534,38 +1697,23 @@ udisks_client_get_jobs_for_object (UDisksClient  *client,
 {
   GList *ret = NULL;
   const gchar *object_path;
-  GList *l, *object_proxies = NULL;
-
-  /* TODO: this is probably slow. Can optimize by maintaining a hash-table from object path to UDisksJob* */
+  GList *l, *job_objects;
 
   g_return_val_if_fail (UDISKS_IS_CLIENT (client), NULL);
   g_return_val_if_fail (UDISKS_IS_OBJECT (object), NULL);
 
   object_path = g_dbus_object_get_object_path (G_DBUS_OBJECT (object));
 
-  object_proxies = g_dbus_object_manager_get_objects (client->object_manager);
-  for (l = object_proxies; l != NULL; l = l->next)
+  job_objects = index_lookup (client, client->jobs_by_object, object_path);
+  for (l = job_objects; l != NULL; l = l->next)
     {
-      UDisksObject *job_object = UDISKS_OBJECT (l->data);
-      UDisksJob *job;
-
-      job = udisks_object_get_job (job_object);
+      UDisksJob *job = udisks_object_get_job (UDISKS_OBJECT (l->data));
       if (job != NULL)
-        {
-          const gchar *const *object_paths;
-          guint n;
-          object_paths = udisks_job_get_objects (job);
-          for (n = 0; object_paths != NULL && object_paths[n] != NULL; n++)
-            {
-              if (g_strcmp0 (object_paths[n], object_path) == 0)
-                ret = g_list_prepend (ret, g_object_ref (job));
-            }
-          g_object_unref (job);
-        }
+        ret = g_list_prepend (ret, job);
     }
   ret = g_list_reverse (ret);
 
-  g_list_free_full (object_proxies, g_object_unref);
+  g_list_free_full (job_objects, g_object_unref);
   return ret;
 }
 
@@ -1641,6 +1789,8 @@ on_object_added (GDBusObjectManager  *manager,
     }
   g_list_free_full (interfaces, g_object_unref);
 
+  update_index (client, UDISKS_OBJECT (object));
+
   udisks_client_queue_changed (client);
 }
 
@@ -1650,6 +1800,7 @@ on_object_removed (GDBusObjectManager  *manager,
                    gpointer             user_data)
 {
   UDisksClient *client = UDISKS_CLIENT (user_data);
+  remove_from_index (client, UDISKS_OBJECT (object));
   udisks_client_queue_changed (client);
 }
 
@@ -1671,6 +1822,8 @@ on_interface_added (GDBusObjectManager  *manager,
 
   init_interface_proxy (client, G_DBUS_PROXY (interface));
 
+  update_index (client, UDISKS_OBJECT (object));
+
   udisks_client_queue_changed (client);
 }
 
@@ -1681,6 +1834,7 @@ on_interface_removed (GDBusObjectManager  *manager,
                       gpointer             user_data)
 {
   UDisksClient *client = UDISKS_CLIENT (user_data);
+  update_index (client, UDISKS_OBJECT (object));
   udisks_client_queue_changed (client);
 }
 
@@ -1698,6 +1852,10 @@ on_interface_proxy_properties_changed (GDBusObjectManagerClient   *manager,
   GVariantIter iter;
   gchar *property_name = NULL;
 
+  /* only these carry indexed properties */
+  if (UDISKS_IS_BLOCK (interface_proxy) || UDISKS_IS_PARTITION (interface_proxy))
+    update_index (client, UDISKS_OBJECT (object_proxy));
+
   /* never emit the change signal for Job objects */
   if (g_strcmp0 (g_dbus_proxy_get_interface_name (interface_proxy), "org.freedesktop.UDisks2.Drive.Job") == 0)
     return;